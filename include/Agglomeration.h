@@ -0,0 +1,95 @@
+#pragma once
+
+#include "PoissonSolver.h"
+
+class SolverCG;
+
+/**
+ * @class Agglomeration
+ * @brief Solves the Poisson problem on a coarser grid of processes when the local domains are too small for the solve to scale.
+ *
+ * Once local domains become small, every conjugate gradient iteration is dominated by the latency of its halo exchanges and global
+ * reductions rather than by computation. The \f$ p \times p \f$ processes are then grouped into \f$ q \times q \f$ blocks of
+ * neighbouring processes, with \f$ q < p \f$ chosen so that each block holds at least the requested number of grid points. The first
+ * process of each block gathers the right hand side and initial guess of its block, the \f$ q^2 \f$ gathering processes solve the
+ * Poisson problem on their own Cartesian grid, and the solution is scattered back. All other processes wait for the solution.
+ *
+ * The union of the local domains of a block is a rectangle, since process \f$ (i,j) \f$ belongs to block
+ * \f$ (\lfloor iq/p \rfloor, \lfloor jq/p \rfloor) \f$, so the gathering process solves a regular local domain. Registered as the
+ * "pcg-agglomerated" backend of PoissonSolver.
+ ***********************************************************************************************************************************/
+class Agglomeration : public PoissonSolver
+{
+public:
+    /**
+     * @brief Constructor that creates the groups of processes and the solver of the coarser process grid
+     * @note Collective over cartGrid
+     * @param[in] cartGrid  Cartesian communicator of the \f$ p \times p \f$ processes, as created by LidDrivenCavity
+     * @param[in] q         Number of processes along each dimension of the coarser grid, less than p
+     * @param[in] xStart    Global index of the first local grid point in x direction
+     * @param[in] yStart    Global index of the first local grid point in y direction
+     * @param[in] pNx       Number of local grid points in x direction
+     * @param[in] pNy       Number of local grid points in y direction
+     * @param[in] dx        Grid spacing in x direction
+     * @param[in] dy        Grid spacing in y direction
+     ***********************************************************************************************************************************/
+    Agglomeration(MPI_Comm cartGrid, int q, int xStart, int yStart, int pNx, int pNy, double dx, double dy);
+
+    /**
+     * @brief Destructor to deallocate memory and free communicators
+     ***********************************************************************************************************************************/
+    ~Agglomeration();
+
+    void SetVerbose(bool pVerbose);     ///<Enable or disable printing the iteration count of each solve, as SolverCG::SetVerbose
+    void SetTolerance(double absolute, double relative, double initial);   ///<Specify when each solve stops, as SolverCG::SetTolerance
+    void Reset();                       ///<Restore the state after construction, as SolverCG::Reset
+    int GetIterations();                ///<Get the number of iterations taken by the latest call to Solve
+    double GetResidual();               ///<Get the 2-norm of the final residual of the latest call to Solve
+    bool IsGathering();                 ///<Get whether this process gathers and solves for its block
+
+    /**
+     * @brief Choose the number of processes along each dimension so every process holds at least minPoints grid points
+     * @param[in] globalNpts    Number of global grid points
+     * @param[in] p             Number of processes along each dimension
+     * @param[in] minPoints     Minimum number of grid points per process, 0 to never agglomerate
+     * @return Number of processes along each dimension, p if no agglomeration is needed
+     ***********************************************************************************************************************************/
+    static int ChooseGridSize(int globalNpts, int p, int minPoints);
+
+protected:
+    /**
+     * @brief Solve \f$ -\nabla^2 x = b \f$ on the coarser process grid, as SolverCG::Solve
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] b         Local right hand side
+     * @param[in,out] x     On input, local initial guess; on output the local solution
+     ***********************************************************************************************************************************/
+    void DoSolve(double* b, double* x);
+
+private:
+    int Npts;                               ///<Number of local grid points of this process
+    MPI_Comm comm_block;                    ///<MPI communicator of the processes of the block of this process, rank 0 gathers
+    int blockSize;                          ///<Number of processes in the block
+    bool gathering;                         ///<This process gathers and solves for its block
+
+    //only allocated on gathering processes
+    MPI_Comm comm_agg = MPI_COMM_NULL;      ///<Cartesian communicator of the gathering processes
+    MPI_Comm comm_agg_row = MPI_COMM_NULL;  ///<Row communicator of #comm_agg
+    MPI_Comm comm_agg_col = MPI_COMM_NULL;  ///<Column communicator of #comm_agg
+    SolverCG* cg = nullptr;                 ///<Solver on the local domain of the block
+    int aggNx = 0;                          ///<Number of grid points of the block in x direction
+    int aggNy = 0;                          ///<Number of grid points of the block in y direction
+    int* blocks = nullptr;                  ///<Start and size in x and y of the local domain of each process of the block, relative to the block
+    int* gatherCounts = nullptr;            ///<Values gathered from each process, right hand side and initial guess
+    int* gatherDispls = nullptr;            ///<Offset of values gathered from each process
+    int* scatterCounts = nullptr;           ///<Values scattered to each process, solution, iterations and residual
+    int* scatterDispls = nullptr;           ///<Offset of values scattered to each process
+    double* aggB = nullptr;                 ///<Right hand side on the block
+    double* aggX = nullptr;                 ///<Solution on the block
+    double* gatherBuffer = nullptr;         ///<Packed right hand sides and initial guesses of the block
+    double* scatterBuffer = nullptr;        ///<Packed solutions of the block
+
+    double* sendBuffer = nullptr;           ///<Packed local right hand side and initial guess
+    double* recvBuffer = nullptr;           ///<Local solution, followed by iterations and residual
+    int iterations = 0;                     ///<Iterations of the latest solve
+    double residual = 0.0;                  ///<Residual of the latest solve
+};
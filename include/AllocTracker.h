@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @class AllocTracker
+ * @brief Counts heap allocations made through the global operator new and malloc, to check that phases of the solver do not allocate.
+ *
+ * Only linked into the unit tests, where it replaces every form of the global operator new and delete, and malloc, calloc and
+ * realloc. While counting is active, allocations of all threads are counted, so allocations within OpenMP parallel regions are
+ * included. Calls of malloc, calloc and realloc are only counted when made by the code of the executable: those made inside the MPI
+ * and BLAS libraries and the OpenMP runtime are not, since the MPI library allocates internally, also from its own progress threads
+ * at arbitrary times.
+ ***********************************************************************************************************************************/
+class AllocTracker
+{
+public:
+    /**
+     * @brief Reset the counters and start counting allocations
+     ***********************************************************************************************************************************/
+    static void Start();
+
+    /**
+     * @brief Stop counting allocations
+     * @return Number of allocations since Start
+     ***********************************************************************************************************************************/
+    static long Stop();
+
+    static long GetCount();                 ///<Get the number of allocations counted since Start
+    static long GetBytes();                 ///<Get the number of bytes allocated since Start
+
+    /**
+     * @brief Count an allocation if counting is active, called by the replacement operator new
+     * @param[in] bytes     Size of the allocation
+     ***********************************************************************************************************************************/
+    static void Record(std::size_t bytes);
+};
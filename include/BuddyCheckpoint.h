@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @class BuddyCheckpoint
+ * @brief Diskless in-memory checkpoints, where each process keeps a copy of its own vorticity and streamfunction and a copy of
+ * the data of a buddy process that lives on a different node.
+ *
+ * Processes are arranged into a ring that interleaves the nodes, so that every process sends its local data to the next process
+ * in the ring (its partner) and receives the data of the previous process in the ring (its buddy). A checkpoint therefore costs two
+ * memory copies and one point-to-point exchange. At a lower frequency, the own and buddy copies are written to node-local storage
+ * (e.g. /dev/shm) by a background thread, so that the time integration is never stalled by the file system.
+ *
+ * @note If a node is lost, the data of its processes can still be recovered from the flushed buddy copies on the partner nodes
+ * @note Only one process per node is required for node diversity; if all processes share a node, the ring still provides a copy
+ * on a different process
+ ***********************************************************************************************************************************/
+class BuddyCheckpoint
+{
+public:
+    /**
+     * @brief Constructor that sets up the buddy ring and the background flush thread
+     * @param[in] pNpts             Number of local grid points, i.e. size of the local vorticity and streamfunction arrays
+     * @param[in] pComm             MPI communicator containing all processes that take part in the checkpoint
+     * @param[in] pDir              Directory on node-local storage that the checkpoints are flushed to
+     * @param[in] pFlushInterval    Flush to storage every pFlushInterval checkpoints, 0 to never flush
+     ***********************************************************************************************************************************/
+    BuddyCheckpoint(int pNpts, MPI_Comm &pComm, std::string pDir, int pFlushInterval);
+
+    /**
+     * @brief Describe the problem the data belongs to, written into every flushed file so that Recover refuses files of another case
+     * @param[in] pGlobalNx     Number of global grid points in x direction
+     * @param[in] pGlobalNy     Number of global grid points in y direction
+     * @param[in] pLx           Length of global domain in x direction
+     * @param[in] pLy           Length of global domain in y direction
+     * @param[in] pDt           Time step
+     * @param[in] pRe           Reynolds number
+     ***********************************************************************************************************************************/
+    void SetProblem(int pGlobalNx, int pGlobalNy, double pLx, double pLy, double pDt, double pRe);
+
+    /**
+     * @brief Destructor that waits for any outstanding flush and deallocates memory
+     ***********************************************************************************************************************************/
+    ~BuddyCheckpoint();
+
+    /**
+     * @brief Take an in-memory checkpoint of the local data and exchange it with the buddy processes
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] v         Local vorticity
+     * @param[in] s         Local streamfunction
+     * @param[in] step      Time step that the data describes
+     ***********************************************************************************************************************************/
+    void Store(double* v, double* s, int step);
+
+    /**
+     * @brief Recover the local data from the flushed checkpoints
+     *
+     * Each process reads its own flushed checkpoint; if it is missing or does not agree with the rest of the processes, the copy held
+     * by the partner process is used instead. A file written for a different problem, see SetProblem, counts as missing.
+     * @note Collective over the communicator passed to the constructor
+     * @param[out] v        Local vorticity
+     * @param[out] s        Local streamfunction
+     * @param[out] step     Time step that the recovered data describes
+     * @return True if every process recovered a consistent checkpoint, otherwise false and outputs are left untouched
+     ***********************************************************************************************************************************/
+    bool Recover(double* v, double* s, int &step);
+
+    /**
+     * @brief Hand the latest in-memory checkpoint to the background thread to be written to storage, whatever the flush interval
+     ***********************************************************************************************************************************/
+    void Flush();
+
+    /**
+     * @brief Block until the background thread has finished writing the latest flush
+     ***********************************************************************************************************************************/
+    void WaitForFlush();
+
+    int GetPartnerRank();       ///<Get rank of process that holds a copy of the local data, -1 if there is none
+    int GetBuddyRank();         ///<Get rank of process whose data is held by this process, -1 if there is none
+    int GetStep();              ///<Get time step of latest in-memory checkpoint, -1 if none has been taken
+
+private:
+    int Npts;                               ///<Number of local grid points
+    int buddyNpts;                          ///<Number of local grid points of the buddy process
+    int rank;                               ///<Rank of current process in #comm
+    int partnerRank;                        ///<Rank of process that local data is sent to
+    int buddyRank;                          ///<Rank of process that data is received from
+    int step = -1;                          ///<Time step of latest checkpoint
+    int buddyStep = -1;                     ///<Time step of latest checkpoint received from buddy
+    int storeCount = 0;                     ///<Number of checkpoints taken so far
+    int flushInterval;                      ///<Flush to storage every flushInterval checkpoints
+    std::string dir;                        ///<Directory for the flushed checkpoints
+    int globalN[2] = {0, 0};                ///<Global grid size of the problem, see SetProblem
+    double problem[4] = {0.0, 0.0, 0.0, 0.0};   ///<Domain lengths, time step and Reynolds number of the problem, see SetProblem
+
+    MPI_Comm comm;                          ///<MPI communicator of the processes taking part in the checkpoint
+    MPI_Request requests[2];                ///<MPI_Request handles -> [0] = send to partner, [1] = receive from buddy
+
+    double* own = nullptr;                  ///<In-memory copy of local v followed by s
+    double* buddy = nullptr;                ///<In-memory copy of buddy v followed by s
+    double* ownFlush = nullptr;             ///<Copy of #own that the background thread writes out
+    double* buddyFlush = nullptr;           ///<Copy of #buddy that the background thread writes out
+    int flushStep;                          ///<Time step of data being flushed
+    int flushBuddyStep;                     ///<Time step of buddy data being flushed
+
+    std::thread flushThread;                ///<Background thread that writes checkpoints to storage
+    std::mutex flushMutex;                  ///<Protects #flushPending and #flushExit
+    std::condition_variable flushCond;      ///<Signals the background thread and waiting callers
+    bool flushPending = false;              ///<Denotes that a flush has been requested and is not yet complete
+    bool flushExit = false;                 ///<Denotes that the background thread should terminate
+
+    /**
+     * @brief Set up the ring of processes interleaved across nodes and assign #partnerRank and #buddyRank
+     ***********************************************************************************************************************************/
+    void CreateRing();
+
+    /**
+     * @brief Loop run by the background thread, writing the flush buffers to storage whenever a flush is requested
+     ***********************************************************************************************************************************/
+    void FlushLoop();
+
+    /**
+     * @brief Read a flushed checkpoint file of this process into #ownFlush and #buddyFlush, which are idle once the flush is waited for
+     * @param[out] ownStep      Time step of own data in file
+     * @param[out] heldStep     Time step of buddy data in file
+     * @return True if the file exists and matches the local problem size and the problem, see SetProblem
+     ***********************************************************************************************************************************/
+    bool ReadFile(int &ownStep, int &heldStep);
+
+    /**
+     * @brief Name of the flushed checkpoint file of this process
+     ***********************************************************************************************************************************/
+    std::string FileName();
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Outcome of one configuration of CavityBenchmark::Run
+ */
+struct BenchmarkResult {
+    double Re;                                      ///<Reynolds number
+    int N;                                          ///<Number of grid points in each direction
+    std::string solver;                             ///<Name of the Poisson solver configuration
+    double dtFraction;                              ///<Time step as a fraction of the explicit stability limit
+    double dt;                                      ///<Time step
+    int steps;                                      ///<Time steps taken until steady state or the maximum time
+    double timeToTolerance;                         ///<Simulated time from which the error stayed below the tolerance, negative if never
+    double wallToTolerance;                         ///<Wall time of integration until then, negative if never
+    double steadyTime;                              ///<Simulated time when steady state was detected, negative if never
+    double wallTime;                                ///<Wall time of the whole integration
+    double error;                                   ///<Final maximum error of the centre-line velocities
+    bool diverged;                                  ///<Solution became non-finite
+};
+
+/**
+ * @class CavityBenchmark
+ * @brief Time-to-accuracy benchmark of the lid driven cavity against the centre-line velocities of Ghia, Ghia & Shin (1982).
+ *
+ * Each configuration integrates the unit cavity towards steady state and gathers the solution every check interval. The horizontal
+ * velocity along \f$ x = 0.5 \f$ and the vertical velocity along \f$ y = 0.5 \f$ are interpolated bilinearly at the tabulated points,
+ * and the largest deviation from the reference is the error. The benchmark records the simulated and wall time from which the error
+ * stays below the tolerance, so configurations are compared by the cost of a given accuracy rather than by steps per second.
+ * Steady state is reached once the sampled velocities change by less than the steady tolerance per unit time.
+ *
+ * Only the wall time of time integration is counted, gathering and checking the solution is excluded.
+ ***********************************************************************************************************************************/
+class CavityBenchmark
+{
+public:
+    /**
+     * @brief Constructor
+     * @param[in] pComm     MPI communicator of the processes solving each configuration, a square number of processes
+     ***********************************************************************************************************************************/
+    CavityBenchmark(MPI_Comm pComm);
+
+    /**
+     * @brief Read the reference velocities of a Reynolds number from a table in the format of test/GhiaRefData
+     * @param[in] file      Name of the reference data file
+     * @param[in] Re        Reynolds number, one of the columns of the file
+     * @return True if the file could be read and holds the Reynolds number
+     ***********************************************************************************************************************************/
+    bool LoadReference(std::string file, double Re);
+
+    /**
+     * @brief Maximum error of the centre-line velocities of a global solution against the loaded reference
+     * @param[in] u0    Horizontal velocity at all global grid points of the unit square, x varying fastest
+     * @param[in] u1    Vertical velocity at all global grid points
+     * @param[in] Nx    Number of global grid points in x direction
+     * @param[in] Ny    Number of global grid points in y direction
+     ***********************************************************************************************************************************/
+    double ProfileError(const double* u0, const double* u1, int Nx, int Ny);
+
+    /**
+     * @brief Integrate one configuration of the loaded Reynolds number to steady state, or to the maximum time
+     * @note Collective over the communicator passed to the constructor, the result is valid on all processes
+     * @param[in] N             Number of grid points in each direction
+     * @param[in] solver        Poisson solver configuration, one of #Solvers
+     * @param[in] dtFraction    Time step as a fraction of StableTimeStep
+     ***********************************************************************************************************************************/
+    BenchmarkResult Run(int N, std::string solver, double dtFraction);
+
+    /**
+     * @brief Explicit stability limit of the time step on the unit cavity with unit lid velocity
+     *
+     * The smallest of the diffusive limit \f$ h^2 Re/4 \f$ checked by LidDrivenCavity, the limit \f$ 2/Re \f$ of central differences
+     * for advection with forward Euler, and the advective limit \f$ h \f$.
+     * @param[in] N     Number of grid points in each direction
+     * @param[in] Re    Reynolds number
+     ***********************************************************************************************************************************/
+    static double StableTimeStep(int N, double Re);
+
+    /**
+     * @brief Print a result as a row of a table on the root process
+     * @param[in] result    Result of Run
+     * @param[in] header    Print the column headings first
+     ***********************************************************************************************************************************/
+    void Print(const BenchmarkResult& result, bool header);
+
+    /**
+     * @brief Append a result to a CSV file on the root process, writing the column headings if the file is new
+     * @param[in] result    Result of Run
+     * @param[in] file      Name of the CSV file
+     ***********************************************************************************************************************************/
+    void AppendCsv(const BenchmarkResult& result, std::string file);
+
+    void SetTolerance(double tol);          ///<Specify the error of the centre-line velocities to measure the time to. 0.02 by default
+    void SetSteadyTolerance(double tol);    ///<Specify the change of the velocities per unit time considered steady. 1e-4 by default
+    void SetCheckInterval(double interval); ///<Specify the simulated time between checks of the solution. 0.5 by default
+    void SetMaxTime(double time);           ///<Specify the simulated time at which a configuration is stopped. 60 by default
+
+    static const std::vector<std::string> Solvers;  ///<Poisson solver configurations accepted by Run
+    static constexpr double AdaptiveRelative = 1e-6;    ///<Tolerance relative to the vorticity of pcg-adaptive, see LidDrivenCavity::SetAdaptiveTolerance
+    static constexpr double AdaptiveStep = 1e-3;        ///<Tolerance relative to the vorticity change over the step of pcg-adaptive
+
+private:
+    MPI_Comm comm;                          ///<MPI communicator of the processes solving each configuration
+    int rank;                               ///<Rank of current process in #comm
+    double Re = 100.0;                      ///<Reynolds number of the loaded reference
+    double tolerance = 0.02;                ///<Error to measure the time to
+    double steadyTolerance = 1e-4;          ///<Change of the velocities per unit time considered steady
+    double checkInterval = 0.5;             ///<Simulated time between checks
+    double maxTime = 60.0;                  ///<Simulated time at which a configuration is stopped
+
+    std::vector<double> uY;                 ///<Reference points along x = 0.5
+    std::vector<double> uRef;               ///<Reference horizontal velocity at #uY
+    std::vector<double> vX;                 ///<Reference points along y = 0.5
+    std::vector<double> vRef;               ///<Reference vertical velocity at #vX
+
+    /**
+     * @brief Sample the centre-line velocities of a global solution at the reference points, u first and then v
+     * @param[in] u0        Horizontal velocity at all global grid points, x varying fastest
+     * @param[in] u1        Vertical velocity at all global grid points
+     * @param[in] Nx        Number of global grid points in x direction
+     * @param[in] Ny        Number of global grid points in y direction
+     * @param[out] samples  Velocities at the #uY and then the #vX reference points
+     ***********************************************************************************************************************************/
+    void Sample(const double* u0, const double* u1, int Nx, int Ny, std::vector<double>& samples);
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @class CavityConfig
+ * @brief Physical and numerical parameters of a lid driven cavity run, validated as a whole before any communicator, decomposition
+ * or field exists, and then applied to LidDrivenCavity by LidDrivenCavity::Configure with a single decomposition of the domain
+ *
+ * The parameters are fixed on construction, so a configuration that has been validated cannot change before it is applied.
+ ***********************************************************************************************************************************/
+class CavityConfig
+{
+public:
+    /**
+     * @brief Constructor that sets all parameters, without checking them
+     * @param[in] pLx       Length of global domain in x direction
+     * @param[in] pLy       Length of global domain in y direction
+     * @param[in] pNx       Number of global grid points in x direction
+     * @param[in] pNy       Number of global grid points in y direction
+     * @param[in] pdt       Time step
+     * @param[in] pT        Final time
+     * @param[in] pRe       Reynolds number
+     * @param[in] pTheta    Implicitness of the time stepping, 0 for explicit, see LidDrivenCavity::SetImplicit
+     ***********************************************************************************************************************************/
+    CavityConfig(double pLx = 1.0, double pLy = 1.0, int pNx = 9, int pNy = 9, double pdt = 0.01, double pT = 1.0, double pRe = 10,
+                 double pTheta = 0.0);
+
+    /**
+     * @brief Check the parameters against each other and the number of processes, without communication or allocation
+     * @param[in] p     Number of processes along each direction of the Cartesian grid
+     * @return Message describing the first invalid parameter, starting with the number of processes, empty if all are valid
+     ***********************************************************************************************************************************/
+    std::string Validate(int p) const;
+
+    /**
+     * @brief Check that every process of a grid of p x p processes gets enough of the grid, which Validate checks first
+     * @param[in] p     Number of processes along each direction of the Cartesian grid
+     ***********************************************************************************************************************************/
+    bool FitsProcesses(int p) const;
+
+    /**
+     * @brief Get the largest stable time step of explicit diffusion, infinite from Crank-Nicolson (theta of 0.5) on
+     ***********************************************************************************************************************************/
+    double GetMaxTimeStep() const;
+
+    double GetLx() const;                   ///<Get length of global domain in x direction
+    double GetLy() const;                   ///<Get length of global domain in y direction
+    int GetNx() const;                      ///<Get number of global grid points in x direction
+    int GetNy() const;                      ///<Get number of global grid points in y direction
+    double GetDt() const;                   ///<Get the time step
+    double GetT() const;                    ///<Get the final time
+    double GetRe() const;                   ///<Get the Reynolds number
+    double GetTheta() const;                ///<Get the implicitness of the time stepping
+
+private:
+    double Lx;                              ///<Length of global domain in x direction
+    double Ly;                              ///<Length of global domain in y direction
+    int Nx;                                 ///<Number of global grid points in x direction
+    int Ny;                                 ///<Number of global grid points in y direction
+    double dt;                              ///<Time step
+    double T;                               ///<Final time
+    double Re;                              ///<Reynolds number
+    double theta;                           ///<Implicitness of the time stepping
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+/**
+ * @class CostModel
+ * @brief Predicts memory, communication volume, conjugate gradient iterations and wall time of a run before it is executed.
+ *
+ * The number of conjugate gradient iterations per time step is estimated from the condition number of the discretised operator
+ * \f$ -\nabla^2 \f$ on the grid, using the classical bound \f$ k \approx \frac{\sqrt{\kappa}}{2}\ln\frac{2}{\epsilon} \f$, where the
+ * reduction \f$ \epsilon \f$ of the residual follows the stopping rule of SolverCG, see SetTolerance. The cost
+ * of each iteration is built from the local grid points, halo messages and global reductions of a \f$ p \times p \f$ decomposition,
+ * with the cost per grid point, message latency and bandwidth taken from a short micro-benchmark on the nodes the job runs on.
+ *
+ * @note Only the base solver is modelled; checkpoints, snapshots and rendering add to the memory and time predicted
+ ***********************************************************************************************************************************/
+class CostModel
+{
+public:
+    /**
+     * @brief Constructor that describes the global problem
+     * @param[in] pGlobalNx     Number of global grid points in x direction
+     * @param[in] pGlobalNy     Number of global grid points in y direction
+     * @param[in] pLx           Length of global domain in x direction
+     * @param[in] pLy           Length of global domain in y direction
+     * @param[in] pDt           Time step size
+     * @param[in] pT            Final time
+     ***********************************************************************************************************************************/
+    CostModel(int pGlobalNx, int pGlobalNy, double pLx, double pLy, double pDt, double pT);
+
+    /**
+     * @brief Calibrate the model with a micro-benchmark of the stencil and vector operations of the solver and of point-to-point
+     * messages, run on all processes at once so that contention for memory bandwidth is included
+     * @note Collective over comm, takes a fraction of a second
+     * @param[in] comm      MPI communicator of all processes of the job
+     ***********************************************************************************************************************************/
+    void Calibrate(MPI_Comm comm);
+
+    /**
+     * @brief Specify the Poisson tolerances of the run, as passed to SolverCG::SetTolerance, by default the absolute 1e-6 only
+     *
+     * SolverCG stops once the residual is below the largest of the bounds, so the reduction of the residual over a solve is that
+     * bound divided by the initial residual. The initial residual of a solve started from the previous streamfunction is the change
+     * of the vorticity over the step, taken as #InitialResidual, and the vorticity as #VorticityNorm.
+     * @param[in] absolute  Bound on the 2-norm of the residual
+     * @param[in] relative  Bound relative to the 2-norm of the right hand side, 0 to disable
+     * @param[in] initial   Bound relative to the 2-norm of the initial residual, 0 to disable
+     ***********************************************************************************************************************************/
+    void SetTolerance(double absolute, double relative = 0.0, double initial = 0.0);
+
+    double GetConditionNumber();            ///<Get condition number of the discretised operator on the global grid
+    int EstimateIterations();               ///<Get expected conjugate gradient iterations per time step
+
+    /**
+     * @brief Estimate peak memory of the busiest process, which is reached while writing the solution
+     * @param[in] p     Number of processes along each direction of the Cartesian grid
+     * @return Memory in bytes
+     ***********************************************************************************************************************************/
+    long long EstimateMemory(int p);
+
+    /**
+     * @brief Estimate the halo data sent by the busiest process in each time step
+     * @param[in] p     Number of processes along each direction of the Cartesian grid
+     * @return Data sent in bytes
+     ***********************************************************************************************************************************/
+    long long EstimateHaloBytes(int p);
+
+    /**
+     * @brief Estimate the wall time of a time step, requires Calibrate
+     * @param[in] p         Number of processes along each direction of the Cartesian grid
+     * @param[in] threads   Number of OpenMP threads per process
+     * @return Time in seconds
+     ***********************************************************************************************************************************/
+    double EstimateStepTime(int p, int threads);
+
+    /**
+     * @brief Estimate the wall time of the whole time integration, requires Calibrate
+     * @param[in] p         Number of processes along each direction of the Cartesian grid
+     * @param[in] threads   Number of OpenMP threads per process
+     * @return Time in seconds
+     ***********************************************************************************************************************************/
+    double EstimateWallTime(int p, int threads);
+
+    /**
+     * @brief Print the calibration, the prediction for the current configuration and the predicted time of every split of the
+     * available cores into \f$ p^2 \f$ processes and threads, marking the fastest one that fits into memory
+     * @note Call on the root process only, after Calibrate
+     * @param[in] p         Number of processes along each direction of the current Cartesian grid
+     * @param[in] threads   Number of OpenMP threads per process in the current configuration
+     ***********************************************************************************************************************************/
+    void Report(int p, int threads);
+
+private:
+    int globalNx;                           ///<Number of global grid points in x direction
+    int globalNy;                           ///<Number of global grid points in y direction
+    double dx;                              ///<Grid spacing in x direction
+    double dy;                              ///<Grid spacing in y direction
+    int NSteps;                             ///<Number of time steps
+    int outputChunk = 8;                    ///<Columns gathered at once by LidDrivenCavity::WriteSolution, as its default
+    double absoluteTol = 1e-6;              ///<Bound on the residual norm of each solve, see SetTolerance
+    double relativeTol = 0.0;               ///<Bound on the residual norm relative to the norm of the right hand side
+    double initialTol = 0.0;                ///<Bound on the residual norm relative to the norm of the initial residual
+
+    static constexpr double InitialResidual = 2e-3; ///<Typical 2-norm of the initial residual of a solve, measured on the cavity at Re = 100
+    static constexpr double VorticityNorm = 10.0;   ///<Typical 2-norm of the vorticity, the right hand side of a solve, measured alike
+
+    double pointCostSerial = 0.0;           ///<Time per grid point per conjugate gradient iteration with one thread
+    double pointCostThreaded = 0.0;         ///<Time per grid point per conjugate gradient iteration with #benchThreads threads
+    int benchThreads = 1;                   ///<Number of threads the threaded benchmark was run with
+    double latency = 0.0;                   ///<Point-to-point message latency in seconds
+    double byteCost = 0.0;                  ///<Point-to-point time per byte in seconds (inverse bandwidth)
+    int nodes = 1;                          ///<Number of nodes of the job
+    int coresPerNode = 1;                   ///<Number of hardware threads of each node
+    long long memoryPerNode = 0;            ///<Physical memory of each node in bytes
+
+    /**
+     * @brief Local grid points along one direction of the busiest process, as distributed by LidDrivenCavity::SplitDomainMPI
+     ***********************************************************************************************************************************/
+    int LocalPoints(int globalN, int p);
+
+    /**
+     * @brief Model of the time per grid point per iteration with a number of threads, from the parallel efficiency measured by
+     * the benchmark
+     ***********************************************************************************************************************************/
+    double PointCost(int threads);
+
+    /**
+     * @brief Run the benchmark kernel, one conjugate gradient iteration worth of work, on an n x n grid
+     * @return Time per grid point per iteration in seconds
+     ***********************************************************************************************************************************/
+    double BenchmarkKernel(int n, int threads);
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <csignal>
+#include <mpi.h>
+
+/**
+ * @class Deadline
+ * @brief Decides, the same on all processes, at which time step boundary a run stops early, either before its wall-clock budget runs
+ * out or after a termination signal such as the one batch systems send ahead of the time limit.
+ *
+ * Update is called after every time step. It measures the step time and decides locally whether to stop: once a signal has been
+ * received, or once the steps still fitting in the remaining budget, less a margin for the final checkpoint, drop below two. The local
+ * decisions are combined by a non-blocking reduction that overlaps with the next step, so all processes learn the outcome at the same
+ * step boundary, one step after any of them asked to stop, without a blocking collective per step.
+ *
+ * @note The signal handlers only set a flag, which is async-signal-safe, and restart interrupted system calls so MPI is unaffected
+ ***********************************************************************************************************************************/
+class Deadline
+{
+public:
+    /**
+     * @brief Reasons for stopping, larger values take precedence when processes disagree
+     */
+    enum Reason {
+        None = 0,                       ///<Run continues
+        Budget,                         ///<Wall-clock budget is about to run out
+        Signal                          ///<Termination signal received
+    };
+
+    /**
+     * @brief Constructor that starts counting step times
+     * @note Collective over pComm
+     * @param[in] pComm     MPI communicator of all processes of the run
+     * @param[in] pEnd      MPI_Wtime by which the run must have stopped, 0 for no budget
+     * @param[in] pMargin   Seconds kept free before pEnd for the final checkpoint and output
+     ***********************************************************************************************************************************/
+    Deadline(MPI_Comm pComm, double pEnd, double pMargin);
+
+    /**
+     * @brief Destructor that completes the outstanding reduction
+     * @note Collective over the communicator passed to the constructor
+     ***********************************************************************************************************************************/
+    ~Deadline();
+
+    /**
+     * @brief Record the end of a time step and decide whether the run stops at this step boundary
+     * @note Collective over the communicator passed to the constructor
+     * @return True on all processes at the same step boundary once any process asked to stop
+     ***********************************************************************************************************************************/
+    bool Update();
+
+    Reason GetReason();                 ///<Get why the run stopped, None until Update returned true
+    int GetStopSignal();                ///<Get the stop signal received by any process once the run stopped for a signal
+    double GetStepTime();               ///<Get the smoothed wall time per time step on this process in seconds
+
+    /**
+     * @brief Install handlers of SIGTERM and SIGUSR1 that ask the run to stop
+     ***********************************************************************************************************************************/
+    static void InstallSignalHandlers();
+
+    static int GetSignal();             ///<Get the latest stop signal received by this process, 0 if none
+
+private:
+    MPI_Comm comm;                          ///<Duplicate of the communicator of the run, so the reduction never matches other collectives
+    double end;                             ///<MPI_Wtime by which the run must have stopped, 0 for no budget
+    double margin;                          ///<Seconds kept free before #end
+    double last;                            ///<MPI_Wtime of the previous step boundary
+    double stepTime = 0.0;                  ///<Exponential average of the step time
+    int steps = 0;                          ///<Step boundaries recorded
+    int local[2] = {None, 0};               ///<Local decision and stop signal of the outstanding reduction
+    int agreed[2] = {None, 0};              ///<Decision and stop signal of all processes, reduced with MPI_MAX
+    bool pending = false;                   ///<A reduction has been started and not yet completed
+    MPI_Request request;                    ///<Handle of the outstanding reduction
+    Reason reason = None;                   ///<Reason the run stopped
+
+    static volatile sig_atomic_t stopSignal;    ///<Latest stop signal received, set by the handler
+
+    static void Handler(int sig);           ///<Signal handler recording the signal in #stopSignal
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @class EnergyMeter
+ * @brief Measures the package energy of phases of the solver with the Linux RAPL powercap counters.
+ *
+ * One process per node reads the energy counter of every package zone under the powercap directory, since the counters describe the
+ * whole node. Counters wrap around at their maximum range, so every reading accumulates the difference to the previous one into a
+ * monotonic total; as the phases are started and stopped at least once per time step, no wrap around is missed. Phases may be nested
+ * (e.g. Solve within Integrate), each phase accumulates its own energy, wall time and units of work, so the energy per time step or
+ * per conjugate gradient iteration can be reported.
+ *
+ * @note If the counters are missing or not readable (reading requires privileges on recent kernels), only wall times are reported
+ ***********************************************************************************************************************************/
+class EnergyMeter
+{
+public:
+    /**
+     * @brief Phases that energy is measured for
+     */
+    enum Phase {
+        Integrate = 0,                  ///<Time integration, units of work are time steps
+        Solve,                          ///<Poisson solves, units of work are conjugate gradient iterations
+        IO,                             ///<Output of solutions, snapshots and images, units of work are calls
+        NumPhases                       ///<Number of phases
+    };
+
+    /**
+     * @brief Constructor that finds the package zones on each node
+     * @note Collective over pComm
+     * @param[in] pComm     MPI communicator of all processes of the run
+     * @param[in] pRoot     Powercap directory, /sys/class/powercap by default
+     ***********************************************************************************************************************************/
+    EnergyMeter(MPI_Comm pComm, std::string pRoot = "/sys/class/powercap");
+
+    /**
+     * @brief Start measuring a phase
+     * @param[in] phase     Phase to start
+     ***********************************************************************************************************************************/
+    void Start(Phase phase);
+
+    /**
+     * @brief Stop measuring a phase and add the energy, wall time and work since Start to the phase
+     * @param[in] phase     Phase to stop
+     * @param[in] units     Units of work done in the phase since Start
+     ***********************************************************************************************************************************/
+    void Stop(Phase phase, long long units = 1);
+
+    int GetNumZones();                      ///<Get number of package zones read by this process, zero on all but one process per node
+    double GetEnergy(Phase phase);          ///<Get energy of a phase on the node of this process in joules
+    double GetTime(Phase phase);            ///<Get wall time of a phase on this process in seconds
+    long long GetUnits(Phase phase);        ///<Get units of work of a phase
+
+    /**
+     * @brief Sum the energy of every node and print energy, average power and energy per unit of work of each phase on the root
+     * process, optionally appending a line per phase to a CSV file to compare configurations between runs
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] label     Description of the configuration, e.g. processes, threads, precision and solver
+     * @param[in] file      CSV file to append to on the root process, empty for none
+     ***********************************************************************************************************************************/
+    void Report(std::string label, std::string file = "");
+
+private:
+    MPI_Comm comm;                                  ///<MPI communicator of all processes of the run
+    int rank;                                       ///<Rank of current process in #comm
+    std::vector<std::string> zones;                 ///<Path of energy counter of each package zone
+    std::vector<long long> maxRange;                ///<Maximum value of each counter in microjoules, after which it wraps
+    std::vector<long long> last;                    ///<Latest value read from each counter in microjoules
+    long long accumulated = 0;                      ///<Energy of all zones since construction in microjoules, never wraps
+
+    long long startEnergy[NumPhases] = {};          ///<#accumulated when each phase was started
+    double startTime[NumPhases] = {};               ///<Wall time when each phase was started
+    long long energy[NumPhases] = {};               ///<Energy of each phase in microjoules
+    double time[NumPhases] = {};                    ///<Wall time of each phase in seconds
+    long long units[NumPhases] = {};                ///<Units of work of each phase
+
+    /**
+     * @brief Read every counter and add the energy since the previous reading to #accumulated, accounting for wrap around
+     ***********************************************************************************************************************************/
+    void Sample();
+
+    /**
+     * @brief Read a single integer from a sysfs file
+     * @return Value read, -1 if the file could not be read
+     ***********************************************************************************************************************************/
+    static long long ReadValue(const std::string& file);
+};
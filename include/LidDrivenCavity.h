@@ -3,7 +3,18 @@
 #include <string>
 using namespace std;
 
+#include "PoissonSolver.h"
+#include "CavityConfig.h"
+
+class BuddyCheckpoint;
+class SnapshotWriter;
+class Renderer;
+class MetricsServer;
+class EnergyMeter;
+class Tracers;
+class StreamingPOD;
 class SolverCG;
+class Deadline;
 
 /**
  * @class LidDrivenCavity
@@ -42,6 +53,12 @@ public:
      * @brief Constructor that sets up the MPI implementation of this class
      *******************************************************************************************************************************************/
     LidDrivenCavity();
+
+    /**
+     * @brief Constructor that sets up the MPI implementation of this class on a subset of the processes
+     * @param[in] pComm     MPI communicator of the processes solving this problem, of size \f$ p^2 \f$
+     *******************************************************************************************************************************************/
+    LidDrivenCavity(MPI_Comm pComm);
     
     /**
      * @brief Destructor to deallocate memory
@@ -84,6 +101,7 @@ public:
     double GetT();                      ///<Get the final time T
     double GetDx();                     ///<Get the x direction step size dx
     double GetDy();                     ///<Get the y direction step size dy
+    int GetStep();                      ///<Get the current time step
     /**@}*/
 
     /**
@@ -94,6 +112,38 @@ public:
      ************************************************************************************************************************************************/
     void GetData(double* vOut, double* sOut);
 
+    /**
+     * @brief Get the local state as written by WriteSolution, i.e. the latest vorticity and streamfunction
+     * @note It is assumed that the user will provide the correct array sizes 
+     * @param[out] vOut    Vorticity at all grid points
+     * @param[out] sOut    Streamfunction at all grid points
+     ************************************************************************************************************************************************/
+    void GetState(double* vOut, double* sOut);
+
+    /**
+     * @brief Set the local state to integrate from, as returned by GetState, and restart the time step count from zero
+     * @note Requires Initialise to have been called
+     * @param[in] vIn      Vorticity at all grid points
+     * @param[in] sIn      Streamfunction at all grid points
+     ************************************************************************************************************************************************/
+    void SetState(double* vIn, double* sIn);
+
+    /**
+     * @brief Gather the global solution, as written by WriteSolution, onto rank 0 of the communicator passed to the constructor
+     * @note Collective. Output arrays have #globalNx x #globalNy points with x varying fastest, and are only accessed on rank 0
+     * @param[out] vOut    Vorticity at all global grid points
+     * @param[out] sOut    Streamfunction at all global grid points
+     * @param[out] u0Out   Horizontal velocity at all global grid points
+     * @param[out] u1Out   Vertical velocity at all global grid points
+     ************************************************************************************************************************************************/
+    void GatherSolution(double* vOut, double* sOut, double* u0Out, double* u1Out);
+
+    /**
+     * @brief Enable or disable progress output of Integrate and SolverCG on the root process, enabled by default
+     * @param[in] pVerbose  True to print progress
+     ************************************************************************************************************************************************/
+    void SetVerbose(bool pVerbose);
+
     /**
      * @brief Specify the problem domain size \f$ (x,y)\in[0,xlen]\times[0,ylen] \f$ and recomputes grid spacing \f$ dx \f$ and \f$ dy \f$
      * @note This takes in values for the global domain
@@ -109,6 +159,18 @@ public:
      * @param[in] ny    Number of grid points in the y direction in global domain
      */
     void SetGridSize(int nx, int ny);
+
+    /**
+     * @brief Specify the domain size, grid size, time step, final time, Reynolds number and implicitness at once
+     *
+     * The local domain is split once, when Initialise or a getter of the local domain first needs it, rather than by every setter.
+     * @note The configuration is not checked here, reject it beforehand by CavityConfig::Validate; PrintConfiguration still
+     * terminates the program if the time step is unstable
+     * @param[in] config    Configuration of the global domain
+     */
+    void Configure(const CavityConfig& config);
+
+    CavityConfig GetConfig();           ///<Get the current configuration of the global domain
     
     /**
      * @brief Specify the time step for the solver
@@ -128,11 +190,53 @@ public:
      */
     void SetReynoldsNumber(double Re);
 
+    /**
+     * @brief Enable diskless buddy checkpoints during time integration, see BuddyCheckpoint
+     * @note Takes effect when Initialise is called
+     * @param[in] interval          Take an in-memory checkpoint every interval time steps, 0 to disable
+     * @param[in] flush             Flush the in-memory checkpoints to node-local storage every flush checkpoints, 0 to never flush
+     * @param[in] dir               Directory on node-local storage for the flushed checkpoints
+     */
+    void SetCheckpoint(int interval, int flush, std::string dir);
+
+    /**
+     * @brief Resume from the latest flushed buddy checkpoint, either periodic in the checkpoint directory or of a run stopped early in
+     * the resume directory, see SetResumeDir, restoring vorticity, streamfunction and time step
+     * @note Must be called after Initialise, collective over all processes
+     * @return True if a consistent checkpoint was recovered on all processes, otherwise false and the solver state is unchanged
+     */
+    bool RecoverCheckpoint();
+
+    /**
+     * @brief Specify where the checkpoint of a run stopped early is flushed to, see SetWalltime, the working directory by default
+     * @param[in] dir       Directory on persistent or shared storage, which outlives the job unlike node-local checkpoint directories
+     */
+    void SetResumeDir(std::string dir);
+
+    /**
+     * @brief Stop time integration early, before a wall-clock budget runs out, at a time step boundary agreed by all processes, and
+     * flush a buddy checkpoint of that step to the resume directory that RecoverCheckpoint resumes from, see Deadline and SetResumeDir
+     * @note Takes effect when Initialise is called
+     * @param[in] budget    Wall time in seconds from this call that the run may take, 0 to disable (default)
+     * @param[in] margin    Seconds kept free at the end of the budget for the checkpoint and output
+     */
+    void SetWalltime(double budget, double margin = 30.0);
+
+    /**
+     * @brief Stop time integration early as SetWalltime once SIGTERM or SIGUSR1 is received, as batch systems send ahead of the time limit
+     * @note Takes effect when Initialise is called, the signal handlers are installed for the whole process
+     * @param[in] enable    True to stop on signals
+     */
+    void SetStopOnSignal(bool enable);
+
+    bool IsStopped();                   ///<Get whether the latest time integration stopped early, see SetWalltime and SetStopOnSignal
+    std::string GetStopReason();        ///<Get why the latest time integration stopped early, empty if it did not
+
     /**
      * @brief Initialise solver
      * 
      * Solver initialised by allocating memory and creating the initial condition, with vorticity and streamfunction zero everywhere.
-     * The spatial solver of class SolverCG is also created.
+     * The Poisson solver backend is also selected and created, see SetPoissonSolver.
      */
     void Initialise();
     
@@ -142,17 +246,185 @@ public:
      * Execute the time domain solver from 0 to T in steps of dt. Calls the spatial domain solver at each time step. Also displays progress of the solver.
      */ 
     void Integrate();
+
+    /**
+     * @brief Integrate from the current time step until a given time step, regardless of the final time T
+     * @param[in] finalStep     Time step to stop at
+     */
+    void IntegrateTo(int finalStep);
     
     /**
      * @brief Print grid position \f$ (x,y) \f$, voriticity, streamfunction and velocities to a text file with the specified name. 
      * 
      * If the specified file does not exist, then it will create a text file with the specified name and output data there.
+     * Each process column is gathered onto its bottom process in chunks of columns with non-blocking gathers, so the next chunk is in
+     * flight while the current one is formatted and written, and no process holds more than two chunks. Velocities are computed
+     * from the streamfunction as each chunk is packed.
      * @param[in] file      name of the target text file
      */ 
     void WriteSolution(std::string file);
+
+    /**
+     * @brief Specify the number of grid columns gathered at once by WriteSolution. 8 by default
+     * @param[in] columns   Columns per chunk, at least 1
+     */
+    void SetOutputChunk(int columns);
+
+    /**
+     * @brief Write snapshots of vorticity, streamfunction and velocities into an indexed binary snapshot file, see SnapshotWriter
+     * @note Takes effect when Initialise is called, which creates (or overwrites) the file
+     * @param[in] file      Name of the snapshot file, empty to disable
+     * @param[in] interval  Append a snapshot every interval time steps during Integrate, 0 to only write snapshots on request
+     */
+    void SetSnapshotOutput(std::string file, int interval);
+
+    /**
+     * @brief Append the current vorticity, streamfunction and velocities to the snapshot file set by SetSnapshotOutput.
+     * 
+     * Each process writes its local data directly into the file, so nothing is gathered. A time step already in the file is not written again.
+     */
+    void WriteSnapshot();
+
+    /**
+     * @brief Enable in-situ rendering of vorticity and streamfunction contours into downsampled PPM images, see Renderer
+     * @note Takes effect when Initialise is called. Image height follows from the domain aspect ratio
+     * @param[in] prefix    Images are written to prefix_<step>.ppm, empty to disable
+     * @param[in] interval  Render a frame every interval time steps during Integrate, 0 to only render on request
+     * @param[in] width     Width of the images in pixels
+     */
+    void SetRendering(std::string prefix, int interval, int width);
+
+    /**
+     * @brief Render the current vorticity and streamfunction into the image prefix_<step>.ppm, if rendering is enabled and the step has not been rendered yet
+     */
+    void RenderFrame();
+
+    /**
+     * @brief Enable passive tracers advected with the flow, see Tracers
+     * @note Takes effect when Initialise is called
+     * @param[in] count     Number of tracers seeded over the global domain, 0 to disable
+     * @param[in] prefix    Positions are written to prefix_<step>.part
+     * @param[in] interval  Write the positions every interval time steps during Integrate, 0 to only write them on request
+     */
+    void SetTracers(long long count, std::string prefix, int interval);
+
+    /**
+     * @brief Write the current tracer positions into prefix_<step>.part, if tracers are enabled and the step has not been written yet
+     *
+     * Each process writes its tracers directly into the file, so nothing is gathered.
+     */
+    void WriteTracers();
+
+    Tracers* GetTracers();              ///<Get the tracers, nullptr if disabled
+
+    /**
+     * @brief Enable the in-situ proper orthogonal decomposition of the vorticity, see StreamingPOD
+     * @note Takes effect when Initialise is called
+     * @param[in] modes         Number of modes kept, also the number of snapshots folded in at once, 0 to disable
+     * @param[in] file          The modes and coefficients are written to this file
+     * @param[in] interval      Add a snapshot every interval time steps during Integrate
+     * @param[in] writeInterval Rewrite the file every writeInterval time steps during Integrate, 0 to only write it on request
+     */
+    void SetPOD(int modes, std::string file, int interval, int writeInterval);
+
+    /**
+     * @brief Write the decomposition of the vorticity snapshots so far into the file set by SetPOD, if enabled and the step has not
+     * been written yet
+     *
+     * Buffered snapshots are folded in first, and each process writes its part of the modes directly into the file.
+     */
+    void WritePOD();
+
+    StreamingPOD* GetPOD();             ///<Get the decomposition, nullptr if disabled
+
+    /**
+     * @brief Expose live progress metrics in Prometheus text format on the root process, see MetricsServer
+     * @note Takes effect when Initialise is called
+     * @param[in] address   TCP port on the loopback interface, or path of a Unix socket prefixed by "unix:", empty to disable
+     */
+    void SetMetricsEndpoint(std::string address);
+
+    /**
+     * @brief Specify the minimum number of grid points per process for the Poisson solve, below which it is agglomerated onto fewer
+     * processes, see Agglomeration. 1024 by default
+     * @note Takes effect when Initialise is called
+     * @param[in] minPoints     Minimum number of grid points per process, 0 to never agglomerate
+     */
+    void SetAgglomeration(int minPoints);
+
+    bool IsAgglomerated();              ///<Get whether the Poisson solve is agglomerated onto fewer processes
+
+    /**
+     * @brief Select the backend of the Poisson solve, see PoissonSolver
+     *
+     * "auto" recommends a backend from the number of grid points per process, see PoissonSolver::Recommend, and "measure" times a
+     * trial solve of every backend that applies to the grid and keeps the fastest, see PoissonSolver::Measure. A registered backend
+     * that does not apply to the grid, such as "pcg-agglomerated" with enough points per process, falls back to "pcg".
+     * @note Takes effect when Initialise is called
+     * @param[in] name  "auto" (default), "measure" or the name of a registered backend
+     * @return False if the name is unknown, leaving the selection unchanged
+     */
+    bool SetPoissonSolver(std::string name);
+
+    std::string GetPoissonSolver();     ///<Get the name of the Poisson solver backend in use, empty before Initialise
+
+    /**
+     * @brief Enable or disable computing the initial residual of the Poisson solve in the same sweep as the time advanced vorticity,
+     * see SolverCG::SolveFromResidual. Enabled by default, only used by backends that accept an initial residual
+     * @param[in] enable    True to fuse
+     */
+    void SetFusedResidual(bool enable);
+
+    /**
+     * @brief Stop each Poisson solve once accurate enough for the time step, instead of at the fixed residual of 1e-6, see
+     * SolverCG::SetTolerance
+     *
+     * A solve stops at whichever is reached first of the fixed residual, a fraction of the 2-norm of the vorticity and a fraction of
+     * the residual of the previous streamfunction, so these fractions only ever loosen the fixed residual. The residual of the previous
+     * streamfunction is the change of the vorticity over the step, which the time-discretisation error of the step is proportional
+     * to, so the solve is not more accurate than the step. Both fractions are loosened tenfold at the first time step and tightened
+     * geometrically to their values over the transient steps.
+     * @param[in] relative          Fraction of the norm of the vorticity, 0 to disable
+     * @param[in] stepFactor        Fraction of the residual of the previous streamfunction, 0 to disable
+     * @param[in] transientSteps    Number of steps over which the fractions are tightened, 0 for none
+     */
+    void SetAdaptiveTolerance(double relative, double stepFactor, int transientSteps);
+
+    /**
+     * @brief Advance vorticity and streamfunction together with the implicit theta method, so the time step is not limited by the
+     * explicit stability restriction
+     *
+     * Each step solves the coupled equations \f$ \omega^{n+1} - \theta\Delta t F(\omega^{n+1},\psi^{n+1}) = \omega^n + (1-\theta)\Delta t
+     * F(\omega^n,\psi^n) \f$ and \f$ A\psi^{n+1} = \omega^{n+1} \f$, with the boundary vorticity of \f$ \psi^{n+1} \f$, by Newton's method.
+     * Each Newton correction is found by flexible GMRES with Jacobian-vector products by finite differences of the residual, so the
+     * Jacobian is never formed. GMRES is preconditioned by the block lower-triangular approximation of the Jacobian without advection:
+     * the vorticity block \f$ I + \theta\Delta t\nu A \f$ is solved by a shifted SolverCG, then the streamfunction block \f$ A \f$ by the
+     * Poisson solver, both to a loose tolerance. The iterations of a step are the GMRES iterations, and its residual the Newton residual.
+     * @param[in] theta         0.5 for Crank-Nicolson, 1 for backward Euler, 0 for the explicit scheme (default)
+     * @param[in] tolerance     Newton stops once the 2-norm of the residual is below this fraction of its value at the start of the step
+     */
+    void SetImplicit(double theta, double tolerance = 1e-6);
+
+    int GetNewtonIterations();          ///<Get the number of Newton iterations of the latest implicit time step
+
+    /**
+     * @brief Enable measurement of package energy with RAPL counters around time integration, Poisson solves and output, see EnergyMeter
+     * @note Takes effect when Initialise is called
+     * @param[in] enable    True to measure energy
+     */
+    void SetEnergyMeasurement(bool enable);
+
+    /**
+     * @brief Print the energy per time step, per conjugate gradient iteration and of output on the root process, if measured, labelled
+     * with the processes, threads, Poisson solver backend and implicitness of the run
+     * @note Collective over the processes of this problem
+     * @param[in] file      CSV file to append the results to, empty for none
+     */
+    void ReportEnergy(std::string file = "");
     
     /**
-     * @brief Print to terminal the current problem specification
+     * @brief Print to terminal the current problem specification, with the requested Poisson solver and, once Initialise has
+     * selected it, the backend in use
      */
     void PrintConfiguration();
 
@@ -161,6 +433,8 @@ private:
     double* vNext = nullptr;                ///<Vorticity at new time step
     double* s   = nullptr;                  ///<Pointer to array describing streamfunction
     double* tmp = nullptr;                  ///<Temporary array
+    double* ux  = nullptr;                  ///<Horizontal velocity, computed for output
+    double* uy  = nullptr;                  ///<Vertical velocity, computed for output
 
     double dt   = 0.01;                     ///<Time step for solver, default 0.01
     double T    = 1.0;                      ///<Final time for solver, default 1
@@ -174,7 +448,10 @@ private:
     double Re   = 10;                       ///<Reynolds number, default 10
     double U    = 1.0;                      ///<Horizontal velocity at top of lid, default 1
     double nu   = 0.1;                      ///<Kinematic viscosity, default 0.1
+    int    step = 0;                        ///<Current time step, reset by Initialise
+    bool   decomposed = false;              ///<The local domain values match the global configuration, see Decompose
 
+    MPI_Comm comm_world;                    ///<MPI communicator of all processes solving this problem, MPI_COMM_WORLD by default
     MPI_Comm comm_Cart_grid;                ///<MPI communicator describing a Cartesian topology grid
     MPI_Comm comm_row_grid;                 ///<MPI communicator for the process row in #comm_Cart_grid
     MPI_Comm comm_col_grid;                 ///<MPI communicator for the process column in #comm_Cart_grid
@@ -210,23 +487,157 @@ private:
     double* tempLeft;                       ///<Temporarily stores data for left hand side of current local grid, to be sent left
     double* tempRight;                      ///<Temporarily stores data for right hand side of current local grid, to be sent right
 
-    SolverCG* cg = nullptr;                 ///<Conjugate gradient solver for Ax=b that can solve spatial domain aspect of the problem
+    PoissonSolver* poisson = nullptr;       ///<Backend solving the Poisson problem of each time step for the streamfunction
+    std::string poissonRequested = "auto";  ///<Requested backend, "auto", "measure" or a registered name
+    std::string poissonSelection;           ///<Request #poisson was selected by, it is reselected when the request changes
+    std::string poissonName;                ///<Name of the backend of #poisson
+    PoissonProblem poissonProblem = {};     ///<Local problem #poisson was created for
+    int agglomerateMinPoints = 1024;        ///<Minimum number of grid points per process for the Poisson solve
+    bool fusedResidual = true;              ///<Compute the initial residual of the Poisson solve with the time advanced vorticity
+    double toleranceRelative = 0.0;         ///<Poisson residual relative to the norm of the vorticity, 0 for the fixed tolerance
+    double toleranceStep = 0.0;             ///<Poisson residual relative to the initial residual, 0 for the fixed tolerance
+    int toleranceTransient = 0;             ///<Steps over which the relative Poisson tolerances are tightened
+    const double TransientLooseness = 10.0; ///<Factor the relative Poisson tolerances are loosened by at the first step
+    int solveIterations = 0;                ///<Conjugate gradient iterations of the latest Poisson solve
+    double solveResidual = 0.0;             ///<Residual of the latest Poisson solve
+
+    double implicitTheta = 0.0;             ///<Implicitness of the theta method, 0 for explicit time stepping, see SetImplicit
+    double newtonTol = 1e-6;                ///<Newton residual relative to its value at the start of the step
+    const double NewtonAbsoluteTol = 1e-10; ///<Newton residual that is converged whatever its value at the start of the step
+    const int NewtonMaxIterations = 20;     ///<Newton iterations after which the step fails
+    const int KrylovDimension = 40;         ///<Most flexible GMRES iterations per Newton iteration
+    const double KrylovTol = 1e-3;          ///<Flexible GMRES residual relative to the Newton residual
+    const double PreconditionerTol = 1e-2;  ///<Residual of the block solves of the preconditioner relative to their right hand sides
+    int newtonIterations = 0;               ///<Newton iterations of the latest implicit step
+    SolverCG* diffusion = nullptr;          ///<Shifted solver of the vorticity block of the preconditioner, created by the first implicit step
+    double* implicitWork = nullptr;         ///<Newton iterate, residuals, Krylov bases, explicit part of the step and Hessenberg system
+
+    BuddyCheckpoint* checkpoint = nullptr;  ///<In-memory buddy checkpoints, only created if #checkpointInterval > 0
+    int checkpointInterval = 0;             ///<Take a checkpoint every checkpointInterval time steps, 0 to disable
+    int flushInterval = 0;                  ///<Flush checkpoints to node-local storage every flushInterval checkpoints
+    std::string checkpointDir = "/dev/shm"; ///<Directory on node-local storage for flushed checkpoints
+    std::string resumeDir = ".";            ///<Directory on persistent storage for the checkpoint of a run stopped early
+
+    Deadline* deadline = nullptr;           ///<Decides when to stop early, only created with a wall-clock budget or stop signals
+    double walltimeBudget = 0.0;            ///<Wall time in seconds the run may take, 0 for no budget
+    double walltimeEnd = 0.0;               ///<MPI_Wtime by which the run must have stopped
+    double walltimeMargin = 30.0;           ///<Seconds kept free at the end of the budget for the checkpoint and output
+    bool stopOnSignal = false;              ///<Stop early on SIGTERM or SIGUSR1
+    bool stopped = false;                   ///<Latest time integration stopped early
+
+    SnapshotWriter* snapshot = nullptr;     ///<Writer for the snapshot file, only created if #snapshotFile is not empty
+    std::string snapshotFile;               ///<Name of the snapshot file
+    int snapshotInterval = 0;               ///<Append a snapshot every snapshotInterval time steps, 0 to disable
+    int lastSnapshotStep = -1;              ///<Time step of the latest snapshot written, prevents duplicates
+
+    Renderer* renderer = nullptr;           ///<In-situ renderer, only created if #renderPrefix is not empty
+    std::string renderPrefix;               ///<Prefix of rendered image files
+    int renderInterval = 0;                 ///<Render a frame every renderInterval time steps, 0 to disable
+    int renderWidth = 256;                  ///<Width of rendered images in pixels
+    int lastRenderStep = -1;                ///<Time step of the latest frame rendered, prevents duplicates
+
+    Tracers* tracers = nullptr;             ///<Passive tracers, only created if #tracerCount > 0
+    long long tracerCount = 0;              ///<Number of tracers seeded over the global domain
+    std::string tracerPrefix;               ///<Prefix of tracer position files
+    int tracerInterval = 0;                 ///<Write tracer positions every tracerInterval time steps, 0 to disable
+    int lastTracerStep = -1;                ///<Time step of the latest tracer positions written, prevents duplicates
+
+    StreamingPOD* pod = nullptr;            ///<Decomposition of the vorticity snapshots, only created if #podModes > 0
+    int podModes = 0;                       ///<Number of modes kept
+    std::string podFile;                    ///<Name of the file of modes and coefficients
+    int podInterval = 1;                    ///<Add a snapshot every podInterval time steps
+    int podWriteInterval = 0;               ///<Rewrite the file every podWriteInterval time steps, 0 to disable
+    int lastPODStep = -1;                   ///<Time step of the latest decomposition written, prevents duplicates
+
+    MetricsServer* metrics = nullptr;       ///<Live metrics endpoint, only created on the root process
+    std::string metricsAddress;             ///<Address of the metrics endpoint, empty to disable
+    bool verbose = true;                    ///<Print progress on the root process
+
+    EnergyMeter* energyMeter = nullptr;     ///<Energy measurement, only created if #measureEnergy is set
+    bool measureEnergy = false;             ///<Measure energy of phases of the solver
+
+    //chunk buffers of WriteSolution, two of each so one chunk is gathered while the other is written, allocated on its first call
+    int outputChunk = 8;                    ///<Grid columns gathered at once by WriteSolution
+    double* chunkSend = nullptr;            ///<Packed vorticity, streamfunction and velocities of two chunks of local columns
+    double* chunkRecv = nullptr;            ///<Two chunks of the whole process column, only on root column processes
+    int* colNy = nullptr;                   ///<Number of local grid points in y direction of each process of the column
+    int* colRecDataNum = nullptr;           ///<Number of values received from each process of the column, for each of the two chunks
+    int* relativeDisp = nullptr;            ///<Offset of the values of each process of the column, for each of the two chunks
 
     /**
      * @brief Deallocate memory associated with arrays and classes
      *****************************************************************************************************************************************/
     void CleanUp();
+
+    /**
+     * @brief Allocate the fields and halo buffers for the local problem
+     *****************************************************************************************************************************************/
+    void Allocate();
+
+    /**
+     * @brief Select and create the Poisson solver backend for the local problem as requested by SetPoissonSolver
+     * @note Collective over #comm_Cart_grid
+     *****************************************************************************************************************************************/
+    void CreatePoissonSolver();
+
+    /**
+     * @brief Deallocate the optional components (checkpoints, snapshots, rendering, tracers, POD, metrics and energy measurement)
+     *****************************************************************************************************************************************/
+    void CleanUpOptional();
+
+    /**
+     * @brief Create a buddy checkpoint of the local data, labelled with the global problem so that recovery refuses other cases
+     * @param[in] dir       Directory of the flushed checkpoints
+     * @param[in] flush     Flush every flush checkpoints, 0 to only flush explicitly
+     *****************************************************************************************************************************************/
+    BuddyCheckpoint* CreateCheckpoint(std::string dir, int flush);
     
     /**
      * @brief Updates spatial steps #dx and #dy based on current grid point numbers (#Nx,#Ny) and domain lengths (#Lx,#Ly)
      ******************************************************************************************************************************************/
     void UpdateDxDy();
+
+    /**
+     * @brief Split the global domain into the local domain of this process, unless already split since the configuration last changed
+     ******************************************************************************************************************************************/
+    void Decompose();
     
     /**
      * @brief Computes vorticity and streamfunction for each grid point in the problem for the next time step
      ******************************************************************************************************************************************/
     void Advance();
 
+    /**
+     * @brief Advance by one implicit time step of the theta method by Jacobian-free Newton-Krylov, see SetImplicit
+     * @note Collective over #comm_Cart_grid
+     ******************************************************************************************************************************************/
+    void AdvanceImplicit();
+
+    /**
+     * @brief Residual of the implicit time step at a vorticity and streamfunction iterate
+     *
+     * The streamfunction part is \f$ A\psi - \omega \f$ and the vorticity part \f$ \omega - \theta\Delta t F(\omega,\psi) \f$ minus the
+     * explicit part of the step, both zero on the global boundary. Leaves \f$ \psi \f$ in #s and \f$ \omega \f$ with the boundary
+     * vorticity of \f$ \psi \f$ in #v.
+     * @param[in] x         Vorticity then streamfunction, 2*Npts values
+     * @param[in] rhs       Explicit part of the step \f$ \omega^n + (1-\theta)\Delta t F(\omega^n,\psi^n) \f$
+     * @param[out] residual Vorticity then streamfunction residual, 2*Npts values
+     ******************************************************************************************************************************************/
+    void ImplicitResidual(const double* x, const double* rhs, double* residual);
+
+    /**
+     * @brief Apply the block lower-triangular preconditioner of the implicit time step, see SetImplicit
+     * @param[in] in        Vorticity then streamfunction residual, 2*Npts values
+     * @param[out] out      Vorticity then streamfunction correction, 2*Npts values, zero on the global boundary
+     ******************************************************************************************************************************************/
+    void ImplicitPrecondition(const double* in, double* out);
+
+    /**
+     * @brief Global dot product of two vorticity and streamfunction vectors of 2*Npts values
+     * @note Collective over #comm_Cart_grid
+     ******************************************************************************************************************************************/
+    double ImplicitDot(const double* a, const double* b);
+
     /**
      * @brief Computes vorticity at the current time step from streamfunction at the current time step
      ******************************************************************************************************************************************/
@@ -234,8 +645,15 @@ private:
 
     /**
      * @brief Computes time advanced vorticity from the vorticity and streamfunction at the current time step
+     *
+     * Optionally also computes the initial residual \f$ r_0 = \omega^{n+1} - A\psi^n \f$ of the following Poisson solve and the squared
+     * norm of \f$ \omega^{n+1} \f$ in the same sweep. As ComputeVorticity leaves \f$ \omega^n = A\psi^n \f$ away from the global
+     * boundary, the residual is \f$ \omega^{n+1} - \omega^n \f$ there and zero on the global boundary.
+     * @param[in] tau   Step the vorticity is advanced by, #dt for the explicit scheme
+     * @param[out] r0   Initial residual of the Poisson solve, nullptr to skip
+     * @param[out] normSquared  Local squared 2-norm of \f$ \omega^{n+1} \f$, only computed with r0
      ******************************************************************************************************************************************/
-    void ComputeTimeAdvanceVorticity();
+    void ComputeTimeAdvanceVorticity(double tau, double* r0 = nullptr, double* normSquared = nullptr);
 
     /**
      * @brief Compute the velocity at all grid points from the streamfunction
@@ -244,6 +662,24 @@ private:
      ******************************************************************************************************************************************/
     void ComputeVelocity(double* u0, double* u1);
 
+    /**
+     * @brief Compute the velocity at one local grid point from the streamfunction, as ComputeVelocity
+     * @note Requires #sTopData and #sRightData to hold the streamfunction of the neighbours above and to the right
+     * @param[in] i     Local index in x direction
+     * @param[in] j     Local index in y direction
+     * @param[out] u0   Horizontal velocity
+     * @param[out] u1   Vertical velocity
+     ******************************************************************************************************************************************/
+    void ComputeVelocityAt(int i, int j, double& u0, double& u1);
+
+    /**
+     * @brief Pack the vorticity, streamfunction and velocity of a chunk of local columns for WriteSolution, column by column
+     * @param[in] i0        First local column of the chunk
+     * @param[in] columns   Number of columns in the chunk
+     * @param[out] buffer   Four values per grid point
+     ******************************************************************************************************************************************/
+    void PackOutputChunk(int i0, int columns, double* buffer);
+
     /**
    * @brief Setup Cartesian grid and column and row communicators
    * @param[out] cartGrid   Communicator for Cartesian grid
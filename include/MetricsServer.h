@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+/**
+ * @class MetricsServer
+ * @brief Exposes the progress of a running simulation in Prometheus text format on a local socket, served by a background thread.
+ *
+ * The solver only stores the latest values into atomic variables with relaxed ordering, so updating the metrics costs a handful of
+ * plain stores and never takes a lock or waits for a client. Derived quantities such as the step rate and the estimated time
+ * remaining are computed by the background thread when a client scrapes the endpoint.
+ *
+ * Any request received on the socket is answered with a minimal HTTP response holding the metrics, so the endpoint can be queried
+ * with e.g. `curl localhost:9100` or `curl --unix-socket ldc.sock http://localhost/metrics`, or scraped by Prometheus directly.
+ * @note Intended to be created on a single process only (the root process)
+ ***********************************************************************************************************************************/
+class MetricsServer
+{
+public:
+    /**
+     * @brief Constructor that opens the socket and starts the background thread
+     * @param[in] address   TCP port on the loopback interface (e.g. "9100"), or path of a Unix socket prefixed by "unix:"
+     ***********************************************************************************************************************************/
+    MetricsServer(std::string address);
+
+    /**
+     * @brief Destructor that stops the background thread and closes the socket
+     ***********************************************************************************************************************************/
+    ~MetricsServer();
+
+    bool IsListening();             ///<Check whether the socket could be opened
+
+    /**
+     * @brief Set the time integration that progress is measured against, resets the step rate
+     * @param[in] pStartStep    Time step the integration starts from
+     * @param[in] pTotalSteps   Time step the integration ends at
+     * @param[in] pDt           Time step size
+     ***********************************************************************************************************************************/
+    void SetRun(int pStartStep, int pTotalSteps, double pDt);
+
+    /**
+     * @brief Record the state after a time step, lock-free
+     * @param[in] pStep         Time step just completed
+     * @param[in] pIterations   Conjugate gradient iterations taken by the time step
+     * @param[in] pResidual     Final conjugate gradient residual of the time step
+     ***********************************************************************************************************************************/
+    void Update(int pStep, int pIterations, double pResidual);
+
+    /**
+     * @brief Format the current metrics in Prometheus text format, as served to clients
+     ***********************************************************************************************************************************/
+    std::string Format();
+
+private:
+    int listenFd = -1;                          ///<File descriptor of the listening socket
+    std::string unixPath;                       ///<Path of the Unix socket, empty for TCP
+    std::thread serveThread;                    ///<Background thread accepting clients
+    std::atomic<bool> serveExit;                ///<Denotes that the background thread should terminate
+
+    std::atomic<int> startStep;                 ///<Time step the integration started from
+    std::atomic<int> totalSteps;                ///<Time step the integration ends at
+    std::atomic<double> dt;                     ///<Time step size
+    std::atomic<int> step;                      ///<Latest time step completed
+    std::atomic<int> iterations;                ///<Conjugate gradient iterations of latest time step
+    std::atomic<long long> iterationsTotal;     ///<Conjugate gradient iterations since the start of the integration
+    std::atomic<double> residual;               ///<Final conjugate gradient residual of latest time step
+    std::atomic<long long> startTime;           ///<Wall time the integration started, in nanoseconds of #clock
+
+    typedef std::chrono::steady_clock clock;    ///<Monotonic clock for step rate and time remaining
+
+    /**
+     * @brief Loop run by the background thread, answering each client with the current metrics
+     ***********************************************************************************************************************************/
+    void ServeLoop();
+
+    /**
+     * @brief Current wall time in nanoseconds of #clock
+     ***********************************************************************************************************************************/
+    static long long Now();
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <string>
+
+class LidDrivenCavity;
+
+/**
+ * @class Parareal
+ * @brief Parallel-in-time integration of the lid driven cavity problem with the Parareal predictor-corrector algorithm.
+ *
+ * The time domain \f$ [0,T] \f$ is split into slices, each owned by a separate group of \f$ p^2 \f$ processes. Each group holds a fine
+ * propagator \f$ \mathcal{F} \f$, which is the usual time stepping of LidDrivenCavity, and a cheap coarse propagator \f$ \mathcal{G} \f$,
+ * which is the same solver with a time step larger by the coarse factor (limited by the time-step restriction). After a coarse
+ * prediction, every iteration runs the fine propagator on all slices concurrently and corrects the slice boundaries sequentially with
+ * \f[ U_{n+1}^{k} = \mathcal{G}(U_n^{k}) + \mathcal{F}(U_n^{k-1}) - \mathcal{G}(U_n^{k-1}) \f]
+ * until the change of the slice boundaries is below the tolerance. After \f$ k \f$ iterations the first \f$ k \f$ slices are exact, so
+ * at most one iteration per slice is needed to reproduce sequential time stepping.
+ *
+ * The state passed between slices is the latest vorticity and the streamfunction, as written by LidDrivenCavity::WriteSolution.
+ * @note Processes with the same rank in their group are assumed to hold the same local domain in every group, which holds since all
+ * groups build identical Cartesian grids
+ ***********************************************************************************************************************************/
+class Parareal
+{
+public:
+    /**
+     * @brief Constructor that splits the processes into one group per time slice, and creates the propagators of this group
+     * @param[in] pSlices   Number of time slices, must divide the number of processes into groups of \f$ p^2 \f$ processes
+     * @param[in] pComm     MPI communicator of all processes
+     ***********************************************************************************************************************************/
+    Parareal(int pSlices, MPI_Comm pComm);
+
+    /**
+     * @brief Destructor to deallocate memory and free communicators
+     ***********************************************************************************************************************************/
+    ~Parareal();
+
+    /**
+     * @defgroup SetPR Set Parareal Problem Parameters
+     * Describe the global problem, as for LidDrivenCavity
+     * @{
+     ***********************************************************************************************************************************/
+    void SetDomainSize(double xlen, double ylen);       ///<Specify the global domain size
+    void SetGridSize(int nx, int ny);                   ///<Specify the global grid size
+    void SetTimeStep(double deltat);                    ///<Specify the time step of the fine propagator
+    void SetFinalTime(double finalt);                   ///<Specify the final time
+    void SetReynoldsNumber(double re);                  ///<Specify the Reynolds number
+    /**@}*/
+
+    /**
+     * @brief Specify how much larger the time step of the coarse propagator is than the fine time step, 10 by default
+     * @note The coarse time step is reduced to satisfy the time-step restriction if necessary
+     ***********************************************************************************************************************************/
+    void SetCoarseFactor(int factor);
+
+    void SetMaxIterations(int iterations);              ///<Specify the maximum number of iterations, 0 (default) for number of slices
+    void SetTolerance(double tol);                      ///<Specify relative change of slice boundaries to stop at, 1e-6 by default
+
+    /**
+     * @brief Print the configuration on the root process and check the time-step restriction and the number of time steps
+     * @note Terminates the program if the configuration is invalid
+     ***********************************************************************************************************************************/
+    void PrintConfiguration();
+
+    /**
+     * @brief Allocate the propagators and the slice boundaries, with zero initial condition
+     ***********************************************************************************************************************************/
+    void Initialise();
+
+    /**
+     * @brief Run the Parareal iterations until converged or the maximum number of iterations is reached
+     * @note Collective over all processes
+     ***********************************************************************************************************************************/
+    void Run();
+
+    /**
+     * @brief Write the solution at the final time, in the same format as LidDrivenCavity::WriteSolution
+     * @note Collective over all processes, the file is written by the group of the last time slice
+     * @param[in] file      Name of the text file
+     ***********************************************************************************************************************************/
+    void WriteSolution(std::string file);
+
+    /**
+     * @brief Print iterations, wall time and speed-up over sequential time stepping on the root process
+     ***********************************************************************************************************************************/
+    void PrintReport();
+
+    /**
+     * @brief Get the local state at the end of the time slice of this group
+     * @param[out] vOut     Vorticity at all local grid points
+     * @param[out] sOut     Streamfunction at all local grid points
+     ***********************************************************************************************************************************/
+    void GetData(double* vOut, double* sOut);
+
+    int GetSlice();                     ///<Get the time slice owned by this process
+    int GetIterations();                ///<Get the number of iterations taken by Run
+    int GetNpts();                      ///<Get the number of local grid points
+    double GetCoarseDt();               ///<Get the time step of the coarse propagator of this group
+    double GetWallTime();               ///<Get the wall time of Run
+    double GetSequentialTime();         ///<Get the wall time of sequential time stepping, as the sum of one fine run of every slice
+    double GetSpeedUp();                ///<Get the speed-up of Run over sequential time stepping
+
+private:
+    int slices;                         ///<Number of time slices
+    int slice;                          ///<Time slice owned by this process
+    int worldRank;                      ///<Rank of current process in #comm
+    MPI_Comm comm;                      ///<MPI communicator of all processes
+    MPI_Comm comm_group;                ///<MPI communicator of the processes of this time slice
+    MPI_Comm comm_time;                 ///<MPI communicator of the processes with the same rank in every group, ranked by time slice
+
+    LidDrivenCavity* fine;              ///<Fine propagator
+    LidDrivenCavity* coarse;            ///<Coarse propagator
+
+    double dt = 0.01;                   ///<Time step of fine propagator
+    double T = 1.0;                     ///<Final time
+    double dx = 0.0;                    ///<Grid spacing in x direction
+    double dy = 0.0;                    ///<Grid spacing in y direction
+    double nu = 0.1;                    ///<Kinematic viscosity
+    double Lx = 1.0;                    ///<Length of global domain in x direction
+    double Ly = 1.0;                    ///<Length of global domain in y direction
+    int globalNx = 9;                   ///<Number of global grid points in x direction
+    int globalNy = 9;                   ///<Number of global grid points in y direction
+    int coarseFactor = 10;              ///<Ratio of coarse to fine time step requested
+    int maxIterations = 0;              ///<Maximum number of iterations, 0 for number of slices
+    double tolerance = 1e-6;            ///<Relative change of slice boundaries to stop at
+
+    int fineSteps = 0;                  ///<Fine time steps of this slice
+    int coarseSteps = 0;                ///<Coarse time steps of this slice
+    double coarseDt = 0.0;              ///<Time step of coarse propagator of this slice
+    int iterations = 0;                 ///<Iterations taken by Run
+    double wallTime = 0.0;              ///<Wall time of Run
+    double sequentialTime = 0.0;        ///<Sum of the fine wall time of every slice
+
+    int Npts = 0;                       ///<Number of local grid points
+    int n = 0;                          ///<Size of local state, vorticity followed by streamfunction
+    double* start = nullptr;            ///<State at start of slice, current iteration
+    double* end = nullptr;              ///<State at end of slice, current iteration
+    double* fineEnd = nullptr;          ///<Fine propagator applied to start of slice of previous iteration
+    double* coarseEnd = nullptr;        ///<Coarse propagator applied to start of slice of previous iteration
+    double* coarseNew = nullptr;        ///<Coarse propagator applied to start of slice of current iteration
+
+    /**
+     * @brief Apply a propagator to the start of the slice
+     * @param[in] solver    Propagator to use
+     * @param[in] nSteps    Number of time steps of the propagator over the slice
+     * @param[in] in        State at start of slice
+     * @param[out] out      State at end of slice
+     ***********************************************************************************************************************************/
+    void Propagate(LidDrivenCavity* solver, int nSteps, double* in, double* out);
+};
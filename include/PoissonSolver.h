@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * @brief Local problem of a Poisson solver backend, as discretised by LidDrivenCavity
+ */
+struct PoissonProblem {
+    int Nx;                                         ///<Number of local grid points in x direction
+    int Ny;                                         ///<Number of local grid points in y direction
+    double dx;                                      ///<Grid spacing in x direction
+    double dy;                                      ///<Grid spacing in y direction
+    int xStart;                                     ///<Global index of the first local grid point in x direction
+    int yStart;                                     ///<Global index of the first local grid point in y direction
+    int globalNx;                                   ///<Number of global grid points in x direction
+    int globalNy;                                   ///<Number of global grid points in y direction
+    int minPoints;                                  ///<Minimum number of grid points per process of agglomerated backends
+    MPI_Comm cartGrid;                              ///<Cartesian communicator of all processes
+    MPI_Comm rowGrid;                               ///<Communicator of the process row in #cartGrid
+    MPI_Comm colGrid;                               ///<Communicator of the process column in #cartGrid
+};
+
+/**
+ * @class PoissonSolver
+ * @brief Interface of the backends solving the Poisson problem \f$ -\nabla^2 x = b \f$ of each time step, and registry to create them by name.
+ *
+ * A backend is set up once for a local problem by its factory, and then solves any number of right hand sides. Solve reports the
+ * iterations, final residual and wall time of the latest solve. The built-in backends are "pcg", SolverCG on all processes,
+ * "pcg-agglomerated", SolverCG on fewer processes through Agglomeration, which only exists when the local domains are small enough,
+ * "schur", the direct SolverSchur, which only exists when its factors fit in memory, and "pcg-tiled", SolverCGTiled with a tile of the
+ * local domain per thread, which only exists when MPI provides MPI_THREAD_MULTIPLE.
+ *
+ * The backend of a problem is either recommended from the local problem size, or measured by timing trial solves of every backend.
+ ***********************************************************************************************************************************/
+class PoissonSolver
+{
+public:
+    /**
+     * @brief Function creating a backend for a local problem
+     * @note Collective over the communicators of the problem
+     * @return New backend, or nullptr on all processes if the backend does not apply to the problem
+     */
+    typedef PoissonSolver* (*Factory)(const PoissonProblem& problem);
+
+    virtual ~PoissonSolver() {}
+
+    /**
+     * @brief Solve \f$ -\nabla^2 x = b \f$ and record the wall time taken
+     * @note Collective over the communicators of the problem
+     * @param[in] b         Local right hand side
+     * @param[in,out] x     On input, local initial guess; on output the local solution
+     ***********************************************************************************************************************************/
+    void Solve(double* b, double* x);
+
+    /**
+     * @brief Solve from an initial residual already written to GetInitialResidual, see SolverCG::SolveFromResidual
+     * @note Only for backends whose GetInitialResidual is not nullptr
+     * @param[in,out] x             On input, initial guess the residual was computed from; on output the local solution
+     * @param[in] bNormSquared      Squared 2-norm of the local right hand side
+     ***********************************************************************************************************************************/
+    void SolveFromResidual(double* x, double bNormSquared);
+
+    /**
+     * @brief Get the storage of the initial residual for SolveFromResidual, nullptr if the backend cannot start from a residual
+     ***********************************************************************************************************************************/
+    virtual double* GetInitialResidual();
+
+    virtual int GetIterations() = 0;        ///<Get the number of iterations taken by the latest solve
+    virtual double GetResidual() = 0;       ///<Get the 2-norm of the final residual of the latest solve
+    double GetSolveTime();                  ///<Get the wall time of the latest solve in seconds
+
+    virtual void SetVerbose(bool pVerbose) = 0;                                         ///<Enable or disable printing the iterations of each solve
+    virtual void SetTolerance(double absolute, double relative, double initial) = 0;   ///<Specify when each solve stops, see SolverCG::SetTolerance
+    virtual void Reset() = 0;               ///<Restore the state after construction, for a new problem of the same size
+
+    /**
+     * @brief Add a backend to the registry, or replace the backend of the same name
+     * @param[in] name      Name of the backend
+     * @param[in] factory   Function creating the backend
+     ***********************************************************************************************************************************/
+    static void Register(std::string name, Factory factory);
+
+    /**
+     * @brief Create a registered backend
+     * @note Collective over the communicators of the problem
+     * @param[in] name      Name of the backend
+     * @param[in] problem   Local problem to solve
+     * @return New backend, or nullptr if the name is unknown or the backend does not apply to the problem
+     ***********************************************************************************************************************************/
+    static PoissonSolver* Create(std::string name, const PoissonProblem& problem);
+
+    static std::vector<std::string> GetNames();     ///<Get the names of all registered backends, built-in ones first
+
+    /**
+     * @brief Recommend a backend from the number of grid points per process
+     *
+     * The conjugate gradient backends take the same iterations for any tolerance, so only the cost of an iteration decides. Below
+     * the minimum number of points per process of the problem, an iteration is bound by the latency of halo exchanges and reductions,
+     * and agglomerating onto fewer processes is faster. The direct backend is only chosen by Measure, as its setup cost and memory
+     * grow faster than the grid.
+     * @param[in] problem   Local problem to solve
+     ***********************************************************************************************************************************/
+    static std::string Recommend(const PoissonProblem& problem);
+
+    /**
+     * @brief Create every registered backend that applies to the problem, time a trial solve of a right hand side with all modes of
+     * the grid to the given tolerance, and keep the fastest
+     * @note Collective over the communicators of the problem, the slowest process decides the time of a backend
+     * @param[in] problem       Local problem to solve
+     * @param[in] tolerance     Absolute tolerance of the trial solves
+     * @param[out] name         Name of the fastest backend
+     * @param[in] verbose       Print the time of each backend on the root process
+     * @return Fastest backend
+     ***********************************************************************************************************************************/
+    static PoissonSolver* Measure(const PoissonProblem& problem, double tolerance, std::string& name, bool verbose);
+
+protected:
+    virtual void DoSolve(double* b, double* x) = 0;                         ///<Solve, see Solve
+
+    /**
+     * @brief Solve from the initial residual, see SolveFromResidual
+     * @note Must be overridden by every backend whose GetInitialResidual is not nullptr, the default terminates the program
+     ***********************************************************************************************************************************/
+    virtual void DoSolveFromResidual(double* x, double bNormSquared);
+
+private:
+    double solveTime = 0.0;                 ///<Wall time of the latest solve
+
+    static std::vector<std::pair<std::string, Factory>>& Registry();       ///<Registered backends, seeded with the built-in ones
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <ctime>
+#include <csignal>
+
+/**
+ * @class Profiler
+ * @brief Sampling profiler that records the call stack of every thread of a process at a fixed rate of CPU time, for use where
+ * external profilers such as perf are not permitted.
+ *
+ * Every OpenMP thread arms its own CPU-time timer, which delivers SIGPROF to that thread only, so all threads are sampled in proportion
+ * to the CPU time they use. The signal handler walks the chain of frame pointers from the registers of the interrupted context into
+ * preallocated storage, reading only the used stack of its own thread, whose top is recorded by Start, and calling no library function,
+ * so it is async-signal-safe whatever the thread was doing; samples beyond the capacity are counted as dropped. Addresses are resolved
+ * to function names when the folded stacks are written, after sampling has stopped.
+ *
+ * The folded stack format has one line per distinct call stack, with frames from the outermost to the innermost separated by
+ * semicolons, followed by the number of samples. Files of all processes can be concatenated and passed to flamegraph.pl to give a
+ * single flame graph of the run.
+ *
+ * @note Stacks are only complete through code compiled with -fno-omit-frame-pointer, as the executable is; a sample interrupted in a
+ * library without frame pointers may skip its caller or end early. Names of functions of the executable are only resolved if it is
+ * linked with -rdynamic. Time spent waiting in MPI is only sampled while the MPI library polls, which is the default of common MPI
+ * implementations. Unwinding is implemented for x86-64 and AArch64, elsewhere only the interrupted function is recorded
+ ***********************************************************************************************************************************/
+class Profiler
+{
+public:
+    /**
+     * @brief Constructor that allocates storage for the samples
+     * @param[in] pFrequency    Samples per second of CPU time of each thread
+     * @param[in] pCapacity     Maximum number of samples stored
+     ***********************************************************************************************************************************/
+    Profiler(int pFrequency = 199, int pCapacity = 1 << 18);
+
+    /**
+     * @brief Destructor to stop sampling and deallocate memory
+     ***********************************************************************************************************************************/
+    ~Profiler();
+
+    /**
+     * @brief Start sampling every OpenMP thread of this process
+     * @note Only one profiler can sample at a time. Must be called outside of a parallel region
+     ***********************************************************************************************************************************/
+    void Start();
+
+    /**
+     * @brief Stop sampling, samples are kept until written
+     ***********************************************************************************************************************************/
+    void Stop();
+
+    /**
+     * @brief Resolve the samples to function names and write them in folded stack format
+     * @param[in] file      Name of the text file
+     ***********************************************************************************************************************************/
+    void WriteFolded(std::string file);
+
+    int GetNumSamples();                    ///<Get the number of samples stored
+    int GetDropped();                       ///<Get the number of samples dropped as the storage was full
+
+private:
+    static const int MaxDepth = 64;         ///<Maximum number of frames of a sample
+
+    int frequency;                          ///<Samples per second of CPU time of each thread
+    int capacity;                           ///<Maximum number of samples stored
+    void** frames = nullptr;                ///<Return addresses of each sample, #MaxDepth per sample
+    int* depth = nullptr;                   ///<Number of frames of each sample
+    std::atomic<int> next;                  ///<Index of next sample, may exceed #capacity
+    std::atomic<int> dropped;               ///<Samples dropped as the storage was full
+    std::vector<timer_t> timers;            ///<CPU-time timer of each thread
+    bool running = false;                   ///<Sampling is active
+
+    static Profiler* active;                ///<Profiler that the signal handler records into
+
+    /**
+     * @brief SIGPROF handler that records the stack of the interrupted thread
+     ***********************************************************************************************************************************/
+    static void Handler(int sig, siginfo_t* info, void* context);
+
+    /**
+     * @brief Walk the frame pointers of an interrupted context on the stack of the calling thread, async-signal-safe
+     * @param[in] context   Context passed to the signal handler, a ucontext_t
+     * @param[out] sample   Interrupted address followed by the return addresses of the callers, at most #MaxDepth
+     * @return Number of addresses recorded
+     ***********************************************************************************************************************************/
+    static int Unwind(void* context, void** sample);
+
+    /**
+     * @brief Resolve a return address to a function name, without argument types
+     * @param[in] address   Address within the function
+     * @return Function name, or module name if the address has no symbol
+     ***********************************************************************************************************************************/
+    static std::string Symbol(void* address);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @class Renderer
+ * @brief In-situ renderer that writes downsampled images of the vorticity with streamfunction contours while the solver runs.
+ *
+ * Each process colour maps the pixels of the image that fall within its local domain into a tile the size of the whole image,
+ * leaving all other pixels zero. The tiles are composited onto the root process with a single MPI_Reduce, which draws the
+ * streamfunction contours and writes the image as a binary PPM file. Only the downsampled image is ever communicated or written,
+ * so a frame costs kilobytes rather than a full dump of the flow field.
+ *
+ * Vorticity is shown with a diverging blue-white-red colour map on a logarithmic scale, as the lid corners are singular and would
+ * otherwise saturate the colour range.
+ ***********************************************************************************************************************************/
+class Renderer
+{
+public:
+    /**
+     * @brief Constructor that describes the image and the local domain of the current process
+     * @param[in] pWidth        Width of the image in pixels
+     * @param[in] pHeight       Height of the image in pixels
+     * @param[in] pContours     Number of streamfunction contour levels, at most 254
+     * @param[in] pGlobalNx     Number of global grid points in x direction
+     * @param[in] pGlobalNy     Number of global grid points in y direction
+     * @param[in] pXStart       Starting point of local domain in global domain, x direction
+     * @param[in] pYStart       Starting point of local domain in global domain, y direction
+     * @param[in] pNx           Number of local grid points in x direction
+     * @param[in] pNy           Number of local grid points in y direction
+     * @param[in] pComm         MPI communicator of all processes holding part of the domain
+     ***********************************************************************************************************************************/
+    Renderer(int pWidth, int pHeight, int pContours, int pGlobalNx, int pGlobalNy, int pXStart, int pYStart, int pNx, int pNy,
+             MPI_Comm pComm);
+
+    /**
+     * @brief Destructor to deallocate memory
+     ***********************************************************************************************************************************/
+    ~Renderer();
+
+    /**
+     * @brief Render a frame and write it to file on the root process
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] v         Local vorticity
+     * @param[in] s         Local streamfunction
+     * @param[in] file      Name of the PPM file to write
+     ***********************************************************************************************************************************/
+    void Render(double* v, double* s, std::string file);
+
+    int GetWidth();         ///<Get width of the image in pixels
+    int GetHeight();        ///<Get height of the image in pixels
+
+private:
+    int width;                              ///<Width of the image in pixels
+    int height;                             ///<Height of the image in pixels
+    int contours;                           ///<Number of streamfunction contour levels
+    int Nx;                                 ///<Number of local grid points in x direction
+    int Ny;                                 ///<Number of local grid points in y direction
+    int rank;                               ///<Rank of current process in #comm
+    MPI_Comm comm;                          ///<MPI communicator of all processes holding part of the domain
+
+    int nPixels;                            ///<Number of image pixels within the local domain
+    int* pixel = nullptr;                   ///<Index of each local pixel in the image
+    int* sample = nullptr;                  ///<Index of the local grid point sampled by each local pixel
+
+    unsigned char* tile = nullptr;          ///<Local tile, 4 bytes per pixel: red, green, blue and contour level
+    unsigned char* image = nullptr;         ///<Composited image on root process, same layout as #tile
+};
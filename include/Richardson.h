@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+
+class LidDrivenCavity;
+
+/**
+ * @class Richardson
+ * @brief Richardson extrapolation of the lid driven cavity solution from grids of \f$ N \f$ and \f$ 2N-1 \f$ points per direction.
+ *
+ * Every point of the coarse grid coincides with every second point of the fine grid, which has half the grid spacing. As the
+ * spatial discretisation is second order, the solutions at the coincident points combine to
+ * \f[ u_R = \frac{4 u_h - u_{2h}}{3} \f]
+ * which cancels the leading error term, giving fourth-order accuracy in space at a quarter of the cost of a grid refined twice. The
+ * difference \f$ (u_h - u_{2h})/3 \f$ estimates the error of the fine grid solution, and is reported for every field.
+ *
+ * Both grids use the same time step, which must satisfy the time-step restriction of the fine grid. The grids are either solved one
+ * after another by all processes, or concurrently by two halves of the processes, each of which must be a square number.
+ ***********************************************************************************************************************************/
+class Richardson
+{
+public:
+    /**
+     * @brief Constructor that creates the solvers of both grids
+     * @param[in] pConcurrent   True to solve the grids concurrently on two halves of the processes, false to solve them one after another
+     * @param[in] pComm         MPI communicator of all processes
+     ***********************************************************************************************************************************/
+    Richardson(bool pConcurrent, MPI_Comm pComm);
+
+    /**
+     * @brief Destructor to deallocate memory and free communicators
+     ***********************************************************************************************************************************/
+    ~Richardson();
+
+    /**
+     * @defgroup SetRE Set Richardson Problem Parameters
+     * Describe the global problem on the coarse grid, as for LidDrivenCavity
+     * @{
+     ***********************************************************************************************************************************/
+    void SetDomainSize(double xlen, double ylen);       ///<Specify the global domain size
+    void SetGridSize(int nx, int ny);                   ///<Specify the coarse grid size, the fine grid has 2nx-1 x 2ny-1 points
+    void SetTimeStep(double deltat);                    ///<Specify the time step of both grids
+    void SetFinalTime(double finalt);                   ///<Specify the final time
+    void SetReynoldsNumber(double re);                  ///<Specify the Reynolds number
+    /**@}*/
+
+    /**
+     * @brief Print the configuration on the root process and check the time-step restriction of the fine grid
+     * @note Terminates the program if the configuration is invalid
+     ***********************************************************************************************************************************/
+    void PrintConfiguration();
+
+    /**
+     * @brief Initialise the solvers of both grids
+     ***********************************************************************************************************************************/
+    void Initialise();
+
+    /**
+     * @brief Integrate both grids to the final time and extrapolate at the coincident points on the root process
+     * @note Collective over all processes
+     ***********************************************************************************************************************************/
+    void Run();
+
+    /**
+     * @brief Write the extrapolated solution on the coarse grid, in the same format as LidDrivenCavity::WriteSolution
+     * @param[in] file      Name of the text file
+     ***********************************************************************************************************************************/
+    void WriteSolution(std::string file);
+
+    /**
+     * @brief Print the estimated error of each field of the fine grid solution and the wall time on the root process
+     ***********************************************************************************************************************************/
+    void PrintReport();
+
+    /**
+     * @brief Get an extrapolated field on the root process
+     * @param[in] field     0 vorticity, 1 streamfunction, 2 horizontal velocity, 3 vertical velocity
+     * @param[out] out      Field at all points of the coarse grid, x varying fastest
+     ***********************************************************************************************************************************/
+    void GetExtrapolated(int field, double* out);
+
+    /**
+     * @brief Get the maximum estimated error of the fine grid solution of a field, \f$ \max |u_h - u_{2h}|/3 \f$, on the root process
+     * @param[in] field     0 vorticity, 1 streamfunction, 2 horizontal velocity, 3 vertical velocity
+     ***********************************************************************************************************************************/
+    double GetErrorEstimate(int field);
+
+    double GetWallTime();               ///<Get the wall time of Run
+
+private:
+    static const int NumFields = 4;     ///<Vorticity, streamfunction and both velocity components
+
+    bool concurrent;                    ///<Grids solved concurrently on two halves of the processes
+    int worldRank;                      ///<Rank of current process in #comm
+    int group;                          ///<0 if this process solves the coarse grid, 1 if the fine grid, 2 if both
+    int fineRoot;                       ///<Rank in #comm of the root process of the fine grid
+    MPI_Comm comm;                      ///<MPI communicator of all processes
+    MPI_Comm comm_group;                ///<MPI communicator of the processes solving the grid of this process
+
+    LidDrivenCavity* coarse = nullptr;  ///<Solver of the coarse grid, only on processes solving it
+    LidDrivenCavity* fine = nullptr;    ///<Solver of the fine grid, only on processes solving it
+
+    double dt = 0.01;                   ///<Time step
+    double T = 1.0;                     ///<Final time
+    double nu = 0.1;                    ///<Kinematic viscosity
+    double Lx = 1.0;                    ///<Length of global domain in x direction
+    double Ly = 1.0;                    ///<Length of global domain in y direction
+    int Nx = 9;                         ///<Number of points of the coarse grid in x direction
+    int Ny = 9;                         ///<Number of points of the coarse grid in y direction
+
+    double* coarseFields[NumFields] = {};   ///<Fields of the coarse grid, on the root process
+    double* fineFields[NumFields] = {};     ///<Fields of the fine grid, on the root process
+    double* result[NumFields] = {};        ///<Extrapolated fields on the coarse grid, on the root process
+    double errorMax[NumFields] = {};        ///<Maximum estimated error of the fine grid solution
+    double errorRms[NumFields] = {};        ///<Root mean square estimated error of the fine grid solution
+    double wallTime = 0.0;                  ///<Wall time of Run
+
+    /**
+     * @brief Integrate a solver to the final time and gather its solution on rank 0 of its group
+     * @param[in] solver    Solver to integrate
+     * @param[out] fields   Global fields, only accessed on rank 0 of the group of the solver
+     ***********************************************************************************************************************************/
+    void Solve(LidDrivenCavity* solver, double** fields);
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Maximum number of fields that can be stored in a snapshot file
+ */
+#define SNAPSHOT_MAX_FIELDS 8
+
+/**
+ * @brief Header at the start of every snapshot file, describing the global domain and the fields stored in each snapshot
+ */
+struct SnapshotFileHeader {
+    char magic[8];                                  ///<File identifier, always "LDCSNAP1"
+    int version;                                    ///<File format version
+    int nFields;                                    ///<Number of fields stored in each snapshot
+    int globalNx;                                   ///<Number of global grid points in x direction
+    int globalNy;                                   ///<Number of global grid points in y direction
+    double Lx;                                      ///<Length of global domain in x direction
+    double Ly;                                      ///<Length of global domain in y direction
+    char fieldNames[SNAPSHOT_MAX_FIELDS][16];       ///<Null terminated name of each field
+};
+
+/**
+ * @brief Header of a single snapshot (record), followed by the block table and then the block data
+ * @note recordBytes allows a reader to jump from one snapshot to the next without touching any data, forming the time index
+ */
+struct SnapshotRecordHeader {
+    long long recordBytes;                          ///<Size of the record including this header, block table and data
+    int step;                                       ///<Time step of the snapshot
+    int nBlocks;                                    ///<Number of blocks (one per process that wrote the snapshot)
+    double time;                                    ///<Time of the snapshot
+};
+
+/**
+ * @brief Entry of the block table of a snapshot, forming the spatial index
+ * @note Block data is stored field after field, each field in row major format
+ */
+struct SnapshotBlockEntry {
+    int xStart;                                     ///<Starting point of block in global domain, x direction
+    int yStart;                                     ///<Starting point of block in global domain, y direction
+    int nx;                                         ///<Number of grid points in block in x direction
+    int ny;                                         ///<Number of grid points in block in y direction
+    long long offset;                               ///<Offset of block data from start of file in bytes
+};
+
+/**
+ * @class SnapshotWriter
+ * @brief Writes snapshots of distributed fields into a single indexed binary file with MPI-IO.
+ *
+ * Each process writes its local block directly into the file, so no data is gathered on any process. Every snapshot holds a
+ * record header with the time step and time, and a block table describing where each local block lives in the global domain and
+ * in the file, which allows SnapshotReader to extract any field, time or subregion without reading the rest of the file.
+ ***********************************************************************************************************************************/
+class SnapshotWriter
+{
+public:
+    /**
+     * @brief Create (or overwrite) a snapshot file and write its file header
+     * @note Collective over pComm
+     * @param[in] file          Name of the snapshot file
+     * @param[in] pNumFields    Number of fields in each snapshot, at most #SNAPSHOT_MAX_FIELDS
+     * @param[in] pFieldNames   Name of each field, at most 15 characters
+     * @param[in] pGlobalNx     Number of global grid points in x direction
+     * @param[in] pGlobalNy     Number of global grid points in y direction
+     * @param[in] pLx           Length of global domain in x direction
+     * @param[in] pLy           Length of global domain in y direction
+     * @param[in] pComm         MPI communicator of the processes that write blocks
+     ***********************************************************************************************************************************/
+    SnapshotWriter(std::string file, int pNumFields, const std::string* pFieldNames, int pGlobalNx, int pGlobalNy,
+                   double pLx, double pLy, MPI_Comm pComm);
+
+    /**
+     * @brief Destructor that closes the file and deallocates memory
+     ***********************************************************************************************************************************/
+    ~SnapshotWriter();
+
+    /**
+     * @brief Append a snapshot of the local block of each field to the file
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] step      Time step of the snapshot
+     * @param[in] time      Time of the snapshot
+     * @param[in] xStart    Starting point of local block in global domain, x direction
+     * @param[in] yStart    Starting point of local block in global domain, y direction
+     * @param[in] nx        Number of grid points in local block in x direction
+     * @param[in] ny        Number of grid points in local block in y direction
+     * @param[in] fields    Local block of each field, in the same order as the field names, row major format
+     ***********************************************************************************************************************************/
+    void Write(int step, double time, int xStart, int yStart, int nx, int ny, double** fields);
+
+    /**
+     * @brief Convert a text file written by LidDrivenCavity::WriteSolution into a snapshot file with fields v, s, u0, u1
+     * @note Not collective, the snapshot file is written by the calling process only
+     * @param[in] textFile  Name of text file in the legacy column-by-column format
+     * @param[in] snapFile  Name of snapshot file to create
+     * @param[in] step      Time step to record for the snapshot
+     * @param[in] time      Time to record for the snapshot
+     * @return True if the text file could be read and converted
+     ***********************************************************************************************************************************/
+    static bool ConvertText(std::string textFile, std::string snapFile, int step, double time);
+
+private:
+    MPI_File fh;                            ///<MPI file handle of the snapshot file
+    MPI_Comm comm;                          ///<MPI communicator of the processes that write blocks
+    int rank;                               ///<Rank of current process in #comm
+    int size;                               ///<Number of processes in #comm
+    int nFields;                            ///<Number of fields in each snapshot
+    long long endOffset;                    ///<Offset of the end of the file, where the next snapshot is written
+    int* blockInfo;                         ///<Gathered xStart, yStart, nx, ny of every process
+    SnapshotBlockEntry* table;              ///<Block table of the snapshot being written
+};
+
+/**
+ * @class SnapshotReader
+ * @brief Random-access reader for snapshot files written by SnapshotWriter.
+ *
+ * The file is memory mapped and only the record headers are visited when the reader is created, so extracting a field for one
+ * time step and subregion only touches the bytes that are requested. The header and the block tables are checked against the size
+ * of the file when the reader is created; records from the first inconsistent one on are ignored, as if the file ended there.
+ ***********************************************************************************************************************************/
+class SnapshotReader
+{
+public:
+    /**
+     * @brief Memory map a snapshot file and build the time index
+     * @param[in] file      Name of the snapshot file
+     ***********************************************************************************************************************************/
+    SnapshotReader(std::string file);
+
+    /**
+     * @brief Destructor that unmaps the file
+     ***********************************************************************************************************************************/
+    ~SnapshotReader();
+
+    bool IsValid();                         ///<Check whether the file could be opened and has a valid header
+    int GetNumSnapshots();                  ///<Get number of snapshots in the file
+    int GetNumFields();                     ///<Get number of fields in each snapshot
+    int GetGlobalNx();                      ///<Get number of global grid points in x direction
+    int GetGlobalNy();                      ///<Get number of global grid points in y direction
+    double GetLx();                         ///<Get length of global domain in x direction
+    double GetLy();                         ///<Get length of global domain in y direction
+
+    /**
+     * @brief Get the name of a field
+     * @param[in] field     Index of the field
+     * @return Name of the field, empty if there is no such field
+     ***********************************************************************************************************************************/
+    std::string GetFieldName(int field);
+
+    /**
+     * @brief Get the index of a field from its name
+     * @param[in] name      Name of the field
+     * @return Index of the field, -1 if not present
+     ***********************************************************************************************************************************/
+    int FindField(std::string name);
+
+    int GetStep(int snapshot);              ///<Get the time step of a snapshot, -1 if there is no such snapshot
+    double GetTime(int snapshot);           ///<Get the time of a snapshot, NaN if there is no such snapshot
+
+    /**
+     * @brief Find the snapshot closest to a given time
+     * @param[in] time      Time to search for
+     * @return Index of the closest snapshot, -1 if the file holds no snapshots
+     ***********************************************************************************************************************************/
+    int FindTime(double time);
+
+    /**
+     * @brief Extract a rectangular subregion of a field from a snapshot
+     * @param[in] snapshot  Index of the snapshot
+     * @param[in] field     Index of the field
+     * @param[in] x0        Starting point of subregion in global domain, x direction
+     * @param[in] y0        Starting point of subregion in global domain, y direction
+     * @param[in] nx        Number of grid points of subregion in x direction
+     * @param[in] ny        Number of grid points of subregion in y direction
+     * @param[out] out      Extracted data of size nx*ny in row major format; points not covered by any block are left untouched
+     * @return False if there is no such snapshot or field, or the subregion is negative, in which case nothing is read
+     ***********************************************************************************************************************************/
+    bool ReadField(int snapshot, int field, int x0, int y0, int nx, int ny, double* out);
+
+private:
+    char* data = nullptr;                   ///<Memory mapped file
+    long long fileBytes = 0;                ///<Size of the file in bytes
+    SnapshotFileHeader* header = nullptr;   ///<File header, pointing into #data
+    int nSnapshots = 0;                     ///<Number of snapshots in the file
+    long long* recordOffsets = nullptr;     ///<Offset of each record from start of file
+
+    /**
+     * @brief Check that a record, its block table and the data of every block lie within the file and the global domain
+     * @param[in] offset    Offset of the record from start of file, with room for its record header
+     ***********************************************************************************************************************************/
+    bool IsRecordValid(long long offset);
+};
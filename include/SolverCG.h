@@ -1,18 +1,20 @@
 #pragma once
 
+#include "PoissonSolver.h"
+
 /**
  * @class SolverCG
  * @brief Describes a preconditioned conjugate gradient solver that solves the equation \f$ -\nabla ^ 2 x = b \f$ 
  * 
  * Describes a preconditioned conjugate gradient solver which solves the matrix equation \f$ Ax=b \f$, with max iteration number of 5000,
-and error tolerance of 1e-3. In this context, \f$ A \f$ describes the coefficients of a second-order central-difference discretisation of the
+and by default an absolute tolerance of 1e-6 on the residual, see SetTolerance. In this context, \f$ A \f$ describes the coefficients of a second-order central-difference discretisation of the
 operator \f$ -\nabla^2 \f$, \f$ x \f$ describes the streamfunction and \f$ b \f$ describes the vorticity (i.e. \f$ -\nabla ^ 2 \psi = \omega \f$).
 The problem domain is \f$ (x,y)\in[0,L_x]\times[0,L_y] \f$, where \f$ L_x \f$ is the domain length in \f$ x \f$ direction and \f$ L_y \f$ is the 
 domain length in the \f$ y  \f$ direction.
  * @note When implemented with MPI, SolverCG expects inputs to already be discretised into local domains by LidDrivenCavity. 
- All member variables describe the local problem domain, unless otherwise specified
+ All member variables describe the local problem domain, unless otherwise specified. Registered as the "pcg" backend of PoissonSolver
  ******************************************************************************************************************************************/
-class SolverCG
+class SolverCG : public PoissonSolver
 {
 public:
     /**
@@ -25,6 +27,18 @@ public:
      * @param[in] colGrid   MPI communicator for the process column in Cartesian topology grid
      ***************************************************************************************************************************************/
     SolverCG(int pNx, int pNy, double pdx, double pdy,MPI_Comm &rowGrid, MPI_Comm &colGrid);
+
+    /**
+     * @brief Constructor for a solver whose Cartesian grid spans a subset of the processes
+     * @param[in] pNx   Number of grid points in x direction
+     * @param[in] pNy   Number of grid points in y direction
+     * @param[in] pdx   Grid spacing in x direction, should satisfy pdx = Lx/(pNx - 1) where Lx is domain length in x direction
+     * @param[in] pdy   Grid spacing in y direction, should satisfy pdy = Ly/(pNy - 1) where Ly is domain length in y direction
+     * @param[in] rowGrid   MPI communicator for the process row in Cartesian topology grid
+     * @param[in] colGrid   MPI communicator for the process column in Cartesian topology grid
+     * @param[in] grid      MPI communicator of the whole Cartesian topology grid, used for global reductions
+     ***************************************************************************************************************************************/
+    SolverCG(int pNx, int pNy, double pdx, double pdy,MPI_Comm &rowGrid, MPI_Comm &colGrid, MPI_Comm grid);
     
     /**
      * @brief Destructor to deallocate memory
@@ -44,6 +58,46 @@ public:
     int GetNy();                ///< Get the number of grid points in y direction, for testing purposes
     /**@}*/
 
+    int GetIterations();        ///< Get the number of iterations taken by the latest call to Solve
+    double GetResidual();       ///< Get the 2-norm of the final residual of the latest call to Solve
+
+    /**
+     * @brief Enable or disable printing the iteration count of each solve on the root process, enabled by default
+     * @param[in] pVerbose  True to print
+     */
+    void SetVerbose(bool pVerbose);
+
+    /**
+     * @brief Specify when Solve stops, once the 2-norm of the global residual is below the largest of the enabled bounds
+     *
+     * The relative bounds let a solve stop as soon as it is accurate to a fraction of the solution, or of the residual of the initial
+     * guess. When the initial guess is the solution of the previous time step, the latter is the change of the right hand side over the
+     * step, which the time-discretisation error of the step is proportional to. The absolute bound also decides when $ b $ is
+     * practically zero and the solve is skipped.
+     * @param[in] absolute  Bound on the residual, 1e-6 by default
+     * @param[in] relative  Bound relative to the 2-norm of $ b $, 0 to disable (default)
+     * @param[in] initial   Bound relative to the 2-norm of the initial residual $ b - Ax_0 $, 0 to disable (default)
+     */
+    void SetTolerance(double absolute, double relative = 0.0, double initial = 0.0);
+
+    /**
+     * @brief Solve \f$ (\sigma I - \nabla^2) x = b \f$ instead, as for the diffusion step of an implicit time step
+     * @param[in] sigma     Non-negative shift \f$ \sigma \f$, 0 by default
+     */
+    void SetShift(double sigma);
+
+    /**
+     * @brief Restore the state after construction, so the solver can be reused for a new problem of the same size without allocating
+     */
+    void Reset();
+
+    /**
+     * @brief Get the storage of the initial residual \f$ r_0 = b - Ax_0 \f$ for SolveFromResidual, to be filled by the caller
+     * @return Local array of Nx*Ny points, which must be zero on the global domain boundary
+     */
+    double* GetInitialResidual();
+
+protected:
     /**
      * @brief Computes the solution to \f$ -\nabla ^ 2 x = b \f$ via a preconditioned conjugate gradient method. 
      * This equation is formulated as \f$ Ax=b \f$. Note that \f$ A \f$ describes the coefficients of a 
@@ -51,7 +105,15 @@ public:
      * @param[in] b     The desired result (in this context, the vorticity)
      * @param[in,out] x     On input, initial guess \f$ x_0 \f$; on output the computed solution (in this context, the streamfunction)
      */
-    void Solve(double* b, double* x);
+    void DoSolve(double* b, double* x);
+
+    /**
+     * @brief Computes the solution to \f$ -\nabla ^ 2 x = b \f$ as Solve, from an initial residual already written to GetInitialResidual.
+     * Lets the caller produce \f$ b \f$, its norm and the initial residual in the same sweep, instead of Solve streaming \f$ b \f$ again
+     * @param[in,out] x     On input, initial guess \f$ x_0 \f$ the residual was computed from; on output the computed solution
+     * @param[in] bNormSquared  Squared 2-norm of the local \f$ b \f$, including the global domain boundary
+     */
+    void DoSolveFromResidual(double* x, double bNormSquared);
 
 private:
     double dx;      ///<Grid spacing in x direction
@@ -62,9 +124,18 @@ private:
     double* p;      ///<Variable for preconditioned conjugate gradient solver
     double* z;      ///<Variable for preconditioned conjugate gradient solver
     double* t;      ///<Variable for preconditioned conjugate gradient solver
+    int iterations = 0;         ///<Number of iterations taken by the latest call to Solve
+    double residual = 0.0;      ///<2-norm of the final residual of the latest call to Solve
+    double absoluteTol = 1e-6;  ///<Bound on the residual norm, see SetTolerance
+    double relativeTol = 0.0;   ///<Bound on the residual norm relative to the norm of b
+    double initialTol = 0.0;    ///<Bound on the residual norm relative to the norm of the initial residual
+    double stopTol = 1e-6;      ///<Largest of the bounds for the current solve, used by Iterate
+    double shift = 0.0;         ///<Shift \f$ \sigma \f$ added to the diagonal of the operator, see SetShift
 
     MPI_Comm comm_row_grid;                 ///<MPI communicator for the process row in Cartesian topology grid
     MPI_Comm comm_col_grid;                 ///<MPI communicator for the process column in Cartesian topology grid
+    MPI_Comm comm_grid;                     ///<MPI communicator of the whole Cartesian topology grid, for global reductions
+    bool verbose = true;                    ///<Print iteration count on root process
     int size;                               ///<Size of a row/column communicator, where size*size is the total number of processors
     int globalNx;                           ///<Number of grid points in global domain in x direction
     int globalNy;                           ///<Number of grid points in global domain in y direction
@@ -117,5 +188,14 @@ private:
      *****************************************************************************************************************************************/
     void ImposeBC(double* p);
 
+    /**
+     * @brief Conjugate gradient iterations shared by Solve and SolveFromResidual, once \f$ r_0 \f$, \f$ z_0 \f$, \f$ p_0 \f$ and
+     * \f$ t = Ap_0 \f$ are known
+     * @param[in,out] x     On input, initial guess; on output the computed solution
+     * @param[in] globalAlpha   Global step length \f$ \alpha_0 \f$ of the first iteration
+     * @param[in] betaDen   Local \f$ r_0^T z_0 \f$, the denominator of \f$ \beta_0 \f$
+     *****************************************************************************************************************************************/
+    void Iterate(double* x, double globalAlpha, double betaDen);
+
 };
 
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+
+#include "PoissonSolver.h"
+
+/**
+ * @class SolverCGTiled
+ * @brief Preconditioned conjugate gradient solver of \f$ -\nabla^2 x = b \f$ in which each OpenMP thread owns a 2D tile of the local
+ * domain, as a process of flat MPI owns its local domain
+ *
+ * SolverCG only parallelises the loops over the interior of the local domain, so its edges, corners and halo exchanges run on one
+ * thread between parallel regions. Here the whole solve is one parallel region, and each thread applies the operator, preconditioner
+ * and vector updates to its own tile only, so it touches the same memory in every iteration. Halos between tiles of the same process
+ * are read directly from the shared vectors once the progress counters of the neighbouring tiles show that they are up to date, see
+ * below. A thread whose tile lies on an edge of the local domain exchanges its segment of that edge with the neighbouring process
+ * itself, concurrently with the other threads, and overlaps the exchange with the interior of its tile. This requires
+ * MPI_THREAD_MULTIPLE.
+ *
+ * There are no OpenMP barriers. Each thread counts the updates of the search direction on its tile in a lock-free progress counter,
+ * and before applying the operator waits only for the counters of the up to four tiles its stencil reads, so a thread delayed by
+ * the operating system only holds up its neighbours. Reductions are counters too: every thread counts its partial sums in, and the
+ * master thread counts the result out once summed over the processes. Waiting threads spin briefly, then yield their core.
+ *
+ * The threads are arranged into the grid of tiles with the shortest total tile perimeter for the global domain, so neighbouring
+ * processes split their shared edges alike. Dot products are summed over the threads in a fixed order and then over the processes,
+ * with the residual norm and \f$ r^T z \f$ of an iteration in one reduction. Registered as the "pcg-tiled" backend of PoissonSolver,
+ * which only exists if MPI provides MPI_THREAD_MULTIPLE, all processes run the same number of threads and each local domain has at
+ * least one row and column per tile. Stops as SolverCG, see SolverCG::SetTolerance.
+ ***********************************************************************************************************************************/
+class SolverCGTiled : public PoissonSolver
+{
+public:
+    /**
+     * @brief Constructor that arranges the threads into tiles and first touches each tile of the work vectors by its thread
+     * @note Collective over the Cartesian communicator of the problem
+     * @param[in] problem   Local problem
+     ***********************************************************************************************************************************/
+    SolverCGTiled(const PoissonProblem& problem);
+
+    /**
+     * @brief Destructor to deallocate memory
+     ***********************************************************************************************************************************/
+    ~SolverCGTiled();
+
+    bool IsUsable();                    ///<Get whether the requirements of the tiling are met on all processes, otherwise do not solve
+    int GetThreads();                   ///<Get the number of threads, one per tile
+    int GetTilesX();                    ///<Get the number of tiles in x direction
+    int GetTilesY();                    ///<Get the number of tiles in y direction
+    int GetIterations();                ///<Get the number of iterations taken by the latest solve
+    double GetResidual();               ///<Get the 2-norm of the final residual of the latest solve
+    void SetVerbose(bool pVerbose);     ///<Enable or disable printing the iterations of each solve on the root process, enabled by default
+    void SetTolerance(double absolute, double relative, double initial);   ///<Specify when each solve stops, see SolverCG::SetTolerance
+    void Reset();                       ///<Restore the state after construction
+
+protected:
+    /**
+     * @brief Solve \f$ -\nabla^2 x = b \f$ with all threads, each on its tile
+     * @note Collective over the Cartesian communicator of the problem
+     * @param[in] b         Local right hand side
+     * @param[in,out] x     On input, initial guess with the values on the global domain boundary; on output the local solution
+     ***********************************************************************************************************************************/
+    void DoSolve(double* b, double* x);
+
+private:
+    /**
+     * @brief Rectangle of local grid points owned by one thread
+     */
+    struct Tile {
+        int i0;                             ///<First column
+        int i1;                             ///<Column after the last
+        int j0;                             ///<First row
+        int j1;                             ///<Row after the last
+        int column;                         ///<Tile column, numbers the segment of the top and bottom edges
+        int row;                            ///<Tile row, numbers the segment of the left and right edges
+        int neighbours[4];                  ///<Threads of the tiles left, right, below and above, in the same process
+        int neighbourCount;                 ///<Number of neighbouring tiles
+    };
+
+    int Nx;                                 ///<Number of local grid points in x direction
+    int Ny;                                 ///<Number of local grid points in y direction
+    double dx2i;                            ///<Inverse of the squared grid spacing in x direction
+    double dy2i;                            ///<Inverse of the squared grid spacing in y direction
+    int threads;                            ///<Number of threads and tiles
+    int tilesX = 1;                         ///<Number of tiles in x direction
+    int tilesY = 1;                         ///<Number of tiles in y direction
+    std::vector<Tile> tiles;                ///<Tile of each thread
+    bool usable = false;                    ///<Requirements of the tiling are met on all processes
+
+    double* r;                              ///<Residual
+    double* p;                              ///<Search direction
+    double* z;                              ///<Preconditioned residual
+    double* t;                              ///<Operator applied to the search direction
+
+    double* topData;                        ///<Row above the local domain, received from the process above
+    double* bottomData;                     ///<Row below the local domain, received from the process below
+    double* leftData;                       ///<Column left of the local domain, received from the process to the left
+    double* rightData;                      ///<Column right of the local domain, received from the process to the right
+    double* tempLeft;                       ///<Left column of the local domain, packed to be sent left
+    double* tempRight;                      ///<Right column of the local domain, packed to be sent right
+
+    static const int Stride = 8;            ///<Values between the partial sums of two threads, so they never share a cache line
+    double* partial;                        ///<Partial sums of each thread, #Stride values per thread
+    double shared[4];                       ///<Sums over all threads and processes, read by every thread after a reduction
+    std::atomic<long>* progress;            ///<Updates of the search direction on the tile of each thread in this solve, #Stride apart
+    std::atomic<long>* arrived;             ///<Partial sums written by each thread in this solve, #Stride apart
+    std::atomic<long> reduced;              ///<Reductions completed by the master thread in this solve
+    static const int SpinCount = 1000;      ///<Polls of a counter before a waiting thread yields its core on every further poll
+
+    MPI_Comm comm_row_grid;                 ///<Duplicate of the process row communicator, so halo tags never match other solvers
+    MPI_Comm comm_col_grid;                 ///<Duplicate of the process column communicator
+    MPI_Comm comm_grid;                     ///<Cartesian communicator of all processes, for global reductions
+    int rank;                               ///<Rank of current process in #comm_grid
+    int topRank;                            ///<Rank of process above in #comm_col_grid, MPI_PROC_NULL at the global boundary
+    int bottomRank;                         ///<Rank of process below in #comm_col_grid, MPI_PROC_NULL at the global boundary
+    int leftRank;                           ///<Rank of process to the left in #comm_row_grid, MPI_PROC_NULL at the global boundary
+    int rightRank;                          ///<Rank of process to the right in #comm_row_grid, MPI_PROC_NULL at the global boundary
+
+    bool verbose = true;                    ///<Print iteration count on root process
+    int iterations = 0;                     ///<Iterations of the latest solve
+    double residual = 0.0;                  ///<2-norm of the final residual of the latest solve
+    double absoluteTol = 1e-6;              ///<Bound on the residual norm
+    double relativeTol = 0.0;               ///<Bound on the residual norm relative to the norm of b
+    double initialTol = 0.0;                ///<Bound on the residual norm relative to the norm of the initial residual
+
+    /**
+     * @brief Apply the discretised \f$ -\nabla^2 \f$ to one tile, zero on the global boundary, exchanging the segments of the local
+     * domain edges of the tile with the neighbouring processes
+     * @note Called by every thread for its tile, once the neighbouring tiles of the input are complete, see WaitForNeighbours
+     * @param[in] tile      Tile of the calling thread
+     * @param[in] in        Local input vector
+     * @param[out] out      Local output vector, written on the tile only
+     ***********************************************************************************************************************************/
+    void ApplyOperator(const Tile& tile, const double* in, double* out);
+
+    /**
+     * @brief Publish an update of the search direction on the tile of a thread, and wait until its neighbouring tiles are updated alike
+     * @param[in] thread    Number of the calling thread
+     * @param[in,out] step  Updates of the search direction by the calling thread in this solve, incremented
+     ***********************************************************************************************************************************/
+    void WaitForNeighbours(int thread, long& step);
+
+    /**
+     * @brief Sum values over all threads and processes
+     * @note Called by every thread, the master thread reduces over the processes once all partial sums arrived
+     * @param[in] thread        Number of the calling thread
+     * @param[in] local         Partial sums of the calling thread
+     * @param[in] count         Number of values, at most 4
+     * @param[out] global       Sums over all threads and processes
+     * @param[in,out] reduction Reductions by the calling thread in this solve, incremented
+     ***********************************************************************************************************************************/
+    void Reduce(int thread, const double* local, int count, double* global, long& reduction);
+
+    /**
+     * @brief Wait until a counter of another thread reaches a value, with acquire ordering so its writes before are visible
+     ***********************************************************************************************************************************/
+    static void WaitFor(const std::atomic<long>& counter, long target);
+
+    /**
+     * @brief Whether a local grid point is on the global domain boundary, where the solution is a Dirichlet condition
+     ***********************************************************************************************************************************/
+    bool IsGlobalBoundary(int i, int j);
+};
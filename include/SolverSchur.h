@@ -0,0 +1,117 @@
+#pragma once
+
+#include "PoissonSolver.h"
+
+/**
+ * @class SolverSchur
+ * @brief Direct solver of \f$ -\nabla^2 x = b \f$ by non-overlapping substructuring, factorising once and back-substituting every solve
+ *
+ * The right column and top row of every local domain with a neighbour in that direction form the interface \f$ \Gamma \f$. Removing it
+ * leaves the remaining interior points of each process coupled only to the interface, so the discretised operator splits into
+ * independent local blocks \f$ A_{II}^{(k)} \f$, and the interface unknowns satisfy the Schur complement system
+ * \f[ S x_\Gamma = b_\Gamma - \sum_k A_{\Gamma I}^{(k)} (A_{II}^{(k)})^{-1} b_I^{(k)}, \qquad
+ *     S = A_{\Gamma\Gamma} - \sum_k A_{\Gamma I}^{(k)} (A_{II}^{(k)})^{-1} A_{I\Gamma}^{(k)} \f]
+ *
+ * The constructor factorises each local block by a banded Cholesky decomposition, and every process contributes its dense part of
+ * \f$ S \f$, found by one local back-substitution per neighbouring interface point. The interface is numbered in row-major order,
+ * so \f$ S \f$ is banded too; it is summed over all processes with one reduction and factorised by every process. A solve then costs
+ * two local back-substitutions, one reduction of the interface right hand side and a back-substitution with the interface factor.
+ *
+ * The values of x on the global domain boundary are kept as Dirichlet conditions, as by SolverCG. The solution is exact up to
+ * rounding, so the tolerance is ignored, and a solve is reported as one iteration with zero residual. Registered as the "schur"
+ * backend of PoissonSolver, which only exists if every local domain has at least 3 points in each direction and the factors fit
+ * in #MaxFactorSize values per process.
+ ***********************************************************************************************************************************/
+class SolverSchur : public PoissonSolver
+{
+public:
+    /**
+     * @brief Constructor that numbers the interface and factorises the local blocks and the Schur complement
+     * @note Collective over the Cartesian communicator of the problem
+     * @param[in] problem   Local problem, every local domain having at least 3 points in each direction
+     ***********************************************************************************************************************************/
+    SolverSchur(const PoissonProblem& problem);
+
+    /**
+     * @brief Destructor to deallocate memory
+     ***********************************************************************************************************************************/
+    ~SolverSchur();
+
+    bool IsFactored();                  ///<Get whether the factors fit in #MaxFactorSize, otherwise the solver cannot be used
+    int GetInterfaceSize();             ///<Get the number of global interface points
+    int GetIterations();                ///<Get the number of iterations of the latest solve, 1 for a direct solve
+    double GetResidual();               ///<Get the residual of the latest solve, 0 as it is exact up to rounding
+    void SetVerbose(bool pVerbose);     ///<Enable or disable printing a line for each solve on the root process, enabled by default
+    void SetTolerance(double absolute, double relative, double initial);   ///<Ignored, as the solve is direct
+    void Reset();                       ///<Restore the state after construction, keeping the factors
+
+    static const long long MaxFactorSize = 1 << 24;    ///<Largest local or interface factor in values, beyond which the solver is not created
+
+protected:
+    /**
+     * @brief Solve \f$ -\nabla^2 x = b \f$ with the factors
+     * @note Collective over the Cartesian communicator of the problem
+     * @param[in] b         Local right hand side
+     * @param[in,out] x     On input, values on the global domain boundary; on output the local solution
+     ***********************************************************************************************************************************/
+    void DoSolve(double* b, double* x);
+
+private:
+    int Nx;                                 ///<Number of local grid points in x direction
+    int Ny;                                 ///<Number of local grid points in y direction
+    MPI_Comm comm_grid;                     ///<Cartesian communicator of all processes
+    int rank;                               ///<Rank of current process in #comm_grid
+    bool verbose = true;                    ///<Print a line for each solve on root process
+    bool factored = false;                  ///<Factors fit in #MaxFactorSize and were computed
+    int iterations = 0;                     ///<Iterations of the latest solve
+
+    //interior block, the local points left once the interface and global boundary are removed, a rectangle in row-major order
+    int iStart;                             ///<First local column of the interior block
+    int jStart;                             ///<First local row of the interior block
+    int interiorWidth;                      ///<Columns of the interior block, also the bandwidth of its factor
+    int interiorSize;                       ///<Points of the interior block
+    double* interiorFactor = nullptr;       ///<Banded Cholesky factor of the interior block, see BandFactor
+    double* interiorRhs = nullptr;          ///<Right hand side of the interior block
+    double* interiorSol = nullptr;          ///<Solution of the interior block
+
+    //interface, numbered globally in row-major order
+    int interfaceSize = 0;                  ///<Number of global interface points
+    int interfaceBand = 0;                  ///<Bandwidth of the Schur complement
+    double* interfaceFactor = nullptr;      ///<Banded Cholesky factor of the Schur complement
+    double* interfaceRhs = nullptr;         ///<Right hand side, then solution, of the interface system
+
+    int ownedCount = 0;                     ///<Interface points of this process
+    int* ownedLocal = nullptr;              ///<Local index of each interface point of this process
+    int* ownedIndex = nullptr;              ///<Interface index of each interface point of this process
+
+    int couplingCount = 0;                  ///<Couplings between the interior block and neighbouring interface points
+    int* couplingInterior = nullptr;        ///<Interior index of each coupling
+    int* couplingInterface = nullptr;       ///<Interface index of each coupling
+    double* couplingValue = nullptr;        ///<Operator coefficient of each coupling
+
+    int dirichletCount = 0;                 ///<Couplings of local unknowns to values on the global domain boundary
+    int* dirichletTarget = nullptr;         ///<Local index of the unknown of each boundary coupling
+    int* dirichletSource = nullptr;         ///<Local index of the boundary point of each boundary coupling
+    double* dirichletValue = nullptr;       ///<Coefficient moving the boundary value to the right hand side
+    double* work = nullptr;                 ///<Local right hand side including the boundary values
+
+    /**
+     * @brief Factorise a symmetric positive definite band matrix in place as \f$ L L^T \f$
+     *
+     * Row i of the lower triangle is stored at a[i*(band+1)], element (i,j) at a[i*(band+1) + j - i + band] for \f$ i - band \le j \le i \f$,
+     * with the entries before the first column of the matrix unused.
+     * @param[in] n         Order of the matrix
+     * @param[in] band      Number of subdiagonals
+     * @param[in,out] a     On input, lower triangle of the matrix; on output, the factor L in the same storage
+     ***********************************************************************************************************************************/
+    static void BandFactor(int n, int band, double* a);
+
+    /**
+     * @brief Solve \f$ L L^T x = b \f$ in place with a factor of BandFactor
+     * @param[in] n         Order of the matrix
+     * @param[in] band      Number of subdiagonals
+     * @param[in] l         Factor of BandFactor
+     * @param[in,out] x     On input, b; on output, x
+     ***********************************************************************************************************************************/
+    static void BandSolve(int n, int band, const double* l, double* x);
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Header at the start of every POD file, followed by the singular values, the times of the snapshots, the coefficients of
+ * each snapshot, one row of modes values per snapshot, and the modes, each a global field stored row by row from the bottom
+ */
+struct PODFileHeader {
+    char magic[8];                                  ///<File identifier, always "LDCPOD01"
+    int globalNx;                                   ///<Number of global grid points in x direction
+    int globalNy;                                   ///<Number of global grid points in y direction
+    int modes;                                      ///<Number of modes in the file
+    int snapshots;                                  ///<Number of snapshots decomposed
+    int step;                                       ///<Time step the file was written at
+    int reserved;                                   ///<Padding, always zero
+    double time;                                    ///<Time the file was written at
+};
+
+/**
+ * @class StreamingPOD
+ * @brief In-situ proper orthogonal decomposition of distributed snapshots of a field, by an incremental truncated SVD, so that only
+ * the leading modes and their coefficients are ever stored instead of every snapshot.
+ *
+ * The snapshots \f$ D = [x_1, \dots, x_m] \f$ are approximated by \f$ U \Sigma V^T \f$ of at most rank k. Snapshots are buffered in
+ * batches of b and folded in together: the tall and skinny matrix \f$ [U \Sigma \,|\, X] \f$ of k+b columns is factorised by a
+ * tall-skinny QR, in which each process factorises its rows by Householder reflections and all processes factorise the gathered
+ * triangular factors, so the only communication is one gather of \f$ (k+b)^2 \f$ values per process. The SVD of the small
+ * triangular factor \f$ R = \tilde U \tilde\Sigma \tilde V^T \f$, by one-sided Jacobi rotations, then gives the new modes
+ * \f$ Q \tilde U \f$, singular values \f$ \tilde\Sigma \f$ and right singular vectors \f$ \mathrm{diag}(V, I) \tilde V \f$, each truncated
+ * to rank k. The small factorisations are repeated by every process on the same data, so all agree without further communication.
+ *
+ * Each process stores its rows of the modes and the batch, and every process the right singular vectors, k values per snapshot. The
+ * coefficients of snapshot j on the modes are \f$ \Sigma V_j \f$. Modes below a relative singular value of #DropTolerance are dropped.
+ ***********************************************************************************************************************************/
+class StreamingPOD
+{
+public:
+    /**
+     * @brief Constructor that allocates the modes and the batch of the local domain
+     * @param[in] pMaxModes     Maximum number of modes kept, k
+     * @param[in] pBatch        Number of snapshots b folded into the decomposition at once, larger batches need fewer but larger updates
+     * @param[in] pGlobalNx     Number of global grid points in x direction
+     * @param[in] pGlobalNy     Number of global grid points in y direction
+     * @param[in] pXStart       Starting point of local domain in global domain, x direction
+     * @param[in] pYStart       Starting point of local domain in global domain, y direction
+     * @param[in] pNx           Number of local grid points in x direction
+     * @param[in] pNy           Number of local grid points in y direction
+     * @param[in] pComm         MPI communicator of all processes, whose local domains together make up the global domain
+     ***********************************************************************************************************************************/
+    StreamingPOD(int pMaxModes, int pBatch, int pGlobalNx, int pGlobalNy, int pXStart, int pYStart, int pNx, int pNy, MPI_Comm pComm);
+
+    /**
+     * @brief Destructor to deallocate memory
+     ***********************************************************************************************************************************/
+    ~StreamingPOD();
+
+    /**
+     * @brief Add a snapshot, folding in the batch once it is full
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] field     Local values of the snapshot
+     * @param[in] time      Time of the snapshot
+     ***********************************************************************************************************************************/
+    void Add(const double* field, double time);
+
+    /**
+     * @brief Fold the buffered snapshots into the decomposition, if any
+     * @note Collective over the communicator passed to the constructor
+     ***********************************************************************************************************************************/
+    void Update();
+
+    /**
+     * @brief Reserve storage for the coefficients and times of the snapshots expected, so that Add and Update do not allocate until
+     * there are more
+     * @param[in] snapshots     Number of snapshots expected
+     ***********************************************************************************************************************************/
+    void Reserve(int snapshots);
+
+    /**
+     * @brief Fold in the buffered snapshots and write the decomposition of all snapshots so far into a binary file with MPI-IO,
+     * see PODFileHeader
+     *
+     * Each process writes its part of every mode directly into the global field of the file, so nothing is gathered.
+     * @note Collective over the communicator passed to the constructor
+     * @param[in] file      Name of the file
+     * @param[in] step      Time step written into the header
+     * @param[in] time      Time written into the header
+     ***********************************************************************************************************************************/
+    void Write(std::string file, int step, double time);
+
+    int GetModes();                         ///<Get the number of modes of the decomposition, excluding buffered snapshots
+    int GetSnapshots();                     ///<Get the number of snapshots decomposed, excluding buffered snapshots
+    const double* GetMode(int l);           ///<Get the local values of mode l, the modes are orthonormal over all processes
+    const double* GetSingularValues();      ///<Get the singular values, in descending order
+    double GetCoefficient(int j, int l);    ///<Get the coefficient of snapshot j on mode l
+
+    static constexpr double DropTolerance = 1e-12;  ///<Modes of singular values below this fraction of the largest are dropped
+
+private:
+    int maxModes;                           ///<Maximum number of modes kept
+    int batch;                              ///<Number of snapshots folded in at once
+    int globalNx;                           ///<Number of global grid points in x direction
+    int globalNy;                           ///<Number of global grid points in y direction
+    int xStart;                             ///<Starting point of local domain in global domain, x direction
+    int yStart;                             ///<Starting point of local domain in global domain, y direction
+    int Nx;                                 ///<Number of local grid points in x direction
+    int Ny;                                 ///<Number of local grid points in y direction
+    int n;                                  ///<Number of local grid points
+    MPI_Comm comm;                          ///<Communicator of all processes
+    int size;                               ///<Number of processes in #comm
+    int rank;                               ///<Rank of current process in #comm
+
+    int modes = 0;                          ///<Current number of modes
+    int buffered = 0;                       ///<Snapshots buffered since the latest update
+    double* U;                              ///<Local values of the modes, one after another
+    double* sigma;                          ///<Singular values
+    std::vector<double> V;                  ///<Right singular vectors, #modes values per snapshot
+    std::vector<double> rotated;            ///<Right singular vectors being updated, swapped with #V
+    std::vector<double> times;              ///<Time of each snapshot decomposed
+    double* pending;                        ///<Time of each buffered snapshot
+    int* order;                             ///<Columns of the SVD of the global triangular factor by descending singular value
+
+    double* A;                              ///<Local columns of \f$ [U \Sigma | X] \f$, the batch X from column #maxModes, factorised in place
+    double* Q;                              ///<Local rows of the orthogonal factor
+    double* tau;                            ///<Scale factors of the Householder reflections
+    double* R;                              ///<Local triangular factor, then the left singular vectors of the global one
+    double* gathered;                       ///<Local triangular factors of all processes, one after another
+    double* stacked;                        ///<Local triangular factors of all processes one below another, factorised in place
+    double* stackedQ;                       ///<Orthogonal factor of #stacked
+    double* stackedTau;                     ///<Scale factors of the Householder reflections of #stacked
+    double* W;                              ///<Left singular vectors of #R, scaled by the singular values
+    double* rotations;                      ///<Right singular vectors of #R
+    double* G;                              ///<Product of the block of the global orthogonal factor of this process and the left singular vectors
+};
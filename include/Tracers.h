@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Header at the start of every tracer file, followed by the ids, then the x and then the y positions of all tracers
+ * @note Tracers are stored in no particular order, ids identify them between files
+ */
+struct TracerFileHeader {
+    char magic[8];                                  ///<File identifier, always "LDCPART1"
+    int step;                                       ///<Time step of the positions
+    int reserved;                                   ///<Padding, always zero
+    double time;                                    ///<Time of the positions
+    long long count;                                ///<Number of tracers in the file
+};
+
+/**
+ * @class Tracers
+ * @brief Passive Lagrangian tracers advected with the flow, distributed over the processes by the local domain they lie in.
+ *
+ * Each process owns the tracers within the cells whose bottom left grid point is in its local domain. Positions are stored as
+ * structure of arrays and are kept sorted by cell, so advecting tracers walks the velocity field in memory order. Tracers are moved
+ * with forward Euler steps, as the vorticity, using the velocity bilinearly interpolated within their cell. The velocity of the
+ * first column of the process to the right and the first row of the process above close the cells on the edges of the local domain.
+ *
+ * Tracers that leave the local domain are packed and sent to the neighbouring process in one message per direction, first left and
+ * right and then down and up, so tracers crossing a corner reach the diagonal neighbour. The sort order decays as tracers move and
+ * arrive, so it is restored in place every few steps.
+ ***********************************************************************************************************************************/
+class Tracers
+{
+public:
+    /**
+     * @brief Constructor that seeds the tracers of the local domain
+     *
+     * Tracers are seeded over the whole domain with the additive recurrence of the plastic number, which is evenly spread for any
+     * number of tracers. Tracer k is placed at the same position for any number of processes.
+     * @note Collective over the communicators
+     * @param[in] pCount        Number of tracers in the global domain
+     * @param[in] pGlobalNx     Number of global grid points in x direction
+     * @param[in] pGlobalNy     Number of global grid points in y direction
+     * @param[in] pdx           Grid spacing in x direction
+     * @param[in] pdy           Grid spacing in y direction
+     * @param[in] pXStart       Starting point of local domain in global domain, x direction
+     * @param[in] pYStart       Starting point of local domain in global domain, y direction
+     * @param[in] pNx           Number of local grid points in x direction
+     * @param[in] pNy           Number of local grid points in y direction
+     * @param[in] rowGrid       MPI communicator for the process row in Cartesian topology grid
+     * @param[in] colGrid       MPI communicator for the process column in Cartesian topology grid
+     ***********************************************************************************************************************************/
+    Tracers(long long pCount, int pGlobalNx, int pGlobalNy, double pdx, double pdy, int pXStart, int pYStart, int pNx, int pNy,
+            MPI_Comm rowGrid, MPI_Comm colGrid);
+
+    /**
+     * @brief Destructor to deallocate memory
+     ***********************************************************************************************************************************/
+    ~Tracers();
+
+    /**
+     * @brief Move the tracers by one time step and send those leaving the local domain to their new process
+     * @note Collective over the communicators passed to the constructor
+     * @param[in] u0    Local horizontal velocity
+     * @param[in] u1    Local vertical velocity
+     * @param[in] dt    Time step
+     ***********************************************************************************************************************************/
+    void Advect(const double* u0, const double* u1, double dt);
+
+    /**
+     * @brief Sort the local tracers by cell in place
+     ***********************************************************************************************************************************/
+    void Sort();
+
+    /**
+     * @brief Write the positions of all tracers into a binary file with MPI-IO, see TracerFileHeader
+     *
+     * Each process writes its tracers directly into its slice of the file, so no tracers are gathered on any process.
+     * @note Collective over all processes holding tracers
+     * @param[in] file      Name of the file
+     * @param[in] step      Time step of the positions
+     * @param[in] time      Time of the positions
+     * @param[in] comm      MPI communicator of all processes holding tracers
+     ***********************************************************************************************************************************/
+    void Write(std::string file, int step, double time, MPI_Comm comm);
+
+    void SetSortInterval(int interval);     ///<Sort the tracers every interval calls to Advect, 0 to never sort. 16 by default
+    long long GetLocalCount();              ///<Get the number of tracers of this process
+    const double* GetX();                   ///<Get the x positions of the tracers of this process
+    const double* GetY();                   ///<Get the y positions of the tracers of this process
+    const long long* GetIds();              ///<Get the ids of the tracers of this process
+
+private:
+    int globalNx;                           ///<Number of global grid points in x direction
+    int globalNy;                           ///<Number of global grid points in y direction
+    double dx;                              ///<Grid spacing in x direction
+    double dy;                              ///<Grid spacing in y direction
+    int xStart;                             ///<Starting point of local domain in global domain, x direction
+    int yStart;                             ///<Starting point of local domain in global domain, y direction
+    int Nx;                                 ///<Number of local grid points in x direction
+    int Ny;                                 ///<Number of local grid points in y direction
+
+    MPI_Comm comm_row_grid;                 ///<MPI communicator for the process row in Cartesian topology grid
+    MPI_Comm comm_col_grid;                 ///<MPI communicator for the process column in Cartesian topology grid
+    int leftRank;                           ///<Rank of the process to the left in #comm_row_grid, MPI_PROC_NULL at the global boundary
+    int rightRank;                          ///<Rank of the process to the right in #comm_row_grid
+    int bottomRank;                         ///<Rank of the process below in #comm_col_grid
+    int topRank;                            ///<Rank of the process above in #comm_col_grid
+
+    //tracers, structure of arrays with capacity entries each
+    long long count = 0;                    ///<Number of local tracers
+    long long capacity = 0;                 ///<Allocated length of the tracer arrays
+    double* x = nullptr;                    ///<x position of each tracer
+    double* y = nullptr;                    ///<y position of each tracer
+    long long* id = nullptr;                ///<Global id of each tracer
+    int* bin = nullptr;                     ///<Cell of each tracer, only valid during Sort
+
+    long long* binStart = nullptr;          ///<First tracer of each cell after Sort, Nx*Ny+1 entries
+    long long* binNext = nullptr;           ///<Next free slot of each cell during Sort
+    int sortInterval = 16;                  ///<Sort every sortInterval calls to Advect
+    int advectCount = 0;                    ///<Calls to Advect since the last sort
+
+    double* uExt = nullptr;                 ///<Local horizontal velocity with the first column and row of the neighbours, (Nx+1) x (Ny+1)
+    double* vExt = nullptr;                 ///<Local vertical velocity with the first column and row of the neighbours
+    double* haloSend = nullptr;             ///<Packed velocity sent to a neighbour
+    double* haloRecv = nullptr;             ///<Packed velocity received from a neighbour
+
+    double* sendLow = nullptr;              ///<Packed tracers leaving to the left or bottom neighbour
+    double* sendHigh = nullptr;             ///<Packed tracers leaving to the right or top neighbour
+    double* recvBuffer = nullptr;           ///<Packed tracers arriving from a neighbour
+    long long sendLowCapacity = 0;          ///<Tracers that fit in #sendLow
+    long long sendHighCapacity = 0;         ///<Tracers that fit in #sendHigh
+    long long recvCapacity = 0;             ///<Tracers that fit in #recvBuffer
+
+    /**
+     * @brief Fill #uExt and #vExt from the local velocity and the first column and row of the neighbours to the right and above
+     * @param[in] u0    Local horizontal velocity
+     * @param[in] u1    Local vertical velocity
+     ***********************************************************************************************************************************/
+    void ExchangeVelocity(const double* u0, const double* u1);
+
+    /**
+     * @brief Send tracers outside the local domain along one direction to the neighbours, until every tracer of the row or column
+     * of processes is in the local domain along that direction
+     * @param[in] vertical  False to exchange with the left and right neighbours, true with the neighbours below and above
+     ***********************************************************************************************************************************/
+    void Migrate(bool vertical);
+
+    /**
+     * @brief Global cell index of a position along one direction, clamped to the cells of the global domain
+     * @param[in] pos       Position
+     * @param[in] h         Grid spacing
+     * @param[in] globalN   Number of global grid points
+     ***********************************************************************************************************************************/
+    int Cell(double pos, double h, int globalN);
+
+    void Reserve(long long n);              ///<Grow the tracer arrays to hold at least n tracers, keeping their contents
+    void Append(double px, double py, long long pid);   ///<Add a tracer to the local tracers
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @class VectorOps
+ * @brief Vector operations of the conjugate gradient solver, computed either in-tree with OpenMP threads and SIMD or by the linked BLAS.
+ *
+ * The in-tree backend splits every operation into the same static blocks of the vector across the OpenMP threads, so each thread
+ * always touches the same part of every vector. Together with SolverCG first touching its vectors with Zero and statically scheduling
+ * its stencils, the pages of each thread stay on the memory of its NUMA node. Short vectors are processed by the calling thread only,
+ * as starting the threads costs more than the operation.
+ *
+ * The BLAS backend dispatches to cblas, for vendor libraries that thread their level 1 routines. The in-tree backend is the default,
+ * unless built with VECTOR_OPS_BLAS defined (`make VECTOR_BACKEND=blas`), and either can be selected at run time with SetBackend.
+ * Reductions of the two backends, and of the in-tree backend with different numbers of threads, differ by rounding.
+ ***********************************************************************************************************************************/
+class VectorOps
+{
+public:
+    /**
+     * @brief Implementations of the vector operations
+     */
+    enum Backend {
+        OpenMP,                             ///<In-tree OpenMP and SIMD loops
+        Blas                                ///<Linked cblas library
+    };
+
+    /**
+     * @brief Select the implementation of all subsequent vector operations of all threads
+     * @param[in] backend   Implementation to use
+     ***********************************************************************************************************************************/
+    static void SetBackend(Backend backend);
+
+    /**
+     * @brief Select the implementation of all subsequent vector operations by name
+     * @param[in] name      "openmp" or "blas"
+     * @return False if the name is unknown, leaving the backend unchanged
+     ***********************************************************************************************************************************/
+    static bool SetBackend(std::string name);
+
+    static Backend GetBackend();            ///<Get the current implementation
+    static std::string GetBackendName();    ///<Get the name of the current implementation, as accepted by SetBackend
+
+    static double Dot(int n, const double* x, const double* y);        ///<Dot product \f$ x^T y \f$ of vectors of length n
+    static double Nrm2(int n, const double* x);                         ///<2-norm of a vector of length n
+    static void Axpy(int n, double a, const double* x, double* y);      ///<\f$ y = a x + y \f$
+    static void Xpay(int n, const double* x, double a, double* y);      ///<\f$ y = x + a y \f$
+    static void Copy(int n, const double* x, double* y);                ///<\f$ y = x \f$
+    static void Zero(int n, double* x);                                 ///<\f$ x = 0 \f$ with the in-tree loop for either backend, to first touch new vectors
+
+private:
+    static Backend backend;                 ///<Current implementation
+    static const int ParallelThreshold = 8192;  ///<Shortest vector processed by all OpenMP threads of the in-tree backend
+};
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+#include <mpi.h>
+
+#include "Agglomeration.h"
+#include "SolverCG.h"
+
+Agglomeration::Agglomeration(MPI_Comm cartGrid, int q, int xStart, int yStart, int pNx, int pNy, double dx, double dy)
+{
+    int size, cartRank;
+    int coords[2];
+    MPI_Comm_size(cartGrid, &size);
+    MPI_Comm_rank(cartGrid, &cartRank);
+    MPI_Cart_coords(cartGrid, cartRank, 2, coords);                 //coords[0] is the row (y), coords[1] the column (x)
+    int p = round(sqrt(size));
+    Npts = pNx * pNy;
+
+    //neighbouring processes form a block, the first process of the block in row-major order gathers
+    int blockY = coords[0] * q / p;
+    int blockX = coords[1] * q / p;
+    MPI_Comm_split(cartGrid, blockY*q + blockX, coords[0]*p + coords[1], &comm_block);
+    MPI_Comm_size(comm_block, &blockSize);
+    int blockRank;
+    MPI_Comm_rank(comm_block, &blockRank);
+    gathering = (blockRank == 0);
+
+    //gathering processes form a q x q Cartesian grid in the same orientation as cartGrid, ranked in row-major order
+    MPI_Comm gatherComm;
+    MPI_Comm_split(cartGrid, gathering ? 0 : MPI_UNDEFINED, blockY*q + blockX, &gatherComm);
+    if(gathering) {
+        int dims[2] = {q, q};
+        int periods[2] = {0, 0};
+        int keep[2];
+        MPI_Cart_create(gatherComm, 2, dims, periods, 0, &comm_agg);
+        MPI_Comm_free(&gatherComm);
+
+        keep[0] = 0;
+        keep[1] = 1;
+        MPI_Cart_sub(comm_agg, keep, &comm_agg_row);
+        keep[0] = 1;
+        keep[1] = 0;
+        MPI_Cart_sub(comm_agg, keep, &comm_agg_col);
+    }
+
+    //local domains of the block, relative to the block, which is the rectangle spanned by them
+    int block[4] = {xStart, yStart, pNx, pNy};
+    if(gathering)
+        blocks = new int[4*blockSize];
+    MPI_Gather(block, 4, MPI_INT, blocks, 4, MPI_INT, 0, comm_block);
+
+    sendBuffer = new double[2*Npts];
+    recvBuffer = new double[Npts + 2];
+
+    if(gathering) {
+        int x0 = xStart, y0 = yStart, x1 = xStart + pNx, y1 = yStart + pNy;
+        for(int r = 0; r < blockSize; ++r) {
+            x0 = std::min(x0, blocks[4*r]);
+            y0 = std::min(y0, blocks[4*r+1]);
+            x1 = std::max(x1, blocks[4*r] + blocks[4*r+2]);
+            y1 = std::max(y1, blocks[4*r+1] + blocks[4*r+3]);
+        }
+        aggNx = x1 - x0;
+        aggNy = y1 - y0;
+
+        gatherCounts = new int[blockSize];
+        gatherDispls = new int[blockSize];
+        scatterCounts = new int[blockSize];
+        scatterDispls = new int[blockSize];
+        int gatherOffset = 0, scatterOffset = 0;
+        for(int r = 0; r < blockSize; ++r) {
+            blocks[4*r] -= x0;
+            blocks[4*r+1] -= y0;
+            int n = blocks[4*r+2] * blocks[4*r+3];
+            gatherCounts[r] = 2*n;
+            gatherDispls[r] = gatherOffset;
+            scatterCounts[r] = n + 2;
+            scatterDispls[r] = scatterOffset;
+            gatherOffset += 2*n;
+            scatterOffset += n + 2;
+        }
+
+        aggB = new double[aggNx*aggNy]();
+        aggX = new double[aggNx*aggNy]();
+        gatherBuffer = new double[gatherOffset];
+        scatterBuffer = new double[scatterOffset];
+        cg = new SolverCG(aggNx, aggNy, dx, dy, comm_agg_row, comm_agg_col, comm_agg);
+    }
+}
+
+Agglomeration::~Agglomeration()
+{
+    delete cg;
+    delete[] blocks;
+    delete[] gatherCounts;
+    delete[] gatherDispls;
+    delete[] scatterCounts;
+    delete[] scatterDispls;
+    delete[] aggB;
+    delete[] aggX;
+    delete[] gatherBuffer;
+    delete[] scatterBuffer;
+    delete[] sendBuffer;
+    delete[] recvBuffer;
+
+    if(gathering) {
+        MPI_Comm_free(&comm_agg_row);
+        MPI_Comm_free(&comm_agg_col);
+        MPI_Comm_free(&comm_agg);
+    }
+    MPI_Comm_free(&comm_block);
+}
+
+void Agglomeration::DoSolve(double* b, double* x)
+{
+    //right hand side and initial guess travel together, so a block costs one gather and one scatter per solve
+    std::copy(b, b + Npts, sendBuffer);
+    std::copy(x, x + Npts, sendBuffer + Npts);
+    MPI_Gatherv(sendBuffer, 2*Npts, MPI_DOUBLE, gatherBuffer, gatherCounts, gatherDispls, MPI_DOUBLE, 0, comm_block);
+
+    if(gathering) {
+        for(int r = 0; r < blockSize; ++r) {
+            int bx = blocks[4*r], by = blocks[4*r+1], nx = blocks[4*r+2], ny = blocks[4*r+3];
+            double* bIn = gatherBuffer + gatherDispls[r];
+            double* xIn = bIn + nx*ny;
+            for(int j = 0; j < ny; ++j) {
+                std::copy(bIn + j*nx, bIn + (j+1)*nx, aggB + (by + j)*aggNx + bx);
+                std::copy(xIn + j*nx, xIn + (j+1)*nx, aggX + (by + j)*aggNx + bx);
+            }
+        }
+
+        cg->Solve(aggB, aggX);
+
+        for(int r = 0; r < blockSize; ++r) {
+            int bx = blocks[4*r], by = blocks[4*r+1], nx = blocks[4*r+2], ny = blocks[4*r+3];
+            double* xOut = scatterBuffer + scatterDispls[r];
+            for(int j = 0; j < ny; ++j)
+                std::copy(aggX + (by + j)*aggNx + bx, aggX + (by + j)*aggNx + bx + nx, xOut + j*nx);
+            xOut[nx*ny] = cg->GetIterations();
+            xOut[nx*ny + 1] = cg->GetResidual();
+        }
+    }
+
+    MPI_Scatterv(scatterBuffer, scatterCounts, scatterDispls, MPI_DOUBLE, recvBuffer, Npts + 2, MPI_DOUBLE, 0, comm_block);
+    std::copy(recvBuffer, recvBuffer + Npts, x);
+    iterations = (int) recvBuffer[Npts];
+    residual = recvBuffer[Npts + 1];
+}
+
+void Agglomeration::SetVerbose(bool pVerbose)
+{
+    if(cg)
+        cg->SetVerbose(pVerbose);
+}
+
+void Agglomeration::SetTolerance(double absolute, double relative, double initial)
+{
+    if(cg)
+        cg->SetTolerance(absolute, relative, initial);
+}
+
+void Agglomeration::Reset()
+{
+    if(cg)
+        cg->Reset();
+    iterations = 0;
+    residual = 0.0;
+}
+
+int Agglomeration::GetIterations() {
+    return iterations;
+}
+
+double Agglomeration::GetResidual() {
+    return residual;
+}
+
+bool Agglomeration::IsGathering() {
+    return gathering;
+}
+
+int Agglomeration::ChooseGridSize(int globalNpts, int p, int minPoints)
+{
+    int q = p;
+    while((q > 1) && ((double) globalNpts / (q*q) < minPoints))
+        --q;
+    return q;
+}
@@ -0,0 +1,136 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocTracker.h"
+
+static std::atomic<bool> counting(false);           //counting is active
+static std::atomic<long> count(0);                  //allocations since Start
+static std::atomic<long> bytes(0);                  //bytes allocated since Start
+
+//code of the executable, between symbols defined by the GNU linker
+extern "C" char __executable_start;
+extern "C" char etext;
+
+//glibc's own allocator, called by the replacements below, so operator new is not counted twice through malloc
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t n, std::size_t size);
+extern "C" void* __libc_realloc(void* ptr, std::size_t size);
+
+void AllocTracker::Start()
+{
+    count = 0;
+    bytes = 0;
+    counting = true;
+}
+
+long AllocTracker::Stop()
+{
+    counting = false;
+    return count;
+}
+
+long AllocTracker::GetCount() {
+    return count;
+}
+
+long AllocTracker::GetBytes() {
+    return bytes;
+}
+
+void AllocTracker::Record(std::size_t size)
+{
+    if(counting.load(std::memory_order_relaxed)) {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Check whether a C allocation function was called by the code of the executable rather than by a library
+ * @param[in] caller    Return address of the allocation function
+ */
+static bool CalledByExecutable(void* caller)
+{
+    return (caller >= (void*) &__executable_start) && (caller < (void*) &etext);
+}
+
+//-------------------------------------------Replacement C Allocation Functions-------------------------------------------------------//
+//only calls by the executable are counted, as the MPI library allocates internally, also from its progress threads at any time
+extern "C" void* malloc(std::size_t size)
+{
+    if(CalledByExecutable(__builtin_return_address(0)))
+        AllocTracker::Record(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t n, std::size_t size)
+{
+    if(CalledByExecutable(__builtin_return_address(0)))
+        AllocTracker::Record(n*size);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size)
+{
+    if(CalledByExecutable(__builtin_return_address(0)))
+        AllocTracker::Record(size);
+    return __libc_realloc(ptr, size);
+}
+
+//-------------------------------------------Replacement Global Allocation Functions-------------------------------------------------//
+//all forms are replaced, so memory from any operator new is released by the matching operator delete below
+void* operator new(std::size_t size)
+{
+    AllocTracker::Record(size);
+    void* ptr = __libc_malloc(size ? size : 1);
+    if(!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    AllocTracker::Record(size);
+    return __libc_malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
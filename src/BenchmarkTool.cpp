@@ -0,0 +1,113 @@
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <mpi.h>
+#include "CavityBenchmark.h"
+
+/**
+ * @brief Time-to-accuracy benchmark of the steady lid driven cavity against the reference data of Ghia, Ghia & Shin (1982)
+ *
+ * Runs every combination of Reynolds number, grid size, Poisson solver and time step and prints the wall time each takes to bring
+ * the centre-line velocities within the tolerance of the reference, see CavityBenchmark.
+ * @warning MPI ranks must satisfy \f$ P = p^2 \f$, otherwise program will terminate
+ *********************************************************************************************************************/
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);
+
+    int worldRank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    po::options_description opts("Time-to-accuracy benchmark of the lid driven cavity against Ghia, Ghia & Shin (1982)");
+    opts.add_options()
+        ("Re",              po::value<vector<double>>()->multitoken()->default_value(vector<double>{100.0}, "100"),
+                            "Reynolds numbers, each tabulated in the reference data (100, 400, 1000).")
+        ("grids",           po::value<vector<int>>()->multitoken()->default_value(vector<int>{33, 65}, "33 65"),
+                            "Grid points in each direction.")
+        ("solvers",         po::value<vector<string>>()->multitoken()->default_value(CavityBenchmark::Solvers, "pcg pcg-fused pcg-adaptive"),
+                            "Poisson solver configurations: pcg, pcg-fused, pcg-adaptive.")
+        ("dt-fractions",    po::value<vector<double>>()->multitoken()->default_value(vector<double>{0.5, 0.9}, "0.5 0.9"),
+                            "Time steps as fractions of the explicit stability limit.")
+        ("tolerance",       po::value<double>()->default_value(0.02),
+                            "Maximum error of the centre-line velocities to measure the time to.")
+        ("steady-tolerance", po::value<double>()->default_value(1e-4),
+                            "Change of the centre-line velocities per unit time considered steady.")
+        ("check-interval",  po::value<double>()->default_value(0.5),
+                            "Simulated time between checks of the solution.")
+        ("max-time",        po::value<double>()->default_value(60.0),
+                            "Simulated time at which a configuration is stopped.")
+        ("reference",       po::value<string>()->default_value("test/GhiaRefData"),
+                            "Reference data file.")
+        ("csv",             po::value<string>()->default_value(""),
+                            "Append the results to this CSV file, empty for none.")
+        ("help",            "Print help message.");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, opts), vm);
+    po::notify(vm);
+
+    if(vm.count("help")) {
+        if(worldRank == 0)
+            cout << opts << endl;
+        MPI_Finalize();
+        return 0;
+    }
+
+    int p = round(sqrt(size));
+    if(p*p != size) {
+        if(worldRank == 0)
+            cout << "Invalid process size. Process size must be square number of size p^2 and greater than 0" << endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    CavityBenchmark benchmark(MPI_COMM_WORLD);
+    benchmark.SetTolerance(vm["tolerance"].as<double>());
+    benchmark.SetSteadyTolerance(vm["steady-tolerance"].as<double>());
+    benchmark.SetCheckInterval(vm["check-interval"].as<double>());
+    benchmark.SetMaxTime(vm["max-time"].as<double>());
+
+    for(const string& solver : vm["solvers"].as<vector<string>>()) {
+        bool known = false;
+        for(const string& name : CavityBenchmark::Solvers)
+            known |= (solver == name);
+        if(!known) {
+            if(worldRank == 0)
+                cout << "Unknown solver " << solver << endl;
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
+    bool header = true;
+    for(double Re : vm["Re"].as<vector<double>>()) {
+        if(!benchmark.LoadReference(vm["reference"].as<string>(), Re)) {
+            if(worldRank == 0)
+                cout << "No reference data for Re = " << Re << " in " << vm["reference"].as<string>() << endl;
+            MPI_Finalize();
+            return 1;
+        }
+
+        for(int N : vm["grids"].as<vector<int>>()) {
+            for(const string& solver : vm["solvers"].as<vector<string>>()) {
+                for(double fraction : vm["dt-fractions"].as<vector<double>>()) {
+                    BenchmarkResult result = benchmark.Run(N, solver, fraction);
+                    benchmark.Print(result, header);
+                    header = false;
+                    if(!vm["csv"].as<string>().empty())
+                        benchmark.AppendCsv(result, vm["csv"].as<string>());
+                }
+            }
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
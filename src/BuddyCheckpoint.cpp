@@ -0,0 +1,290 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+using namespace std;
+
+#include <mpi.h>
+
+#include "BuddyCheckpoint.h"
+
+BuddyCheckpoint::BuddyCheckpoint(int pNpts, MPI_Comm &pComm, std::string pDir, int pFlushInterval)
+{
+    Npts = pNpts;
+    comm = pComm;
+    dir = pDir;
+    flushInterval = pFlushInterval;
+
+    MPI_Comm_rank(comm, &rank);
+    CreateRing();
+
+    //buddy may hold a different number of grid points, so exchange sizes once so buffers can be allocated up front
+    buddyNpts = 0;
+    if(partnerRank != -1) {
+        MPI_Sendrecv(&Npts,1,MPI_INT,partnerRank,20,&buddyNpts,1,MPI_INT,buddyRank,20,comm,MPI_STATUS_IGNORE);
+    }
+
+    //v and s are stored back to back in a single buffer, so a checkpoint is a single message
+    own = new double[2*Npts]();
+    buddy = new double[2*buddyNpts]();
+    ownFlush = new double[2*Npts]();
+    buddyFlush = new double[2*buddyNpts]();
+
+    //background thread is created once, so no thread creation cost is incurred during time integration
+    if(flushInterval > 0)
+        flushThread = std::thread(&BuddyCheckpoint::FlushLoop, this);
+}
+
+BuddyCheckpoint::~BuddyCheckpoint()
+{
+    if(flushThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            flushExit = true;                                       //outstanding flush is completed before thread terminates
+        }
+        flushCond.notify_all();
+        flushThread.join();
+    }
+
+    delete[] own;
+    delete[] buddy;
+    delete[] ownFlush;
+    delete[] buddyFlush;
+}
+
+void BuddyCheckpoint::SetProblem(int pGlobalNx, int pGlobalNy, double pLx, double pLy, double pDt, double pRe)
+{
+    globalN[0] = pGlobalNx;
+    globalN[1] = pGlobalNy;
+    problem[0] = pLx;
+    problem[1] = pLy;
+    problem[2] = pDt;
+    problem[3] = pRe;
+}
+
+int BuddyCheckpoint::GetPartnerRank() {
+    return partnerRank;
+}
+
+int BuddyCheckpoint::GetBuddyRank() {
+    return buddyRank;
+}
+
+int BuddyCheckpoint::GetStep() {
+    return step;
+}
+
+void BuddyCheckpoint::Store(double* v, double* s, int pStep)
+{
+    //keep own copy in memory, so a rollback never has to go to storage
+    std::memcpy(own, v, Npts*sizeof(double));
+    std::memcpy(own+Npts, s, Npts*sizeof(double));
+    step = pStep;
+
+    //send own copy to partner on another node and receive copy of buddy; tag = 20 -> checkpoint data
+    if(partnerRank != -1) {
+        MPI_Irecv(buddy,2*buddyNpts,MPI_DOUBLE,buddyRank,20,comm,&requests[1]);
+        MPI_Isend(own,2*Npts,MPI_DOUBLE,partnerRank,20,comm,&requests[0]);
+        MPI_Waitall(2,requests,MPI_STATUSES_IGNORE);
+        buddyStep = pStep;                                          //all processes checkpoint the same time step
+    }
+
+    storeCount++;
+    if((flushInterval > 0) && (storeCount % flushInterval == 0))
+        Flush();
+}
+
+void BuddyCheckpoint::Flush()
+{
+    //without a flush interval, the thread is only started by the first explicit flush
+    if(!flushThread.joinable())
+        flushThread = std::thread(&BuddyCheckpoint::FlushLoop, this);
+
+    //previous flush should long be complete at the lower flush frequency, only wait in the unlikely case it is not
+    WaitForFlush();
+
+    //hand a snapshot of the buffers to the background thread, so the next checkpoint can proceed while it writes
+    std::memcpy(ownFlush, own, 2*Npts*sizeof(double));
+    std::memcpy(buddyFlush, buddy, 2*buddyNpts*sizeof(double));
+    flushStep = step;
+    flushBuddyStep = buddyStep;
+
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushPending = true;
+    }
+    flushCond.notify_all();
+}
+
+bool BuddyCheckpoint::Recover(double* v, double* s, int &pStep)
+{
+    WaitForFlush();
+
+    //read own file into the idle flush buffers, so that the in-memory copies survive a failed recovery; a missing file is marked
+    //by a step of -1
+    int ownStep = -1;
+    int heldStep = -1;
+    ReadFile(ownStep, heldStep);
+
+    //latest checkpoint that any process has is the one to recover
+    int target;
+    MPI_Allreduce(&ownStep,&target,1,MPI_INT,MPI_MAX,comm);
+
+    //return the buddy copy to its owner and receive the copy of own data held by the partner
+    int partnerHeldStep = -1;
+    double* received = new double[2*Npts];
+    if(partnerRank != -1) {
+        MPI_Sendrecv(&heldStep,1,MPI_INT,buddyRank,21,&partnerHeldStep,1,MPI_INT,partnerRank,21,comm,MPI_STATUS_IGNORE);
+        MPI_Sendrecv(buddyFlush,2*buddyNpts,MPI_DOUBLE,buddyRank,22,received,2*Npts,MPI_DOUBLE,partnerRank,22,comm,MPI_STATUS_IGNORE);
+    }
+
+    //prefer own copy, fall back to copy held by partner
+    double* source = nullptr;
+    if((target >= 0) && (ownStep == target))
+        source = ownFlush;
+    else if((target >= 0) && (partnerHeldStep == target))
+        source = received;
+
+    int found = (source != nullptr);
+    int allFound;
+    MPI_Allreduce(&found,&allFound,1,MPI_INT,MPI_MIN,comm);
+
+    if(allFound) {
+        std::memcpy(v, source, Npts*sizeof(double));
+        std::memcpy(s, source+Npts, Npts*sizeof(double));
+        std::memcpy(own, source, 2*Npts*sizeof(double));
+        if(heldStep >= 0) {
+            std::memcpy(buddy, buddyFlush, 2*buddyNpts*sizeof(double));
+            buddyStep = heldStep;
+        }
+        step = target;
+        pStep = target;
+    }
+    delete[] received;
+    return allFound;
+}
+
+void BuddyCheckpoint::WaitForFlush()
+{
+    std::unique_lock<std::mutex> lock(flushMutex);
+    flushCond.wait(lock, [this]{ return !flushPending; });
+}
+
+void BuddyCheckpoint::CreateRing()
+{
+    int size;
+    MPI_Comm_size(comm, &size);
+
+    if(size == 1) {                                                 //nobody to exchange with, only own in-memory copy is kept
+        partnerRank = -1;
+        buddyRank = -1;
+        return;
+    }
+
+    //find processes sharing a node, identify each node by the rank of its first process
+    MPI_Comm nodeComm;
+    int nodeRank, nodeId;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodeComm);
+    MPI_Comm_rank(nodeComm, &nodeRank);
+    nodeId = rank;
+    MPI_Bcast(&nodeId,1,MPI_INT,0,nodeComm);
+    MPI_Comm_free(&nodeComm);
+
+    int* nodeIds = new int[size];
+    int* nodeRanks = new int[size];
+    int* order = new int[size];
+    MPI_Allgather(&nodeId,1,MPI_INT,nodeIds,1,MPI_INT,comm);
+    MPI_Allgather(&nodeRank,1,MPI_INT,nodeRanks,1,MPI_INT,comm);
+
+    //order processes by position within node first and node second, which interleaves the nodes
+    //adjacent processes in this ring are therefore on different nodes whenever more than one node is used
+    for(int i = 0; i < size; ++i)
+        order[i] = i;
+    std::sort(order, order+size, [nodeIds,nodeRanks](int a, int b) {
+        if(nodeRanks[a] != nodeRanks[b])
+            return nodeRanks[a] < nodeRanks[b];
+        return nodeIds[a] < nodeIds[b];
+    });
+
+    int pos = std::find(order, order+size, rank) - order;
+    partnerRank = order[(pos + 1) % size];
+    buddyRank = order[(pos - 1 + size) % size];
+
+    delete[] nodeIds;
+    delete[] nodeRanks;
+    delete[] order;
+}
+
+void BuddyCheckpoint::FlushLoop()
+{
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while(true) {
+        flushCond.wait(lock, [this]{ return flushPending || flushExit; });
+        if(!flushPending)
+            break;                                                  //only exit once no flush is outstanding
+
+        lock.unlock();
+
+        //write to temporary file first, then rename, so a crash mid-write never corrupts the previous checkpoint
+        std::string file = FileName();
+        std::string tmpFile = file + ".tmp";
+        int header[4] = {Npts, flushStep, buddyNpts, flushBuddyStep};
+
+        std::ofstream f(tmpFile.c_str(), std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<char*>(header), sizeof(header));
+        f.write(reinterpret_cast<const char*>(globalN), sizeof(globalN));
+        f.write(reinterpret_cast<const char*>(problem), sizeof(problem));
+        f.write(reinterpret_cast<char*>(ownFlush), 2*Npts*sizeof(double));
+        f.write(reinterpret_cast<char*>(buddyFlush), 2*buddyNpts*sizeof(double));
+        f.close();
+
+        if(f)
+            std::rename(tmpFile.c_str(), file.c_str());
+        else
+            cout << "WARNING: failed to flush checkpoint to " << file << endl;
+
+        lock.lock();
+        flushPending = false;
+        flushCond.notify_all();
+    }
+}
+
+bool BuddyCheckpoint::ReadFile(int &ownStep, int &heldStep)
+{
+    std::ifstream f(FileName().c_str(), std::ios::binary);
+    if(!f.is_open())
+        return false;
+
+    int header[4];
+    f.read(reinterpret_cast<char*>(header), sizeof(header));
+    if(!f || (header[0] != Npts))                                  //file from a different decomposition is of no use
+        return false;
+
+    //file of another case on the same decomposition, or of an older run, would silently continue the wrong problem
+    int fileN[2];
+    double fileProblem[4];
+    f.read(reinterpret_cast<char*>(fileN), sizeof(fileN));
+    f.read(reinterpret_cast<char*>(fileProblem), sizeof(fileProblem));
+    if(!f || !std::equal(fileN, fileN+2, globalN) || !std::equal(fileProblem, fileProblem+4, problem)) {
+        cout << "WARNING: checkpoint " << FileName() << " belongs to a different problem, ignored" << endl;
+        return false;
+    }
+
+    f.read(reinterpret_cast<char*>(ownFlush), 2*Npts*sizeof(double));
+    if(!f)
+        return false;
+    ownStep = header[1];
+
+    if(header[2] == buddyNpts) {
+        f.read(reinterpret_cast<char*>(buddyFlush), 2*buddyNpts*sizeof(double));
+        if(f)
+            heldStep = header[3];
+    }
+    return true;
+}
+
+std::string BuddyCheckpoint::FileName()
+{
+    return dir + "/buddy_ckpt_" + std::to_string(rank) + ".bin";
+}
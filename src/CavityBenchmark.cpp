@@ -0,0 +1,274 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+#include <mpi.h>
+#include <unistd.h>
+
+#include "CavityBenchmark.h"
+#include "LidDrivenCavity.h"
+
+const std::vector<std::string> CavityBenchmark::Solvers = {"pcg", "pcg-fused", "pcg-adaptive"};
+
+CavityBenchmark::CavityBenchmark(MPI_Comm pComm)
+{
+    comm = pComm;
+    MPI_Comm_rank(comm, &rank);
+}
+
+bool CavityBenchmark::LoadReference(std::string file, double pRe)
+{
+    std::ifstream f(file.c_str());
+    if(!f.is_open())
+        return false;
+
+    uY.clear();
+    uRef.clear();
+    vX.clear();
+    vRef.clear();
+
+    //the line starting with Re names the Reynolds number of each velocity column
+    int column = -1;
+    std::string line, key;
+    while(std::getline(f, line)) {
+        if(line.empty() || (line[0] == '#'))
+            continue;
+
+        std::stringstream data(line);
+        data >> key;
+        if(key == "Re") {
+            double value;
+            for(int c = 0; data >> value; ++c) {
+                if(value == pRe)
+                    column = c;
+            }
+            if(column < 0)
+                return false;
+            continue;
+        }
+        if(column < 0)
+            return false;
+
+        double coordinate, value;
+        data >> coordinate;
+        for(int c = 0; c <= column; ++c)
+            data >> value;
+        if(data.fail())
+            return false;
+
+        if(key == "u") {
+            uY.push_back(coordinate);
+            uRef.push_back(value);
+        }
+        else if(key == "v") {
+            vX.push_back(coordinate);
+            vRef.push_back(value);
+        }
+    }
+
+    Re = pRe;
+    return !uY.empty() && !vX.empty();
+}
+
+double CavityBenchmark::ProfileError(const double* u0, const double* u1, int Nx, int Ny)
+{
+    std::vector<double> samples;
+    Sample(u0, u1, Nx, Ny, samples);
+
+    double error = 0.0;
+    for(unsigned int k = 0; k < uRef.size(); ++k)
+        error = std::max(error, fabs(samples[k] - uRef[k]));
+    for(unsigned int k = 0; k < vRef.size(); ++k)
+        error = std::max(error, fabs(samples[uRef.size() + k] - vRef[k]));
+    return error;
+}
+
+BenchmarkResult CavityBenchmark::Run(int N, std::string solver, double dtFraction)
+{
+    BenchmarkResult result;
+    result.Re = Re;
+    result.N = N;
+    result.solver = solver;
+    result.dtFraction = dtFraction;
+    result.dt = dtFraction * StableTimeStep(N, Re);
+    result.timeToTolerance = -1.0;
+    result.wallToTolerance = -1.0;
+    result.steadyTime = -1.0;
+    result.wallTime = 0.0;
+    result.error = 0.0;
+    result.diverged = false;
+
+    LidDrivenCavity* cavity = new LidDrivenCavity(comm);
+    cavity->SetDomainSize(1.0, 1.0);
+    cavity->SetGridSize(N, N);
+    cavity->SetTimeStep(result.dt);
+    cavity->SetFinalTime(maxTime);
+    cavity->SetReynoldsNumber(Re);
+    cavity->SetVerbose(false);
+    cavity->SetFusedResidual(solver != "pcg");
+    if(solver == "pcg-adaptive")
+        cavity->SetAdaptiveTolerance(AdaptiveRelative, AdaptiveStep, 0);
+    cavity->Initialise();
+
+    //global fields only on the root process
+    double* v = nullptr;
+    double* s = nullptr;
+    double* u0 = nullptr;
+    double* u1 = nullptr;
+    if(rank == 0) {
+        v = new double[N*N];
+        s = new double[N*N];
+        u0 = new double[N*N];
+        u1 = new double[N*N];
+    }
+
+    int checkSteps = std::max(1, (int) round(checkInterval / result.dt));
+    int maxSteps = ceil(maxTime / result.dt);
+    std::vector<double> samples, previous;
+
+    while(cavity->GetStep() < maxSteps) {
+        int stepsBefore = cavity->GetStep();
+        MPI_Barrier(comm);
+        double start = MPI_Wtime();
+        cavity->IntegrateTo(std::min(stepsBefore + checkSteps, maxSteps));
+        MPI_Barrier(comm);
+        result.wallTime += MPI_Wtime() - start;
+
+        //error, change per unit time and divergence are decided on the root process and shared, so all processes stop together
+        double status[3] = {0.0, 0.0, 0.0};
+        cavity->GatherSolution(v, s, u0, u1);
+        if(rank == 0) {
+            double elapsed = (cavity->GetStep() - stepsBefore) * result.dt;
+            Sample(u0, u1, N, N, samples);
+            status[0] = ProfileError(u0, u1, N, N);
+            status[1] = previous.empty() ? INFINITY : 0.0;
+            for(unsigned int k = 0; k < previous.size(); ++k)
+                status[1] = std::max(status[1], fabs(samples[k] - previous[k]) / elapsed);
+            status[2] = std::isfinite(status[0]) ? 0.0 : 1.0;
+            previous.swap(samples);
+        }
+        MPI_Bcast(status, 3, MPI_DOUBLE, 0, comm);
+
+        double time = cavity->GetStep() * result.dt;
+        result.error = status[0];
+        if(status[2] != 0.0) {
+            result.diverged = true;
+            break;
+        }
+        //transients can pass through the reference on the way to steady state, so only the last entry into the tolerance counts
+        if(status[0] >= tolerance) {
+            result.timeToTolerance = -1.0;
+            result.wallToTolerance = -1.0;
+        }
+        else if(result.timeToTolerance < 0.0) {
+            result.timeToTolerance = time;
+            result.wallToTolerance = result.wallTime;
+        }
+        if(status[1] < steadyTolerance) {
+            result.steadyTime = time;
+            break;
+        }
+    }
+    result.steps = cavity->GetStep();
+
+    delete cavity;
+    delete[] v;
+    delete[] s;
+    delete[] u0;
+    delete[] u1;
+    return result;
+}
+
+double CavityBenchmark::StableTimeStep(int N, double Re)
+{
+    double h = 1.0 / (N - 1);
+    return std::min(std::min(0.25 * h * h * Re, 2.0 / Re), h);
+}
+
+void CavityBenchmark::Print(const BenchmarkResult& result, bool header)
+{
+    if(rank != 0)
+        return;
+
+    if(header) {
+        cout << setw(6) << "Re" << setw(6) << "N" << setw(14) << "solver" << setw(8) << "dt/max" << setw(11) << "dt"
+             << setw(8) << "steps" << setw(10) << "t(tol)" << setw(12) << "wall(tol)" << setw(10) << "t(steady)"
+             << setw(12) << "wall" << setw(11) << "error" << endl;
+    }
+
+    //configurations that never reach the tolerance or steady state are marked with a dash
+    cout << setw(6) << result.Re << setw(6) << result.N << setw(14) << result.solver << setw(8) << result.dtFraction
+         << setw(11) << result.dt << setw(8) << result.steps;
+    if(result.timeToTolerance >= 0.0)
+        cout << setw(10) << result.timeToTolerance << setw(12) << result.wallToTolerance;
+    else
+        cout << setw(10) << "-" << setw(12) << "-";
+    if(result.steadyTime >= 0.0)
+        cout << setw(10) << result.steadyTime;
+    else
+        cout << setw(10) << "-";
+    cout << setw(12) << result.wallTime << setw(11) << result.error;
+    if(result.diverged)
+        cout << "  diverged";
+    cout << endl;
+}
+
+void CavityBenchmark::AppendCsv(const BenchmarkResult& result, std::string file)
+{
+    if(rank != 0)
+        return;
+
+    bool exists = (access(file.c_str(), F_OK) == 0);
+    std::ofstream f(file.c_str(), std::ios::app);
+    if(!exists)
+        f << "Re,N,solver,dt_fraction,dt,steps,time_to_tolerance,wall_to_tolerance,steady_time,wall_time,error,diverged" << endl;
+    f << result.Re << "," << result.N << "," << result.solver << "," << result.dtFraction << "," << result.dt << ","
+      << result.steps << "," << result.timeToTolerance << "," << result.wallToTolerance << "," << result.steadyTime << ","
+      << result.wallTime << "," << result.error << "," << (result.diverged ? 1 : 0) << endl;
+}
+
+void CavityBenchmark::SetTolerance(double tol)
+{
+    tolerance = tol;
+}
+
+void CavityBenchmark::SetSteadyTolerance(double tol)
+{
+    steadyTolerance = tol;
+}
+
+void CavityBenchmark::SetCheckInterval(double interval)
+{
+    checkInterval = interval;
+}
+
+void CavityBenchmark::SetMaxTime(double time)
+{
+    maxTime = time;
+}
+
+void CavityBenchmark::Sample(const double* u0, const double* u1, int Nx, int Ny, std::vector<double>& samples)
+{
+    double dx = 1.0 / (Nx - 1);
+    double dy = 1.0 / (Ny - 1);
+    samples.resize(uY.size() + vX.size());
+
+    //bilinear interpolation, the last cell is closed by the boundary
+    auto interpolate = [&](const double* field, double x, double y) {
+        int i = std::min((int) floor(x / dx), Nx - 2);
+        int j = std::min((int) floor(y / dy), Ny - 2);
+        double fx = x / dx - i;
+        double fy = y / dy - j;
+        return (1.0 - fx)*(1.0 - fy)*field[j*Nx + i] + fx*(1.0 - fy)*field[j*Nx + i + 1]
+             + (1.0 - fx)*fy*field[(j+1)*Nx + i] + fx*fy*field[(j+1)*Nx + i + 1];
+    };
+
+    for(unsigned int k = 0; k < uY.size(); ++k)
+        samples[k] = interpolate(u0, 0.5, uY[k]);
+    for(unsigned int k = 0; k < vX.size(); ++k)
+        samples[uY.size() + k] = interpolate(u1, vX[k], 0.5);
+}
@@ -0,0 +1,105 @@
+#include <sstream>
+#include <limits>
+using namespace std;
+
+#include "CavityConfig.h"
+
+CavityConfig::CavityConfig(double pLx, double pLy, int pNx, int pNy, double pdt, double pT, double pRe, double pTheta)
+{
+    Lx = pLx;
+    Ly = pLy;
+    Nx = pNx;
+    Ny = pNy;
+    dt = pdt;
+    T = pT;
+    Re = pRe;
+    theta = pTheta;
+}
+
+std::string CavityConfig::Validate(int p) const
+{
+    if(!FitsProcesses(p))
+        return "Excessive number of processes (p^2) for specified grid size. Ensure 2*Nx < p and 2*Ny < p";
+
+    if(!(Lx > 0.0) || !(Ly > 0.0))                                  //negated so that NaN is rejected too
+        return "Invalid domain size, Lx and Ly must be positive";
+
+    if((Nx < 3) || (Ny < 3))
+        return "Invalid grid size, Nx and Ny must be at least 3 so the domain has an interior";
+
+    if(!(dt > 0.0) || !(T >= 0.0))
+        return "Invalid time step or final time, dt must be positive and T not negative";
+
+    if(!(Re > 0.0))
+        return "Invalid Reynolds number, must be positive";
+
+    if(!(theta >= 0.0) || (theta > 1.0))
+        return "Invalid implicitness, must be at least 0 and at most 1";
+
+    if(dt > GetMaxTimeStep()) {
+        ostringstream message;
+        message << "ERROR: Time-step restriction not satisfied!" << endl << "Maximum time-step is " << GetMaxTimeStep();
+        return message.str();
+    }
+
+    return "";
+}
+
+bool CavityConfig::FitsProcesses(int p) const
+{
+    //don't let user use excessive number of processes for the specified grid size
+    //for example no point using 4x4 processes to compute anything smaller than 8x8 grid, would be slower
+    //also catches case where a process ends up having no data to process
+    return (Nx*2 >= p) && (Ny*2 >= p);
+}
+
+double CavityConfig::GetMaxTimeStep() const
+{
+    //the restriction is lifted by implicit diffusion, from Crank-Nicolson on
+    if(theta >= 0.5)
+        return numeric_limits<double>::infinity();
+
+    double dx = Lx / (Nx-1);
+    double dy = Ly / (Ny-1);
+    return 0.25 * dx * dy * Re;                                     //nu = 1/Re
+}
+
+double CavityConfig::GetLx() const
+{
+    return Lx;
+}
+
+double CavityConfig::GetLy() const
+{
+    return Ly;
+}
+
+int CavityConfig::GetNx() const
+{
+    return Nx;
+}
+
+int CavityConfig::GetNy() const
+{
+    return Ny;
+}
+
+double CavityConfig::GetDt() const
+{
+    return dt;
+}
+
+double CavityConfig::GetT() const
+{
+    return T;
+}
+
+double CavityConfig::GetRe() const
+{
+    return Re;
+}
+
+double CavityConfig::GetTheta() const
+{
+    return theta;
+}
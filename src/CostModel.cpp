@@ -0,0 +1,295 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+using namespace std;
+
+#include <cblas.h>
+#include <mpi.h>
+#include <omp.h>
+#include <unistd.h>
+
+#include "CostModel.h"
+
+CostModel::CostModel(int pGlobalNx, int pGlobalNy, double pLx, double pLy, double pDt, double pT)
+{
+    globalNx = pGlobalNx;
+    globalNy = pGlobalNy;
+    dx = pLx / (globalNx - 1);
+    dy = pLy / (globalNy - 1);
+    NSteps = ceil(pT / pDt);
+}
+
+void CostModel::Calibrate(MPI_Comm comm)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    //--------------------------------------------------Describe the nodes of the job---------------------------------------------------//
+    MPI_Comm node;
+    int nodeRank, nodeSize;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &nodeRank);
+    MPI_Comm_size(node, &nodeSize);
+    MPI_Comm_free(&node);
+
+    int leader = (nodeRank == 0) ? 1 : 0;
+    MPI_Allreduce(&leader, &nodes, 1, MPI_INT, MPI_SUM, comm);
+
+    //smallest node limits what can be run
+    long long local[2] = {(long long) std::max(1u, std::thread::hardware_concurrency()),
+                          (long long) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE)};
+    long long global[2];
+    MPI_Allreduce(local, global, 2, MPI_LONG_LONG, MPI_MIN, comm);
+    coresPerNode = global[0];
+    memoryPerNode = global[1];
+
+    //--------------------------------------------------Benchmark computation-----------------------------------------------------------//
+    //every process runs the kernel at the same time on its current local grid size, so shared memory bandwidth is accounted for
+    int p = round(sqrt(size));
+    int n = std::min(std::max(std::max(LocalPoints(globalNx, p), LocalPoints(globalNy, p)), 64), 1024);
+    benchThreads = std::max(1, coresPerNode / nodeSize);
+
+    double cost[2];
+    MPI_Barrier(comm);
+    cost[0] = BenchmarkKernel(n, 1);
+    MPI_Barrier(comm);
+    cost[1] = BenchmarkKernel(n, benchThreads);
+    MPI_Allreduce(MPI_IN_PLACE, cost, 2, MPI_DOUBLE, MPI_MAX, comm);         //slowest process sets the pace
+    pointCostSerial = cost[0];
+    pointCostThreaded = cost[1];
+
+    //--------------------------------------------------Benchmark communication---------------------------------------------------------//
+    //ping-pong between rank 0 and 1 with an empty and a halo-sized message; with a single process, messages are sent to itself
+    int partner = (size > 1) ? 1 - rank : rank;
+    int reps = 100;
+    int haloLength = std::max(n, 1024);
+    double* buffer = new double[2*haloLength]();
+    double timing[2] = {0.0, 0.0};
+
+    if(rank < 2) {
+        int lengths[2] = {1, haloLength};
+        for(int m = 0; m < 2; ++m) {
+            double start = MPI_Wtime();
+            for(int k = 0; k < reps; ++k) {
+                if(size == 1) {
+                    MPI_Sendrecv(buffer, lengths[m], MPI_DOUBLE, rank, 0, buffer + haloLength, lengths[m], MPI_DOUBLE, rank, 0,
+                                 comm, MPI_STATUS_IGNORE);
+                }
+                else if(rank == 0) {
+                    MPI_Send(buffer, lengths[m], MPI_DOUBLE, partner, 0, comm);
+                    MPI_Recv(buffer, lengths[m], MPI_DOUBLE, partner, 0, comm, MPI_STATUS_IGNORE);
+                }
+                else {
+                    MPI_Recv(buffer, lengths[m], MPI_DOUBLE, partner, 0, comm, MPI_STATUS_IGNORE);
+                    MPI_Send(buffer, lengths[m], MPI_DOUBLE, partner, 0, comm);
+                }
+            }
+            timing[m] = (MPI_Wtime() - start) / reps / ((size == 1) ? 1 : 2);      //one way time
+        }
+    }
+    MPI_Bcast(timing, 2, MPI_DOUBLE, 0, comm);
+    delete[] buffer;
+
+    latency = timing[0];
+    byteCost = std::max(timing[1] - timing[0], 0.0) / (8.0 * (haloLength - 1));
+}
+
+double CostModel::GetConditionNumber()
+{
+    //extreme eigenvalues of the five point stencil with Dirichlet boundaries on the interior points
+    double sx = sin(M_PI / (2.0 * (globalNx - 1)));
+    double sy = sin(M_PI / (2.0 * (globalNy - 1)));
+    double lambdaMin = 4.0 / dx / dx * sx * sx + 4.0 / dy / dy * sy * sy;
+    double lambdaMax = 4.0 / dx / dx * (1.0 - sx * sx) + 4.0 / dy / dy * (1.0 - sy * sy);
+    return lambdaMax / lambdaMin;
+}
+
+void CostModel::SetTolerance(double absolute, double relative, double initial)
+{
+    absoluteTol = absolute;
+    relativeTol = relative;
+    initialTol = initial;
+}
+
+int CostModel::EstimateIterations()
+{
+    //constant diagonal preconditioner of SolverCG leaves the condition number unchanged
+    //SolverCG stops at the largest of its bounds on the residual, which relative to the initial residual is the reduction needed
+    double reduction = std::max(std::max(absoluteTol, relativeTol * VorticityNorm) / InitialResidual, initialTol);
+    reduction = std::min(reduction, 1.0);
+    int k = ceil(0.5 * sqrt(GetConditionNumber()) * log(2.0 / reduction));
+    return std::min(k, 5000);
+}
+
+long long CostModel::EstimateMemory(int p)
+{
+    long long localNx = LocalPoints(globalNx, p);
+    long long localNy = LocalPoints(globalNy, p);
+    long long npts = localNx * localNy;
+
+    //LidDrivenCavity: v, vNext, s, tmp, ux, uy; SolverCG: r, p, z, t; both hold halo buffers for each side
+    long long solver = 10 * npts + 6 * (localNx + localNy) + 4 * (localNx + localNy);
+
+    //WriteSolution additionally holds two chunks of four fields of its columns, and the bottom process of each column two chunks of
+    //the whole process column
+    long long output = 2 * 4 * (long long) outputChunk * (localNy + globalNy);
+    return 8 * (solver + output);
+}
+
+long long CostModel::EstimateHaloBytes(int p)
+{
+    //interior processes of the Cartesian grid have two neighbours in each direction, p = 2 has one, p = 1 none
+    int neighbours = std::min(p - 1, 2);
+    long long bytesPerExchange = 8LL * neighbours * (LocalPoints(globalNx, p) + LocalPoints(globalNy, p));
+
+    //one exchange per CG iteration, plus initial residual of CG, vorticity boundary and time advance
+    return bytesPerExchange * (EstimateIterations() + 3);
+}
+
+double CostModel::EstimateStepTime(int p, int threads)
+{
+    int iterations = EstimateIterations();
+    int neighbours = std::min(p - 1, 2);
+    double npts = (double) LocalPoints(globalNx, p) * LocalPoints(globalNy, p);
+
+    //halo messages are sent concurrently but each pays latency; allreduce modelled as recursive doubling
+    double exchange = 2 * neighbours * latency + EstimateHaloBytes(p) / (iterations + 3) * byteCost;
+    double allreduce = (p > 1) ? 2.0 * latency * ceil(log2((double) p * p)) : 0.0;
+
+    return (iterations + 3) * (npts * PointCost(threads) + exchange) + (5 * iterations + 1) * allreduce;
+}
+
+double CostModel::EstimateWallTime(int p, int threads)
+{
+    return NSteps * EstimateStepTime(p, threads);
+}
+
+void CostModel::Report(int p, int threads)
+{
+    cout << "Cost model calibrated on " << nodes << " node(s) with " << coresPerNode << " cores and "
+         << memoryPerNode / 1048576 << " MB each" << endl;
+    cout << "  Grid point cost: " << pointCostSerial * 1e9 << " ns (1 thread), "
+         << pointCostThreaded * 1e9 << " ns (" << benchThreads << " threads) per CG iteration" << endl;
+    cout << "  Message latency: " << latency * 1e6 << " us, bandwidth: " << 1e-9 / std::max(byteCost, 1e-300) << " GB/s" << endl;
+    cout << "  Condition number: " << GetConditionNumber() << ", expected CG iterations per step: " << EstimateIterations() << endl;
+    cout << endl;
+
+    cout << "Prediction for " << p*p << " process(es) x " << threads << " thread(s):" << endl;
+    cout << "  Memory per process:  " << EstimateMemory(p) / 1048576.0 << " MB" << endl;
+    cout << "  Halo data per step:  " << EstimateHaloBytes(p) / 1024.0 << " kB" << endl;
+    cout << "  Time per step:       " << EstimateStepTime(p, threads) * 1e3 << " ms" << endl;
+    cout << "  Wall time:           " << EstimateWallTime(p, threads) << " s for " << NSteps << " steps" << endl;
+    cout << endl;
+
+    //every square number of processes that fits onto the cores, with the remaining cores of each node given to threads
+    int totalCores = nodes * coresPerNode;
+    int best = 0;
+    double bestTime = 0.0;
+    cout << "Splits of " << totalCores << " cores:" << endl;
+    cout << setw(12) << "processes" << setw(10) << "threads" << setw(16) << "MB/process" << setw(16) << "wall time (s)" << endl;
+    for(int q = 1; q*q <= totalCores; ++q) {
+        if((globalNx * 2 < q) || (globalNy * 2 < q))                            //rejected by the solver
+            break;
+
+        int perNode = (q*q + nodes - 1) / nodes;
+        int qThreads = std::max(1, coresPerNode / perNode);
+        bool fits = EstimateMemory(q) * perNode <= memoryPerNode;
+        double time = EstimateWallTime(q, qThreads);
+
+        cout << setw(12) << q*q << setw(10) << qThreads << setw(16) << EstimateMemory(q) / 1048576.0 << setw(16) << time
+             << (fits ? "" : "  exceeds memory") << endl;
+        if(fits && ((best == 0) || (time < bestTime))) {
+            best = q;
+            bestTime = time;
+        }
+    }
+
+    if(best > 0) {
+        int perNode = (best*best + nodes - 1) / nodes;
+        cout << "Suggested: " << best*best << " process(es) x " << std::max(1, coresPerNode / perNode) << " thread(s)" << endl;
+    }
+    else
+        cout << "WARNING: problem does not fit into memory for any split" << endl;
+}
+
+int CostModel::LocalPoints(int globalN, int p)
+{
+    return (globalN + p - 1) / p;                               //first processes take one extra point if not divisible
+}
+
+double CostModel::PointCost(int threads)
+{
+    //parallel efficiency measured by the benchmark, assume perfect scaling if only one thread could be measured
+    double efficiency = 1.0;
+    if(benchThreads > 1)
+        efficiency = std::min(std::max((pointCostSerial / pointCostThreaded - 1.0) / (benchThreads - 1), 0.0), 1.0);
+
+    return pointCostSerial / (1.0 + (threads - 1) * efficiency);
+}
+
+double CostModel::BenchmarkKernel(int n, int threads)
+{
+    //one iteration of SolverCG: stencil, preconditioner and the same BLAS vector operations, on fields of the local grid size
+    int npts = n*n;
+    double* x = new double[npts]();
+    double* r = new double[npts];
+    double* z = new double[npts]();
+    double* p = new double[npts];
+    double* t = new double[npts]();
+    std::fill(r, r + npts, 1.0);
+    std::fill(p, p + npts, 1.0);
+
+    int previousThreads = omp_get_max_threads();
+    omp_set_num_threads(threads);
+
+    double dx2i = 1.0/dx/dx;
+    double dy2i = 1.0/dy/dy;
+    double factor = 2.0*(dx2i + dy2i);
+    int iterations = 0;
+    double start = MPI_Wtime();
+    double elapsed = 0.0;
+
+    //repeat until long enough to time reliably, 0.05 s keeps the whole calibration well below a second
+    while((iterations < 3) || (elapsed < 0.05)) {
+        #pragma omp parallel for schedule(dynamic)
+        for(int j = 1; j < n - 1; ++j) {
+            for(int i = 1; i < n - 1; ++i) {
+                t[j*n + i] = ( - p[j*n + i - 1] + 2.0*p[j*n + i] - p[j*n + i + 1])*dx2i
+                           + ( - p[(j-1)*n + i] + 2.0*p[j*n + i] - p[(j+1)*n + i])*dy2i;
+            }
+        }
+
+        double alpha = cblas_ddot(npts, t, 1, p, 1) + cblas_ddot(npts, r, 1, z, 1);
+        alpha = 1e-12 / (1.0 + std::fabs(alpha));                  //tiny update keeps values bounded over many repetitions
+        cblas_daxpy(npts, alpha, p, 1, x, 1);
+        cblas_daxpy(npts, -alpha, t, 1, r, 1);
+        double eps = cblas_dnrm2(npts, r, 1);
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int j = 1; j < n - 1; ++j) {
+            for(int i = 1; i < n - 1; ++i)
+                z[j*n + i] = r[j*n + i] / factor;
+        }
+
+        double beta = 1e-12 * cblas_ddot(npts, r, 1, z, 1) / (1.0 + eps);
+        cblas_dcopy(npts, z, 1, t, 1);
+        cblas_daxpy(npts, beta, p, 1, t, 1);
+        cblas_dcopy(npts, t, 1, p, 1);
+
+        iterations++;
+        elapsed = MPI_Wtime() - start;
+    }
+
+    omp_set_num_threads(previousThreads);
+
+    delete[] x;
+    delete[] r;
+    delete[] z;
+    delete[] p;
+    delete[] t;
+
+    return elapsed / iterations / npts;
+}
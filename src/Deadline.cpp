@@ -0,0 +1,90 @@
+#include <cstring>
+using namespace std;
+
+#include <mpi.h>
+#include <signal.h>
+
+#include "Deadline.h"
+
+volatile sig_atomic_t Deadline::stopSignal = 0;
+
+Deadline::Deadline(MPI_Comm pComm, double pEnd, double pMargin)
+{
+    MPI_Comm_dup(pComm, &comm);
+    end = pEnd;
+    margin = pMargin;
+    last = MPI_Wtime();
+}
+
+Deadline::~Deadline()
+{
+    if(pending)
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    MPI_Comm_free(&comm);
+}
+
+bool Deadline::Update()
+{
+    double now = MPI_Wtime();
+    double latest = now - last;
+    last = now;
+    stepTime = (steps == 0) ? latest : 0.75*stepTime + 0.25*latest;     //first step includes warm-up, so it is soon forgotten
+    ++steps;
+
+    //outcome of the reduction started at the previous boundary, the same on all processes
+    if(pending) {
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        pending = false;
+        if(agreed[0] != None) {
+            reason = (Reason) agreed[0];
+            return true;
+        }
+    }
+
+    //the decision takes effect one step later, so the remaining budget must hold that step, one more for variation, and the margin
+    local[0] = None;
+    local[1] = stopSignal;
+    if((end > 0.0) && (now + 2.0*stepTime + margin > end))
+        local[0] = Budget;
+    if(local[1] != 0)
+        local[0] = Signal;
+    MPI_Iallreduce(local, agreed, 2, MPI_INT, MPI_MAX, comm, &request);
+    pending = true;
+    return false;
+}
+
+Deadline::Reason Deadline::GetReason()
+{
+    return reason;
+}
+
+int Deadline::GetStopSignal()
+{
+    return agreed[1];
+}
+
+double Deadline::GetStepTime()
+{
+    return stepTime;
+}
+
+void Deadline::InstallSignalHandlers()
+{
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = Handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
+int Deadline::GetSignal()
+{
+    return stopSignal;
+}
+
+void Deadline::Handler(int sig)
+{
+    stopSignal = sig;
+}
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+#include <mpi.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "EnergyMeter.h"
+
+EnergyMeter::EnergyMeter(MPI_Comm pComm, std::string pRoot)
+{
+    comm = pComm;
+    MPI_Comm_rank(comm, &rank);
+
+    //counters describe the whole node, so only the first process on each node reads them
+    MPI_Comm node;
+    int nodeRank;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &nodeRank);
+    MPI_Comm_free(&node);
+
+    if(nodeRank == 0) {
+        //package zones are the top level zones, e.g. intel-rapl:0; sub zones such as intel-rapl:0:0 (core, dram) are part of them
+        DIR* dir = opendir(pRoot.c_str());
+        struct dirent* entry;
+        while(dir && (entry = readdir(dir))) {
+            std::string name(entry->d_name);
+            size_t colon = name.find(':');
+            if((colon == std::string::npos) || (name.find(':', colon + 1) != std::string::npos))
+                continue;
+
+            std::string zone = pRoot + "/" + name;
+            long long value = ReadValue(zone + "/energy_uj");
+            long long range = ReadValue(zone + "/max_energy_range_uj");
+            if((value < 0) || (range <= 0))
+                continue;                                           //not readable without privileges
+
+            zones.push_back(zone + "/energy_uj");
+            maxRange.push_back(range);
+            last.push_back(value);
+        }
+        if(dir)
+            closedir(dir);
+    }
+}
+
+void EnergyMeter::Start(Phase phase)
+{
+    Sample();
+    startEnergy[phase] = accumulated;
+    startTime[phase] = MPI_Wtime();
+}
+
+void EnergyMeter::Stop(Phase phase, long long pUnits)
+{
+    Sample();
+    energy[phase] += accumulated - startEnergy[phase];
+    time[phase] += MPI_Wtime() - startTime[phase];
+    units[phase] += pUnits;
+}
+
+int EnergyMeter::GetNumZones() {
+    return zones.size();
+}
+
+double EnergyMeter::GetEnergy(Phase phase) {
+    return energy[phase] * 1e-6;
+}
+
+double EnergyMeter::GetTime(Phase phase) {
+    return time[phase];
+}
+
+long long EnergyMeter::GetUnits(Phase phase) {
+    return units[phase];
+}
+
+void EnergyMeter::Report(std::string label, std::string file)
+{
+    //energy summed over nodes, wall time of slowest process
+    int nodesRead = zones.empty() ? 0 : 1;
+    int nodesReadTotal;
+    long long energyTotal[NumPhases];
+    double timeMax[NumPhases];
+    MPI_Reduce(&nodesRead, &nodesReadTotal, 1, MPI_INT, MPI_SUM, 0, comm);
+    MPI_Reduce(energy, energyTotal, NumPhases, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(time, timeMax, NumPhases, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    if(rank != 0)
+        return;
+
+    const char* names[NumPhases] = {"Integrate", "Solve", "IO"};
+    const char* unitNames[NumPhases] = {"step", "CG iteration", "call"};
+
+    cout << "Energy (" << label << "):" << endl;
+    if(nodesReadTotal == 0)
+        cout << "  RAPL counters not available, reporting wall time only" << endl;
+
+    for(int k = 0; k < NumPhases; ++k) {
+        if(units[k] == 0)
+            continue;
+
+        double joules = energyTotal[k] * 1e-6;
+        cout << "  " << setw(10) << left << names[k] << right
+             << setw(12) << joules << " J" << setw(12) << timeMax[k] << " s"
+             << setw(12) << ((timeMax[k] > 0.0) ? joules / timeMax[k] : 0.0) << " W"
+             << setw(14) << joules / units[k] << " J/" << unitNames[k] << endl;
+    }
+
+    if(!file.empty()) {
+        //header only for a new file, so runs with different configurations collect in one table
+        std::ifstream exists(file.c_str());
+        bool header = !exists.good();
+        exists.close();
+
+        std::ofstream f(file.c_str(), std::ios::app);
+        if(header)
+            f << "configuration,nodes_measured,phase,energy_J,time_s,units,energy_per_unit_J" << "\n";
+        for(int k = 0; k < NumPhases; ++k) {
+            if(units[k] == 0)
+                continue;
+            f << label << "," << nodesReadTotal << "," << names[k] << "," << energyTotal[k] * 1e-6 << "," << timeMax[k] << ","
+              << units[k] << "," << energyTotal[k] * 1e-6 / units[k] << "\n";
+        }
+    }
+}
+
+void EnergyMeter::Sample()
+{
+    for(size_t z = 0; z < zones.size(); ++z) {
+        long long value = ReadValue(zones[z]);
+        if(value < 0)
+            continue;
+
+        //counter restarts from zero after reaching its maximum range
+        long long delta = value - last[z];
+        if(delta < 0)
+            delta += maxRange[z];
+        accumulated += delta;
+        last[z] = value;
+    }
+}
+
+long long EnergyMeter::ReadValue(const std::string& file)
+{
+    //plain system calls into a stack buffer, as counters are read around every Poisson solve, which must not allocate
+    char buffer[32];
+    int fd = open(file.c_str(), O_RDONLY);
+    if(fd < 0)
+        return -1;
+    ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if(n <= 0)
+        return -1;
+
+    buffer[n] = '\0';
+    char* end;
+    long long value = strtoll(buffer, &end, 10);
+    return (end == buffer) ? -1 : value;
+}
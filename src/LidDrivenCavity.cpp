@@ -1,8 +1,12 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <vector>
+#include <cfloat>
 using namespace std;
 
 #include <cblas.h>
@@ -17,10 +21,26 @@ using namespace std;
 #define IDX(I,J) ((J)*Nx + (I))
 
 #include "LidDrivenCavity.h"
+#include "BuddyCheckpoint.h"
+#include "Snapshot.h"
+#include "Renderer.h"
+#include "MetricsServer.h"
+#include "EnergyMeter.h"
+#include "Agglomeration.h"
+#include "Tracers.h"
+#include "StreamingPOD.h"
+#include "VectorOps.h"
 #include "SolverCG.h"
+#include "Deadline.h"
 
-LidDrivenCavity::LidDrivenCavity()
+LidDrivenCavity::LidDrivenCavity() : LidDrivenCavity(MPI_COMM_WORLD)
 {
+}
+
+LidDrivenCavity::LidDrivenCavity(MPI_Comm pComm)
+{
+    comm_world = pComm;
+
     //create Cartesian communicator and row and column communicators, also assigns size of row/column communicators
     CreateCartGrid(comm_Cart_grid,comm_row_grid,comm_col_grid);
     
@@ -43,8 +63,7 @@ LidDrivenCavity::LidDrivenCavity()
     globalLx = Lx;
     globalLy = Ly;                                                  //assign global values
 
-    SplitDomainMPI(comm_Cart_grid,globalNx,globalNy,globalLx, globalLy, Nx, Ny, Lx, Ly,xDomainStart,yDomainStart);
-    UpdateDxDy();
+    UpdateDxDy();                                                   //the domain is split once the configuration is complete, see Decompose
 }
 
 LidDrivenCavity::~LidDrivenCavity()
@@ -71,16 +90,23 @@ double LidDrivenCavity::GetDx() {
 double LidDrivenCavity::GetDy() {
     return dy;
 }   
+
+int LidDrivenCavity::GetStep() {
+    return step;
+}
     
 int LidDrivenCavity::GetNx() {
+    Decompose();
     return Nx;
 }
 
 int LidDrivenCavity::GetNy() {
+    Decompose();
     return Ny;
 }
 
 int LidDrivenCavity::GetNpts() {
+    Decompose();
     return Nx*Ny;
 }
 
@@ -89,10 +115,12 @@ int LidDrivenCavity::GetGlobalNpts() {
 }
 
 double LidDrivenCavity::GetLx() {
+    Decompose();
     return Lx;
 }    
 
 double LidDrivenCavity::GetLy() {
+    Decompose();
     return Ly;
 }    
 
@@ -131,14 +159,83 @@ void LidDrivenCavity::GetData(double* vOut, double* sOut) {
     cblas_dcopy(Npts,s,1,sOut,1);
 }
 
+void LidDrivenCavity::GetState(double* vOut, double* sOut) {
+    cblas_dcopy(Npts,vNext,1,vOut,1);                               //vNext holds the latest vorticity, as in WriteSolution
+    cblas_dcopy(Npts,s,1,sOut,1);
+}
+
+void LidDrivenCavity::GatherSolution(double* vOut, double* sOut, double* u0Out, double* u1Out)
+{
+    int worldRank, worldSize;
+    MPI_Comm_rank(comm_world, &worldRank);
+    MPI_Comm_size(comm_world, &worldSize);
+
+    ComputeVelocity(ux,uy);
+
+    //root learns the position and size of the local domain of every process, then receives each domain contiguously
+    int block[4] = {xDomainStart, yDomainStart, Nx, Ny};
+    int* blocks = nullptr;
+    int* counts = nullptr;
+    int* displs = nullptr;
+    double* recv = nullptr;
+    if(worldRank == 0) {
+        blocks = new int[4*worldSize];
+        counts = new int[worldSize];
+        displs = new int[worldSize];
+        recv = new double[globalNx*globalNy];
+    }
+    MPI_Gather(block,4,MPI_INT,blocks,4,MPI_INT,0,comm_world);
+
+    if(worldRank == 0) {
+        int offset = 0;
+        for(int r = 0; r < worldSize; ++r) {
+            counts[r] = blocks[4*r+2] * blocks[4*r+3];
+            displs[r] = offset;
+            offset += counts[r];
+        }
+    }
+
+    double* local[4] = {vNext, s, ux, uy};                          //vNext holds the latest vorticity, as in WriteSolution
+    double* global[4] = {vOut, sOut, u0Out, u1Out};
+    for(int f = 0; f < 4; ++f) {
+        MPI_Gatherv(local[f],Npts,MPI_DOUBLE,recv,counts,displs,MPI_DOUBLE,0,comm_world);
+
+        if(worldRank == 0) {
+            for(int r = 0; r < worldSize; ++r) {
+                int x0 = blocks[4*r], y0 = blocks[4*r+1], nx = blocks[4*r+2], ny = blocks[4*r+3];
+                for(int j = 0; j < ny; ++j)
+                    for(int i = 0; i < nx; ++i)
+                        global[f][(y0 + j)*globalNx + x0 + i] = recv[displs[r] + j*nx + i];
+            }
+        }
+    }
+
+    delete[] blocks;
+    delete[] counts;
+    delete[] displs;
+    delete[] recv;
+}
+
+void LidDrivenCavity::SetState(double* vIn, double* sIn) {
+    cblas_dcopy(Npts,vIn,1,vNext,1);
+    cblas_dcopy(Npts,sIn,1,s,1);                                    //v is recomputed from s at the start of the next time step
+    step = 0;
+}
+
+void LidDrivenCavity::SetVerbose(bool pVerbose) {
+    verbose = pVerbose;
+    if(poisson)
+        poisson->SetVerbose(verbose);
+}
+
 void LidDrivenCavity::SetDomainSize(double xlen, double ylen)
 {
     //global values are entered and stored
     globalLx = xlen;
     globalLy = ylen;
 
-    //update local domain with right size and values
-    SplitDomainMPI(comm_Cart_grid, globalNx, globalNy, globalLx, globalLy,Nx, Ny, Lx,Ly,xDomainStart,yDomainStart);
+    //local domain is split again when next needed
+    decomposed = false;
     UpdateDxDy();
 }
 
@@ -147,10 +244,31 @@ void LidDrivenCavity::SetGridSize(int nx, int ny)
     globalNx = nx;
     globalNy = ny;
 
-    SplitDomainMPI(comm_Cart_grid, globalNx, globalNy, globalLx, globalLy,Nx, Ny, Lx,Ly,xDomainStart,yDomainStart);
+    decomposed = false;
     UpdateDxDy();
 }
 
+void LidDrivenCavity::Configure(const CavityConfig& config)
+{
+    globalLx = config.GetLx();
+    globalLy = config.GetLy();
+    globalNx = config.GetNx();
+    globalNy = config.GetNy();
+    dt = config.GetDt();
+    T = config.GetT();
+    Re = config.GetRe();
+    nu = 1.0/config.GetRe();
+    implicitTheta = config.GetTheta();
+
+    decomposed = false;
+    UpdateDxDy();
+}
+
+CavityConfig LidDrivenCavity::GetConfig()
+{
+    return CavityConfig(globalLx,globalLy,globalNx,globalNy,dt,T,Re,implicitTheta);
+}
+
 void LidDrivenCavity::SetTimeStep(double deltat)
 {
     this->dt = deltat;
@@ -168,16 +286,287 @@ void LidDrivenCavity::SetReynoldsNumber(double re)
     this->nu = 1.0/re;
 }
 
+void LidDrivenCavity::SetCheckpoint(int interval, int flush, std::string dir)
+{
+    checkpointInterval = interval;
+    flushInterval = flush;
+    checkpointDir = dir;
+}
+
+void LidDrivenCavity::SetSnapshotOutput(std::string file, int interval)
+{
+    snapshotFile = file;
+    snapshotInterval = interval;
+}
+
+void LidDrivenCavity::SetTracers(long long count, std::string prefix, int interval)
+{
+    tracerCount = count;
+    tracerPrefix = prefix;
+    tracerInterval = interval;
+}
+
+Tracers* LidDrivenCavity::GetTracers() {
+    return tracers;
+}
+
+void LidDrivenCavity::SetPOD(int modes, std::string file, int interval, int writeInterval)
+{
+    podModes = modes;
+    podFile = file;
+    podInterval = interval;
+    podWriteInterval = writeInterval;
+}
+
+StreamingPOD* LidDrivenCavity::GetPOD() {
+    return pod;
+}
+
+void LidDrivenCavity::SetRendering(std::string prefix, int interval, int width)
+{
+    renderPrefix = prefix;
+    renderInterval = interval;
+    renderWidth = width;
+}
+
+void LidDrivenCavity::SetMetricsEndpoint(std::string address)
+{
+    metricsAddress = address;
+}
+
+void LidDrivenCavity::SetAgglomeration(int minPoints)
+{
+    agglomerateMinPoints = minPoints;
+}
+
+bool LidDrivenCavity::IsAgglomerated() {
+    return poisson && (poissonName == "pcg-agglomerated");
+}
+
+bool LidDrivenCavity::SetPoissonSolver(std::string name)
+{
+    std::vector<std::string> names = PoissonSolver::GetNames();
+    if((name != "auto") && (name != "measure") && (std::find(names.begin(), names.end(), name) == names.end()))
+        return false;
+    poissonRequested = name;
+    return true;
+}
+
+std::string LidDrivenCavity::GetPoissonSolver() {
+    return poissonName;
+}
+
+void LidDrivenCavity::SetFusedResidual(bool enable)
+{
+    fusedResidual = enable;
+}
+
+void LidDrivenCavity::SetAdaptiveTolerance(double relative, double stepFactor, int transientSteps)
+{
+    toleranceRelative = relative;
+    toleranceStep = stepFactor;
+    toleranceTransient = transientSteps;
+}
+
+void LidDrivenCavity::SetImplicit(double theta, double tolerance)
+{
+    implicitTheta = theta;
+    newtonTol = tolerance;
+}
+
+int LidDrivenCavity::GetNewtonIterations() {
+    return newtonIterations;
+}
+
+void LidDrivenCavity::SetEnergyMeasurement(bool enable)
+{
+    measureEnergy = enable;
+}
+
+void LidDrivenCavity::ReportEnergy(std::string file)
+{
+    if(!energyMeter)
+        return;
+
+    //configuration label distinguishes runs that are appended to the same file, it is a CSV field so has no commas
+    std::stringstream label;
+    label << size << " processes x " << omp_get_max_threads() << " threads double " << poissonName;
+    if(implicitTheta > 0.0)
+        label << " implicit theta " << implicitTheta;
+    energyMeter->Report(label.str(), file);
+}
+
+BuddyCheckpoint* LidDrivenCavity::CreateCheckpoint(std::string dir, int flush)
+{
+    BuddyCheckpoint* created = new BuddyCheckpoint(Npts,comm_Cart_grid,dir,flush);
+    created->SetProblem(globalNx,globalNy,globalLx,globalLy,dt,Re);
+    return created;
+}
+
+bool LidDrivenCavity::RecoverCheckpoint()
+{
+    if(!checkpoint)
+        checkpoint = CreateCheckpoint(checkpointDir,flushInterval);
+
+    //vNext is what is written out and s is all that is needed to continue, v is recomputed from s at next step
+    int recoveredStep = -1;
+    bool found = checkpoint->Recover(vNext, s, recoveredStep);
+
+    //a run stopped early leaves its checkpoint in the resume directory, the later of the two checkpoints is resumed from
+    if(resumeDir != checkpointDir) {
+        BuddyCheckpoint* resume = CreateCheckpoint(resumeDir,0);
+        int resumeStep;
+        if(resume->Recover(tmp, ux, resumeStep) && (!found || (resumeStep > recoveredStep))) {
+            cblas_dcopy(Npts,tmp,1,vNext,1);                        //tmp and ux are work arrays, overwritten before they are read
+            cblas_dcopy(Npts,ux,1,s,1);
+            recoveredStep = resumeStep;
+            found = true;
+        }
+        delete resume;
+    }
+
+    if(!found)
+        return false;
+    step = recoveredStep;
+    return true;
+}
+
+void LidDrivenCavity::SetResumeDir(std::string dir)
+{
+    resumeDir = dir;
+}
+
+void LidDrivenCavity::SetWalltime(double budget, double margin)
+{
+    walltimeBudget = budget;
+    walltimeEnd = (budget > 0.0) ? MPI_Wtime() + budget : 0.0;
+    walltimeMargin = margin;
+}
+
+void LidDrivenCavity::SetStopOnSignal(bool enable)
+{
+    stopOnSignal = enable;
+    if(enable)
+        Deadline::InstallSignalHandlers();
+}
+
+bool LidDrivenCavity::IsStopped() {
+    return stopped;
+}
+
+std::string LidDrivenCavity::GetStopReason()
+{
+    if(!stopped)
+        return "";
+    return (deadline->GetReason() == Deadline::Signal) ? "signal " + std::to_string(deadline->GetStopSignal()) : "wall-clock budget";
+}
+
 void LidDrivenCavity::Initialise()
 {
-    CleanUp();
+    CleanUpOptional();
+    Decompose();
+
+    //reuse arrays and the Poisson solver if the local problem is unchanged, so repeated initialisation does not allocate
+    bool sameGrid = v && (poissonProblem.Nx == Nx) && (poissonProblem.Ny == Ny) && (poissonProblem.dx == dx) && (poissonProblem.dy == dy);
+    if(sameGrid) {
+        std::fill(v, v+Npts, 0.0);
+        std::fill(vNext, vNext+Npts, 0.0);
+        std::fill(s, s+Npts, 0.0);
+        std::fill(tmp, tmp+Npts, 0.0);
+        std::fill(ux, ux+Npts, 0.0);
+        std::fill(uy, uy+Npts, 0.0);
+        std::fill(vTopData, vTopData+Nx, 0.0);
+        std::fill(vBottomData, vBottomData+Nx, 0.0);
+        std::fill(vLeftData, vLeftData+Ny, 0.0);
+        std::fill(vRightData, vRightData+Ny, 0.0);
+        std::fill(sTopData, sTopData+Nx, 0.0);
+        std::fill(sBottomData, sBottomData+Nx, 0.0);
+        std::fill(sLeftData, sLeftData+Ny, 0.0);
+        std::fill(sRightData, sRightData+Ny, 0.0);
+    }
+    else {
+        CleanUp();
+        Allocate();
+    }
+
+    //the backend is only selected again if the grid or the selection changed, as measuring it takes several solves
+    if(sameGrid && poisson && (poissonProblem.minPoints == agglomerateMinPoints) && (poissonSelection == poissonRequested))
+        poisson->Reset();
+    else
+        CreatePoissonSolver();
+    poisson->SetVerbose(verbose);
+
+    step = 0;
+    if(checkpointInterval > 0)
+        checkpoint = CreateCheckpoint(checkpointDir,flushInterval);
+
+    lastSnapshotStep = -1;
+    if(!snapshotFile.empty()) {
+        std::string names[4] = {"v", "s", "u0", "u1"};              //same fields as WriteSolution
+        snapshot = new SnapshotWriter(snapshotFile,4,names,globalNx,globalNy,globalLx,globalLy,comm_Cart_grid);
+    }
+
+    if(!renderPrefix.empty()) {
+        int renderHeight = std::max(1, (int) round(renderWidth * globalLy / globalLx));     //keep aspect ratio of domain
+        renderer = new Renderer(renderWidth,renderHeight,16,globalNx,globalNy,xDomainStart,yDomainStart,Nx,Ny,comm_Cart_grid);
+    }
+
+    lastTracerStep = -1;
+    if(tracerCount > 0)
+        tracers = new Tracers(tracerCount,globalNx,globalNy,dx,dy,xDomainStart,yDomainStart,Nx,Ny,comm_row_grid,comm_col_grid);
+
+    lastPODStep = -1;
+    if(podModes > 0) {
+        pod = new StreamingPOD(podModes,podModes,globalNx,globalNy,xDomainStart,yDomainStart,Nx,Ny,comm_Cart_grid);
+        if(podInterval > 0)
+            pod->Reserve(ceil(T/dt)/podInterval);                   //snapshots of the whole run, so none is stored by reallocating
+    }
+
+    if(measureEnergy)
+        energyMeter = new EnergyMeter(comm_Cart_grid);
+
+    stopped = false;
+    if((walltimeBudget > 0.0) || stopOnSignal)
+        deadline = new Deadline(comm_Cart_grid, walltimeEnd, walltimeMargin);
+
+    if(!metricsAddress.empty() && (rowRank == 0) && (colRank == 0))      //CG iterations and residual are global, so root suffices
+        metrics = new MetricsServer(metricsAddress);
+}
+
+void LidDrivenCavity::CreatePoissonSolver()
+{
+    delete poisson;
+    poissonProblem = {Nx, Ny, dx, dy, xDomainStart, yDomainStart, globalNx, globalNy, agglomerateMinPoints,
+                      comm_Cart_grid, comm_row_grid, comm_col_grid};
+    poissonSelection = poissonRequested;
+
+    if(poissonRequested == "measure") {
+        poisson = PoissonSolver::Measure(poissonProblem, 1e-6, poissonName, verbose);
+    }
+    else {
+        poissonName = (poissonRequested == "auto") ? PoissonSolver::Recommend(poissonProblem) : poissonRequested;
+        poisson = PoissonSolver::Create(poissonName, poissonProblem);
+    }
+
+    //a backend that does not apply to the grid falls back to the solver on all processes
+    if(!poisson) {
+        poissonName = "pcg";
+        poisson = PoissonSolver::Create(poissonName, poissonProblem);
+    }
 
+    if(verbose && (rowRank == 0) && (colRank == 0))
+        cout << "Poisson solver selected: " << poissonName << endl;
+}
+
+void LidDrivenCavity::Allocate()
+{
     // v-> vorticity, s-> streamfunction
     v   = new double[Npts]();
     vNext = new double[Npts]();     //v at next time step
     s   = new double[Npts]();
     tmp = new double[Npts]();
-    cg  = new SolverCG(Nx, Ny, dx, dy,comm_row_grid,comm_col_grid);
+    ux  = new double[Npts]();
+    uy  = new double[Npts]();
     
     //store data from neighbouring processes here (leftData => data from left process)
     vTopData = new double[Nx]();                                        //top and bottom data row have size local 1 x Nx
@@ -196,56 +585,142 @@ void LidDrivenCavity::Initialise()
 
 void LidDrivenCavity::Integrate()
 {
-    int NSteps = ceil(T/dt);                                        //number of time steps required
-    for (int t = 0; t < NSteps; ++t)
+    IntegrateTo(ceil(T/dt));                                        //number of time steps required
+}
+
+void LidDrivenCavity::IntegrateTo(int NSteps)
+{
+    if(metrics)
+        metrics->SetRun(step, NSteps, dt);
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::Integrate);
+    int firstStep = step;
+    stopped = false;
+
+    for (int t = step; t < NSteps; ++t)                             //start from current step, which is non-zero after a recovery
     {
-        if((rowRank == 0) && (colRank == 0)) {                      //only print on root rank
+        if(verbose && (rowRank == 0) && (colRank == 0)) {           //only print on root rank
             std::cout << "Step: " << setw(8) << t
                       << "  Time: " << setw(8) << t*dt
                       << std::endl;                                 //after each step, output time and step information
         }
+        //tracers take a forward Euler step with the velocity at the start of the step, as the vorticity
+        if(tracers) {
+            ComputeVelocity(ux,uy);
+            tracers->Advect(ux,uy,dt);
+        }
+
         Advance();                                                  //compute flow properties across domain for next time step
+        step = t + 1;
+
+        if(metrics)
+            metrics->Update(step, solveIterations, solveResidual);          //lock-free, served by background thread
+
+        //in-memory checkpoint only costs a copy and a neighbour exchange, flushing to storage happens in the background
+        if(checkpoint && (checkpointInterval > 0) && (step % checkpointInterval == 0))
+            checkpoint->Store(vNext, s, step);
+
+        if(snapshot && (snapshotInterval > 0) && (step % snapshotInterval == 0))
+            WriteSnapshot();
+
+        if(renderer && (renderInterval > 0) && (step % renderInterval == 0))
+            RenderFrame();
+
+        if(tracers && (tracerInterval > 0) && (step % tracerInterval == 0))
+            WriteTracers();
+
+        //only the modes and coefficients are kept, a batch of snapshots at a time
+        if(pod && (podInterval > 0) && (step % podInterval == 0))
+            pod->Add(vNext, step*dt);
+
+        if(pod && (podWriteInterval > 0) && (step % podWriteInterval == 0))
+            WritePOD();
+
+        //all processes stop at the same step boundary before the budget runs out or after a stop signal
+        if(deadline && deadline->Update()) {
+            stopped = true;
+            break;
+        }
     }
+
+    //checkpoint of the step reached is flushed whatever the checkpoint interval, so RecoverCheckpoint resumes from it
+    //node-local storage is usually wiped after the job, so it goes to the resume directory for the next job
+    if(stopped) {
+        bool periodic = checkpoint && (resumeDir == checkpointDir);  //periodic checkpoint also flushes there, so must not be raced
+        BuddyCheckpoint* resume = periodic ? checkpoint : CreateCheckpoint(resumeDir,0);
+        resume->Store(vNext, s, step);
+        resume->Flush();
+        resume->WaitForFlush();
+        if(!periodic)
+            delete resume;
+    }
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::Integrate, step - firstStep);
 }
 
 void LidDrivenCavity::WriteSolution(std::string file)
 {
-    //compute velocities locally before sending -> faster than gathering then calculating
-    double* u0 = new double[Nx*Ny]();                                                   //u0 is horizontal x velocity
-    double* u1 = new double[Nx*Ny]();                                                   //u1 is vertical y velocity
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::IO);
 
-    ComputeVelocity(u0,u1);
+    //velocities are computed while packing each chunk, which only needs the streamfunction above and to the right, as ComputeVelocity
+    MPI_Isend(s, Nx, MPI_DOUBLE, bottomRank, 1, comm_col_grid,&requests[1]);            //tag = 1 -> streamfunction data sent down
+    cblas_dcopy(Ny,s,Nx,tempLeft,1);
+    MPI_Isend(tempLeft,Ny,MPI_DOUBLE,leftRank, 2, comm_row_grid,&requests[2]);          //tag = 2 -> streamfunction data sent left
+    MPI_Recv(sTopData,Nx,MPI_DOUBLE,topRank,1,comm_col_grid,MPI_STATUS_IGNORE);
+    MPI_Recv(sRightData,Ny,MPI_DOUBLE,rightRank,2,comm_row_grid,MPI_STATUS_IGNORE);
+    MPI_Waitall(2,requests+1,MPI_STATUSES_IGNORE);
 
     //------------------------------------------Gather Data to Write Solution to File--------------------------------------------------------------//
-    /*Data stored in row major format and printed columnwise. Gather all data at root of each column communicator
-    Root column process (bottom row of grid) holds all data for the entire column, can print columns sequentially from left to right
+    /*Data stored in row major format and printed columnwise. Gather data at root of each column communicator a chunk of columns at a time
+    Root column process (bottom row of grid) receives the next chunk while it writes the current one, can print columns sequentially from left to right
     Root column processes have rank colRank = 0 and share a row communicator (exploits sequential labelling of ranks in Cartesian subgrids row and columns)*/
 
-    double* sAllCol = new double[Nx*globalNy]();
-    double* vAllCol = new double[Nx*globalNy]();
-    double* u0AllCol = new double[Nx*globalNy]();
-    double* u1AllCol = new double[Nx*globalNy]();         
-
-    //using GatherV as each process holds different number of data
-    int* colRecDataNum = new int[size];         //how many data points to be received from each process in column communicator
-    int* relativeDisp = new int[size];          //where data should be stored relative to send buffer pointer
-    int rel = yDomainStart*Nx;                  //where current process data would go in the column communicator gathered matrix
+    //kept between calls, so repeated output does not allocate; receive buffers are only significant at the root
+    if(!colNy) {
+        colNy = new int[size];                  //how many rows each process in column communicator holds
+        colRecDataNum = new int[2*size];        //how many data points to be received from each process, for each chunk in flight
+        relativeDisp = new int[2*size];         //where data should be stored relative to receive buffer pointer
+    }
+    if(!chunkSend) {
+        chunkSend = new double[2*4*outputChunk*Ny];
+        if(colRank == 0)
+            chunkRecv = new double[2*4*outputChunk*globalNy];
+    }
+    MPI_Gather(&Ny,1,MPI_INT,colNy,1,MPI_INT,0,comm_col_grid);                          //root needs this info for Igatherv
+
+    int colSize;
+    MPI_Comm_size(comm_col_grid,&colSize);
+    int chunks = (Nx + outputChunk - 1) / outputChunk;
+    MPI_Request gather[2];
+
+    //pack chunk c into buffer c%2 and start gathering it; column ranks ascend with y, so the root receives the column bottom to top
+    auto startChunk = [&](int c) {
+        int b = c % 2;
+        int columns = std::min(outputChunk, Nx - c*outputChunk);
+        double* send = chunkSend + b*4*outputChunk*Ny;
+        double* recv = nullptr;
+        PackOutputChunk(c*outputChunk, columns, send);
+        if(colRank == 0) {
+            recv = chunkRecv + b*4*outputChunk*globalNy;
+            int offset = 0;
+            for(int r = 0; r < colSize; ++r) {
+                colRecDataNum[b*size + r] = 4*columns*colNy[r];
+                relativeDisp[b*size + r] = offset;
+                offset += colRecDataNum[b*size + r];
+            }
+        }
+        MPI_Igatherv(send,4*columns*Ny,MPI_DOUBLE,recv,colRecDataNum + b*size,relativeDisp + b*size,MPI_DOUBLE,0,comm_col_grid,&gather[b]);
+    };
 
-    MPI_Gather(&Npts,1,MPI_INT,colRecDataNum+colRank,1,MPI_INT,0,comm_col_grid);        //root needs this info for Gatherv
-    MPI_Gather(&rel,1,MPI_INT,relativeDisp+colRank,1,MPI_INT,0,comm_col_grid);
+    startChunk(0);                                                      //first chunk is in flight while waiting for the left column
 
-    //send local data for s and v of each process to correct place in root column; AllCol now data for the entire column communicator
-    MPI_Gatherv(s,Npts,MPI_DOUBLE,sAllCol,colRecDataNum,relativeDisp,MPI_DOUBLE,0,comm_col_grid);       
-    MPI_Gatherv(vNext,Npts,MPI_DOUBLE,vAllCol,colRecDataNum,relativeDisp,MPI_DOUBLE,0,comm_col_grid);       
-    MPI_Gatherv(u0,Npts,MPI_DOUBLE,u0AllCol,colRecDataNum,relativeDisp,MPI_DOUBLE,0,comm_col_grid);       
-    MPI_Gatherv(u1,Npts,MPI_DOUBLE,u1AllCol,colRecDataNum,relativeDisp,MPI_DOUBLE,0,comm_col_grid);   
+    std::ofstream f;
+    int goAheadMessage = 0;                                             //Receive buffer that will be used to end a blocking receive on the adjacent column rank
 
-    //only root column ranks can write to file
+    //only root column ranks can write to file, left column first (rowRank = 0) to right (row communnicator ranks ordered from left to right)
     if(colRank == 0) {
-        std::ofstream f;
-        int goAheadMessage = 0;                                         //Receive buffer that will be used to end a blocking receive on the adjacent column rank
-
-        //write left column first (rowRank = 0) to right (row communnicator ranks ordered from left to right)
         if(rowRank == 0) {
             //for row rank 0 (prints data first) open file to overwrite
             f.open(file.c_str(),std::ios::trunc);
@@ -256,33 +731,137 @@ void LidDrivenCavity::WriteSolution(std::string file)
             MPI_Recv(&goAheadMessage,1,MPI_INT,leftRank,10,comm_row_grid,MPI_STATUS_IGNORE);
             f.open(file.c_str(),std::ios::app);                         //other processes should append data to file
         }
-        
-        int k = 0;
-        for (int i = 0; i < Nx; ++i)
-        {
-            for (int j = 0; j < globalNy; ++j)                                  //print data in columns
+    }
+
+    for(int c = 0; c < chunks; ++c) {
+        //buffer of the next chunk was released by waiting for the previous one
+        if(c + 1 < chunks)
+            startChunk(c + 1);
+        MPI_Wait(&gather[c % 2],MPI_STATUS_IGNORE);
+
+        if(colRank == 0) {
+            int b = c % 2;
+            int columns = std::min(outputChunk, Nx - c*outputChunk);
+            const double* data = chunkRecv + b*4*outputChunk*globalNy;
+            for(int i = 0; i < columns; ++i)
             {
-                k = IDX(i, j);
-                f << (i + xDomainStart) * dx << " " << (j + yDomainStart) * dy  //i+xDomainStart accounts for where local column starts in the global x direction
-                << " " << vAllCol[k] <<  " " << sAllCol[k]                      //on each line in file, print the grid location (x,y), vorticity...
-                << " " << u0AllCol[k] << " " << u1AllCol[k] << std::endl;       //streamfunction, x velocity, y velocity at that grid location
-            }
-            f << std::endl;                                                     //After printing all (y) data for column in grid, proceed to next column...
-        }                                                                       //with a space to differentiate between each column
+                int j = 0;                                                      //global row, root column process is at the bottom
+                for(int r = 0; r < colSize; ++r)
+                {
+                    const double* block = data + relativeDisp[b*size + r] + 4*i*colNy[r];
+                    for(int k = 0; k < 4*colNy[r]; k += 4, ++j)                 //print data in columns
+                    {
+                        f << (c*outputChunk + i + xDomainStart) * dx << " " << j * dy   //c*outputChunk+i+xDomainStart accounts for where column starts in the global x direction
+                        << " " << block[k] <<  " " << block[k+1]                //on each line in file, print the grid location (x,y), vorticity...
+                        << " " << block[k+2] << " " << block[k+3] << "\n";      //streamfunction, x velocity, y velocity at that grid location
+                    }
+                }
+                f << "\n";                                                      //After printing all (y) data for column in grid, proceed to next column...
+            }                                                                   //with a space to differentiate between each column
+        }
+    }
+
+    if(colRank == 0) {
         f.close();
 
         //writing done for this process, tell next process to go by sending a message to unblock the next root column process
         MPI_Send(&goAheadMessage,1,MPI_INT,rightRank,10,comm_row_grid);
     }
 
-    delete[] u0;
-    delete[] u1;
-    delete[] sAllCol;
-    delete[] vAllCol;
-    delete[] u0AllCol;
-    delete[] u1AllCol;
     //ensure all processes have finished writing before proceeding, prevents access errors if file to be opened after function call
-    MPI_Barrier(MPI_COMM_WORLD);                                                
+    MPI_Barrier(comm_Cart_grid);                                                
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::IO);
+}
+
+void LidDrivenCavity::SetOutputChunk(int columns)
+{
+    outputChunk = std::max(1, columns);
+    delete[] chunkSend;                                             //buffers are sized by the chunk, so reallocated by the next WriteSolution
+    delete[] chunkRecv;
+    chunkSend = chunkRecv = nullptr;
+}
+
+void LidDrivenCavity::PackOutputChunk(int i0, int columns, double* buffer)
+{
+    //vNext holds the latest vorticity
+    for(int i = 0; i < columns; ++i) {
+        for(int j = 0; j < Ny; ++j) {
+            double* point = buffer + 4*(i*Ny + j);
+            point[0] = vNext[IDX(i0 + i, j)];
+            point[1] = s[IDX(i0 + i, j)];
+            ComputeVelocityAt(i0 + i, j, point[2], point[3]);
+        }
+    }
+}
+
+void LidDrivenCavity::WriteSnapshot()
+{
+    if(!snapshot || (step == lastSnapshotStep))
+        return;
+
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::IO);
+
+    ComputeVelocity(ux,uy);
+
+    //vNext holds the latest vorticity, as in WriteSolution
+    double* fields[4] = {vNext, s, ux, uy};
+    snapshot->Write(step,step*dt,xDomainStart,yDomainStart,Nx,Ny,fields);
+    lastSnapshotStep = step;
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::IO);
+}
+
+void LidDrivenCavity::RenderFrame()
+{
+    if(!renderer || (step == lastRenderStep))
+        return;
+    lastRenderStep = step;
+
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::IO);
+
+    std::stringstream file;
+    file << renderPrefix << "_" << setw(6) << setfill('0') << step << ".ppm";
+    renderer->Render(vNext, s, file.str());                         //vNext holds the latest vorticity, as in WriteSolution
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::IO);
+}
+
+void LidDrivenCavity::WriteTracers()
+{
+    if(!tracers || (step == lastTracerStep))
+        return;
+    lastTracerStep = step;
+
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::IO);
+
+    std::stringstream file;
+    file << tracerPrefix << "_" << setw(6) << setfill('0') << step << ".part";
+    tracers->Write(file.str(), step, step*dt, comm_Cart_grid);
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::IO);
+}
+
+void LidDrivenCavity::WritePOD()
+{
+    if(!pod || (step == lastPODStep))
+        return;
+    lastPODStep = step;
+
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::IO);
+
+    pod->Write(podFile, step, step*dt);
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::IO);
 }
 
 void LidDrivenCavity::PrintConfiguration()
@@ -295,14 +874,34 @@ void LidDrivenCavity::PrintConfiguration()
         cout << "Timestep:  " << dt << endl;
         cout << "Steps:     " << ceil(T/dt) << endl;
         cout << "Reynolds number: " << Re << endl;
-        cout << "Linear solver: preconditioned conjugate gradient" << endl;
+        cout << "Linear solver: " << poissonRequested << " Poisson solver";      //the backend is selected at initialisation
+        if(!poissonName.empty())
+            cout << ", selected " << poissonName;
+        cout << endl;
+        cout << "Vector ops: " << VectorOps::GetBackendName() << endl;
+        int p = round(sqrt(size));
+        int q = Agglomeration::ChooseGridSize(globalNx*globalNy, p, agglomerateMinPoints);
+        if((q < p) && ((poissonRequested == "auto") || (poissonRequested == "pcg-agglomerated")))
+            cout << "Poisson solve agglomerated onto " << q << " x " << q << " processes" << endl;
+        if((toleranceRelative > 0.0) || (toleranceStep > 0.0))
+            cout << "Poisson tolerance: adaptive, " << toleranceRelative << " of |v|, " << toleranceStep << " of step change, "
+                 << toleranceTransient << " transient steps" << endl;
+        if(implicitTheta > 0.0)
+            cout << "Time stepping: implicit theta = " << implicitTheta << ", Newton tolerance " << newtonTol << endl;
+        if(tracerCount > 0)
+            cout << "Tracers:   " << tracerCount << endl;
+        if(podModes > 0)
+            cout << "POD:       " << podModes << " modes of the vorticity every " << podInterval << " steps" << endl;
+        if(walltimeBudget > 0.0)
+            cout << "Wall-clock budget: " << walltimeBudget << " s, " << walltimeMargin << " s kept for the checkpoint" << endl;
         cout << endl;
     }
     
-    if (nu * dt / dx / dy > 0.25) {                                             //if timestep restriction not satisfied, terminate the program
+    double maxTimeStep = GetConfig().GetMaxTimeStep();
+    if (dt > maxTimeStep) {                                                     //if timestep restriction not satisfied, terminate the program
         if((rowRank == 0) && (colRank == 0)) {
             cout << "ERROR: Time-step restriction not satisfied!" << endl;
-            cout << "Maximum time-step is " << 0.25 * dx * dy / nu << endl;
+            cout << "Maximum time-step is " << maxTimeStep << endl;
         }
 
         MPI_Finalize();
@@ -317,7 +916,8 @@ void LidDrivenCavity::CleanUp()
         delete[] vNext;
         delete[] s;
         delete[] tmp;
-        delete cg;
+        delete[] ux;
+        delete[] uy;
         
         delete[] vTopData;
         delete[] vBottomData;
@@ -331,7 +931,44 @@ void LidDrivenCavity::CleanUp()
 
         delete[] tempLeft;
         delete[] tempRight;
+        v = nullptr;                                                //arrays may be reallocated by Initialise
     }
+
+    delete[] chunkSend;
+    delete[] chunkRecv;
+    delete[] colNy;
+    delete[] colRecDataNum;
+    delete[] relativeDisp;
+    chunkSend = chunkRecv = nullptr;
+    colNy = colRecDataNum = relativeDisp = nullptr;
+    delete poisson;
+    poisson = nullptr;
+    delete diffusion;
+    diffusion = nullptr;
+    delete[] implicitWork;
+    implicitWork = nullptr;
+
+    CleanUpOptional();
+}
+
+void LidDrivenCavity::CleanUpOptional()
+{
+    delete checkpoint;
+    checkpoint = nullptr;                                           //only created when enabled, so must not be deleted twice
+    delete snapshot;                                                //closes snapshot file
+    snapshot = nullptr;
+    delete renderer;
+    renderer = nullptr;
+    delete tracers;
+    tracers = nullptr;
+    delete pod;
+    pod = nullptr;
+    delete metrics;
+    metrics = nullptr;
+    delete energyMeter;
+    energyMeter = nullptr;
+    delete deadline;
+    deadline = nullptr;
 }
 
 void LidDrivenCavity::UpdateDxDy()
@@ -339,20 +976,263 @@ void LidDrivenCavity::UpdateDxDy()
     //calculate new spatial steps dx and dy based off current global grid numbers (Nx,Ny) and domain size (Lx,Ly)
     dx = globalLx / (globalNx-1);       
     dy = globalLy / (globalNy-1);
-    
+}
+
+void LidDrivenCavity::Decompose()
+{
+    if(decomposed)
+        return;
+
+    SplitDomainMPI(comm_Cart_grid, globalNx, globalNy, globalLx, globalLy, Nx, Ny, Lx, Ly, xDomainStart, yDomainStart);
     Npts = Nx * Ny;                 //total number of local grid points
+    decomposed = true;
 }
 
 void LidDrivenCavity::Advance()
 {
+    if(implicitTheta > 0.0) {
+        AdvanceImplicit();
+        return;
+    }
+
     //compute current vorticity from streamfunction with 2nd order finite central difference (2FCD)
     ComputeVorticity();
 
     //compute vorticity at next time step from current time step with streamfunction and vorticity with 2FCD
-    ComputeTimeAdvanceVorticity();
+    //when fused, the initial residual of the Poisson solve and the norm of vNext come out of the same sweep
+    bool fused = fusedResidual && poisson->GetInitialResidual();
+    double normSquared = 0.0;
+    ComputeTimeAdvanceVorticity(dt, fused ? poisson->GetInitialResidual() : nullptr, &normSquared);
 
     // Solve Poisson problem to get streamfunction at next time step -> flow properties at next time step now known
-    cg->Solve(vNext, s);
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::Solve);
+
+    //relative tolerances start loose during the initial transient, and tighten geometrically over it
+    if((toleranceRelative > 0.0) || (toleranceStep > 0.0)) {
+        double loosen = (step < toleranceTransient) ? pow(TransientLooseness, 1.0 - (double) step/toleranceTransient) : 1.0;
+        poisson->SetTolerance(1e-6, loosen*toleranceRelative, loosen*toleranceStep);
+    }
+
+    if(fused)
+        poisson->SolveFromResidual(s, normSquared);
+    else
+        poisson->Solve(vNext, s);
+    solveIterations = poisson->GetIterations();
+    solveResidual = poisson->GetResidual();
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::Solve, solveIterations);
+}
+
+void LidDrivenCavity::AdvanceImplicit()
+{
+    int n = 2*Npts;                                                 //vorticity then streamfunction
+    int m = KrylovDimension;
+    if(!implicitWork) {
+        implicitWork = new double[(2*m + 7)*n + Npts + (m + 5)*m + 2]();
+        diffusion = new SolverCG(Nx,Ny,dx,dy,comm_row_grid,comm_col_grid,comm_Cart_grid);
+    }
+    double* x = implicitWork;                                       //Newton iterate
+    double* residual = x + n;                                       //residual at the iterate
+    double* trial = residual + n;                                   //perturbed or line search iterate
+    double* trialResidual = trial + n;                              //residual at the trial iterate
+    double* delta = trialResidual + n;                              //Newton correction
+    double* w = delta + n;                                          //new Krylov direction
+    double* V = w + n;                                              //orthonormal Krylov basis, m+1 vectors
+    double* Z = V + (m + 1)*n;                                      //preconditioned basis, m vectors
+    double* rhs = Z + m*n;                                          //explicit part of the step
+    double* H = rhs + Npts;                                         //Hessenberg matrix, m+1 rows of m
+    double* g = H + (m + 1)*m;                                      //rotated residual, m+1 entries
+    double* cs = g + m + 1;                                         //cosines of the Givens rotations
+    double* sn = cs + m;                                            //sines of the Givens rotations
+    double* h = sn + m;                                             //projections onto the Krylov basis, m+1 entries
+
+    if(energyMeter)
+        energyMeter->Start(EnergyMeter::Solve);
+
+    //the preconditioner blocks only need to be roughly solved, and the solves of every Krylov iteration are not printed
+    diffusion->SetVerbose(false);
+    diffusion->SetShift(1.0/(implicitTheta*dt*nu));
+    diffusion->SetTolerance(1e-12, 0.0, PreconditionerTol);
+    poisson->SetVerbose(false);
+    poisson->SetTolerance(1e-12, 0.0, PreconditionerTol);
+
+    //explicit part of the step, and the state at the start of the step as the first iterate
+    ComputeVorticity();
+    ComputeTimeAdvanceVorticity((1.0 - implicitTheta)*dt);
+    std::copy(vNext, vNext + Npts, rhs);
+    std::copy(v, v + Npts, x);
+    std::copy(s, s + Npts, x + Npts);
+
+    ImplicitResidual(x, rhs, residual);
+    double norm = sqrt(ImplicitDot(residual, residual));
+    double stopTol = std::max(newtonTol*norm, NewtonAbsoluteTol);
+    int krylovIterations = 0;
+    newtonIterations = 0;
+
+    while(norm > stopTol) {
+        if(newtonIterations == NewtonMaxIterations) {
+            if((rowRank == 0) && (colRank == 0))
+                cout << "NEWTON FAILED TO CONVERGE" << endl;
+
+            MPI_Finalize();
+            exit(-1);
+        }
+        ++newtonIterations;
+
+        //flexible GMRES for J delta = -residual from delta = 0, right preconditioned, without restarts
+        std::fill(H, H + (m + 1)*m, 0.0);
+        std::fill(g, g + m + 1, 0.0);
+        g[0] = norm;
+        for(int k = 0; k < n; ++k)
+            V[k] = -residual[k]/norm;
+        double xNorm = sqrt(ImplicitDot(x, x));
+
+        int iterations = 0;
+        while(iterations < m) {
+            int c = iterations;
+            double* z = Z + c*n;
+            ImplicitPrecondition(V + c*n, z);
+
+            //Jacobian-vector product by a forward difference of the residual, scaled to the size of the iterate
+            double zNorm = sqrt(ImplicitDot(z, z));
+            double epsilon = (zNorm > 0.0) ? sqrt(DBL_EPSILON)*(1.0 + xNorm)/zNorm : 1.0;
+            for(int k = 0; k < n; ++k)
+                trial[k] = x[k] + epsilon*z[k];
+            ImplicitResidual(trial, rhs, w);
+            for(int k = 0; k < n; ++k)
+                w[k] = (w[k] - residual[k])/epsilon;
+
+            //classical Gram-Schmidt twice, with one reduction of all projections per pass
+            for(int pass = 0; pass < 2; ++pass) {
+                for(int b = 0; b <= c; ++b)
+                    h[b] = VectorOps::Dot(n, w, V + b*n);
+                MPI_Allreduce(MPI_IN_PLACE, h, c + 1, MPI_DOUBLE, MPI_SUM, comm_Cart_grid);
+                for(int b = 0; b <= c; ++b) {
+                    VectorOps::Axpy(n, -h[b], V + b*n, w);
+                    H[b*m + c] += h[b];
+                }
+            }
+            double wNorm = sqrt(ImplicitDot(w, w));
+            if(wNorm > 0.0) {
+                for(int k = 0; k < n; ++k)
+                    V[(c + 1)*n + k] = w[k]/wNorm;
+            }
+
+            //Givens rotations reduce the Hessenberg matrix to triangular, leaving the residual norm in g
+            for(int b = 0; b < c; ++b) {
+                double upper = H[b*m + c];
+                double lower = H[(b + 1)*m + c];
+                H[b*m + c] = cs[b]*upper + sn[b]*lower;
+                H[(b + 1)*m + c] = -sn[b]*upper + cs[b]*lower;
+            }
+            double diagonal = hypot(H[c*m + c], wNorm);
+            cs[c] = H[c*m + c]/diagonal;
+            sn[c] = wNorm/diagonal;
+            H[c*m + c] = diagonal;
+            g[c + 1] = -sn[c]*g[c];
+            g[c] = cs[c]*g[c];
+
+            ++iterations;
+            if((fabs(g[iterations]) <= KrylovTol*norm) || (wNorm == 0.0))
+                break;
+        }
+        krylovIterations += iterations;
+
+        //back substitution for the coefficients of the preconditioned basis
+        for(int b = iterations - 1; b >= 0; --b) {
+            for(int c = b + 1; c < iterations; ++c)
+                g[b] -= H[b*m + c]*g[c];
+            g[b] /= H[b*m + b];
+        }
+        std::fill(delta, delta + n, 0.0);
+        for(int b = 0; b < iterations; ++b)
+            VectorOps::Axpy(n, g[b], Z + b*n, delta);
+
+        //halve the correction until the residual decreases, accepting the last one tried otherwise
+        double trialNorm = 0.0;
+        double scale = 1.0;
+        for(int halving = 0; halving <= 4; ++halving) {
+            for(int k = 0; k < n; ++k)
+                trial[k] = x[k] + scale*delta[k];
+            ImplicitResidual(trial, rhs, trialResidual);
+            trialNorm = sqrt(ImplicitDot(trialResidual, trialResidual));
+            if(trialNorm < norm)
+                break;
+            scale *= 0.5;
+        }
+        std::copy(trial, trial + n, x);
+        std::copy(trialResidual, trialResidual + n, residual);
+        norm = trialNorm;
+    }
+
+    //the latest residual was evaluated at the solution, leaving its streamfunction in s and its vorticity with boundary values in v
+    std::copy(v, v + Npts, vNext);
+    solveIterations = krylovIterations;
+    solveResidual = norm;
+
+    poisson->SetVerbose(verbose);
+    poisson->SetTolerance(1e-6, 0.0, 0.0);
+    if(verbose && (rowRank == 0) && (colRank == 0))
+        cout << "Newton iterations: " << newtonIterations << ", Krylov iterations: " << krylovIterations << ", residual: " << norm << endl;
+
+    if(energyMeter)
+        energyMeter->Stop(EnergyMeter::Solve, solveIterations);
+}
+
+void LidDrivenCavity::ImplicitResidual(const double* x, const double* rhs, double* residual)
+{
+    auto globalBoundary = [&](int i, int j) {
+        return ((i == 0) && (leftRank == MPI_PROC_NULL)) || ((i == Nx-1) && (rightRank == MPI_PROC_NULL))
+            || ((j == 0) && (bottomRank == MPI_PROC_NULL)) || ((j == Ny-1) && (topRank == MPI_PROC_NULL));
+    };
+
+    //A psi away from the global boundary and the boundary vorticity of psi on it
+    std::copy(x + Npts, x + 2*Npts, s);
+    ComputeVorticity();
+    for(int j = 0; j < Ny; ++j) {
+        for(int i = 0; i < Nx; ++i) {
+            if(globalBoundary(i,j))
+                residual[Npts + IDX(i,j)] = 0.0;
+            else {
+                residual[Npts + IDX(i,j)] = v[IDX(i,j)] - x[IDX(i,j)];
+                v[IDX(i,j)] = x[IDX(i,j)];
+            }
+        }
+    }
+
+    //vNext = omega + theta dt F(omega, psi), so the vorticity residual is 2 omega - vNext - rhs
+    ComputeTimeAdvanceVorticity(implicitTheta*dt);
+    for(int j = 0; j < Ny; ++j) {
+        for(int i = 0; i < Nx; ++i)
+            residual[IDX(i,j)] = globalBoundary(i,j) ? 0.0 : 2.0*x[IDX(i,j)] - vNext[IDX(i,j)] - rhs[IDX(i,j)];
+    }
+}
+
+void LidDrivenCavity::ImplicitPrecondition(const double* in, double* out)
+{
+    //vorticity block (I + theta dt nu A) dw = r_w, solved as (A + sigma I) dw = sigma r_w, with the streamfunction half as storage
+    double sigma = 1.0/(implicitTheta*dt*nu);
+    for(int k = 0; k < Npts; ++k) {
+        out[Npts + k] = sigma*in[k];
+        out[k] = 0.0;
+    }
+    diffusion->Solve(out + Npts, out);
+
+    //streamfunction block A dpsi = r_psi + dw, as the vorticity correction enters the streamfunction residual with a minus sign
+    for(int k = 0; k < Npts; ++k) {
+        tmp[k] = in[Npts + k] + out[k];
+        out[Npts + k] = 0.0;
+    }
+    poisson->Solve(tmp, out + Npts);
+}
+
+double LidDrivenCavity::ImplicitDot(const double* a, const double* b)
+{
+    double dot = VectorOps::Dot(2*Npts, a, b);
+    MPI_Allreduce(MPI_IN_PLACE, &dot, 1, MPI_DOUBLE, MPI_SUM, comm_Cart_grid);
+    return dot;
 }
 
 void LidDrivenCavity::ComputeVorticity() {
@@ -519,7 +1399,7 @@ void LidDrivenCavity::ComputeVorticity() {
     MPI_Waitall(4,requests,MPI_STATUSES_IGNORE);   
 }
 
-void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
+void LidDrivenCavity::ComputeTimeAdvanceVorticity(double tau, double* r0, double* normSquared) {
     //assume s data already sent and received by ComputeVorticity
     double dxi  = 1.0/dx;
     double dyi  = 1.0/dy;
@@ -541,16 +1421,22 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     MPI_Isend(tempRight,Ny,MPI_DOUBLE,rightRank,3,comm_row_grid,&requests[3]);          //tag = 3 -> streamfunction data sent right
     
     //compute interior points of v_n+1 to allow all data to be sent; requires only data stored in current process
-    #pragma omp parallel for schedule(dynamic)
+    //v = A s at interior points after ComputeVorticity, so the initial residual vNext - A s is formed while vNext is in cache
+    double norm = 0.0;
+    #pragma omp parallel for schedule(dynamic) reduction(+:norm)
         for (int i = 1; i < Nx - 1; ++i) {
             for (int j = 1; j < Ny - 1; ++j) {
-                vNext[IDX(i,j)] = v[IDX(i,j)] + dt*(
+                vNext[IDX(i,j)] = v[IDX(i,j)] + tau*(
                         ( (s[IDX(i+1,j)] - s[IDX(i-1,j)]) * 0.5 * dxi
                         *(v[IDX(i,j+1)] - v[IDX(i,j-1)]) * 0.5 * dyi)
                     - ( (s[IDX(i,j+1)] - s[IDX(i,j-1)]) * 0.5 * dyi
                         *(v[IDX(i+1,j)] - v[IDX(i-1,j)]) * 0.5 * dxi)
                     + nu * (v[IDX(i+1,j)] - 2.0 * v[IDX(i,j)] + v[IDX(i-1,j)])*dx2i
                     + nu * (v[IDX(i,j+1)] - 2.0 * v[IDX(i,j)] + v[IDX(i,j-1)])*dy2i);
+                if(r0) {
+                    r0[IDX(i,j)] = vNext[IDX(i,j)] - v[IDX(i,j)];
+                    norm += vNext[IDX(i,j)] * vNext[IDX(i,j)];
+                }
             }
         }
     
@@ -565,7 +1451,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     //------------------------------------------------------------------------------------------------------------------------------------//    
 
     if(!((bottomRank == MPI_PROC_NULL) || (leftRank == MPI_PROC_NULL))) {
-        vNext[IDX(0,0)] = v[IDX(0,0)] + dt*(                                    //compute bottom left corner, access left and bottom
+        vNext[IDX(0,0)] = v[IDX(0,0)] + tau*(                                    //compute bottom left corner, access left and bottom
             ( (s[IDX(1,0)] - sLeftData[0]) * 0.5 * dxi                          //if at left or bottom, BC will be imposed later
                 *(v[IDX(0,1)] - vBottomData[0]) * 0.5 * dyi)
             - ( (s[IDX(0,1)] - sBottomData[0]) * 0.5 * dyi
@@ -575,7 +1461,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     }
         
     if(!((bottomRank == MPI_PROC_NULL )|| (rightRank == MPI_PROC_NULL))) {
-        vNext[IDX(Nx-1,0)] = v[IDX(Nx-1,0)] + dt*(                              //compute bottom right corner, acess right and bottom
+        vNext[IDX(Nx-1,0)] = v[IDX(Nx-1,0)] + tau*(                              //compute bottom right corner, acess right and bottom
             ( (sRightData[0] - s[IDX(Nx-2,0)]) * 0.5 * dxi                      //if at right or bottom, BC will be imposed later
                 *(v[IDX(Nx-1,1)] - vBottomData[Nx-1]) * 0.5 * dyi)
             - ( (s[IDX(Nx-1,1)] - sBottomData[Nx-1]) * 0.5 * dyi
@@ -585,7 +1471,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     }
             
     if(!((topRank == MPI_PROC_NULL) || (leftRank == MPI_PROC_NULL))) {
-        vNext[IDX(0,Ny-1)] = v[IDX(0,Ny-1)] + dt*(                              //compute top left corner, access top and left
+        vNext[IDX(0,Ny-1)] = v[IDX(0,Ny-1)] + tau*(                              //compute top left corner, access top and left
             ( (s[IDX(1,Ny-1)] - sLeftData[Ny-1]) * 0.5 * dxi                    //if at top or left, BC will be imposed later
                 *(vTopData[0] - v[IDX(0,Ny-2)]) * 0.5 * dyi)
             - ( (sTopData[0] - s[IDX(0,Ny-2)]) * 0.5 * dyi
@@ -595,7 +1481,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     }
             
     if(!((topRank == MPI_PROC_NULL) || (rightRank == MPI_PROC_NULL))) {
-        vNext[IDX(Nx-1,Ny-1)] = v[IDX(Nx-1,Ny-1)] + dt*(                        //compute top right corner, access top and right
+        vNext[IDX(Nx-1,Ny-1)] = v[IDX(Nx-1,Ny-1)] + tau*(                        //compute top right corner, access top and right
             ( (sRightData[Ny-1] - s[IDX(Nx-2,Ny-1)]) * 0.5 * dxi                //if at top or right, BC will be imposed later
                 *(vTopData[Nx-1] - v[IDX(Nx-1,Ny-2)]) * 0.5 * dyi)
             - ( (sTopData[Nx-1] - s[IDX(Nx-1,Ny-2)]) * 0.5 * dyi
@@ -614,7 +1500,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     //only compute bottom row between corners if not at bottom of grid
     if(bottomRank != MPI_PROC_NULL) {   
         for (int i = 1; i < Nx - 1; ++i) {                                      //bottom row, needs access to bottom
-            vNext[IDX(i,0)] = v[IDX(i,0)] + dt*(
+            vNext[IDX(i,0)] = v[IDX(i,0)] + tau*(
                     ( (s[IDX(i+1,0)] - s[IDX(i-1,0)]) * 0.5 * dxi
                         *(v[IDX(i,1)] - vBottomData[i]) * 0.5 * dyi)
                     - ( (s[IDX(i,1)] - sBottomData[i]) * 0.5 * dyi
@@ -627,7 +1513,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     //only compute top row if not at top of grid
     if(topRank != MPI_PROC_NULL) {  
         for (int i = 1; i < Nx - 1; ++i) {                                      
-            vNext[IDX(i,Ny-1)] = v[IDX(i,Ny-1)] + dt*(                          //top row, needs access to top
+            vNext[IDX(i,Ny-1)] = v[IDX(i,Ny-1)] + tau*(                          //top row, needs access to top
                     ( (s[IDX(i+1,Ny-1)] - s[IDX(i-1,Ny-1)]) * 0.5 * dxi
                         *(vTopData[i] - v[IDX(i,Ny-2)]) * 0.5 * dyi)
                     - ( (sTopData[i] - s[IDX(i,Ny-2)]) * 0.5 * dyi
@@ -640,7 +1526,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     //only compute left column if not at LHS of grid
     if(leftRank != MPI_PROC_NULL) {
         for (int j = 1; j < Ny - 1; ++j) {                                       //left column, needs access to left
-            vNext[IDX(0,j)] = v[IDX(0,j)] + dt*(
+            vNext[IDX(0,j)] = v[IDX(0,j)] + tau*(
                     ( (s[IDX(1,j)] - sLeftData[j]) * 0.5 * dxi
                         *(v[IDX(0,j+1)] - v[IDX(0,j-1)]) * 0.5 * dyi)
                     - ( (s[IDX(0,j+1)] - s[IDX(0,j-1)]) * 0.5 * dyi
@@ -653,7 +1539,7 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
     //only compute right column if not at RHS of grid
     if(rightRank != MPI_PROC_NULL) {
         for (int j = 1; j < Ny - 1; ++j) {                                          
-            vNext[IDX(Nx-1,j)] = v[IDX(Nx-1,j)] + dt*(                          //right column, needs access to right
+            vNext[IDX(Nx-1,j)] = v[IDX(Nx-1,j)] + tau*(                          //right column, needs access to right
                     ( (sRightData[j] - s[IDX(Nx-2,j)]) * 0.5 * dxi
                     *(v[IDX(Nx-1,j+1)] - v[IDX(Nx-1,j-1)]) * 0.5 * dyi)
                     - ( (s[IDX(Nx-1,j+1)] - s[IDX(Nx-1,j-1)]) * 0.5 * dyi
@@ -691,6 +1577,32 @@ void LidDrivenCavity::ComputeTimeAdvanceVorticity() {
         }
     }
 
+    //------------------------------------------------------------------------------------------------------------------------------------//
+    //-------------------------------------------Step 5: Initial Residual on Edges of Local Domain----------------------------------------//
+    //------------------------------------------------------------------------------------------------------------------------------------//
+
+    if(r0) {
+        //residual is zero on the global boundary, as imposed by SolverCG, and v = A s on all other edge points
+        auto edgePoint = [&](int i, int j) {
+            bool globalBoundary = ((i == 0) && (leftRank == MPI_PROC_NULL)) || ((i == Nx-1) && (rightRank == MPI_PROC_NULL))
+                               || ((j == 0) && (bottomRank == MPI_PROC_NULL)) || ((j == Ny-1) && (topRank == MPI_PROC_NULL));
+            r0[IDX(i,j)] = globalBoundary ? 0.0 : vNext[IDX(i,j)] - v[IDX(i,j)];
+            norm += vNext[IDX(i,j)] * vNext[IDX(i,j)];
+        };
+
+        for(int i = 0; i < Nx; ++i) {               //bottom and top rows, including corners
+            edgePoint(i, 0);
+            if(Ny > 1)
+                edgePoint(i, Ny-1);
+        }
+        for(int j = 1; j < Ny - 1; ++j) {           //left and right columns between corners
+            edgePoint(0, j);
+            if(Nx > 1)
+                edgePoint(Nx-1, j);
+        }
+        *normSquared = norm;
+    }
+
     //ensure all communication completed
     MPI_Waitall(4,requests,MPI_STATUSES_IGNORE);   
 }
@@ -792,13 +1704,35 @@ void LidDrivenCavity::ComputeVelocity(double* u0, double* u1) {
     MPI_Waitall(2,requests+1,MPI_STATUSES_IGNORE);
 }
 
+void LidDrivenCavity::ComputeVelocityAt(int i, int j, double& u0, double& u1) {
+    //global boundary keeps the boundary conditions, no slip with the lid moving at U, as ComputeVelocity leaves it
+    if((topRank == MPI_PROC_NULL) && (j == Ny - 1)) {
+        u0 = U;
+        u1 = 0.0;
+        return;
+    }
+    if(((leftRank == MPI_PROC_NULL) && (i == 0)) || ((rightRank == MPI_PROC_NULL) && (i == Nx - 1))
+        || ((bottomRank == MPI_PROC_NULL) && (j == 0))) {
+        u0 = 0.0;
+        u1 = 0.0;
+        return;
+    }
+
+    double dxi = 1/dx;
+    double dyi = 1/dy;
+    double sAbove = (j < Ny - 1) ? s[IDX(i,j+1)] : sTopData[i];
+    double sRight = (i < Nx - 1) ? s[IDX(i+1,j)] : sRightData[j];
+    u0 =  (sAbove - s[IDX(i,j)]) * dyi;
+    u1 = -(sRight - s[IDX(i,j)]) * dxi;
+}
+
 void LidDrivenCavity::CreateCartGrid(MPI_Comm &cartGrid,MPI_Comm &rowGrid, MPI_Comm &colGrid){
     
     int worldRank, size;    
     
     //return rank and size
-    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank); 
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(comm_world, &worldRank); 
+    MPI_Comm_size(comm_world, &size);
     this-> size = size;                                                 //assign to member variable
     
     //check if input rank is square number size = p^2
@@ -822,7 +1756,7 @@ void LidDrivenCavity::CreateCartGrid(MPI_Comm &cartGrid,MPI_Comm &rowGrid, MPI_C
     int reorder = 1;                                                                        //reordering of grid allowed
     int keep[dims];                                                                         //denotes which dimension to keep when finding subgrids
 
-    MPI_Cart_create(MPI_COMM_WORLD,dims,gridSize,periods,reorder, &cartGrid);         //create Cartesian topology grid
+    MPI_Cart_create(comm_world,dims,gridSize,periods,reorder, &cartGrid);         //create Cartesian topology grid
     
     //create row communnicator in subgrid so process can communicate with other processes on row   
     keep[0] = 0;        
@@ -842,7 +1776,7 @@ void LidDrivenCavity::SplitDomainMPI(MPI_Comm &grid, int globalNx, int globalNy,
     int dims = 2;
     int coords[2];
 
-    MPI_Comm_size(MPI_COMM_WORLD, &size);                       //return total number of MPI ranks, size denotes total number of processes P
+    MPI_Comm_size(grid, &size);                                 //return total number of MPI ranks, size denotes total number of processes P
     MPI_Comm_rank(grid, &gridRank);
     MPI_Cart_coords(grid, gridRank, dims, coords);              //use process rank in Cartesian grid to generate coordinates
     
@@ -1,12 +1,44 @@
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 using namespace std;
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
 #include <mpi.h>
+#include <omp.h>
 #include "LidDrivenCavity.h"
+#include "CostModel.h"
+#include "Parareal.h"
+#include "Profiler.h"
+#include "Richardson.h"
+#include "VectorOps.h"
+
+/**
+ * @brief Parse a wall-clock budget given as seconds, minutes:seconds or hours:minutes:seconds, as batch systems write time limits
+ * @param[in] text      Budget, empty for none
+ * @return Budget in seconds, 0 for none, negative if the text is not a budget
+ *********************************************************************************************************************/
+static double ParseWalltime(std::string text)
+{
+    if(text.empty())
+        return 0.0;
+
+    double seconds = 0.0;
+    size_t start = 0;
+    for(int field = 0; field < 3; ++field) {
+        size_t colon = text.find(':', start);
+        std::string part = text.substr(start, colon - start);
+        if(part.empty() || (part.find_first_not_of("0123456789.") != std::string::npos))
+            return -1.0;
+        seconds = 60.0*seconds + std::stod(part);
+        if(colon == std::string::npos)
+            return seconds;
+        start = colon + 1;
+    }
+    return -1.0;
+}
 
 /**
  * @brief Main program that allows for user specification of problem followed by implementation of solver
@@ -14,29 +46,6 @@ namespace po = boost::program_options;
  *********************************************************************************************************************/
 int main(int argc, char* argv[])
 {
-    //-----------------------------------------Initialise MPI communicator-----------------------------------------//
-    int worldRank, size, retval_rank, retval_size;    
-    MPI_Init(&argc, &argv);
-    
-    retval_rank = MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);                                //return rank and size
-    retval_size = MPI_Comm_size(MPI_COMM_WORLD, &size);
-   
-    if(retval_rank == MPI_ERR_COMM || retval_size == MPI_ERR_COMM) {                        //check if communicator set up correctly
-        cout << "Invalid communicator" << endl;
-        return 1;
-    }
-    
-    //check if input rank is square number size = p^2
-    int p = round(sqrt(size));
-    
-    if((p*p != size) | (size < 1)) {                                                        //if not a square number, print error and terminate program
-        if(worldRank == 0)
-            cout << "Invalide process size. Process size must be square number of size p^2 and greater than 0" << endl;
-            
-        MPI_Finalize();
-        return 2;
-    }
-    
     //------------------------------------User program options to define problem ------------------------------------//
     po::options_description opts(
         "Solver for the 2D lid-driven cavity incompressible flow problem");
@@ -55,14 +64,101 @@ int main(int argc, char* argv[])
                  "Final time.")
         ("Re",  po::value<double>()->default_value(10),
                  "Reynolds number.")
+        ("checkpoint", po::value<int>()->default_value(0),
+                 "Take an in-memory buddy checkpoint every N time steps, 0 to disable.")
+        ("flush", po::value<int>()->default_value(10),
+                 "Flush buddy checkpoints to node-local storage every N checkpoints, 0 to never flush.")
+        ("checkpoint-dir", po::value<string>()->default_value("/dev/shm"),
+                 "Node-local directory that buddy checkpoints are flushed to.")
+        ("recover",    "Resume from the latest flushed buddy checkpoint in the checkpoint or resume directory, failing if there is none.")
+        ("walltime", po::value<string>()->default_value(""),
+                 "Wall-clock budget of the run as [[HH:]MM:]SS. The run stops before it runs out, and on SIGTERM or SIGUSR1, flushing a buddy checkpoint to --resume-dir to resume from with --recover.")
+        ("resume-dir", po::value<string>()->default_value("."),
+                 "Persistent or shared directory that the checkpoint of a run stopped early is flushed to, for the next job.")
+        ("walltime-margin", po::value<double>()->default_value(30.0),
+                 "Seconds kept free at the end of the wall-clock budget for the checkpoint and output.")
+        ("snapshot", po::value<string>()->default_value(""),
+                 "Write indexed binary snapshots to this file, empty to disable.")
+        ("snapshot-interval", po::value<int>()->default_value(0),
+                 "Append a snapshot every N time steps, 0 for initial and final state only.")
+        ("render", po::value<string>()->default_value(""),
+                 "Render vorticity and streamfunction contours to PREFIX_<step>.ppm, empty to disable.")
+        ("render-interval", po::value<int>()->default_value(0),
+                 "Render a frame every N time steps, 0 for initial and final state only.")
+        ("render-width", po::value<int>()->default_value(256),
+                 "Width of rendered frames in pixels.")
+        ("tracers", po::value<long long>()->default_value(0),
+                 "Number of passive tracers advected with the flow, 0 to disable.")
+        ("tracer-output", po::value<string>()->default_value("tracers"),
+                 "Write tracer positions to PREFIX_<step>.part.")
+        ("tracer-interval", po::value<int>()->default_value(0),
+                 "Write tracer positions every N time steps, 0 for initial and final state only.")
+        ("pod-modes", po::value<int>()->default_value(0),
+                 "Number of POD modes of the vorticity kept in-situ by an incremental SVD, 0 to disable.")
+        ("pod-output", po::value<string>()->default_value("pod.bin"),
+                 "Write the POD modes and coefficients to this file.")
+        ("pod-interval", po::value<int>()->default_value(1),
+                 "Add a vorticity snapshot to the POD every N time steps.")
+        ("pod-write-interval", po::value<int>()->default_value(0),
+                 "Rewrite the POD file every N time steps, 0 for the final state only.")
+        ("metrics", po::value<string>()->default_value(""),
+                 "Serve live metrics in Prometheus format on this TCP port of localhost, or on unix:PATH. Empty to disable.")
+        ("agglomerate", po::value<int>()->default_value(1024),
+                 "Solve the Poisson problem on fewer processes if there are fewer than N grid points per process, 0 to disable.")
+        ("poisson-solver", po::value<string>()->default_value("auto"),
+                 "Poisson solver backend: 'pcg', 'pcg-agglomerated', direct 'schur', 'pcg-tiled' with a tile per thread, 'auto' to choose by grid points per process or 'measure' to time each.")
+        ("cg-rtol", po::value<double>()->default_value(0.0),
+                 "Stop each Poisson solve at this residual relative to the vorticity norm, 0 for the fixed tolerance of 1e-6.")
+        ("cg-step-tol", po::value<double>()->default_value(0.0),
+                 "Stop each Poisson solve at this fraction of the vorticity change over the step, 0 for the fixed tolerance.")
+        ("cg-transient", po::value<int>()->default_value(0),
+                 "Loosen the relative Poisson tolerances tenfold at the first step, tightening them over N steps.")
+        ("implicit", po::value<double>()->implicit_value(0.5),
+                 "Step vorticity and streamfunction implicitly by Newton-Krylov with the theta method, 0.5 for Crank-Nicolson or 1 for backward Euler, lifting the time step restriction.")
+        ("newton-tol", po::value<double>()->default_value(1e-6),
+                 "Newton residual of each implicit time step relative to its value at the start of the step.")
+        ("vector-backend", po::value<string>()->default_value(VectorOps::GetBackendName()),
+                 "Vector operations of the conjugate gradient solver: 'openmp' threaded in-tree loops or 'blas' library calls.")
+        ("energy", po::value<string>()->implicit_value(""),
+                 "Measure package energy with RAPL counters and report joules per step and per CG iteration. Optionally append to a CSV file.")
+        ("profile", po::value<string>()->default_value(""),
+                 "Sample call stacks of every thread and write them in folded stack format to PREFIX.<rank>.folded, empty to disable.")
+        ("profile-frequency", po::value<int>()->default_value(199),
+                 "Profiler samples per second of CPU time of each thread.")
+        ("parareal", po::value<int>()->default_value(0),
+                 "Integrate in parallel in time with Parareal over N time slices, each owned by P/N processes. 0 to disable.")
+        ("coarse-factor", po::value<int>()->default_value(10),
+                 "Ratio of the coarse to the fine time step for Parareal.")
+        ("parareal-iterations", po::value<int>()->default_value(0),
+                 "Maximum number of Parareal iterations, 0 for number of time slices.")
+        ("parareal-tol", po::value<double>()->default_value(1e-6),
+                 "Relative change of the Parareal slice boundaries to stop at.")
+        ("richardson", po::value<string>()->implicit_value("sequential"),
+                 "Richardson extrapolation from grids of Nx x Ny and 2Nx-1 x 2Ny-1 points, solved 'sequential'ly by all processes or 'concurrent'ly by two halves of the processes.")
+        ("dry-run",    "Predict memory, communication and wall time of the run and suggest a process/thread split, without running it.")
         ("verbose",    "Be more verbose.")
         ("help",       "Print help message.");
 
-    //extract user inputs
+    //extract user inputs before MPI starts, as the Poisson solver decides the thread support to request
     po::variables_map vm;                                                       
     po::store(po::parse_command_line(argc, argv, opts), vm);
     po::notify(vm);
 
+    //-----------------------------------------Initialise MPI communicator-----------------------------------------//
+    int worldRank, size, retval_rank, retval_size, provided;
+    //pcg-tiled makes MPI calls from every thread, and measure may choose it
+    string poissonSolver = vm["poisson-solver"].as<string>();
+    int required = ((poissonSolver == "pcg-tiled") || (poissonSolver == "measure")) ? MPI_THREAD_MULTIPLE : MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, required, &provided);
+    
+    retval_rank = MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);                                //return rank and size
+    retval_size = MPI_Comm_size(MPI_COMM_WORLD, &size);
+   
+    if(retval_rank == MPI_ERR_COMM || retval_size == MPI_ERR_COMM) {                        //check if communicator set up correctly
+        cout << "Invalid communicator" << endl;
+        return 1;
+    }
+
     if (vm.count("help")) {       
         if(worldRank == 0)
             cout << opts << endl;
@@ -71,41 +167,240 @@ int main(int argc, char* argv[])
         return 0;
     }
 
-    //don't let user use excessive number of processes for the specified grid size
-    //for example no point using 4x4 processes to compute anything smaller than 8x8 grid, would be slower
-    //protect code from a small bug in processing certain special cases that occur for above case, leads to slightly erroneous solution
-    //also catches case where a process ends up having no data to process
-    if((vm["Nx"].as<int>()*2 < p) || (vm["Ny"].as<int>()*2 < p)) {
+    if(!VectorOps::SetBackend(vm["vector-backend"].as<string>())) {
+        if(worldRank == 0)
+            cout << "Invalid vector backend, must be openmp or blas" << endl;
+
+        MPI_Finalize();
+        return 1;
+    }
 
+    //check if input rank is square number size = p^2, or P/N = p^2 for each of the N Parareal time slices or two Richardson grids
+    bool richardson = vm.count("richardson");
+    bool concurrent = richardson && (vm["richardson"].as<string>() == "concurrent");
+    if(richardson && ((!concurrent && (vm["richardson"].as<string>() != "sequential")) || (vm["parareal"].as<int>() > 0))) {
         if(worldRank == 0)
-            cout << "Excessive number of processes (p^2) for specified grid size. Ensure 2*Nx < p and 2*Ny < p" << endl;
+            cout << "Invalid Richardson mode, must be sequential or concurrent and cannot be combined with Parareal" << endl;
+
+        MPI_Finalize();
+        return 1;
+    }
 
+    //Parareal and Richardson run their own solvers, which would silently ignore the options of a single run
+    if(richardson || (vm["parareal"].as<int>() > 0)) {
+        const char* singleRun[] = {"implicit", "newton-tol", "checkpoint", "recover", "snapshot", "render", "tracers", "pod-modes",
+                                   "walltime", "dry-run", "poisson-solver", "cg-rtol", "cg-step-tol", "cg-transient", "agglomerate",
+                                   "metrics", "energy"};
+        for(const char* option : singleRun) {
+            if(vm.count(option) && !vm[option].defaulted()) {
+                if(worldRank == 0)
+                    cout << "Invalid option --" << option << ", not supported with " << (richardson ? "Richardson" : "Parareal") << endl;
+
+                MPI_Finalize();
+                return 1;
+            }
+        }
+    }
+    int slices = std::max(vm["parareal"].as<int>(), concurrent ? 2 : 1);
+    int p = round(sqrt(size / slices));
+    
+    if((p*p*slices != size) | (size < 1)) {                                                 //if not a square number, print error and terminate program
+        if(worldRank == 0)
+            cout << "Invalide process size. Process size must be square number of size p^2 and greater than 0"
+                 << ((slices > 1) ? (concurrent ? " for each Richardson grid" : " for each Parareal time slice") : "") << endl;
+            
         MPI_Finalize();
-        return 3;
+        return 2;
+    }
+
+    //check the whole configuration before any communicator, profiler or field is created, so invalid input fails cheaply
+    const CavityConfig config(vm["Lx"].as<double>(), vm["Ly"].as<double>(), vm["Nx"].as<int>(), vm["Ny"].as<int>(),
+                              vm["dt"].as<double>(), vm["T"].as<double>(), vm["Re"].as<double>(),
+                              vm.count("implicit") ? vm["implicit"].as<double>() : 0.0);
+    std::string invalid = config.Validate(p);
+    if(!invalid.empty()) {
+        if(worldRank == 0)
+            cout << invalid << endl;
+
+        MPI_Finalize();
+        return config.FitsProcesses(p) ? 1 : 3;                                             //excessive processes are checked first
+    }
+
+    //batch systems signal ahead of the time limit, so a run always stops cleanly on signals, and also before an optional budget
+    double walltime = ParseWalltime(vm["walltime"].as<string>());
+    if(walltime < 0.0) {
+        if(worldRank == 0)
+            cout << "Invalid wall-clock budget, must be [[HH:]MM:]SS" << endl;
+
+        MPI_Finalize();
+        return 1;
     }
 
     //------------------------------------------Implement Parallel Solver---------------------------------------------------//
     //pass global values in, LidDrivenCavity will perform suitable domain discretistion
     //this allows the Set variables to retain their 'global' meaning, so user not confused by 'local' and 'global' domain definitions
 
+    //sample the run on every process, files of all processes merge into one flame graph
+    Profiler* profiler = nullptr;
+    std::string profileFile = vm["profile"].as<string>() + "." + std::to_string(worldRank) + ".folded";
+    if(!vm["profile"].as<string>().empty()) {
+        profiler = new Profiler(vm["profile-frequency"].as<int>());
+        profiler->Start();
+    }
+
+    //parallel-in-time integration across groups of processes, each group solving one time slice with the spatial solver
+    if(vm["parareal"].as<int>() > 0) {
+        Parareal* parareal = new Parareal(slices,MPI_COMM_WORLD);
+        parareal->SetDomainSize(vm["Lx"].as<double>(),vm["Ly"].as<double>());
+        parareal->SetGridSize(vm["Nx"].as<int>(),vm["Ny"].as<int>());
+        parareal->SetTimeStep(vm["dt"].as<double>());
+        parareal->SetFinalTime(vm["T"].as<double>());
+        parareal->SetReynoldsNumber(vm["Re"].as<double>());
+        parareal->SetCoarseFactor(vm["coarse-factor"].as<int>());
+        parareal->SetMaxIterations(vm["parareal-iterations"].as<int>());
+        parareal->SetTolerance(vm["parareal-tol"].as<double>());
+
+        parareal->PrintConfiguration();
+        parareal->Initialise();
+        parareal->Run();
+        parareal->WriteSolution("final.txt");
+        parareal->PrintReport();
+
+        if(profiler) {
+            profiler->Stop();
+            profiler->WriteFolded(profileFile);
+            delete profiler;
+        }
+
+        delete parareal;
+        MPI_Finalize();
+        return 0;
+    }
+
+    //extrapolation from two grid resolutions, either on all processes one after another or on two halves concurrently
+    if(richardson) {
+        Richardson* extrapolation = new Richardson(concurrent,MPI_COMM_WORLD);
+        extrapolation->SetDomainSize(vm["Lx"].as<double>(),vm["Ly"].as<double>());
+        extrapolation->SetGridSize(vm["Nx"].as<int>(),vm["Ny"].as<int>());
+        extrapolation->SetTimeStep(vm["dt"].as<double>());
+        extrapolation->SetFinalTime(vm["T"].as<double>());
+        extrapolation->SetReynoldsNumber(vm["Re"].as<double>());
+
+        extrapolation->PrintConfiguration();
+        extrapolation->Initialise();
+        extrapolation->Run();
+        extrapolation->WriteSolution("final.txt");
+        extrapolation->PrintReport();
+
+        if(profiler) {
+            profiler->Stop();
+            profiler->WriteFolded(profileFile);
+            delete profiler;
+        }
+
+        delete extrapolation;
+        MPI_Finalize();
+        return 0;
+    }
+
     LidDrivenCavity* solver = new LidDrivenCavity();
 
-    solver->SetDomainSize(vm["Lx"].as<double>(),vm["Ly"].as<double>());         //configure the problem with user inputs
-    solver->SetGridSize(vm["Nx"].as<int>(),vm["Ny"].as<int>());
-    solver->SetTimeStep(vm["dt"].as<double>());
-    solver->SetFinalTime(vm["T"].as<double>());
-    solver->SetReynoldsNumber(vm["Re"].as<double>());
+    solver->Configure(config);                                                  //configure the problem with user inputs
+    solver->SetCheckpoint(vm["checkpoint"].as<int>(),vm["flush"].as<int>(),vm["checkpoint-dir"].as<string>());
+    solver->SetSnapshotOutput(vm["snapshot"].as<string>(),vm["snapshot-interval"].as<int>());
+    solver->SetRendering(vm["render"].as<string>(),vm["render-interval"].as<int>(),vm["render-width"].as<int>());
+    solver->SetTracers(vm["tracers"].as<long long>(),vm["tracer-output"].as<string>(),vm["tracer-interval"].as<int>());
+    solver->SetPOD(vm["pod-modes"].as<int>(),vm["pod-output"].as<string>(),vm["pod-interval"].as<int>(),vm["pod-write-interval"].as<int>());
+    solver->SetMetricsEndpoint(vm["metrics"].as<string>());
+    solver->SetAgglomeration(vm["agglomerate"].as<int>());
+    if(!solver->SetPoissonSolver(vm["poisson-solver"].as<string>())) {
+        if(worldRank == 0)
+            cout << "Invalid Poisson solver, must be auto, measure, pcg, pcg-agglomerated, schur or pcg-tiled" << endl;
+
+        delete solver;
+        delete profiler;
+        MPI_Finalize();
+        return 1;
+    }
+    solver->SetAdaptiveTolerance(vm["cg-rtol"].as<double>(), vm["cg-step-tol"].as<double>(), vm["cg-transient"].as<int>());
+    if(config.GetTheta() > 0.0)
+        solver->SetImplicit(config.GetTheta(), vm["newton-tol"].as<double>());
+    solver->SetEnergyMeasurement(vm.count("energy") > 0);
+    solver->SetWalltime(walltime, vm["walltime-margin"].as<double>());
+    solver->SetResumeDir(vm["resume-dir"].as<string>());
+    solver->SetStopOnSignal(true);
 
     solver->PrintConfiguration();                                               //print the solver configuration to user
 
+    //predict cost before any field is allocated, so an oversized run can be rejected cheaply
+    if(vm.count("dry-run")) {
+        CostModel model(config.GetNx(),config.GetNy(),config.GetLx(),config.GetLy(),config.GetDt(),config.GetT());
+        model.SetTolerance(1e-6, vm["cg-rtol"].as<double>(), vm["cg-step-tol"].as<double>());
+        model.Calibrate(MPI_COMM_WORLD);
+        if(worldRank == 0)
+            model.Report(p,omp_get_max_threads());
+
+        delete solver;
+        delete profiler;
+        MPI_Finalize();
+        return 0;
+    }
+
     solver->Initialise();                                                       //initialise solver
 
-    solver->WriteSolution("ic.txt");                                            //write initial state to file named ic.txt
+    //resume from buddy checkpoints if requested, otherwise start from the initial condition
+    bool recovered = false;
+    if(vm.count("recover")) {
+        recovered = solver->RecoverCheckpoint();
+        if(!recovered) {
+            //starting over would silently discard the work of the previous jobs of a chain
+            if(worldRank == 0)
+                cout << "ERROR: No consistent checkpoint found in " << vm["checkpoint-dir"].as<string>() << " or "
+                     << vm["resume-dir"].as<string>() << endl;
+
+            delete solver;
+            delete profiler;
+            MPI_Finalize();
+            return 1;
+        }
+        if(worldRank == 0)
+            cout << "Recovered checkpoint at step " << solver->GetStep() << endl;
+    }
+
+    if(!recovered)
+        solver->WriteSolution("ic.txt");                                        //write initial state to file named ic.txt
+    solver->WriteSnapshot();                                                    //no-op unless snapshots enabled
+    solver->RenderFrame();                                                      //no-op unless rendering enabled
+    solver->WriteTracers();                                                     //no-op unless tracers enabled
 
     solver->Integrate();                                                        //solve the flow properties at each time step and grid point
 
-    solver->WriteSolution("final.txt");                                         //write the final solution to file named final.txt
+    //a run stopped early has not reached the final time, its state is in the checkpoint instead
+    if(solver->IsStopped()) {
+        if(worldRank == 0)
+            cout << "Stopped at step " << solver->GetStep() << " on " << solver->GetStopReason() << ", checkpoint flushed to "
+                 << vm["resume-dir"].as<string>() << ", resume with --recover" << endl;
+    }
+    else
+        solver->WriteSolution("final.txt");                                     //write the final solution to file named final.txt
+    solver->WriteSnapshot();
+    solver->RenderFrame();
+    solver->WriteTracers();
+    solver->WritePOD();                                                         //no-op unless POD enabled
+
+    if(vm.count("energy"))
+        solver->ReportEnergy(vm["energy"].as<string>());
+
+    if(profiler) {
+        profiler->Stop();
+        profiler->WriteFolded(profileFile);
+        if(worldRank == 0)
+            cout << "Profile written to " << vm["profile"].as<string>() << ".<rank>.folded, "
+                 << profiler->GetNumSamples() << " samples on rank 0" << endl;
+        delete profiler;
+    }
 
+    delete solver;                                                              //completes outstanding checkpoint flushes and frees communicators
     MPI_Finalize();
 	return 0;
 }
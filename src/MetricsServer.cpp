@@ -0,0 +1,191 @@
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+using namespace std;
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "MetricsServer.h"
+
+MetricsServer::MetricsServer(std::string address)
+    : serveExit(false), startStep(0), totalSteps(0), dt(0.0), step(0), iterations(0), iterationsTotal(0), residual(0.0),
+      startTime(Now())
+{
+    if(address.compare(0, 5, "unix:") == 0) {
+        unixPath = address.substr(5);
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, unixPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        unlink(unixPath.c_str());                                   //stale socket left by a previous run
+        listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if((listenFd >= 0) && (bind(listenFd, (struct sockaddr*) &addr, sizeof(addr)) != 0)) {
+            close(listenFd);
+            listenFd = -1;
+        }
+    }
+    else {
+        //loopback only, metrics are meant for monitoring on the node the job runs on
+        struct sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(atoi(address.c_str()));
+
+        int reuse = 1;
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if(listenFd >= 0)
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if((listenFd >= 0) && (bind(listenFd, (struct sockaddr*) &addr, sizeof(addr)) != 0)) {
+            close(listenFd);
+            listenFd = -1;
+        }
+    }
+
+    if((listenFd >= 0) && (listen(listenFd, 8) != 0)) {
+        close(listenFd);
+        listenFd = -1;
+    }
+
+    if(listenFd < 0) {
+        cout << "Failed to open metrics endpoint " << address << endl;
+        return;
+    }
+
+    serveThread = std::thread(&MetricsServer::ServeLoop, this);
+}
+
+MetricsServer::~MetricsServer()
+{
+    if(serveThread.joinable()) {
+        serveExit.store(true);
+        serveThread.join();                                         //thread polls with a timeout, so terminates promptly
+    }
+
+    if(listenFd >= 0)
+        close(listenFd);
+    if(!unixPath.empty())
+        unlink(unixPath.c_str());
+}
+
+bool MetricsServer::IsListening() {
+    return listenFd >= 0;
+}
+
+void MetricsServer::SetRun(int pStartStep, int pTotalSteps, double pDt)
+{
+    startStep.store(pStartStep, std::memory_order_relaxed);
+    totalSteps.store(pTotalSteps, std::memory_order_relaxed);
+    dt.store(pDt, std::memory_order_relaxed);
+    step.store(pStartStep, std::memory_order_relaxed);
+    iterationsTotal.store(0, std::memory_order_relaxed);
+    startTime.store(Now(), std::memory_order_relaxed);
+}
+
+void MetricsServer::Update(int pStep, int pIterations, double pResidual)
+{
+    //relaxed stores only -> a scrape may see values from two adjacent steps, which is acceptable for monitoring
+    iterations.store(pIterations, std::memory_order_relaxed);
+    residual.store(pResidual, std::memory_order_relaxed);
+    iterationsTotal.fetch_add(pIterations, std::memory_order_relaxed);
+    step.store(pStep, std::memory_order_relaxed);
+}
+
+std::string MetricsServer::Format()
+{
+    int current = step.load(std::memory_order_relaxed);
+    int first = startStep.load(std::memory_order_relaxed);
+    int last = totalSteps.load(std::memory_order_relaxed);
+    double elapsed = (Now() - startTime.load(std::memory_order_relaxed)) * 1e-9;
+
+    //step rate and time remaining are derived here, keeping the solver side to plain stores
+    double rate = (elapsed > 0.0) ? (current - first) / elapsed : 0.0;
+    double eta = (rate > 0.0) ? (last - current) / rate : -1.0;            //-1 until the first step completes
+    double progress = (last > 0) ? (double) current / last : 0.0;
+
+    std::stringstream out;
+    out << "# HELP ldc_step Latest time step completed.\n"
+        << "# TYPE ldc_step gauge\n"
+        << "ldc_step " << current << "\n"
+        << "# HELP ldc_steps_final Time step the integration ends at.\n"
+        << "# TYPE ldc_steps_final gauge\n"
+        << "ldc_steps_final " << last << "\n"
+        << "# HELP ldc_simulation_time Simulated time of latest time step.\n"
+        << "# TYPE ldc_simulation_time gauge\n"
+        << "ldc_simulation_time " << current * dt.load(std::memory_order_relaxed) << "\n"
+        << "# HELP ldc_progress_ratio Fraction of time steps completed.\n"
+        << "# TYPE ldc_progress_ratio gauge\n"
+        << "ldc_progress_ratio " << progress << "\n"
+        << "# HELP ldc_cg_iterations Conjugate gradient iterations of latest time step.\n"
+        << "# TYPE ldc_cg_iterations gauge\n"
+        << "ldc_cg_iterations " << iterations.load(std::memory_order_relaxed) << "\n"
+        << "# HELP ldc_cg_iterations_total Conjugate gradient iterations since start of integration.\n"
+        << "# TYPE ldc_cg_iterations_total counter\n"
+        << "ldc_cg_iterations_total " << iterationsTotal.load(std::memory_order_relaxed) << "\n"
+        << "# HELP ldc_cg_residual Final conjugate gradient residual of latest time step.\n"
+        << "# TYPE ldc_cg_residual gauge\n"
+        << "ldc_cg_residual " << residual.load(std::memory_order_relaxed) << "\n"
+        << "# HELP ldc_step_rate Time steps per second since start of integration.\n"
+        << "# TYPE ldc_step_rate gauge\n"
+        << "ldc_step_rate " << rate << "\n"
+        << "# HELP ldc_eta_seconds Estimated wall time until integration completes.\n"
+        << "# TYPE ldc_eta_seconds gauge\n"
+        << "ldc_eta_seconds " << eta << "\n";
+    return out.str();
+}
+
+void MetricsServer::ServeLoop()
+{
+    struct pollfd pfd;
+    pfd.fd = listenFd;
+    pfd.events = POLLIN;
+
+    while(!serveExit.load()) {
+        if(poll(&pfd, 1, 200) <= 0)                                 //wake up regularly to check for termination
+            continue;
+
+        int client = accept(listenFd, nullptr, nullptr);
+        if(client < 0)
+            continue;
+
+        //read (and ignore) the request header; timeout prevents a silent client from stalling the endpoint
+        struct timeval timeout = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        char buffer[1024];
+        ssize_t bytes;
+        while((request.find("\r\n\r\n") == std::string::npos) && (request.size() < 8192)
+              && ((bytes = recv(client, buffer, sizeof(buffer), 0)) > 0))
+            request.append(buffer, bytes);
+
+        std::string body = Format();
+        std::stringstream response;
+        response << "HTTP/1.0 200 OK\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+
+        std::string data = response.str();
+        size_t sent = 0;
+        while(sent < data.size()) {
+            bytes = send(client, data.c_str() + sent, data.size() - sent, MSG_NOSIGNAL);      //no SIGPIPE if client went away
+            if(bytes <= 0)
+                break;
+            sent += bytes;
+        }
+        close(client);
+    }
+}
+
+long long MetricsServer::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+}
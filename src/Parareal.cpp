@@ -0,0 +1,306 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+#include <cblas.h>
+#include <mpi.h>
+
+#include "Parareal.h"
+#include "LidDrivenCavity.h"
+
+Parareal::Parareal(int pSlices, MPI_Comm pComm)
+{
+    int size;
+    comm = pComm;
+    slices = pSlices;
+    MPI_Comm_rank(comm, &worldRank);
+    MPI_Comm_size(comm, &size);
+
+    //contiguous ranks form a group, so a group is kept on as few nodes as possible for its halo exchanges
+    int groupSize = size / slices;
+    slice = worldRank / groupSize;
+    MPI_Comm_split(comm, slice, worldRank, &comm_group);
+
+    int groupRank;
+    MPI_Comm_rank(comm_group, &groupRank);
+    MPI_Comm_split(comm, groupRank, slice, &comm_time);            //rank in comm_time equals time slice
+
+    fine = new LidDrivenCavity(comm_group);
+    coarse = new LidDrivenCavity(comm_group);
+    fine->SetVerbose(false);                                        //progress is reported per iteration instead
+    coarse->SetVerbose(false);
+}
+
+Parareal::~Parareal()
+{
+    delete fine;
+    delete coarse;
+
+    delete[] start;
+    delete[] end;
+    delete[] fineEnd;
+    delete[] coarseEnd;
+    delete[] coarseNew;
+
+    MPI_Comm_free(&comm_group);
+    MPI_Comm_free(&comm_time);
+}
+
+void Parareal::SetDomainSize(double xlen, double ylen)
+{
+    Lx = xlen;
+    Ly = ylen;
+    fine->SetDomainSize(xlen, ylen);
+    coarse->SetDomainSize(xlen, ylen);
+}
+
+void Parareal::SetGridSize(int nx, int ny)
+{
+    globalNx = nx;
+    globalNy = ny;
+    fine->SetGridSize(nx, ny);
+    coarse->SetGridSize(nx, ny);
+}
+
+void Parareal::SetTimeStep(double deltat)
+{
+    dt = deltat;
+    fine->SetTimeStep(deltat);
+}
+
+void Parareal::SetFinalTime(double finalt)
+{
+    T = finalt;
+}
+
+void Parareal::SetReynoldsNumber(double re)
+{
+    nu = 1.0/re;
+    fine->SetReynoldsNumber(re);
+    coarse->SetReynoldsNumber(re);
+}
+
+void Parareal::SetCoarseFactor(int factor)
+{
+    coarseFactor = factor;
+}
+
+void Parareal::SetMaxIterations(int pIterations)
+{
+    maxIterations = pIterations;
+}
+
+void Parareal::SetTolerance(double tol)
+{
+    tolerance = tol;
+}
+
+void Parareal::PrintConfiguration()
+{
+    dx = Lx / (globalNx - 1);
+    dy = Ly / (globalNy - 1);
+    int NSteps = ceil(T/dt);
+
+    if(worldRank == 0) {
+        cout << "Grid size: " << globalNx << " x " << globalNy << endl;
+        cout << "Spacing:   " << dx << " x " << dy << endl;
+        cout << "Length:    " << Lx << " x " << Ly << endl;
+        cout << "Grid pts:  " << globalNx*globalNy << endl;
+        cout << "Timestep:  " << dt << endl;
+        cout << "Steps:     " << NSteps << endl;
+        cout << "Reynolds number: " << 1.0/nu << endl;
+        cout << "Linear solver: preconditioned conjugate gradient" << endl;
+        cout << "Time integration: Parareal with " << slices << " time slices, coarse factor " << coarseFactor << endl;
+        cout << endl;
+    }
+
+    //same checks on every process, so all terminate together
+    if((nu * dt / dx / dy > 0.25) || (NSteps < slices)) {
+        if(worldRank == 0) {
+            if(NSteps < slices)
+                cout << "ERROR: Fewer time steps than time slices!" << endl;
+            else {
+                cout << "ERROR: Time-step restriction not satisfied!" << endl;
+                cout << "Maximum time-step is " << 0.25 * dx * dy / nu << endl;
+            }
+        }
+
+        MPI_Finalize();
+        exit(-1);
+    }
+}
+
+void Parareal::Initialise()
+{
+    dx = Lx / (globalNx - 1);
+    dy = Ly / (globalNy - 1);
+
+    //distribute fine time steps over slices, first slices take one extra step if not divisible
+    int NSteps = ceil(T/dt);
+    fineSteps = NSteps / slices + ((slice < NSteps % slices) ? 1 : 0);
+
+    //coarse time step limited by time-step restriction of the explicit time advance, with a small margin
+    double sliceTime = fineSteps * dt;
+    double coarseTarget = std::min(coarseFactor * dt, 0.99 * 0.25 * dx * dy / nu);
+    coarseSteps = std::max(1, (int) ceil(sliceTime / coarseTarget - 1e-9));
+    coarseDt = sliceTime / coarseSteps;                            //coarse steps end exactly at end of slice
+    coarse->SetTimeStep(coarseDt);
+
+    fine->Initialise();
+    coarse->Initialise();
+
+    delete[] start;
+    delete[] end;
+    delete[] fineEnd;
+    delete[] coarseEnd;
+    delete[] coarseNew;
+
+    Npts = fine->GetNpts();
+    n = 2*Npts;
+    start = new double[n]();                                        //zero initial condition, as LidDrivenCavity
+    end = new double[n]();
+    fineEnd = new double[n]();
+    coarseEnd = new double[n]();
+    coarseNew = new double[n]();
+}
+
+void Parareal::Run()
+{
+    int maxK = (maxIterations > 0) ? std::min(maxIterations, slices) : slices;
+    double startTime = MPI_Wtime();
+    double fineTime = 0.0;
+
+    //-------------------------------------------Iteration 0: Coarse Prediction----------------------------------------------------//
+    //slice 0 starts from the initial condition, all other slices wait for the coarse result of the previous slice
+    if(slice > 0)
+        MPI_Recv(start, n, MPI_DOUBLE, slice - 1, 0, comm_time, MPI_STATUS_IGNORE);
+
+    Propagate(coarse, coarseSteps, start, coarseEnd);
+    cblas_dcopy(n, coarseEnd, 1, end, 1);
+
+    if(slice < slices - 1)
+        MPI_Send(end, n, MPI_DOUBLE, slice + 1, 0, comm_time);
+
+    //-------------------------------------------Iterations 1..K: Fine Propagation and Correction----------------------------------//
+    iterations = 0;
+    for(int k = 1; k <= maxK; ++k) {
+        //fine propagation of all slices concurrently; slices before k - 1 started from exact values last iteration, so are unchanged
+        if(slice >= k - 1) {
+            double t0 = MPI_Wtime();
+            Propagate(fine, fineSteps, start, fineEnd);
+            if(k == 1)
+                fineTime = MPI_Wtime() - t0;
+        }
+
+        if(slice > 0)
+            MPI_Recv(start, n, MPI_DOUBLE, slice - 1, 0, comm_time, MPI_STATUS_IGNORE);
+
+        //correction U_{n+1} = G(U_n^k) + F(U_n^{k-1}) - G(U_n^{k-1}); slices before k started from exact values, so U_{n+1} = F(U_n)
+        double local[2] = {0.0, 0.0};                               //[0] = squared change of end of slice, [1] = squared norm
+        if(slice < k) {
+            for(int i = 0; i < n; ++i) {
+                local[0] += (fineEnd[i] - end[i]) * (fineEnd[i] - end[i]);
+                end[i] = fineEnd[i];
+            }
+        }
+        else {
+            Propagate(coarse, coarseSteps, start, coarseNew);
+            for(int i = 0; i < n; ++i) {
+                double corrected = coarseNew[i] + fineEnd[i] - coarseEnd[i];
+                local[0] += (corrected - end[i]) * (corrected - end[i]);
+                end[i] = corrected;
+            }
+            std::swap(coarseEnd, coarseNew);
+        }
+        local[1] = cblas_ddot(n, end, 1, end, 1);
+
+        if(slice < slices - 1)
+            MPI_Send(end, n, MPI_DOUBLE, slice + 1, 0, comm_time);
+
+        double global[2];
+        MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, comm);
+        double change = sqrt(global[0] / std::max(global[1], 1e-300));
+        iterations = k;
+
+        if(worldRank == 0)
+            cout << "Parareal iteration: " << setw(4) << k << "  Change: " << setw(12) << change << endl;
+
+        if(change < tolerance)
+            break;
+    }
+
+    wallTime = MPI_Wtime() - startTime;
+
+    //sequential time stepping runs every slice one after another with the fine propagator
+    double groupFineTime;
+    MPI_Allreduce(&fineTime, &groupFineTime, 1, MPI_DOUBLE, MPI_MAX, comm_group);
+    MPI_Allreduce(&groupFineTime, &sequentialTime, 1, MPI_DOUBLE, MPI_SUM, comm_time);
+    MPI_Allreduce(MPI_IN_PLACE, &wallTime, 1, MPI_DOUBLE, MPI_MAX, comm);
+}
+
+void Parareal::WriteSolution(std::string file)
+{
+    if(slice == slices - 1) {
+        fine->SetState(end, end + Npts);
+        fine->WriteSolution(file);
+    }
+    MPI_Barrier(comm);                                              //file complete for every process on return
+}
+
+void Parareal::PrintReport()
+{
+    if(worldRank != 0)
+        return;
+
+    cout << endl;
+    cout << "Parareal time slices:     " << slices << endl;
+    cout << "Iterations:               " << iterations << endl;
+    cout << "Coarse time step:         " << coarseDt << " (" << coarseSteps << " steps per slice)" << endl;
+    cout << "Wall time:                " << wallTime << " s" << endl;
+    cout << "Sequential time stepping: " << sequentialTime << " s" << endl;
+    cout << "Speed-up:                 " << GetSpeedUp() << " (at most " << (double) slices / iterations << " for "
+         << iterations << " iterations)" << endl;
+}
+
+void Parareal::GetData(double* vOut, double* sOut)
+{
+    cblas_dcopy(Npts, end, 1, vOut, 1);
+    cblas_dcopy(Npts, end + Npts, 1, sOut, 1);
+}
+
+int Parareal::GetSlice() {
+    return slice;
+}
+
+int Parareal::GetIterations() {
+    return iterations;
+}
+
+int Parareal::GetNpts() {
+    return Npts;
+}
+
+double Parareal::GetCoarseDt() {
+    return coarseDt;
+}
+
+double Parareal::GetWallTime() {
+    return wallTime;
+}
+
+double Parareal::GetSequentialTime() {
+    return sequentialTime;
+}
+
+double Parareal::GetSpeedUp() {
+    return (wallTime > 0.0) ? sequentialTime / wallTime : 0.0;
+}
+
+void Parareal::Propagate(LidDrivenCavity* solver, int nSteps, double* in, double* out)
+{
+    solver->SetState(in, in + Npts);                                //restarts step count from zero
+    solver->IntegrateTo(nSteps);
+    solver->GetState(out, out + Npts);
+}
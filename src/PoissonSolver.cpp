@@ -0,0 +1,184 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+using namespace std;
+
+#include <mpi.h>
+
+#include "PoissonSolver.h"
+#include "SolverCG.h"
+#include "Agglomeration.h"
+#include "SolverSchur.h"
+#include "SolverCGTiled.h"
+
+void PoissonSolver::Solve(double* b, double* x)
+{
+    double start = MPI_Wtime();
+    DoSolve(b, x);
+    solveTime = MPI_Wtime() - start;
+}
+
+void PoissonSolver::SolveFromResidual(double* x, double bNormSquared)
+{
+    double start = MPI_Wtime();
+    DoSolveFromResidual(x, bNormSquared);
+    solveTime = MPI_Wtime() - start;
+}
+
+double* PoissonSolver::GetInitialResidual()
+{
+    return nullptr;
+}
+
+void PoissonSolver::DoSolveFromResidual(double* x, double bNormSquared)
+{
+    //reached by a backend that provides GetInitialResidual without solving from it, or by a caller that ignored a nullptr storage;
+    //x would silently keep the initial guess, and there is no right hand side to fall back to
+    cout << "ERROR: Poisson backend cannot solve from an initial residual" << endl;
+    MPI_Finalize();
+    exit(-1);
+}
+
+double PoissonSolver::GetSolveTime()
+{
+    return solveTime;
+}
+
+//built-in backends, created on all processes of the problem
+static PoissonSolver* CreateCG(const PoissonProblem& problem)
+{
+    MPI_Comm rowGrid = problem.rowGrid;
+    MPI_Comm colGrid = problem.colGrid;
+    return new SolverCG(problem.Nx, problem.Ny, problem.dx, problem.dy, rowGrid, colGrid, problem.cartGrid);
+}
+
+static PoissonSolver* CreateAgglomerated(const PoissonProblem& problem)
+{
+    int size;
+    MPI_Comm_size(problem.cartGrid, &size);
+    int p = round(sqrt(size));
+    int q = Agglomeration::ChooseGridSize(problem.globalNx*problem.globalNy, p, problem.minPoints);
+    if(q >= p)
+        return nullptr;
+    return new Agglomeration(problem.cartGrid, q, problem.xStart, problem.yStart, problem.Nx, problem.Ny, problem.dx, problem.dy);
+}
+
+static PoissonSolver* CreateSchur(const PoissonProblem& problem)
+{
+    SolverSchur* solver = new SolverSchur(problem);
+    if(!solver->IsFactored()) {
+        delete solver;
+        return nullptr;
+    }
+    return solver;
+}
+
+static PoissonSolver* CreateTiled(const PoissonProblem& problem)
+{
+    SolverCGTiled* solver = new SolverCGTiled(problem);
+    if(!solver->IsUsable()) {
+        delete solver;
+        return nullptr;
+    }
+    return solver;
+}
+
+std::vector<std::pair<std::string, PoissonSolver::Factory>>& PoissonSolver::Registry()
+{
+    static std::vector<std::pair<std::string, Factory>> registry = {{"pcg", CreateCG}, {"pcg-agglomerated", CreateAgglomerated},
+                                                                    {"schur", CreateSchur}, {"pcg-tiled", CreateTiled}};
+    return registry;
+}
+
+void PoissonSolver::Register(std::string name, Factory factory)
+{
+    for(auto& entry : Registry()) {
+        if(entry.first == name) {
+            entry.second = factory;
+            return;
+        }
+    }
+    Registry().push_back(std::make_pair(name, factory));
+}
+
+PoissonSolver* PoissonSolver::Create(std::string name, const PoissonProblem& problem)
+{
+    for(auto& entry : Registry()) {
+        if(entry.first == name)
+            return entry.second(problem);
+    }
+    return nullptr;
+}
+
+std::vector<std::string> PoissonSolver::GetNames()
+{
+    std::vector<std::string> names;
+    for(auto& entry : Registry())
+        names.push_back(entry.first);
+    return names;
+}
+
+std::string PoissonSolver::Recommend(const PoissonProblem& problem)
+{
+    int size;
+    MPI_Comm_size(problem.cartGrid, &size);
+    int p = round(sqrt(size));
+    if(Agglomeration::ChooseGridSize(problem.globalNx*problem.globalNy, p, problem.minPoints) < p)
+        return "pcg-agglomerated";
+    return "pcg";
+}
+
+PoissonSolver* PoissonSolver::Measure(const PoissonProblem& problem, double tolerance, std::string& name, bool verbose)
+{
+    int rank;
+    MPI_Comm_rank(problem.cartGrid, &rank);
+
+    //all modes of the grid, as a single mode is solved in one iteration, from the global index so any partition gives the same problem
+    int n = problem.Nx*problem.Ny;
+    double* b = new double[n];
+    double* x = new double[n];
+    for(int j = 0; j < problem.Ny; ++j) {
+        for(int i = 0; i < problem.Nx; ++i) {
+            long long k = (long long) (problem.yStart + j)*problem.globalNx + problem.xStart + i;
+            b[j*problem.Nx + i] = (double) ((k*7919) % 1009) / 1009 - 0.5;
+        }
+    }
+
+    PoissonSolver* best = nullptr;
+    double bestTime = 0.0;
+    for(auto& entry : Registry()) {
+        PoissonSolver* candidate = entry.second(problem);
+        if(!candidate)
+            continue;
+        candidate->SetVerbose(false);
+        candidate->SetTolerance(tolerance, 0.0, 0.0);
+
+        //first solve warms caches and the communication paths, the second is timed
+        for(int trial = 0; trial < 2; ++trial) {
+            std::fill(x, x + n, 0.0);
+            MPI_Barrier(problem.cartGrid);
+            candidate->Solve(b, x);
+        }
+        double time = candidate->GetSolveTime();
+        MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, problem.cartGrid);
+        if(verbose && (rank == 0))
+            cout << "Poisson solver " << entry.first << ": " << time << " s, " << candidate->GetIterations() << " iterations" << endl;
+
+        //ties keep the earlier backend, so the choice is the same on all processes
+        if(!best || (time < bestTime)) {
+            delete best;
+            best = candidate;
+            bestTime = time;
+            name = entry.first;
+        }
+        else
+            delete candidate;
+    }
+
+    delete[] b;
+    delete[] x;
+    if(best)
+        best->Reset();
+    return best;
+}
@@ -0,0 +1,238 @@
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+#include <omp.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <sys/syscall.h>
+
+#include "Profiler.h"
+
+//older C libraries only define the member behind this name in the kernel headers
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+Profiler* Profiler::active = nullptr;
+
+//top of the stack of each sampled thread, set by Start; a thread without it only records the interrupted address
+static thread_local uintptr_t stackHigh = 0;
+
+Profiler::Profiler(int pFrequency, int pCapacity)
+    : next(0), dropped(0)
+{
+    frequency = pFrequency;
+    capacity = pCapacity;
+    frames = new void*[(size_t) capacity * MaxDepth];               //pages only touched when samples are recorded
+    depth = new int[capacity];
+}
+
+Profiler::~Profiler()
+{
+    Stop();
+    delete[] frames;
+    delete[] depth;
+}
+
+void Profiler::Start()
+{
+    if(running || active)
+        return;
+
+    active = this;
+    running = true;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = Handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    //each thread arms a timer on its own CPU clock that signals only this thread
+    long nanoseconds = 1000000000L / frequency;
+    timers.clear();
+    #pragma omp parallel
+    {
+        struct sigevent event;
+        memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = syscall(SYS_gettid);
+
+        //the handler only follows frame pointers into the used part of the stack of its thread, so a corrupt chain can never fault
+        pthread_attr_t attributes;
+        if(pthread_getattr_np(pthread_self(), &attributes) == 0) {
+            void* base;
+            size_t size;
+            if(pthread_attr_getstack(&attributes, &base, &size) == 0)
+                stackHigh = (uintptr_t) base + size;
+            pthread_attr_destroy(&attributes);
+        }
+
+        timer_t timer;
+        if(timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) == 0) {
+            struct itimerspec interval;
+            interval.it_interval.tv_sec = nanoseconds / 1000000000L;
+            interval.it_interval.tv_nsec = nanoseconds % 1000000000L;
+            interval.it_value = interval.it_interval;
+            timer_settime(timer, 0, &interval, nullptr);
+
+            #pragma omp critical
+            timers.push_back(timer);
+        }
+    }
+}
+
+void Profiler::Stop()
+{
+    if(!running)
+        return;
+
+    for(size_t t = 0; t < timers.size(); ++t)
+        timer_delete(timers[t]);
+    timers.clear();
+
+    signal(SIGPROF, SIG_IGN);                                       //signals still pending are discarded
+    active = nullptr;
+    running = false;
+}
+
+void Profiler::WriteFolded(std::string file)
+{
+    //identical stacks are merged, sorted so files of different processes are easily compared
+    std::map<void*, std::string> symbols;
+    std::map<std::string, int> stacks;
+    int samples = GetNumSamples();
+
+    for(int k = 0; k < samples; ++k) {
+        void** sample = frames + (size_t) k * MaxDepth;
+
+        //frame 0 is the interrupted address, the frames after it are return addresses, which point after the call
+        std::string stack;
+        for(int f = depth[k] - 1; f >= 0; --f) {
+            void* address = (f == 0) ? sample[f] : (void*) ((char*) sample[f] - 1);
+            std::map<void*, std::string>::iterator it = symbols.find(address);
+            if(it == symbols.end())
+                it = symbols.insert(std::make_pair(address, Symbol(address))).first;
+
+            if(!stack.empty())
+                stack += ";";
+            stack += it->second;
+        }
+        if(!stack.empty())
+            stacks[stack]++;
+    }
+
+    std::ofstream f(file.c_str());
+    for(std::map<std::string, int>::iterator it = stacks.begin(); it != stacks.end(); ++it)
+        f << it->first << " " << it->second << "\n";
+}
+
+int Profiler::GetNumSamples() {
+    int n = next.load();
+    return (n < capacity) ? n : capacity;
+}
+
+int Profiler::GetDropped() {
+    return dropped.load();
+}
+
+void Profiler::Handler(int sig, siginfo_t* info, void* context)
+{
+    Profiler* profiler = active;
+    if(!profiler)
+        return;
+
+    int saved = errno;
+    int k = profiler->next.fetch_add(1, std::memory_order_relaxed);
+    if(k < profiler->capacity)
+        profiler->depth[k] = Unwind(context, profiler->frames + (size_t) k * MaxDepth);
+    else
+        profiler->dropped.fetch_add(1, std::memory_order_relaxed);
+    errno = saved;
+}
+
+int Profiler::Unwind(void* context, void** sample)
+{
+    const ucontext_t* interrupted = static_cast<const ucontext_t*>(context);
+#if defined(__x86_64__)
+    uintptr_t pc = interrupted->uc_mcontext.gregs[REG_RIP];
+    uintptr_t sp = interrupted->uc_mcontext.gregs[REG_RSP];
+    uintptr_t fp = interrupted->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+    uintptr_t pc = interrupted->uc_mcontext.pc;
+    uintptr_t sp = interrupted->uc_mcontext.sp;
+    uintptr_t fp = interrupted->uc_mcontext.regs[29];
+#else
+    uintptr_t pc = 0;
+    uintptr_t sp = 1;
+    uintptr_t fp = 0;
+    (void) interrupted;
+#endif
+
+    int n = 0;
+    sample[n++] = (void*) pc;
+
+    //each frame holds the frame pointer of its caller followed by the return address, callers lie further up the stack
+    //only the stack between the interrupted stack pointer and the top is surely mapped, code without frame pointers may leave anything
+    while((n < MaxDepth) && (fp >= sp) && (fp + 2*sizeof(uintptr_t) <= stackHigh) && (fp % sizeof(uintptr_t) == 0)) {
+        const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+        if(frame[1] == 0)
+            break;
+        sample[n++] = (void*) frame[1];
+        if(frame[0] <= fp)                                          //chain must move up the stack, anything else is not a frame pointer
+            break;
+        fp = frame[0];
+    }
+    return n;
+}
+
+std::string Profiler::Symbol(void* address)
+{
+    //frames read through code without frame pointers may be any value, for which dladdr fills in nothing
+    Dl_info info;
+    if(!dladdr(address, &info))
+        return "[unknown]";
+    if(!info.dli_sname) {
+        if(info.dli_fname) {
+            const char* base = strrchr(info.dli_fname, '/');
+            return std::string("[") + (base ? base + 1 : info.dli_fname) + "]";
+        }
+        return "[unknown]";
+    }
+
+    int status;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    std::string name = (status == 0) ? demangled : info.dli_sname;
+    free(demangled);
+
+    //drop argument types, keep suffixes such as [clone ._omp_fn.0] that identify OpenMP regions
+    size_t open = name.find('(');
+    if(open != std::string::npos) {
+        int level = 0;
+        size_t close = open;
+        for(; close < name.size(); ++close) {
+            if(name[close] == '(')
+                ++level;
+            else if((name[close] == ')') && (--level == 0))
+                break;
+        }
+        name.erase(open, close - open + 1);
+    }
+
+    //semicolons separate frames in folded stacks
+    for(size_t i = 0; i < name.size(); ++i)
+        if(name[i] == ';')
+            name[i] = ':';
+    return name;
+}
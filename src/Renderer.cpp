@@ -0,0 +1,124 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+#include <mpi.h>
+
+#include "Renderer.h"
+
+Renderer::Renderer(int pWidth, int pHeight, int pContours, int pGlobalNx, int pGlobalNy, int pXStart, int pYStart, int pNx, int pNy,
+                   MPI_Comm pComm)
+{
+    width = pWidth;
+    height = pHeight;
+    contours = std::min(pContours, 254);                    //level 0 is reserved for pixels not covered by current process
+    Nx = pNx;
+    Ny = pNy;
+    comm = pComm;
+    MPI_Comm_rank(comm, &rank);
+
+    //each pixel samples its nearest global grid point, so pixel ownership is decided once here and every pixel has exactly one owner
+    //image row 0 is the top of the domain, whereas j = 0 is the bottom
+    pixel = new int[width*height];
+    sample = new int[width*height];
+    nPixels = 0;
+    for(int py = 0; py < height; ++py) {
+        int gj = (int) round((double) (height - 1 - py) * (pGlobalNy - 1) / std::max(height - 1, 1));
+        if((gj < pYStart) || (gj >= pYStart + pNy))
+            continue;
+
+        for(int px = 0; px < width; ++px) {
+            int gi = (int) round((double) px * (pGlobalNx - 1) / std::max(width - 1, 1));
+            if((gi < pXStart) || (gi >= pXStart + pNx))
+                continue;
+
+            pixel[nPixels] = py*width + px;
+            sample[nPixels] = (gj - pYStart)*Nx + (gi - pXStart);
+            nPixels++;
+        }
+    }
+
+    tile = new unsigned char[4*width*height]();
+    if(rank == 0)
+        image = new unsigned char[4*width*height]();
+}
+
+Renderer::~Renderer()
+{
+    delete[] pixel;
+    delete[] sample;
+    delete[] tile;
+    delete[] image;
+}
+
+int Renderer::GetWidth() {
+    return width;
+}
+
+int Renderer::GetHeight() {
+    return height;
+}
+
+void Renderer::Render(double* v, double* s, std::string file)
+{
+    //global ranges for colour map and contour levels: [0] = max |v|, [1] = max s, [2] = -min s -> single reduction
+    double localRange[3] = {0.0, -1e300, -1e300};
+    double globalRange[3];
+    for(int k = 0; k < nPixels; ++k) {
+        double vk = v[sample[k]];
+        double sk = s[sample[k]];
+        localRange[0] = std::max(localRange[0], std::fabs(vk));
+        localRange[1] = std::max(localRange[1], sk);
+        localRange[2] = std::max(localRange[2], -sk);
+    }
+    MPI_Allreduce(localRange,globalRange,3,MPI_DOUBLE,MPI_MAX,comm);
+
+    double vScale = 1.0 / log1p(std::max(globalRange[0], 1e-300));
+    double sMax = globalRange[1];
+    double sMin = -globalRange[2];
+    double sScale = (sMax > sMin) ? contours / (sMax - sMin) : 0.0;
+
+    //colour map local pixels into the tile, all other pixels remain zero
+    for(int k = 0; k < nPixels; ++k) {
+        double vk = v[sample[k]];
+        double c = std::min(1.0, log1p(std::fabs(vk)) * vScale);          //0 -> white, 1 -> saturated
+        unsigned char* rgbl = tile + 4*pixel[k];
+
+        if(vk < 0) {                                                        //negative vorticity (clockwise) -> blue
+            rgbl[0] = (unsigned char) (255 * (1.0 - c));
+            rgbl[1] = (unsigned char) (255 * (1.0 - c));
+            rgbl[2] = 255;
+        }
+        else {                                                              //positive vorticity (anticlockwise) -> red
+            rgbl[0] = 255;
+            rgbl[1] = (unsigned char) (255 * (1.0 - c));
+            rgbl[2] = (unsigned char) (255 * (1.0 - c));
+        }
+
+        int level = (int) ((s[sample[k]] - sMin) * sScale);
+        rgbl[3] = (unsigned char) (1 + std::min(std::max(level, 0), contours - 1));
+    }
+
+    //every pixel is owned by exactly one process, so summing the tiles composites the image
+    MPI_Reduce(tile,image,4*width*height,MPI_UNSIGNED_CHAR,MPI_SUM,0,comm);
+
+    if(rank == 0) {
+        std::ofstream f(file.c_str(), std::ios::binary | std::ios::trunc);
+        f << "P6\n" << width << " " << height << "\n255\n";
+
+        //contours drawn where the level changes between neighbouring pixels, which needs the full image so is done on root
+        unsigned char black[3] = {0, 0, 0};
+        for(int py = 0; py < height; ++py) {
+            for(int px = 0; px < width; ++px) {
+                unsigned char* rgbl = image + 4*(py*width + px);
+                bool contour = ((px + 1 < width) && (rgbl[3] != rgbl[7]))
+                            || ((py + 1 < height) && (rgbl[3] != image[4*((py+1)*width + px) + 3]));
+                f.write(reinterpret_cast<char*>(contour ? black : rgbl), 3);
+            }
+        }
+        f.close();
+    }
+}
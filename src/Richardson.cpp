@@ -0,0 +1,252 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+#include <mpi.h>
+
+#include "Richardson.h"
+#include "LidDrivenCavity.h"
+
+Richardson::Richardson(bool pConcurrent, MPI_Comm pComm)
+{
+    int size;
+    comm = pComm;
+    concurrent = pConcurrent;
+    MPI_Comm_rank(comm, &worldRank);
+    MPI_Comm_size(comm, &size);
+
+    //first half of the processes solves the coarse grid, second half the fine grid; root of the coarse grid is the root process
+    if(concurrent) {
+        group = (worldRank < size / 2) ? 0 : 1;
+        fineRoot = size / 2;
+        MPI_Comm_split(comm, group, worldRank, &comm_group);
+    }
+    else {
+        group = 2;
+        fineRoot = 0;
+        MPI_Comm_dup(comm, &comm_group);
+    }
+
+    if(group != 1) {
+        coarse = new LidDrivenCavity(comm_group);
+        coarse->SetVerbose(false);                                  //progress is reported once for both grids instead
+    }
+    if(group != 0) {
+        fine = new LidDrivenCavity(comm_group);
+        fine->SetVerbose(false);
+    }
+}
+
+Richardson::~Richardson()
+{
+    delete coarse;
+    delete fine;
+
+    for(int f = 0; f < NumFields; ++f) {
+        delete[] coarseFields[f];
+        delete[] fineFields[f];
+        delete[] result[f];
+    }
+
+    MPI_Comm_free(&comm_group);
+}
+
+void Richardson::SetDomainSize(double xlen, double ylen)
+{
+    Lx = xlen;
+    Ly = ylen;
+    if(coarse)
+        coarse->SetDomainSize(xlen, ylen);
+    if(fine)
+        fine->SetDomainSize(xlen, ylen);
+}
+
+void Richardson::SetGridSize(int nx, int ny)
+{
+    Nx = nx;
+    Ny = ny;
+    if(coarse)
+        coarse->SetGridSize(nx, ny);
+    if(fine)
+        fine->SetGridSize(2*nx - 1, 2*ny - 1);                      //halved spacing, every second point coincides with the coarse grid
+}
+
+void Richardson::SetTimeStep(double deltat)
+{
+    dt = deltat;
+    if(coarse)
+        coarse->SetTimeStep(deltat);
+    if(fine)
+        fine->SetTimeStep(deltat);
+}
+
+void Richardson::SetFinalTime(double finalt)
+{
+    T = finalt;
+    if(coarse)
+        coarse->SetFinalTime(finalt);
+    if(fine)
+        fine->SetFinalTime(finalt);
+}
+
+void Richardson::SetReynoldsNumber(double re)
+{
+    nu = 1.0/re;
+    if(coarse)
+        coarse->SetReynoldsNumber(re);
+    if(fine)
+        fine->SetReynoldsNumber(re);
+}
+
+void Richardson::PrintConfiguration()
+{
+    double dx = Lx / (Nx - 1);
+    double dy = Ly / (Ny - 1);
+    double fineDx = 0.5 * dx;
+    double fineDy = 0.5 * dy;
+
+    if(worldRank == 0) {
+        cout << "Grid size: " << Nx << " x " << Ny << " and " << 2*Nx - 1 << " x " << 2*Ny - 1 << endl;
+        cout << "Spacing:   " << dx << " x " << dy << " and " << fineDx << " x " << fineDy << endl;
+        cout << "Length:    " << Lx << " x " << Ly << endl;
+        cout << "Timestep:  " << dt << endl;
+        cout << "Steps:     " << ceil(T/dt) << endl;
+        cout << "Reynolds number: " << 1.0/nu << endl;
+        cout << "Linear solver: preconditioned conjugate gradient" << endl;
+        cout << "Richardson extrapolation: grids solved " << (concurrent ? "concurrently" : "sequentially") << endl;
+        cout << endl;
+    }
+
+    //same check on every process, so all terminate together; the fine grid has the stricter restriction
+    if(nu * dt / fineDx / fineDy > 0.25) {
+        if(worldRank == 0) {
+            cout << "ERROR: Time-step restriction not satisfied on the fine grid!" << endl;
+            cout << "Maximum time-step is " << 0.25 * fineDx * fineDy / nu << endl;
+        }
+
+        MPI_Finalize();
+        exit(-1);
+    }
+}
+
+void Richardson::Initialise()
+{
+    if(coarse)
+        coarse->Initialise();
+    if(fine)
+        fine->Initialise();
+
+    //global fields are only held on the root process, and on the root of the fine grid until sent
+    int fineNpts = (2*Nx - 1) * (2*Ny - 1);
+    for(int f = 0; f < NumFields; ++f) {
+        if(worldRank == 0) {
+            coarseFields[f] = new double[Nx*Ny];
+            result[f] = new double[Nx*Ny];
+        }
+        if((worldRank == 0) || (worldRank == fineRoot))
+            fineFields[f] = new double[fineNpts];
+    }
+}
+
+void Richardson::Run()
+{
+    double startTime = MPI_Wtime();
+
+    if(coarse)
+        Solve(coarse, coarseFields);
+    if(fine)
+        Solve(fine, fineFields);
+
+    int fineNx = 2*Nx - 1;
+    int fineNpts = fineNx * (2*Ny - 1);
+    if(concurrent) {
+        for(int f = 0; f < NumFields; ++f) {
+            if(worldRank == fineRoot)
+                MPI_Send(fineFields[f], fineNpts, MPI_DOUBLE, 0, f, comm);
+            else if(worldRank == 0)
+                MPI_Recv(fineFields[f], fineNpts, MPI_DOUBLE, fineRoot, f, comm, MPI_STATUS_IGNORE);
+        }
+    }
+
+    //coarse point (i,j) coincides with fine point (2i,2j)
+    if(worldRank == 0) {
+        for(int f = 0; f < NumFields; ++f) {
+            errorMax[f] = 0.0;
+            errorRms[f] = 0.0;
+            for(int j = 0; j < Ny; ++j) {
+                for(int i = 0; i < Nx; ++i) {
+                    double c = coarseFields[f][j*Nx + i];
+                    double h = fineFields[f][2*j*fineNx + 2*i];
+                    double error = fabs(h - c) / 3.0;
+
+                    result[f][j*Nx + i] = (4.0*h - c) / 3.0;
+                    errorMax[f] = std::max(errorMax[f], error);
+                    errorRms[f] += error * error;
+                }
+            }
+            errorRms[f] = sqrt(errorRms[f] / (Nx*Ny));
+        }
+    }
+
+    wallTime = MPI_Wtime() - startTime;
+    MPI_Allreduce(MPI_IN_PLACE, &wallTime, 1, MPI_DOUBLE, MPI_MAX, comm);
+}
+
+void Richardson::WriteSolution(std::string file)
+{
+    if(worldRank == 0) {
+        double dx = Lx / (Nx - 1);
+        double dy = Ly / (Ny - 1);
+
+        std::ofstream f(file.c_str(), std::ios::trunc);
+        std::cout << "Writing file " << file << std::endl;
+
+        //columns from left to right, as LidDrivenCavity::WriteSolution
+        for(int i = 0; i < Nx; ++i) {
+            for(int j = 0; j < Ny; ++j) {
+                int k = j*Nx + i;
+                f << i * dx << " " << j * dy
+                  << " " << result[0][k] << " " << result[1][k]
+                  << " " << result[2][k] << " " << result[3][k] << std::endl;
+            }
+            f << std::endl;
+        }
+        f.close();
+    }
+    MPI_Barrier(comm);                                              //file complete for every process on return
+}
+
+void Richardson::PrintReport()
+{
+    if(worldRank != 0)
+        return;
+
+    const char* names[NumFields] = {"Vorticity", "Streamfunction", "x velocity", "y velocity"};
+
+    cout << endl;
+    cout << "Estimated error of the " << 2*Nx - 1 << " x " << 2*Ny - 1 << " solution (|u_h - u_2h|/3):" << endl;
+    for(int f = 0; f < NumFields; ++f)
+        cout << "  " << names[f] << ": max " << errorMax[f] << ", rms " << errorRms[f] << endl;
+    cout << "Wall time: " << wallTime << " s" << endl;
+}
+
+void Richardson::GetExtrapolated(int field, double* out)
+{
+    std::copy(result[field], result[field] + Nx*Ny, out);
+}
+
+double Richardson::GetErrorEstimate(int field) {
+    return errorMax[field];
+}
+
+double Richardson::GetWallTime() {
+    return wallTime;
+}
+
+void Richardson::Solve(LidDrivenCavity* solver, double** fields)
+{
+    solver->Integrate();
+    solver->GatherSolution(fields[0], fields[1], fields[2], fields[3]);
+}
@@ -0,0 +1,346 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+#include <mpi.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Snapshot.h"
+
+SnapshotWriter::SnapshotWriter(std::string file, int pNumFields, const std::string* pFieldNames, int pGlobalNx, int pGlobalNy,
+                               double pLx, double pLy, MPI_Comm pComm)
+{
+    comm = pComm;
+    nFields = pNumFields;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    //the file header has room for a fixed number of field names
+    if((nFields < 1) || (nFields > SNAPSHOT_MAX_FIELDS)) {
+        if(rank == 0)
+            cout << "ERROR: snapshot files hold 1 to " << SNAPSHOT_MAX_FIELDS << " fields, " << nFields << " requested" << endl;
+
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    //block table is gathered every snapshot, so allocate once here
+    blockInfo = new int[4*size];
+    table = new SnapshotBlockEntry[size];
+
+    //open and truncate file, any previous content is discarded
+    MPI_File_open(comm, file.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+    MPI_File_set_size(fh, 0);
+
+    if(rank == 0) {
+        SnapshotFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "LDCSNAP1", 8);
+        header.version = 1;
+        header.nFields = nFields;
+        header.globalNx = pGlobalNx;
+        header.globalNy = pGlobalNy;
+        header.Lx = pLx;
+        header.Ly = pLy;
+        for(int f = 0; f < nFields; ++f)
+            std::strncpy(header.fieldNames[f], pFieldNames[f].c_str(), 15);
+
+        MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+    endOffset = sizeof(SnapshotFileHeader);
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    MPI_File_close(&fh);
+
+    delete[] blockInfo;
+    delete[] table;
+}
+
+void SnapshotWriter::Write(int step, double time, int xStart, int yStart, int nx, int ny, double** fields)
+{
+    //every process needs the block table to find where its own data goes in the file
+    int info[4] = {xStart, yStart, nx, ny};
+    MPI_Allgather(info,4,MPI_INT,blockInfo,4,MPI_INT,comm);
+
+    //record layout: record header, block table, then data of each block in rank order
+    long long offset = endOffset + sizeof(SnapshotRecordHeader) + size*sizeof(SnapshotBlockEntry);
+    for(int q = 0; q < size; ++q) {
+        table[q].xStart = blockInfo[4*q];
+        table[q].yStart = blockInfo[4*q+1];
+        table[q].nx = blockInfo[4*q+2];
+        table[q].ny = blockInfo[4*q+3];
+        table[q].offset = offset;
+        offset += (long long) nFields * table[q].nx * table[q].ny * sizeof(double);
+    }
+
+    SnapshotRecordHeader record;
+    record.recordBytes = offset - endOffset;
+    record.step = step;
+    record.nBlocks = size;
+    record.time = time;
+
+    //root writes the index, every process writes its own block directly -> nothing is gathered
+    if(rank == 0) {
+        MPI_File_write_at(fh, endOffset, &record, sizeof(record), MPI_BYTE, MPI_STATUS_IGNORE);
+        MPI_File_write_at(fh, endOffset + sizeof(record), table, size*sizeof(SnapshotBlockEntry), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    for(int f = 0; f < nFields; ++f) {
+        MPI_Offset fieldOffset = table[rank].offset + (long long) f * nx * ny * sizeof(double);
+        MPI_File_write_at_all(fh, fieldOffset, fields[f], nx*ny, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    }
+
+    endOffset += record.recordBytes;
+}
+
+bool SnapshotWriter::ConvertText(std::string textFile, std::string snapFile, int step, double time)
+{
+    std::ifstream f(textFile.c_str());
+    if(!f.is_open())
+        return false;
+
+    //legacy format prints the domain column by column, each line holding x y v s u0 u1, with empty lines between columns
+    std::vector<double> values[6];
+    std::string line;
+    int globalNy = 0;
+    int columnLength = 0;
+    double xMax = 0.0;
+    double yMax = 0.0;
+
+    while(std::getline(f,line)) {
+        if(line.empty()) {
+            if((globalNy == 0) && (columnLength > 0))
+                globalNy = columnLength;                            //length of first column gives number of points in y
+            columnLength = 0;
+            continue;
+        }
+
+        std::stringstream data(line);
+        double value[6];
+        for(int k = 0; k < 6; ++k) {
+            if(!(data >> value[k]))
+                return false;
+            values[k].push_back(value[k]);
+        }
+        xMax = std::max(xMax, value[0]);
+        yMax = std::max(yMax, value[1]);
+        columnLength++;
+    }
+
+    if(globalNy == 0)
+        globalNy = columnLength;
+    int nPts = values[0].size();
+    if((globalNy == 0) || (nPts % globalNy != 0))
+        return false;
+    int globalNx = nPts / globalNy;
+
+    //reorder from column-by-column into row major format
+    double* fields[4];
+    for(int k = 0; k < 4; ++k) {
+        fields[k] = new double[nPts];
+        for(int i = 0; i < globalNx; ++i)
+            for(int j = 0; j < globalNy; ++j)
+                fields[k][j*globalNx + i] = values[k+2][i*globalNy + j];
+    }
+
+    std::string names[4] = {"v", "s", "u0", "u1"};
+    {
+        SnapshotWriter writer(snapFile, 4, names, globalNx, globalNy, xMax, yMax, MPI_COMM_SELF);
+        writer.Write(step, time, 0, 0, globalNx, globalNy, fields);
+    }
+
+    for(int k = 0; k < 4; ++k)
+        delete[] fields[k];
+    return true;
+}
+
+SnapshotReader::SnapshotReader(std::string file)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+
+    struct stat st;
+    if((fstat(fd, &st) != 0) || (st.st_size < (long long) sizeof(SnapshotFileHeader))) {
+        close(fd);
+        return;
+    }
+
+    //map whole file; pages are only read from storage when the requested data is touched
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return;
+
+    data = static_cast<char*>(map);
+    fileBytes = st.st_size;
+    header = reinterpret_cast<SnapshotFileHeader*>(data);
+
+    //everything used to index into the mapping is checked first, so a corrupt file is rejected instead of read past its end
+    bool namesTerminated = true;
+    for(int f = 0; f < SNAPSHOT_MAX_FIELDS; ++f)
+        namesTerminated = namesTerminated && (std::memchr(header->fieldNames[f], 0, 16) != nullptr);
+    if((std::memcmp(header->magic, "LDCSNAP1", 8) != 0) || (header->version != 1) || (header->nFields < 1)
+       || (header->nFields > SNAPSHOT_MAX_FIELDS) || (header->globalNx < 1) || (header->globalNy < 1) || !namesTerminated) {
+        munmap(data, fileBytes);
+        data = nullptr;
+        header = nullptr;
+        return;
+    }
+
+    //walk the chain of record headers twice (count, then store) to build the time index, no field data is touched
+    for(int pass = 0; pass < 2; ++pass) {
+        long long offset = sizeof(SnapshotFileHeader);
+        int count = 0;
+        while(offset + (long long) sizeof(SnapshotRecordHeader) <= fileBytes) {
+            SnapshotRecordHeader* record = reinterpret_cast<SnapshotRecordHeader*>(data + offset);
+            if(!IsRecordValid(offset))
+                break;                                              //incomplete record at end of file, e.g. job killed mid-write
+            if(pass == 1)
+                recordOffsets[count] = offset;
+            count++;
+            offset += record->recordBytes;
+        }
+
+        if(pass == 0) {
+            nSnapshots = count;
+            recordOffsets = new long long[count];
+        }
+    }
+}
+
+bool SnapshotReader::IsRecordValid(long long offset)
+{
+    SnapshotRecordHeader* record = reinterpret_cast<SnapshotRecordHeader*>(data + offset);
+    long long tableBytes = (long long) record->nBlocks * sizeof(SnapshotBlockEntry);
+    if((record->recordBytes <= 0) || (record->recordBytes > fileBytes - offset) || (record->nBlocks < 0)
+       || ((long long) sizeof(SnapshotRecordHeader) + tableBytes > record->recordBytes))
+        return false;
+
+    //each block has to lie in the data of its record and in the global domain
+    long long dataStart = offset + sizeof(SnapshotRecordHeader) + tableBytes;
+    long long recordEnd = offset + record->recordBytes;
+    SnapshotBlockEntry* table = reinterpret_cast<SnapshotBlockEntry*>(data + offset + sizeof(SnapshotRecordHeader));
+    for(int q = 0; q < record->nBlocks; ++q) {
+        SnapshotBlockEntry &block = table[q];
+        if((block.nx < 0) || (block.ny < 0) || (block.xStart < 0) || (block.yStart < 0)
+           || (block.xStart > header->globalNx - block.nx) || (block.yStart > header->globalNy - block.ny))
+            return false;
+        long long blockBytes = (long long) header->nFields * block.nx * block.ny * sizeof(double);
+        if((block.offset < dataStart) || (block.offset > recordEnd - blockBytes))
+            return false;
+    }
+    return true;
+}
+
+SnapshotReader::~SnapshotReader()
+{
+    if(data)
+        munmap(data, fileBytes);
+    delete[] recordOffsets;
+}
+
+bool SnapshotReader::IsValid() {
+    return header != nullptr;
+}
+
+int SnapshotReader::GetNumSnapshots() {
+    return nSnapshots;
+}
+
+int SnapshotReader::GetNumFields() {
+    return header->nFields;
+}
+
+int SnapshotReader::GetGlobalNx() {
+    return header->globalNx;
+}
+
+int SnapshotReader::GetGlobalNy() {
+    return header->globalNy;
+}
+
+double SnapshotReader::GetLx() {
+    return header->Lx;
+}
+
+double SnapshotReader::GetLy() {
+    return header->Ly;
+}
+
+std::string SnapshotReader::GetFieldName(int field) {
+    if((field < 0) || (field >= header->nFields))
+        return "";
+    return std::string(header->fieldNames[field]);
+}
+
+int SnapshotReader::FindField(std::string name) {
+    for(int f = 0; f < header->nFields; ++f) {
+        if(name == header->fieldNames[f])
+            return f;
+    }
+    return -1;
+}
+
+int SnapshotReader::GetStep(int snapshot) {
+    if((snapshot < 0) || (snapshot >= nSnapshots))
+        return -1;
+    return reinterpret_cast<SnapshotRecordHeader*>(data + recordOffsets[snapshot])->step;
+}
+
+double SnapshotReader::GetTime(int snapshot) {
+    if((snapshot < 0) || (snapshot >= nSnapshots))
+        return NAN;
+    return reinterpret_cast<SnapshotRecordHeader*>(data + recordOffsets[snapshot])->time;
+}
+
+int SnapshotReader::FindTime(double time) {
+    int best = -1;
+    double bestDiff = 0.0;
+    for(int k = 0; k < nSnapshots; ++k) {
+        double diff = std::fabs(GetTime(k) - time);
+        if((best == -1) || (diff < bestDiff)) {
+            best = k;
+            bestDiff = diff;
+        }
+    }
+    return best;
+}
+
+bool SnapshotReader::ReadField(int snapshot, int field, int x0, int y0, int nx, int ny, double* out)
+{
+    if((snapshot < 0) || (snapshot >= nSnapshots) || (field < 0) || (field >= header->nFields) || (nx < 0) || (ny < 0))
+        return false;
+
+    SnapshotRecordHeader* record = reinterpret_cast<SnapshotRecordHeader*>(data + recordOffsets[snapshot]);
+    SnapshotBlockEntry* table = reinterpret_cast<SnapshotBlockEntry*>(data + recordOffsets[snapshot] + sizeof(SnapshotRecordHeader));
+
+    //only copy the rows of blocks that overlap the requested subregion
+    for(int q = 0; q < record->nBlocks; ++q) {
+        SnapshotBlockEntry &block = table[q];
+        int iStart = std::max(x0, block.xStart);
+        int iEnd = std::min(x0 + nx, block.xStart + block.nx);
+        int jStart = std::max(y0, block.yStart);
+        int jEnd = std::min(y0 + ny, block.yStart + block.ny);
+        if((iStart >= iEnd) || (jStart >= jEnd))
+            continue;
+
+        const double* blockData = reinterpret_cast<const double*>(data + block.offset) + (long long) field * block.nx * block.ny;
+        for(int j = jStart; j < jEnd; ++j) {
+            std::memcpy(out + (j - y0)*nx + (iStart - x0),
+                        blockData + (j - block.yStart)*block.nx + (iStart - block.xStart),
+                        (iEnd - iStart)*sizeof(double));
+        }
+    }
+    return true;
+}
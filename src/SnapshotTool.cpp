@@ -0,0 +1,136 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+using namespace std;
+
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+#include <mpi.h>
+#include "Snapshot.h"
+
+/**
+ * @brief Command line tool to inspect, extract from and convert to snapshot files written by SnapshotWriter
+ *
+ * Usage:
+ *  - snapshot info FILE                                        list the fields and snapshots in FILE
+ *  - snapshot extract FILE --field v [--time t | --step n]     print x y value of a field for one snapshot and subregion
+ *  - snapshot convert TEXT FILE [--time t] [--step n]          convert a text file written by WriteSolution to a snapshot file
+ *********************************************************************************************************************/
+int main(int argc, char* argv[])
+{
+    MPI_Init(&argc, &argv);                                                     //needed by SnapshotWriter for conversion
+
+    po::options_description opts("Inspect, extract from and convert to lid driven cavity snapshot files");
+    opts.add_options()
+        ("command", po::value<string>(), "One of info, extract or convert.")
+        ("input",   po::value<string>(), "Snapshot file, or text file for convert.")
+        ("output",  po::value<string>(), "Snapshot file to create for convert.")
+        ("field",   po::value<string>()->default_value("v"), "Field to extract.")
+        ("time",    po::value<double>(), "Time of snapshot to extract (closest is used), or time to record for convert.")
+        ("step",    po::value<int>(), "Time step of snapshot to extract, or time step to record for convert.")
+        ("x0",      po::value<int>()->default_value(0), "Start of subregion in x direction.")
+        ("y0",      po::value<int>()->default_value(0), "Start of subregion in y direction.")
+        ("nx",      po::value<int>()->default_value(-1), "Grid points of subregion in x direction, -1 for all.")
+        ("ny",      po::value<int>()->default_value(-1), "Grid points of subregion in y direction, -1 for all.")
+        ("help",    "Print help message.");
+
+    po::positional_options_description positional;
+    positional.add("command", 1).add("input", 1).add("output", 1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(opts).positional(positional).run(), vm);
+    po::notify(vm);
+
+    if(vm.count("help") || !vm.count("command") || !vm.count("input")) {
+        cout << opts << endl;
+        MPI_Finalize();
+        return 0;
+    }
+
+    string command = vm["command"].as<string>();
+    string input = vm["input"].as<string>();
+    int retval = 0;
+
+    if(command == "convert") {
+        int step = vm.count("step") ? vm["step"].as<int>() : 0;
+        double time = vm.count("time") ? vm["time"].as<double>() : 0.0;
+
+        if(!vm.count("output") || !SnapshotWriter::ConvertText(input, vm["output"].as<string>(), step, time)) {
+            cout << "Failed to convert " << input << endl;
+            retval = 1;
+        }
+    }
+    else {
+        SnapshotReader reader(input);
+        if(!reader.IsValid()) {
+            cout << "Invalid snapshot file " << input << endl;
+            MPI_Finalize();
+            return 1;
+        }
+
+        if(command == "info") {
+            cout << "Grid size: " << reader.GetGlobalNx() << " x " << reader.GetGlobalNy() << endl;
+            cout << "Length:    " << reader.GetLx() << " x " << reader.GetLy() << endl;
+            cout << "Fields:   ";
+            for(int f = 0; f < reader.GetNumFields(); ++f)
+                cout << " " << reader.GetFieldName(f);
+            cout << endl;
+            for(int k = 0; k < reader.GetNumSnapshots(); ++k)
+                cout << "Snapshot " << setw(6) << k << "  Step: " << setw(8) << reader.GetStep(k)
+                     << "  Time: " << setw(8) << reader.GetTime(k) << endl;
+        }
+        else if(command == "extract") {
+            int field = reader.FindField(vm["field"].as<string>());
+
+            //select by step if given, otherwise closest time, otherwise the latest snapshot
+            int snapshot = reader.GetNumSnapshots() - 1;
+            if(vm.count("step")) {
+                snapshot = -1;
+                for(int k = 0; k < reader.GetNumSnapshots(); ++k)
+                    if(reader.GetStep(k) == vm["step"].as<int>())
+                        snapshot = k;
+            }
+            else if(vm.count("time")) {
+                snapshot = reader.FindTime(vm["time"].as<double>());
+            }
+
+            if((field < 0) || (snapshot < 0)) {
+                cout << "Field or snapshot not found" << endl;
+                MPI_Finalize();
+                return 1;
+            }
+
+            int x0 = vm["x0"].as<int>();
+            int y0 = vm["y0"].as<int>();
+            int nx = (vm["nx"].as<int>() < 0) ? reader.GetGlobalNx() - x0 : vm["nx"].as<int>();
+            int ny = (vm["ny"].as<int>() < 0) ? reader.GetGlobalNy() - y0 : vm["ny"].as<int>();
+            double dx = reader.GetLx() / (reader.GetGlobalNx() - 1);
+            double dy = reader.GetLy() / (reader.GetGlobalNy() - 1);
+
+            if((nx < 0) || (ny < 0)) {
+                cout << "Invalid subregion" << endl;
+                MPI_Finalize();
+                return 1;
+            }
+
+            double* out = new double[nx*ny]();
+            reader.ReadField(snapshot, field, x0, y0, nx, ny, out);
+
+            //same column-by-column layout as WriteSolution, so existing plotting scripts can be reused
+            for(int i = 0; i < nx; ++i) {
+                for(int j = 0; j < ny; ++j)
+                    cout << (i + x0) * dx << " " << (j + y0) * dy << " " << out[j*nx + i] << "\n";
+                cout << "\n";
+            }
+            delete[] out;
+        }
+        else {
+            cout << "Unknown command " << command << endl;
+            retval = 1;
+        }
+    }
+
+    MPI_Finalize();
+    return retval;
+}
@@ -9,6 +9,7 @@ using namespace std;
 #include <omp.h>
 
 #include "SolverCG.h"
+#include "VectorOps.h"
 
 /**
  * @brief Macro to map coordinates \f$ (i,j) \f$ onto its corresponding location in memory, assuming row-wise matrix storage
@@ -24,6 +25,11 @@ using namespace std;
 *******************************************************************************************************************************/
 
 SolverCG::SolverCG(int pNx, int pNy, double pdx, double pdy,MPI_Comm &rowGrid, MPI_Comm &colGrid)
+    : SolverCG(pNx, pNy, pdx, pdy, rowGrid, colGrid, MPI_COMM_WORLD)
+{
+}
+
+SolverCG::SolverCG(int pNx, int pNy, double pdx, double pdy,MPI_Comm &rowGrid, MPI_Comm &colGrid, MPI_Comm grid)
 {
     //All member variables are local unless otherwise stated
     dx = pdx;
@@ -32,9 +38,13 @@ SolverCG::SolverCG(int pNx, int pNy, double pdx, double pdy,MPI_Comm &rowGrid, M
     Ny = pNy;
     int n = Nx*Ny;                                  //total number of local grid points
     r = new double[n];                              //conjugate gradient algorithm variables
-    p = new double[n];
+    p = new double[n];                              //zero initialised, as ApplyOperator never writes the global boundary of t
     z = new double[n];
     t = new double[n];
+    VectorOps::Zero(n, r);                          //first touched by the threads that use them, see VectorOps
+    VectorOps::Zero(n, p);
+    VectorOps::Zero(n, z);
+    VectorOps::Zero(n, t);
     
     topData = new double[Nx];
     bottomData = new double[Nx];
@@ -47,6 +57,7 @@ SolverCG::SolverCG(int pNx, int pNy, double pdx, double pdy,MPI_Comm &rowGrid, M
 
     comm_row_grid = rowGrid;
     comm_col_grid = colGrid;
+    comm_grid = grid;
 
     MPI_Comm_size(comm_row_grid,&size);             //get size of communicator -> number of processes along each dimension
     MPI_Comm_rank(comm_row_grid, &rowRank);         //compute current rank along row and column communicators
@@ -97,34 +108,63 @@ int SolverCG::GetNy() {
     return Ny;
 }
 
-void SolverCG::Solve(double* b, double* x) {
+void SolverCG::SetVerbose(bool pVerbose) {
+    verbose = pVerbose;
+}
+
+void SolverCG::SetShift(double sigma) {
+    shift = sigma;
+}
+
+void SolverCG::Reset() {
+    unsigned int n = Nx*Ny;
+    VectorOps::Zero(n, r);
+    VectorOps::Zero(n, p);
+    VectorOps::Zero(n, z);
+    VectorOps::Zero(n, t);
+    iterations = 0;
+    residual = 0.0;
+}
+
+int SolverCG::GetIterations() {
+    return iterations;
+}
+
+double SolverCG::GetResidual() {
+    return residual;
+}
+
+void SolverCG::SetTolerance(double absolute, double relative, double initial) {
+    absoluteTol = absolute;
+    relativeTol = relative;
+    initialTol = initial;
+}
+
+void SolverCG::DoSolve(double* b, double* x) {
     unsigned int n = Nx*Ny;                         //total local grid points
-    int k;                                          //iteration counter
     double alphaNum;                                //local variables for CG algorithm
     double alphaDen;
-    double betaNum;
     double betaDen;
     double eps;
-    double tol = 0.001;
     
     //global variables
     double globalAlpha;
     double globalAlphaTemp;
-    double globalBeta;
-    double globalBetaTemp;
     double globalEps;
 
     //want error squared for summation (as 2-norm isn't linear but 2-normed squared is) to get global/actual error
     //doing ddot instead was slower than doing dnrm2 then squaring
-    eps = cblas_dnrm2(n, b, 1);
+    eps = VectorOps::Nrm2(n, b);
     eps *= eps;    
 
-    MPI_Allreduce(&eps,&globalEps,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+    MPI_Allreduce(&eps,&globalEps,1,MPI_DOUBLE,MPI_SUM,comm_grid);
     globalEps = sqrt(globalEps);
 
-    if (globalEps < tol*tol) {                      //if 2-norm of b is lower than tolerance squared, then b practically zero
+    if (globalEps < absoluteTol) {                  //if 2-norm of b is lower than absolute tolerance, then b practically zero
         std::fill(x, x+n, 0.0);                     //hence don't waste time with algorithm, solution x is 0
-        if((rowRank == 0) & (colRank == 0))         //print on root rank only
+        iterations = 0;
+        residual = globalEps;
+        if(verbose && (rowRank == 0) & (colRank == 0))          //print on root rank only
             cout << "Norm is " << globalEps << endl;
         return;
     }
@@ -132,64 +172,134 @@ void SolverCG::Solve(double* b, double* x) {
     // --------------------------- PRECONDITIONED CONJUGATE GRADIENT ALGORITHM ---------------------------------------------------//
     //Refer to standard notation provided in the literature for this algorithm
     ApplyOperator(x, t);                            //apply discretised operator -nabla^2 to x, so t = -nabla^2 x, or t = Ax 
-    cblas_dcopy(n, b, 1, r, 1);                     //r_0 = b
+    VectorOps::Copy(n, b, r);                       //r_0 = b
     ImposeBC(r);                                    //apply zeros to edges of global, not local, domain
 
-    cblas_daxpy(n, -1.0, t, 1, r, 1);               //r=r-t (i.e. r = b - Ax), first step of conjugate gradient algorithm
+    VectorOps::Axpy(n, -1.0, t, r);                 //r=r-t (i.e. r = b - Ax), first step of conjugate gradient algorithm
     Precondition(r, z);                             //Apply preconditioner to improve convergence, preconditioned matrix in z
-    cblas_dcopy(n, z, 1, p, 1);                     //p_0 = z_0 (where z_0 is the preconditioned version of r_0)
+    VectorOps::Copy(n, z, p);                       //p_0 = z_0 (where z_0 is the preconditioned version of r_0)
 
-    k = 0;
-    
-    do {
-        k++;
+    ApplyOperator(p, t);                            //compute -nabla^2 p and store in t (effectively A*p_0)
 
-        ApplyOperator(p, t);                        //compute -nabla^2 p and store in t (effectively A*p_k)
+    //division cannot be performed locally then summed, numerator and denominator must be summed separately to get global numerator and denominator
+    //(that describes the ACTUAL alpha of the problem) then divided for global alpha (and beta) 
+    alphaDen = VectorOps::Dot(n, t, p);             // denominator of alpha = p_k^T*A*p_k (^T is transpose)
+    alphaNum = VectorOps::Dot(n, r, z);             // numerator of alpha = r^k^T*r_k
+    betaDen  = alphaNum;                            // denominator of beta = z_k^T*r_k (for later in the algorithm)
 
-        //division cannot be performed locally then summed, numerator and denominator must be summed separately to get global numerator and denominator
-        //(that describes the ACTUAL alpha of the problem) then divided for global alpha (and beta) 
+    MPI_Allreduce(&alphaDen,&globalAlphaTemp,1,MPI_DOUBLE,MPI_SUM,comm_grid);
+    MPI_Allreduce(&alphaNum,&globalAlpha, 1, MPI_DOUBLE, MPI_SUM,comm_grid);
 
-        alphaDen = cblas_ddot(n, t, 1, p, 1);                                               // denominator of alpha = p_k^T*A*p_k (^T is transpose)
-        alphaNum = cblas_ddot(n, r, 1, z, 1);                                               // numerator of alpha = r^k^T*r_k              
-        betaDen  = cblas_ddot(n, r, 1, z, 1);                                               // denominator of beta = z_k^T*r_k (for later in the algorithm)
-        
-        //compute alpha_k (global not local)
-        MPI_Allreduce(&alphaDen,&globalAlphaTemp,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
-        MPI_Allreduce(&alphaNum,&globalAlpha, 1, MPI_DOUBLE, MPI_SUM,MPI_COMM_WORLD);
+    //norm of the initial residual costs an extra reduction, so only when bounded by it
+    double initialNorm = 0.0;
+    if(initialTol > 0.0) {
+        eps = VectorOps::Dot(n, r, r);
+        MPI_Allreduce(&eps,&initialNorm,1,MPI_DOUBLE,MPI_SUM,comm_grid);
+        initialNorm = sqrt(initialNorm);
+    }
+    stopTol = std::max(absoluteTol, std::max(relativeTol*globalEps, initialTol*initialNorm));
 
-        globalAlpha = globalAlpha/globalAlphaTemp;
+    Iterate(x, globalAlpha/globalAlphaTemp, betaDen);
+}
+
+double* SolverCG::GetInitialResidual() {
+    return r;
+}
+
+void SolverCG::DoSolveFromResidual(double* x, double bNormSquared) {
+    unsigned int n = Nx*Ny;                         //total local grid points
+    double local[4];                                //squared norm of b, alpha denominator and numerator, squared norm of r_0
+    double global[4];
+
+    //r_0 = b - Ax is already in r, so the first iteration starts from preconditioning it
+    Precondition(r, z);
+    VectorOps::Copy(n, z, p);
+    ApplyOperator(p, t);
+
+    //norm of b is only needed for the early exit, so it travels with the first reductions of alpha
+    local[0] = bNormSquared;
+    local[1] = VectorOps::Dot(n, t, p);
+    local[2] = VectorOps::Dot(n, r, z);
+    local[3] = (initialTol > 0.0) ? VectorOps::Dot(n, r, r) : 0.0;
+    MPI_Allreduce(local, global, (initialTol > 0.0) ? 4 : 3, MPI_DOUBLE, MPI_SUM, comm_grid);
+    global[0] = sqrt(global[0]);
+
+    if (global[0] < absoluteTol) {                  //b practically zero, as in Solve
+        std::fill(x, x+n, 0.0);
+        iterations = 0;
+        residual = global[0];
+        if(verbose && (rowRank == 0) & (colRank == 0))
+            cout << "Norm is " << global[0] << endl;
+        return;
+    }
+
+    stopTol = std::max(absoluteTol, relativeTol*global[0]);
+    if(initialTol > 0.0)
+        stopTol = std::max(stopTol, initialTol*sqrt(global[3]));
+
+    Iterate(x, global[2]/global[1], local[2]);
+}
+
+void SolverCG::Iterate(double* x, double globalAlpha, double betaDen) {
+    unsigned int n = Nx*Ny;                         //total local grid points
+    int k = 0;                                      //iteration counter
+    double alphaNum;                                //local variables for CG algorithm
+    double alphaDen;
+    double betaNum;
+    double eps;
+
+    //global variables
+    double globalAlphaTemp;
+    double globalBeta;
+    double globalBetaTemp;
+    double globalEps;
+
+    do {
+        k++;
 
         //update x_{k+1} and r_{k+1}
-        cblas_daxpy(n,  globalAlpha, p, 1, x, 1);
-        cblas_daxpy(n, -globalAlpha, t, 1, r, 1);
+        VectorOps::Axpy(n,  globalAlpha, p, x);
+        VectorOps::Axpy(n, -globalAlpha, t, r);
     
         //check convergence
-        eps = cblas_dnrm2(n, r, 1);
+        eps = VectorOps::Nrm2(n, r);
         eps *= eps;
 
-        MPI_Allreduce(&eps,&globalEps,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+        MPI_Allreduce(&eps,&globalEps,1,MPI_DOUBLE,MPI_SUM,comm_grid);
         globalEps = sqrt(globalEps);
 
-        if (globalEps < tol*tol) {
+        if (globalEps < stopTol) {
             break;
         }
         
         Precondition(r, z);                                                                 //precondition r_{k+1} and store in z_{k+1}
 
-        betaNum = cblas_ddot(n, r, 1, z, 1);                                                //numerator of beta = (r_{k+1}^T*r_{k+1})
-                
-        cblas_dcopy(n, z, 1, t, 1);                                                         //copy z_{k+1} into t, so t now holds preconditioned r_{k+1}
+        betaNum = VectorOps::Dot(n, r, z);                                                  //numerator of beta = (r_{k+1}^T*r_{k+1})
         
         //compute beta_k
-        MPI_Allreduce(&betaDen,&globalBetaTemp,1,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
-        MPI_Allreduce(&betaNum,&globalBeta,1, MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+        MPI_Allreduce(&betaDen,&globalBetaTemp,1,MPI_DOUBLE,MPI_SUM,comm_grid);
+        MPI_Allreduce(&betaNum,&globalBeta,1, MPI_DOUBLE,MPI_SUM,comm_grid);
         
         globalBeta = globalBeta / globalBetaTemp;       
 
         //update value p_{k+1} for next iteration
-        cblas_daxpy(n, globalBeta, p, 1, t, 1);                                             //t = t + beta_k*p_k i.e. p_{k+1} = z_{k+1} + beta_k*p_k
-        cblas_dcopy(n, t, 1, p, 1);                                                         //copy z_{k+1} from t into p, so p_{k+1} = z{k+1}, for next iteration
-    } while (k < 5000);
+        VectorOps::Xpay(n, z, globalBeta, p);                                               //p_{k+1} = z_{k+1} + beta_k*p_k, in place
+
+        if (k == 5000)
+            break;
+
+        ApplyOperator(p, t);                                                                //compute -nabla^2 p and store in t (effectively A*p_k)
+
+        alphaDen = VectorOps::Dot(n, t, p);                                                 // denominator of alpha = p_k^T*A*p_k (^T is transpose)
+        alphaNum = betaNum;                                                                 // numerator of alpha = r^k^T*r_k, r and z unchanged since beta
+        betaDen  = betaNum;                                                                 // denominator of beta = z_k^T*r_k (for later in the algorithm)
+        
+        //compute alpha_k (global not local)
+        MPI_Allreduce(&alphaDen,&globalAlphaTemp,1,MPI_DOUBLE,MPI_SUM,comm_grid);
+        MPI_Allreduce(&alphaNum,&globalAlpha, 1, MPI_DOUBLE, MPI_SUM,comm_grid);
+
+        globalAlpha = globalAlpha/globalAlphaTemp;
+    } while (true);
 
     if (k == 5000) {
         if((rowRank == 0) & (colRank == 0))
@@ -199,7 +309,10 @@ void SolverCG::Solve(double* b, double* x) {
         exit(-1);
     }
 
-    if((rowRank == 0) & (colRank == 0))
+    iterations = k;
+    residual = globalEps;
+
+    if(verbose && (rowRank == 0) & (colRank == 0))
         cout << "Converged in " << k << " iterations. eps = " << globalEps << endl;
 }
 
@@ -220,11 +333,11 @@ void SolverCG::ApplyOperator(double* in, double* out) {
     MPI_Isend(tempLeft,Ny,MPI_DOUBLE,leftRank,2,comm_row_grid,&requests[2]);                //send data on LHS of current process to the left -> tag 2
     MPI_Isend(tempRight,Ny,MPI_DOUBLE, rightRank,3,comm_row_grid,&requests[3]);             //send data on RHS of current process to right -> tag 3
     
-    //dynamic scheduling for load balancing; more effective than static after testing
+    //static scheduling, so each thread works on the rows it first touched and that VectorOps gives it, see VectorOps
     //computing interior points from five point stencil on all local domains
     double dx2i = 1.0/dx/dx;
     double dy2i = 1.0/dy/dy;
-    #pragma omp parallel for schedule(dynamic) private(i,j)
+    #pragma omp parallel for schedule(static) private(i,j)
         for (j = 1; j < Ny - 1; ++j) {
             for (i = 1; i < Nx - 1; ++i) {
                 out[IDX(i,j)] = ( -     in[IDX(i-1, j)]
@@ -309,6 +422,20 @@ void SolverCG::ApplyOperator(double* in, double* out) {
         }
     }
 
+    //shifted operator, left unwritten on the global boundary as the stencil
+    if(shift != 0.0) {
+        int iStart = (leftRank == MPI_PROC_NULL) ? 1 : 0;
+        int iEnd = (rightRank == MPI_PROC_NULL) ? Nx - 1 : Nx;
+        int jStart = (bottomRank == MPI_PROC_NULL) ? 1 : 0;
+        int jEnd = (topRank == MPI_PROC_NULL) ? Ny - 1 : Ny;
+        #pragma omp parallel for schedule(static) private(i,j)
+            for (j = jStart; j < jEnd; ++j) {
+                for (i = iStart; i < iEnd; ++i) {
+                    out[IDX(i,j)] += shift*in[IDX(i,j)];
+                }
+            }
+    }
+
     //complete MPI communications
     MPI_Waitall(4,requests,MPI_STATUSES_IGNORE);
 }
@@ -318,15 +445,15 @@ void SolverCG::Precondition(double* in, double* out) {
 
     double dx2i = 1.0/dx/dx;
     double dy2i = 1.0/dy/dy;
-    double factor = 1/(2.0*(dx2i + dy2i));                      //precondition factor
+    double factor = 1/(2.0*(dx2i + dy2i) + shift);              //precondition factor, the diagonal of the operator
     
     //here edge calculations also parallelised as parallel region already created for the nested O(n^2) loop
     //hence no overhead costs, so marginal gains can be made
     #pragma omp parallel private(i,j)
     {   
         //----------------------------------------------Step 1: Precondition Interior Points First--------------------------------------------//
-        //dynamic for load balancing
-        #pragma omp for schedule(dynamic) nowait
+        //static to keep each thread on its own rows, as ApplyOperator
+        #pragma omp for schedule(static) nowait
             for (j = 1; j < Ny - 1; ++j) {                  
                 for (i = 1; i < Nx - 1; ++i) {
                     out[IDX(i,j)] = in[IDX(i,j)]*factor;
@@ -0,0 +1,442 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+using namespace std;
+
+#include <mpi.h>
+#include <omp.h>
+
+#include "SolverCGTiled.h"
+
+/**
+ * @brief Macro to map coordinates \f$ (i,j) \f$ onto its corresponding location in memory, assuming row-wise matrix storage
+ * @param I     coordinate \f$ i \f$ denoting horizontal position of grid from left to right
+ * @param J     coordinate \f$ j \f$ denoting vertical position of grid from bottom to top
+ */
+#define IDX(I,J) ((J)*Nx + (I))
+
+SolverCGTiled::SolverCGTiled(const PoissonProblem& problem)
+{
+    Nx = problem.Nx;
+    Ny = problem.Ny;
+    dx2i = 1.0/problem.dx/problem.dx;
+    dy2i = 1.0/problem.dy/problem.dy;
+    int n = Nx*Ny;
+    r = new double[n];
+    p = new double[n];
+    z = new double[n];
+    t = new double[n];
+    topData = new double[Nx];
+    bottomData = new double[Nx];
+    leftData = new double[Ny];
+    rightData = new double[Ny];
+    tempLeft = new double[Ny];
+    tempRight = new double[Ny];
+
+    comm_grid = problem.cartGrid;
+    MPI_Comm_rank(comm_grid, &rank);
+    MPI_Comm_dup(problem.rowGrid, &comm_row_grid);
+    MPI_Comm_dup(problem.colGrid, &comm_col_grid);
+    MPI_Cart_shift(comm_col_grid, 0, 1, &bottomRank, &topRank);
+    MPI_Cart_shift(comm_row_grid, 0, 1, &leftRank, &rightRank);
+
+    //tiles of the shortest perimeter for the global domain, so the same on all processes and neighbours split shared edges alike
+    threads = omp_get_max_threads();
+    double bestPerimeter = 0.0;
+    for(int tx = 1; tx <= threads; ++tx) {
+        if(threads % tx != 0)
+            continue;
+        double perimeter = (double) problem.globalNx/tx + (double) problem.globalNy/(threads/tx);
+        if((tx == 1) || (perimeter < bestPerimeter)) {
+            bestPerimeter = perimeter;
+            tilesX = tx;
+        }
+    }
+    tilesY = threads/tilesX;
+    partial = new double[threads*Stride];
+    progress = new std::atomic<long>[threads*Stride];
+    arrived = new std::atomic<long>[threads*Stride];
+
+    //every thread makes its own halo exchanges, and tiles only line up if all processes run as many threads
+    int provided;
+    MPI_Query_thread(&provided);
+    int local[3] = {(provided == MPI_THREAD_MULTIPLE) && (Nx >= tilesX) && (Ny >= tilesY), threads, -threads};
+    MPI_Allreduce(MPI_IN_PLACE, local, 3, MPI_INT, MPI_MIN, comm_grid);
+    usable = local[0] && (local[1] == -local[2]);
+    if(!usable)
+        return;
+
+    for(int row = 0; row < tilesY; ++row) {
+        for(int column = 0; column < tilesX; ++column) {
+            Tile tile;
+            tile.i0 = column*Nx/tilesX;
+            tile.i1 = (column + 1)*Nx/tilesX;
+            tile.j0 = row*Ny/tilesY;
+            tile.j1 = (row + 1)*Ny/tilesY;
+            tile.column = column;
+            tile.row = row;
+            int thread = row*tilesX + column;
+            tile.neighbourCount = 0;
+            if(column > 0)
+                tile.neighbours[tile.neighbourCount++] = thread - 1;
+            if(column < tilesX - 1)
+                tile.neighbours[tile.neighbourCount++] = thread + 1;
+            if(row > 0)
+                tile.neighbours[tile.neighbourCount++] = thread - tilesX;
+            if(row < tilesY - 1)
+                tile.neighbours[tile.neighbourCount++] = thread + tilesX;
+            tiles.push_back(tile);
+        }
+    }
+    Reset();
+}
+
+SolverCGTiled::~SolverCGTiled()
+{
+    delete[] r;
+    delete[] p;
+    delete[] z;
+    delete[] t;
+
+    delete[] topData;
+    delete[] bottomData;
+    delete[] leftData;
+    delete[] rightData;
+    delete[] tempLeft;
+    delete[] tempRight;
+    delete[] partial;
+    delete[] progress;
+    delete[] arrived;
+
+    MPI_Comm_free(&comm_row_grid);
+    MPI_Comm_free(&comm_col_grid);
+}
+
+bool SolverCGTiled::IsUsable() {
+    return usable;
+}
+
+int SolverCGTiled::GetThreads() {
+    return threads;
+}
+
+int SolverCGTiled::GetTilesX() {
+    return tilesX;
+}
+
+int SolverCGTiled::GetTilesY() {
+    return tilesY;
+}
+
+int SolverCGTiled::GetIterations() {
+    return iterations;
+}
+
+double SolverCGTiled::GetResidual() {
+    return residual;
+}
+
+void SolverCGTiled::SetVerbose(bool pVerbose) {
+    verbose = pVerbose;
+}
+
+void SolverCGTiled::SetTolerance(double absolute, double relative, double initial) {
+    absoluteTol = absolute;
+    relativeTol = relative;
+    initialTol = initial;
+}
+
+void SolverCGTiled::Reset() {
+    if(!usable)
+        return;
+
+    //zeroed by the thread of each tile, so its pages are first touched where they are used
+    #pragma omp parallel num_threads(threads)
+    {
+        const Tile& tile = tiles[omp_get_thread_num()];
+        for(int j = tile.j0; j < tile.j1; ++j) {
+            for(int i = tile.i0; i < tile.i1; ++i) {
+                r[IDX(i,j)] = 0.0;
+                p[IDX(i,j)] = 0.0;
+                z[IDX(i,j)] = 0.0;
+                t[IDX(i,j)] = 0.0;
+            }
+        }
+    }
+    iterations = 0;
+    residual = 0.0;
+}
+
+void SolverCGTiled::DoSolve(double* b, double* x) {
+    double factor = 1.0/(2.0*(dx2i + dy2i));        //precondition factor, the diagonal of the operator
+    double bNorm = 0.0;
+
+    //counters start from zero every solve, after the join of the previous parallel region
+    for(int k = 0; k < threads; ++k) {
+        progress[k*Stride].store(0, std::memory_order_relaxed);
+        arrived[k*Stride].store(0, std::memory_order_relaxed);
+    }
+    reduced.store(0, std::memory_order_relaxed);
+
+    #pragma omp parallel num_threads(threads)
+    {
+        int thread = omp_get_thread_num();
+        const Tile& tile = tiles[thread];
+        double local[3];
+        double global[3];
+        long step = 0;                              //updates of p by this thread, see WaitForNeighbours
+        long reduction = 0;                         //reductions by this thread, see Reduce
+        int i, j;
+
+        local[0] = 0.0;
+        for(j = tile.j0; j < tile.j1; ++j) {
+            for(i = tile.i0; i < tile.i1; ++i) {
+                local[0] += b[IDX(i,j)]*b[IDX(i,j)];
+            }
+        }
+        Reduce(thread, local, 1, global, reduction);
+
+        //if 2-norm of b is lower than absolute tolerance, then b practically zero and the solution x is 0, as in SolverCG
+        if(sqrt(global[0]) < absoluteTol) {
+            for(j = tile.j0; j < tile.j1; ++j) {
+                for(i = tile.i0; i < tile.i1; ++i) {
+                    x[IDX(i,j)] = 0.0;
+                }
+            }
+            #pragma omp master
+            {
+                bNorm = sqrt(global[0]);
+                iterations = 0;
+                residual = bNorm;
+            }
+        }
+        else {
+            double rz;                              //numerator of alpha and denominator of beta, r_k^T*z_k
+            double alpha;
+            double beta;
+            double eps;
+            int k = 0;
+
+            //r_0 = b - Ax, zero on the global boundary, and t is never written there; z stays zero there too after preconditioning
+            ApplyOperator(tile, x, t);
+            for(j = tile.j0; j < tile.j1; ++j) {
+                for(i = tile.i0; i < tile.i1; ++i) {
+                    r[IDX(i,j)] = IsGlobalBoundary(i, j) ? 0.0 : b[IDX(i,j)] - t[IDX(i,j)];
+                    z[IDX(i,j)] = r[IDX(i,j)]*factor;
+                    p[IDX(i,j)] = z[IDX(i,j)];
+                }
+            }
+
+            WaitForNeighbours(thread, step);
+            ApplyOperator(tile, p, t);
+            local[0] = 0.0;
+            local[1] = 0.0;
+            local[2] = 0.0;
+            for(j = tile.j0; j < tile.j1; ++j) {
+                for(i = tile.i0; i < tile.i1; ++i) {
+                    local[0] += t[IDX(i,j)]*p[IDX(i,j)];
+                    local[1] += r[IDX(i,j)]*z[IDX(i,j)];
+                    local[2] += r[IDX(i,j)]*r[IDX(i,j)];
+                }
+            }
+            //norm of the initial residual rides along with alpha, only summed when bounded by it
+            double bNormLocal = sqrt(global[0]);
+            Reduce(thread, local, (initialTol > 0.0) ? 3 : 2, global, reduction);
+            double tol = std::max(absoluteTol, relativeTol*bNormLocal);
+            if(initialTol > 0.0)
+                tol = std::max(tol, initialTol*sqrt(global[2]));
+            rz = global[1];
+            alpha = rz/global[0];
+
+            do {
+                k++;
+
+                //update x_{k+1} and r_{k+1} and precondition in one sweep of the tile, with both dot products of the iteration
+                local[0] = 0.0;
+                local[1] = 0.0;
+                for(j = tile.j0; j < tile.j1; ++j) {
+                    for(i = tile.i0; i < tile.i1; ++i) {
+                        x[IDX(i,j)] += alpha*p[IDX(i,j)];
+                        r[IDX(i,j)] -= alpha*t[IDX(i,j)];
+                        z[IDX(i,j)] = r[IDX(i,j)]*factor;
+                        local[0] += r[IDX(i,j)]*r[IDX(i,j)];
+                        local[1] += r[IDX(i,j)]*z[IDX(i,j)];
+                    }
+                }
+                Reduce(thread, local, 2, global, reduction);
+                eps = sqrt(global[0]);
+                if(eps < tol)
+                    break;
+
+                beta = global[1]/rz;
+                rz = global[1];
+                for(j = tile.j0; j < tile.j1; ++j) {
+                    for(i = tile.i0; i < tile.i1; ++i) {
+                        p[IDX(i,j)] = z[IDX(i,j)] + beta*p[IDX(i,j)];
+                    }
+                }
+
+                if(k == 5000)
+                    break;
+
+                //neighbouring tiles of p must be complete before the stencil reads them, the others may still be updating
+                WaitForNeighbours(thread, step);
+                ApplyOperator(tile, p, t);
+                local[0] = 0.0;
+                for(j = tile.j0; j < tile.j1; ++j) {
+                    for(i = tile.i0; i < tile.i1; ++i) {
+                        local[0] += t[IDX(i,j)]*p[IDX(i,j)];
+                    }
+                }
+                Reduce(thread, local, 1, global, reduction);
+                alpha = rz/global[0];
+            } while(true);
+
+            #pragma omp master
+            {
+                bNorm = bNormLocal;
+                iterations = k;
+                residual = eps;
+            }
+        }
+    }
+
+    if(iterations == 0) {
+        if(verbose && (rank == 0))
+            cout << "Norm is " << bNorm << endl;
+        return;
+    }
+
+    if(iterations == 5000) {
+        if(rank == 0)
+            cout << "FAILED TO CONVERGE" << endl;
+
+        MPI_Finalize();
+        exit(-1);
+    }
+
+    if(verbose && (rank == 0))
+        cout << "Converged in " << iterations << " iterations. eps = " << residual << endl;
+}
+
+void SolverCGTiled::ApplyOperator(const Tile& tile, const double* in, double* out) {
+    MPI_Request requests[8];
+    int count = 0;
+    int width = tile.i1 - tile.i0;
+    int height = tile.j1 - tile.j0;
+    int i, j;
+
+    //segments of the local domain edges on this tile, tagged by segment so the threads of a process never match each other's messages
+    if(tile.j0 == 0) {
+        MPI_Irecv(bottomData + tile.i0, width, MPI_DOUBLE, bottomRank, 4*tile.column, comm_col_grid, &requests[count++]);
+        MPI_Isend(in + IDX(tile.i0,0), width, MPI_DOUBLE, bottomRank, 4*tile.column + 1, comm_col_grid, &requests[count++]);
+    }
+    if(tile.j1 == Ny) {
+        MPI_Irecv(topData + tile.i0, width, MPI_DOUBLE, topRank, 4*tile.column + 1, comm_col_grid, &requests[count++]);
+        MPI_Isend(in + IDX(tile.i0,Ny-1), width, MPI_DOUBLE, topRank, 4*tile.column, comm_col_grid, &requests[count++]);
+    }
+    if(tile.i0 == 0) {
+        for(j = tile.j0; j < tile.j1; ++j)
+            tempLeft[j] = in[IDX(0,j)];
+        MPI_Irecv(leftData + tile.j0, height, MPI_DOUBLE, leftRank, 4*tile.row + 3, comm_row_grid, &requests[count++]);
+        MPI_Isend(tempLeft + tile.j0, height, MPI_DOUBLE, leftRank, 4*tile.row + 2, comm_row_grid, &requests[count++]);
+    }
+    if(tile.i1 == Nx) {
+        for(j = tile.j0; j < tile.j1; ++j)
+            tempRight[j] = in[IDX(Nx-1,j)];
+        MPI_Irecv(rightData + tile.j0, height, MPI_DOUBLE, rightRank, 4*tile.row + 2, comm_row_grid, &requests[count++]);
+        MPI_Isend(tempRight + tile.j0, height, MPI_DOUBLE, rightRank, 4*tile.row + 3, comm_row_grid, &requests[count++]);
+    }
+
+    //points of the tile inside the local domain only need the shared input, including the tiles of other threads
+    int iStart = std::max(tile.i0, 1);
+    int iEnd = std::min(tile.i1, Nx - 1);
+    int jStart = std::max(tile.j0, 1);
+    int jEnd = std::min(tile.j1, Ny - 1);
+    for(j = jStart; j < jEnd; ++j) {
+        for(i = iStart; i < iEnd; ++i) {
+            out[IDX(i,j)] = ( -     in[IDX(i-1, j)]
+                            + 2.0*in[IDX(i,   j)]
+                            -     in[IDX(i+1, j)])*dx2i
+                        + ( -     in[IDX(i, j-1)]
+                            + 2.0*in[IDX(i,   j)]
+                            -     in[IDX(i, j+1)])*dy2i;
+        }
+    }
+
+    MPI_Waitall(count, requests, MPI_STATUSES_IGNORE);
+
+    //points on the local domain edges, with neighbours from the received segments; corners are visited twice with the same result
+    auto edge = [&](int ie, int je) {
+        if(IsGlobalBoundary(ie, je))
+            return;
+        double left   = (ie > 0)      ? in[IDX(ie-1,je)] : leftData[je];
+        double right  = (ie < Nx - 1) ? in[IDX(ie+1,je)] : rightData[je];
+        double bottom = (je > 0)      ? in[IDX(ie,je-1)] : bottomData[ie];
+        double top    = (je < Ny - 1) ? in[IDX(ie,je+1)] : topData[ie];
+        out[IDX(ie,je)] = (- left + 2.0*in[IDX(ie,je)] - right)*dx2i + (- bottom + 2.0*in[IDX(ie,je)] - top)*dy2i;
+    };
+    if(tile.j0 == 0)
+        for(i = tile.i0; i < tile.i1; ++i)
+            edge(i, 0);
+    if(tile.j1 == Ny)
+        for(i = tile.i0; i < tile.i1; ++i)
+            edge(i, Ny-1);
+    if(tile.i0 == 0)
+        for(j = tile.j0; j < tile.j1; ++j)
+            edge(0, j);
+    if(tile.i1 == Nx)
+        for(j = tile.j0; j < tile.j1; ++j)
+            edge(Nx-1, j);
+}
+
+void SolverCGTiled::WaitForNeighbours(int thread, long& step) {
+    //a neighbour cannot update p again before this thread has contributed to the next reduction, so p is stable while read
+    progress[thread*Stride].store(++step, std::memory_order_release);
+    const Tile& tile = tiles[thread];
+    for(int k = 0; k < tile.neighbourCount; ++k)
+        WaitFor(progress[tile.neighbours[k]*Stride], step);
+}
+
+void SolverCGTiled::Reduce(int thread, const double* local, int count, double* global, long& reduction) {
+    //the master thread has read the partial sums of the previous reduction before any thread could leave it
+    for(int c = 0; c < count; ++c)
+        partial[thread*Stride + c] = local[c];
+    arrived[thread*Stride].store(++reduction, std::memory_order_release);
+
+    //summed in thread order, so the result does not depend on which thread arrives first
+    if(thread == 0) {
+        for(int k = 0; k < threads; ++k)
+            WaitFor(arrived[k*Stride], reduction);
+        for(int c = 0; c < count; ++c) {
+            shared[c] = 0.0;
+            for(int k = 0; k < threads; ++k)
+                shared[c] += partial[k*Stride + c];
+        }
+        MPI_Allreduce(MPI_IN_PLACE, shared, count, MPI_DOUBLE, MPI_SUM, comm_grid);
+        reduced.store(reduction, std::memory_order_release);
+    }
+    else
+        WaitFor(reduced, reduction);
+
+    //the next result is only written once every thread has arrived at the next reduction, after reading this one
+    for(int c = 0; c < count; ++c)
+        global[c] = shared[c];
+}
+
+void SolverCGTiled::WaitFor(const std::atomic<long>& counter, long target) {
+    //spinning is cheapest while the other thread runs, yielding lets it run when threads outnumber cores
+    int spin = 0;
+    while(counter.load(std::memory_order_acquire) < target) {
+        if(spin < SpinCount)
+            ++spin;
+        else
+            std::this_thread::yield();
+    }
+}
+
+bool SolverCGTiled::IsGlobalBoundary(int i, int j) {
+    return ((i == 0) && (leftRank == MPI_PROC_NULL)) || ((i == Nx - 1) && (rightRank == MPI_PROC_NULL))
+        || ((j == 0) && (bottomRank == MPI_PROC_NULL)) || ((j == Ny - 1) && (topRank == MPI_PROC_NULL));
+}
@@ -0,0 +1,332 @@
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+using namespace std;
+
+#include <cblas.h>
+#include <mpi.h>
+
+#include "SolverSchur.h"
+
+SolverSchur::SolverSchur(const PoissonProblem& problem)
+{
+    Nx = problem.Nx;
+    Ny = problem.Ny;
+    comm_grid = problem.cartGrid;
+    MPI_Comm_rank(comm_grid, &rank);
+    int size;
+    MPI_Comm_size(comm_grid, &size);
+    int gNx = problem.globalNx;
+    int gNy = problem.globalNy;
+    double dx2i = 1.0/problem.dx/problem.dx;
+    double dy2i = 1.0/problem.dy/problem.dy;
+
+    //with fewer points a neighbour on the global boundary may belong to another process
+    int usable = (Nx >= 3) && (Ny >= 3);
+    MPI_Allreduce(MPI_IN_PLACE, &usable, 1, MPI_INT, MPI_MIN, comm_grid);
+    iStart = (problem.xStart == 0) ? 1 : 0;
+    jStart = (problem.yStart == 0) ? 1 : 0;
+    interiorWidth = Nx - 1 - iStart;
+    interiorSize = interiorWidth * (Ny - 1 - jStart);
+    if(!usable)
+        return;
+
+    //separators are the last column and row of every local domain that does not end at the global boundary
+    int domain[4] = {problem.xStart, Nx, problem.yStart, Ny};
+    int* domains = new int[4*size];
+    MPI_Allgather(domain, 4, MPI_INT, domains, 4, MPI_INT, comm_grid);
+    std::vector<bool> separatorColumn(gNx, false);
+    std::vector<bool> separatorRow(gNy, false);
+    for(int r = 0; r < size; ++r) {
+        int xEnd = domains[4*r] + domains[4*r+1] - 1;
+        int yEnd = domains[4*r+2] + domains[4*r+3] - 1;
+        if(xEnd < gNx - 1)
+            separatorColumn[xEnd] = true;
+        if(yEnd < gNy - 1)
+            separatorRow[yEnd] = true;
+    }
+    delete[] domains;
+
+    //row-major numbering of the interface, a separator row holds all its interior points and any other row its separator columns
+    std::vector<int> columnPosition(gNx, -1);
+    int separatorColumns = 0;
+    for(int gi = 1; gi < gNx - 1; ++gi) {
+        if(separatorColumn[gi])
+            columnPosition[gi] = separatorColumns++;
+    }
+    std::vector<int> rowOffset(gNy, 0);
+    for(int gj = 1; gj < gNy - 1; ++gj) {
+        rowOffset[gj] = interfaceSize;
+        interfaceSize += separatorRow[gj] ? gNx - 2 : separatorColumns;
+    }
+    auto onBoundary = [&](int gi, int gj) {
+        return (gi == 0) || (gj == 0) || (gi == gNx - 1) || (gj == gNy - 1);
+    };
+    auto onInterface = [&](int gi, int gj) {
+        return !onBoundary(gi, gj) && (separatorColumn[gi] || separatorRow[gj]);
+    };
+    auto interfaceIndex = [&](int gi, int gj) {
+        return rowOffset[gj] + (separatorRow[gj] ? gi - 1 : columnPosition[gi]);
+    };
+
+    //couplings of every local unknown to the global boundary, of the interior block to the interface, and within the interface
+    std::vector<int> owned, ownedGlobal, coupled, coupledGlobal, target, source, pairRow, pairColumn;
+    std::vector<double> coupledValue, targetValue, pairValue;
+    int offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+    double coefficients[4] = {dx2i, dx2i, dy2i, dy2i};
+    for(int j = 0; j < Ny; ++j) {
+        for(int i = 0; i < Nx; ++i) {
+            int gi = problem.xStart + i;
+            int gj = problem.yStart + j;
+            if(onBoundary(gi, gj))
+                continue;
+            bool isInterface = onInterface(gi, gj);
+            if(isInterface) {
+                owned.push_back(j*Nx + i);
+                ownedGlobal.push_back(interfaceIndex(gi, gj));
+            }
+            for(int d = 0; d < 4; ++d) {
+                int ngi = gi + offsets[d][0];
+                int ngj = gj + offsets[d][1];
+                if(onBoundary(ngi, ngj)) {
+                    target.push_back(j*Nx + i);
+                    source.push_back((j + offsets[d][1])*Nx + i + offsets[d][0]);
+                    targetValue.push_back(coefficients[d]);
+                }
+                else if(onInterface(ngi, ngj)) {
+                    if(!isInterface) {
+                        coupled.push_back((j - jStart)*interiorWidth + i - iStart);
+                        coupledGlobal.push_back(interfaceIndex(ngi, ngj));
+                        coupledValue.push_back(-coefficients[d]);
+                    }
+                    else if(interfaceIndex(ngi, ngj) < ownedGlobal.back()) {
+                        pairRow.push_back(ownedGlobal.back());
+                        pairColumn.push_back(interfaceIndex(ngi, ngj));
+                        pairValue.push_back(-coefficients[d]);
+                    }
+                }
+            }
+        }
+    }
+
+    //the interface points next to the interior block are coupled to each other through it, which sets the band of the complement
+    std::vector<int> adjacent(coupledGlobal);
+    std::sort(adjacent.begin(), adjacent.end());
+    adjacent.erase(std::unique(adjacent.begin(), adjacent.end()), adjacent.end());
+    if(!adjacent.empty())
+        interfaceBand = adjacent.back() - adjacent.front();
+    for(unsigned int e = 0; e < pairRow.size(); ++e)
+        interfaceBand = std::max(interfaceBand, pairRow[e] - pairColumn[e]);
+    MPI_Allreduce(MPI_IN_PLACE, &interfaceBand, 1, MPI_INT, MPI_MAX, comm_grid);
+
+    long long interiorFactorSize = (long long) interiorSize * (interiorWidth + 1);
+    long long interfaceFactorSize = (long long) interfaceSize * (interfaceBand + 1);
+    int fits = (interiorFactorSize <= MaxFactorSize) && (interfaceFactorSize <= MaxFactorSize);
+    MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_INT, MPI_MIN, comm_grid);
+    if(!fits)
+        return;
+
+    ownedCount = owned.size();
+    ownedLocal = new int[ownedCount];
+    ownedIndex = new int[ownedCount];
+    std::copy(owned.begin(), owned.end(), ownedLocal);
+    std::copy(ownedGlobal.begin(), ownedGlobal.end(), ownedIndex);
+    couplingCount = coupled.size();
+    couplingInterior = new int[couplingCount];
+    couplingInterface = new int[couplingCount];
+    couplingValue = new double[couplingCount];
+    std::copy(coupled.begin(), coupled.end(), couplingInterior);
+    std::copy(coupledGlobal.begin(), coupledGlobal.end(), couplingInterface);
+    std::copy(coupledValue.begin(), coupledValue.end(), couplingValue);
+    dirichletCount = target.size();
+    dirichletTarget = new int[dirichletCount];
+    dirichletSource = new int[dirichletCount];
+    dirichletValue = new double[dirichletCount];
+    std::copy(target.begin(), target.end(), dirichletTarget);
+    std::copy(source.begin(), source.end(), dirichletSource);
+    std::copy(targetValue.begin(), targetValue.end(), dirichletValue);
+
+    work = new double[Nx*Ny];
+    interiorRhs = new double[interiorSize];
+    interiorSol = new double[interiorSize];
+    interfaceRhs = new double[interfaceSize];
+
+    //interior block in row-major order couples each point to the previous one in its row and the one below, interiorWidth back
+    int stride = interiorWidth + 1;
+    interiorFactor = new double[interiorFactorSize]();
+    for(int q = 0; q < interiorSize; ++q) {
+        interiorFactor[(long long) q*stride + interiorWidth] = 2.0*(dx2i + dy2i);
+        if(q % interiorWidth > 0)
+            interiorFactor[(long long) q*stride + interiorWidth - 1] = -dx2i;
+        if(q >= interiorWidth)
+            interiorFactor[(long long) q*stride] = -dy2i;
+    }
+    BandFactor(interiorSize, interiorWidth, interiorFactor);
+
+    //dense local part of the complement, one back-substitution for each adjacent interface point
+    int m = adjacent.size();
+    int* position = new int[couplingCount];
+    for(int e = 0; e < couplingCount; ++e)
+        position[e] = std::lower_bound(adjacent.begin(), adjacent.end(), couplingInterface[e]) - adjacent.begin();
+    double* local = new double[(long long) m*m]();
+    #pragma omp parallel
+    {
+        double* column = new double[interiorSize];
+        #pragma omp for schedule(dynamic)
+        for(int c = 0; c < m; ++c) {
+            std::fill(column, column + interiorSize, 0.0);
+            for(int e = 0; e < couplingCount; ++e) {
+                if(position[e] == c)
+                    column[couplingInterior[e]] += couplingValue[e];
+            }
+            BandSolve(interiorSize, interiorWidth, interiorFactor, column);
+            for(int e = 0; e < couplingCount; ++e)
+                local[(long long) position[e]*m + c] += couplingValue[e] * column[couplingInterior[e]];
+        }
+        delete[] column;
+    }
+
+    //complement summed over all processes, then factorised by each of them
+    stride = interfaceBand + 1;
+    interfaceFactor = new double[interfaceFactorSize]();
+    for(int r = 0; r < m; ++r) {
+        for(int c = 0; c < m; ++c) {
+            if(adjacent[c] <= adjacent[r])
+                interfaceFactor[(long long) adjacent[r]*stride + adjacent[c] - adjacent[r] + interfaceBand] -= local[(long long) r*m + c];
+        }
+    }
+    for(int k = 0; k < ownedCount; ++k)
+        interfaceFactor[(long long) ownedIndex[k]*stride + interfaceBand] += 2.0*(dx2i + dy2i);
+    for(unsigned int e = 0; e < pairRow.size(); ++e)
+        interfaceFactor[(long long) pairRow[e]*stride + pairColumn[e] - pairRow[e] + interfaceBand] += pairValue[e];
+    if(interfaceSize > 0) {
+        MPI_Allreduce(MPI_IN_PLACE, interfaceFactor, (int) interfaceFactorSize, MPI_DOUBLE, MPI_SUM, comm_grid);
+        BandFactor(interfaceSize, interfaceBand, interfaceFactor);
+    }
+
+    delete[] position;
+    delete[] local;
+    factored = true;
+}
+
+SolverSchur::~SolverSchur()
+{
+    delete[] interiorFactor;
+    delete[] interiorRhs;
+    delete[] interiorSol;
+    delete[] interfaceFactor;
+    delete[] interfaceRhs;
+    delete[] ownedLocal;
+    delete[] ownedIndex;
+    delete[] couplingInterior;
+    delete[] couplingInterface;
+    delete[] couplingValue;
+    delete[] dirichletTarget;
+    delete[] dirichletSource;
+    delete[] dirichletValue;
+    delete[] work;
+}
+
+bool SolverSchur::IsFactored() {
+    return factored;
+}
+
+int SolverSchur::GetInterfaceSize() {
+    return interfaceSize;
+}
+
+int SolverSchur::GetIterations() {
+    return iterations;
+}
+
+double SolverSchur::GetResidual() {
+    return 0.0;
+}
+
+void SolverSchur::SetVerbose(bool pVerbose) {
+    verbose = pVerbose;
+}
+
+void SolverSchur::SetTolerance(double absolute, double relative, double initial) {
+    //direct solve, exact up to rounding
+}
+
+void SolverSchur::Reset() {
+    iterations = 0;
+}
+
+void SolverSchur::DoSolve(double* b, double* x)
+{
+    //values on the global boundary move to the right hand side of their neighbours
+    std::copy(b, b + Nx*Ny, work);
+    for(int e = 0; e < dirichletCount; ++e)
+        work[dirichletTarget[e]] += dirichletValue[e] * x[dirichletSource[e]];
+
+    //interior block with the interface at zero
+    for(int j = jStart; j < Ny - 1; ++j)
+        std::copy(work + j*Nx + iStart, work + j*Nx + Nx - 1, interiorRhs + (j - jStart)*interiorWidth);
+    std::copy(interiorRhs, interiorRhs + interiorSize, interiorSol);
+    BandSolve(interiorSize, interiorWidth, interiorFactor, interiorSol);
+
+    //right hand side of the complement, each process adding its own interface points and the coupling of its interior block
+    std::fill(interfaceRhs, interfaceRhs + interfaceSize, 0.0);
+    for(int k = 0; k < ownedCount; ++k)
+        interfaceRhs[ownedIndex[k]] = work[ownedLocal[k]];
+    for(int e = 0; e < couplingCount; ++e)
+        interfaceRhs[couplingInterface[e]] -= couplingValue[e] * interiorSol[couplingInterior[e]];
+    if(interfaceSize > 0) {
+        MPI_Allreduce(MPI_IN_PLACE, interfaceRhs, interfaceSize, MPI_DOUBLE, MPI_SUM, comm_grid);
+        BandSolve(interfaceSize, interfaceBand, interfaceFactor, interfaceRhs);
+    }
+
+    //interior block again with the interface solution
+    for(int e = 0; e < couplingCount; ++e)
+        interiorRhs[couplingInterior[e]] -= couplingValue[e] * interfaceRhs[couplingInterface[e]];
+    BandSolve(interiorSize, interiorWidth, interiorFactor, interiorRhs);
+
+    for(int j = jStart; j < Ny - 1; ++j)
+        std::copy(interiorRhs + (j - jStart)*interiorWidth, interiorRhs + (j - jStart + 1)*interiorWidth, x + j*Nx + iStart);
+    for(int k = 0; k < ownedCount; ++k)
+        x[ownedLocal[k]] = interfaceRhs[ownedIndex[k]];
+
+    iterations = 1;
+    if(verbose && (rank == 0))
+        cout << "Direct solve with " << interfaceSize << " interface points" << endl;
+}
+
+void SolverSchur::BandFactor(int n, int band, double* a)
+{
+    //row i holds L(i,j) at row[j], so the dot products of the left-looking update run over contiguous memory
+    long long stride = band + 1;
+    for(int i = 0; i < n; ++i) {
+        double* rowI = a + i*stride + band - i;
+        int first = std::max(0, i - band);
+        for(int j = first; j <= i; ++j) {
+            double* rowJ = a + j*stride + band - j;
+            int k0 = std::max(first, j - band);
+            double sum = rowI[j] - cblas_ddot(j - k0, rowI + k0, 1, rowJ + k0, 1);
+            rowI[j] = (j == i) ? sqrt(sum) : sum / rowJ[j];
+        }
+    }
+}
+
+void SolverSchur::BandSolve(int n, int band, const double* l, double* x)
+{
+    long long stride = band + 1;
+
+    //forward substitution by rows
+    for(int i = 0; i < n; ++i) {
+        const double* row = l + i*stride + band - i;
+        int first = std::max(0, i - band);
+        x[i] = (x[i] - cblas_ddot(i - first, row + first, 1, x + first, 1)) / row[i];
+    }
+
+    //back substitution with the transpose by columns, which are the same rows
+    for(int i = n - 1; i >= 0; --i) {
+        const double* row = l + i*stride + band - i;
+        int first = std::max(0, i - band);
+        x[i] /= row[i];
+        cblas_daxpy(i - first, -x[i], row + first, 1, x + first, 1);
+    }
+}
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+#include <cblas.h>
+#include <mpi.h>
+
+#include "StreamingPOD.h"
+
+/**
+ * @brief Householder QR factorisation in place
+ * @param[in] m         Number of rows
+ * @param[in] c         Number of columns
+ * @param[in,out] a     Column-major m x c matrix; on output R in the upper triangle and the reflectors below, scaled to a leading 1
+ * @param[out] tau      Scale factors of the min(m,c) reflections
+ */
+static void HouseholderQR(int m, int c, double* a, double* tau)
+{
+    int p = std::min(m, c);
+    for(int j = 0; j < p; ++j) {
+        double* x = a + (long) j*m + j;
+        double norm = cblas_dnrm2(m - j, x, 1);
+        if(norm == 0.0) {                                           //column already zero below the diagonal
+            tau[j] = 0.0;
+            continue;
+        }
+        double beta = (x[0] > 0.0) ? -norm : norm;                  //opposite sign to x[0] avoids cancellation
+        tau[j] = (beta - x[0])/beta;
+        cblas_dscal(m - j - 1, 1.0/(x[0] - beta), x + 1, 1);
+        x[0] = beta;
+
+        for(int col = j + 1; col < c; ++col) {
+            double* y = a + (long) col*m + j;
+            double w = tau[j]*(y[0] + cblas_ddot(m - j - 1, x + 1, 1, y + 1, 1));
+            y[0] -= w;
+            cblas_daxpy(m - j - 1, -w, x + 1, 1, y + 1, 1);
+        }
+    }
+}
+
+/**
+ * @brief Form the orthogonal factor of HouseholderQR, applying the reflections backwards to the identity
+ * @param[in] m         Number of rows
+ * @param[in] c         Number of columns
+ * @param[in] a         Factorisation from HouseholderQR
+ * @param[in] tau       Scale factors from HouseholderQR
+ * @param[out] q        Column-major m x c orthogonal factor, columns from min(m,c) on are zero
+ */
+static void FormQ(int m, int c, const double* a, const double* tau, double* q)
+{
+    int p = std::min(m, c);
+    std::fill(q, q + (long) m*c, 0.0);
+    for(int j = 0; j < p; ++j)
+        q[(long) j*m + j] = 1.0;
+
+    for(int j = p - 1; j >= 0; --j) {
+        const double* v = a + (long) j*m + j;
+        for(int col = j; col < p; ++col) {
+            double* y = q + (long) col*m + j;
+            double w = tau[j]*(y[0] + cblas_ddot(m - j - 1, v + 1, 1, y + 1, 1));
+            y[0] -= w;
+            cblas_daxpy(m - j - 1, -w, v + 1, 1, y + 1, 1);
+        }
+    }
+}
+
+/**
+ * @brief One-sided Jacobi SVD, rotating pairs of columns until all are orthogonal
+ * @param[in] c         Order of the matrix
+ * @param[in,out] w     Column-major c x c matrix; on output its left singular vectors scaled by the singular values, unsorted
+ * @param[out] v        Column-major c x c right singular vectors, in the order of the columns of w
+ */
+static void JacobiSVD(int c, double* w, double* v)
+{
+    std::fill(v, v + c*c, 0.0);
+    for(int j = 0; j < c; ++j)
+        v[j*c + j] = 1.0;
+
+    for(int sweep = 0; sweep < 60; ++sweep) {
+        bool rotated = false;
+        for(int p = 0; p < c - 1; ++p) {
+            for(int q = p + 1; q < c; ++q) {
+                double alpha = cblas_ddot(c, w + p*c, 1, w + p*c, 1);
+                double beta = cblas_ddot(c, w + q*c, 1, w + q*c, 1);
+                double gamma = cblas_ddot(c, w + p*c, 1, w + q*c, 1);
+                if(std::fabs(gamma) <= 1e-15*sqrt(alpha*beta))     //orthogonal to working precision, including zero columns
+                    continue;
+                rotated = true;
+
+                //rotation zeroing the inner product of the pair, the smaller of the two possible angles
+                double zeta = (beta - alpha)/(2.0*gamma);
+                double t = ((zeta >= 0.0) ? 1.0 : -1.0)/(std::fabs(zeta) + sqrt(1.0 + zeta*zeta));
+                double cs = 1.0/sqrt(1.0 + t*t);
+                double sn = cs*t;
+                cblas_drot(c, w + p*c, 1, w + q*c, 1, cs, -sn);
+                cblas_drot(c, v + p*c, 1, v + q*c, 1, cs, -sn);
+            }
+        }
+        if(!rotated)
+            break;
+    }
+}
+
+StreamingPOD::StreamingPOD(int pMaxModes, int pBatch, int pGlobalNx, int pGlobalNy, int pXStart, int pYStart, int pNx, int pNy,
+                           MPI_Comm pComm)
+{
+    maxModes = pMaxModes;
+    batch = pBatch;
+    globalNx = pGlobalNx;
+    globalNy = pGlobalNy;
+    xStart = pXStart;
+    yStart = pYStart;
+    Nx = pNx;
+    Ny = pNy;
+    n = Nx*Ny;
+    comm = pComm;
+    MPI_Comm_size(comm, &size);
+    MPI_Comm_rank(comm, &rank);
+
+    int c = maxModes + batch;                                       //most columns of an update
+    U = new double[(long) n*maxModes];
+    sigma = new double[maxModes];
+    A = new double[(long) n*c];
+    Q = new double[(long) n*c];
+    tau = new double[c];
+    R = new double[c*c];
+    gathered = new double[(long) size*c*c];
+    stacked = new double[(long) size*c*c];
+    stackedQ = new double[(long) size*c*c];
+    stackedTau = new double[c];
+    W = new double[c*c];
+    rotations = new double[c*c];
+    G = new double[c*maxModes];
+    pending = new double[batch];
+    order = new int[c];
+}
+
+StreamingPOD::~StreamingPOD()
+{
+    delete[] U;
+    delete[] sigma;
+    delete[] A;
+    delete[] Q;
+    delete[] tau;
+    delete[] R;
+    delete[] gathered;
+    delete[] stacked;
+    delete[] stackedQ;
+    delete[] stackedTau;
+    delete[] W;
+    delete[] rotations;
+    delete[] G;
+    delete[] pending;
+    delete[] order;
+}
+
+void StreamingPOD::Add(const double* field, double time)
+{
+    std::copy(field, field + n, A + (long) (maxModes + buffered)*n);
+    pending[buffered] = time;
+    if(++buffered == batch)
+        Update();
+}
+
+void StreamingPOD::Reserve(int snapshots)
+{
+    V.reserve((long) snapshots*maxModes);
+    rotated.reserve((long) snapshots*maxModes);
+    times.reserve(snapshots);
+}
+
+void StreamingPOD::Update()
+{
+    if(buffered == 0)
+        return;
+
+    //columns of [U Sigma | X] end where the batch ends, so they are contiguous whatever the number of modes
+    int c = modes + buffered;
+    double* first = A + (long) (maxModes - modes)*n;
+    for(int l = 0; l < modes; ++l) {
+        for(int i = 0; i < n; ++i)
+            first[(long) l*n + i] = U[(long) l*n + i]*sigma[l];
+    }
+
+    //-----------------------------------------Tall-skinny QR across processes-----------------------------------------//
+    //local factors first, with zero rows below the local rows if this process has fewer points than columns
+    HouseholderQR(n, c, first, tau);
+    for(int col = 0; col < c; ++col) {
+        for(int row = 0; row < c; ++row)
+            R[col*c + row] = ((row <= col) && (row < n)) ? first[(long) col*n + row] : 0.0;
+    }
+    FormQ(n, c, first, tau, Q);
+
+    //every process factorises the local factors of all processes stacked in rank order, so all get the same global factor
+    int rows = size*c;
+    MPI_Allgather(R, c*c, MPI_DOUBLE, gathered, c*c, MPI_DOUBLE, comm);
+    for(int k = 0; k < size; ++k) {
+        for(int col = 0; col < c; ++col) {
+            for(int row = 0; row < c; ++row)
+                stacked[(long) col*rows + k*c + row] = gathered[(long) k*c*c + col*c + row];
+        }
+    }
+    HouseholderQR(rows, c, stacked, stackedTau);
+    FormQ(rows, c, stacked, stackedTau, stackedQ);
+
+    //-----------------------------------------SVD of the global triangular factor-----------------------------------------//
+    for(int col = 0; col < c; ++col) {
+        for(int row = 0; row < c; ++row)
+            W[col*c + row] = (row <= col) ? stacked[(long) col*rows + row] : 0.0;
+    }
+    JacobiSVD(c, W, rotations);
+
+    double* values = tau;                                           //reflections of the local factor are no longer needed
+    for(int j = 0; j < c; ++j)
+        values[j] = cblas_dnrm2(c, W + j*c, 1);
+
+    //insertion sort is stable like std::stable_sort, without its temporary buffer, and c is small
+    for(int j = 0; j < c; ++j) {
+        int i = j;
+        for(; (i > 0) && (values[order[i-1]] < values[j]); --i)
+            order[i] = order[i-1];
+        order[i] = j;
+    }
+
+    int kept = 0;
+    while((kept < std::min(c, maxModes)) && (values[order[kept]] > DropTolerance*values[order[0]]))
+        ++kept;
+
+    //left singular vectors of the kept modes, in R as the local factor is no longer needed
+    for(int l = 0; l < kept; ++l) {
+        for(int row = 0; row < c; ++row)
+            R[l*c + row] = W[order[l]*c + row]/values[order[l]];
+    }
+
+    //modes are the local rows of Q, the block of this process of the global orthogonal factor, and the left singular vectors
+    if(kept > 0) {
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, c, kept, c, 1.0, stackedQ + rank*c, rows, R, c, 0.0, G, c);
+        cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, n, kept, c, 1.0, Q, n, G, c, 0.0, U, n);
+    }
+
+    //right singular vectors of the previous snapshots are rotated, those of the batch are the remaining rows of the rotations
+    int snapshots = times.size();
+    rotated.resize((long) (snapshots + buffered)*kept);
+    for(int j = 0; j < snapshots; ++j) {
+        for(int l = 0; l < kept; ++l) {
+            double sum = 0.0;
+            for(int q = 0; q < modes; ++q)
+                sum += V[(long) j*modes + q]*rotations[order[l]*c + q];
+            rotated[(long) j*kept + l] = sum;
+        }
+    }
+    for(int j = 0; j < buffered; ++j) {
+        for(int l = 0; l < kept; ++l)
+            rotated[(long) (snapshots + j)*kept + l] = rotations[order[l]*c + modes + j];
+    }
+    V.swap(rotated);
+
+    for(int l = 0; l < kept; ++l)
+        sigma[l] = values[order[l]];
+    modes = kept;
+    times.insert(times.end(), pending, pending + buffered);
+    buffered = 0;
+}
+
+void StreamingPOD::Write(std::string file, int step, double time)
+{
+    Update();
+    int snapshots = times.size();
+
+    MPI_File fh;
+    MPI_File_open(comm, file.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+    MPI_File_set_size(fh, 0);
+
+    //small arrays are the same on all processes, so the root writes them
+    if(rank == 0) {
+        PODFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "LDCPOD01", 8);
+        header.globalNx = globalNx;
+        header.globalNy = globalNy;
+        header.modes = modes;
+        header.snapshots = snapshots;
+        header.step = step;
+        header.time = time;
+
+        std::vector<double> coefficients((long) snapshots*modes);
+        for(int j = 0; j < snapshots; ++j) {
+            for(int l = 0; l < modes; ++l)
+                coefficients[(long) j*modes + l] = GetCoefficient(j, l);
+        }
+
+        MPI_Offset offset = sizeof(header);
+        MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+        MPI_File_write_at(fh, offset, sigma, modes, MPI_DOUBLE, MPI_STATUS_IGNORE);
+        offset += modes*sizeof(double);
+        MPI_File_write_at(fh, offset, times.data(), snapshots, MPI_DOUBLE, MPI_STATUS_IGNORE);
+        offset += snapshots*sizeof(double);
+        MPI_File_write_at(fh, offset, coefficients.data(), snapshots*modes, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    }
+
+    //each mode is a global field, into which every process writes its local domain through a subarray view
+    MPI_Datatype domain;
+    int sizes[2] = {globalNy, globalNx};
+    int subsizes[2] = {Ny, Nx};
+    int starts[2] = {yStart, xStart};
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &domain);
+    MPI_Type_commit(&domain);
+    MPI_Offset base = sizeof(PODFileHeader) + ((long long) modes + snapshots + (long long) snapshots*modes)*sizeof(double);
+    for(int l = 0; l < modes; ++l) {
+        MPI_File_set_view(fh, base + (MPI_Offset) l*globalNx*globalNy*sizeof(double), MPI_DOUBLE, domain, "native", MPI_INFO_NULL);
+        MPI_File_write_all(fh, U + (long) l*n, n, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    }
+    MPI_Type_free(&domain);
+
+    MPI_File_close(&fh);
+}
+
+int StreamingPOD::GetModes() {
+    return modes;
+}
+
+int StreamingPOD::GetSnapshots() {
+    return times.size();
+}
+
+const double* StreamingPOD::GetMode(int l) {
+    return U + (long) l*n;
+}
+
+const double* StreamingPOD::GetSingularValues() {
+    return sigma;
+}
+
+double StreamingPOD::GetCoefficient(int j, int l) {
+    return sigma[l]*V[(long) j*modes + l];
+}
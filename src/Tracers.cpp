@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+#include <mpi.h>
+
+#include "Tracers.h"
+
+/**
+ * @brief Grow a packing buffer of tracers to hold at least n tracers, keeping its contents
+ * @param[in,out] buffer    Buffer of 3 values per tracer
+ * @param[in,out] capacity  Tracers that fit in the buffer
+ * @param[in] n             Tracers needed
+ */
+static void GrowBuffer(double*& buffer, long long& capacity, long long n)
+{
+    if(n <= capacity)
+        return;
+    long long newCapacity = std::max(n, 2*capacity);
+    double* newBuffer = new double[3*newCapacity];
+    std::copy(buffer, buffer + 3*capacity, newBuffer);
+    delete[] buffer;
+    buffer = newBuffer;
+    capacity = newCapacity;
+}
+
+Tracers::Tracers(long long pCount, int pGlobalNx, int pGlobalNy, double pdx, double pdy, int pXStart, int pYStart, int pNx, int pNy,
+                 MPI_Comm rowGrid, MPI_Comm colGrid)
+{
+    globalNx = pGlobalNx;
+    globalNy = pGlobalNy;
+    dx = pdx;
+    dy = pdy;
+    xStart = pXStart;
+    yStart = pYStart;
+    Nx = pNx;
+    Ny = pNy;
+    comm_row_grid = rowGrid;
+    comm_col_grid = colGrid;
+    MPI_Cart_shift(comm_col_grid,0,1,&bottomRank,&topRank);
+    MPI_Cart_shift(comm_row_grid,0,1,&leftRank,&rightRank);
+
+    uExt = new double[(Nx+1)*(Ny+1)]();                             //halo column and row stay zero at the global boundary
+    vExt = new double[(Nx+1)*(Ny+1)]();
+    haloSend = new double[2*std::max(Nx+1, Ny)];
+    haloRecv = new double[2*std::max(Nx+1, Ny)];
+    binStart = new long long[Nx*Ny + 1];
+    binNext = new long long[Nx*Ny];
+
+    //additive recurrence with the plastic number g, x_k = frac(1/2 + k/g), y_k = frac(1/2 + k/g^2)
+    const double g = 1.32471795724474602596;
+    const double a1 = 1.0/g;
+    const double a2 = 1.0/(g*g);
+    double Lx = (globalNx - 1) * dx;
+    double Ly = (globalNy - 1) * dy;
+    Reserve(pCount * Nx * Ny / ((long long) globalNx * globalNy) + 16);
+
+    //packing buffers fit the tracers of a strip of cells along the longer local edge, all that leave in a step of under a cell
+    long long strip = pCount * std::max(Nx, Ny) / ((long long) globalNx * globalNy) + 16;
+    GrowBuffer(sendLow, sendLowCapacity, strip);
+    GrowBuffer(sendHigh, sendHighCapacity, strip);
+    GrowBuffer(recvBuffer, recvCapacity, strip);
+    for(long long k = 0; k < pCount; ++k) {
+        double px = fmod(0.5 + k*a1, 1.0) * Lx;
+        double py = fmod(0.5 + k*a2, 1.0) * Ly;
+        int i = Cell(px, dx, globalNx) - xStart;
+        int j = Cell(py, dy, globalNy) - yStart;
+        if((i >= 0) && (i < Nx) && (j >= 0) && (j < Ny))
+            Append(px, py, k);
+    }
+
+    Sort();
+}
+
+Tracers::~Tracers()
+{
+    delete[] x;
+    delete[] y;
+    delete[] id;
+    delete[] bin;
+    delete[] binStart;
+    delete[] binNext;
+    delete[] uExt;
+    delete[] vExt;
+    delete[] haloSend;
+    delete[] haloRecv;
+    delete[] sendLow;
+    delete[] sendHigh;
+    delete[] recvBuffer;
+}
+
+void Tracers::Advect(const double* u0, const double* u1, double dt)
+{
+    ExchangeVelocity(u0, u1);
+
+    double dxi = 1.0/dx;
+    double dyi = 1.0/dy;
+    double Lx = (globalNx - 1) * dx;
+    double Ly = (globalNy - 1) * dy;
+    int NxExt = Nx + 1;
+
+    //every local tracer lies in a cell of the local domain, whose top and right corners are in the halo at worst
+    #pragma omp parallel for schedule(static)
+    for(long long k = 0; k < count; ++k) {
+        int ci = Cell(x[k], dx, globalNx);
+        int cj = Cell(y[k], dy, globalNy);
+        double fx = x[k]*dxi - ci;                                  //position within the cell, 0 to 1
+        double fy = y[k]*dyi - cj;
+        int c = (cj - yStart)*NxExt + (ci - xStart);                //bottom left corner of the cell
+
+        double w00 = (1.0 - fx)*(1.0 - fy);
+        double w10 = fx*(1.0 - fy);
+        double w01 = (1.0 - fx)*fy;
+        double w11 = fx*fy;
+        double u = w00*uExt[c] + w10*uExt[c+1] + w01*uExt[c+NxExt] + w11*uExt[c+NxExt+1];
+        double v = w00*vExt[c] + w10*vExt[c+1] + w01*vExt[c+NxExt] + w11*vExt[c+NxExt+1];
+
+        //walls are impermeable, so a tracer overshooting one due to the finite time step stays on it
+        x[k] = std::min(std::max(x[k] + dt*u, 0.0), Lx);
+        y[k] = std::min(std::max(y[k] + dt*v, 0.0), Ly);
+    }
+
+    //left and right first, so tracers crossing a corner are sent on to the diagonal neighbour by the second exchange
+    Migrate(false);
+    Migrate(true);
+
+    if((sortInterval > 0) && (++advectCount >= sortInterval))
+        Sort();
+}
+
+void Tracers::Sort()
+{
+    advectCount = 0;
+    int nBins = Nx*Ny;
+
+    //counting pass
+    std::fill(binStart, binStart + nBins + 1, 0);
+    for(long long k = 0; k < count; ++k) {
+        bin[k] = (Cell(y[k], dy, globalNy) - yStart)*Nx + (Cell(x[k], dx, globalNx) - xStart);
+        ++binStart[bin[k] + 1];
+    }
+    for(int b = 0; b < nBins; ++b) {
+        binStart[b+1] += binStart[b];
+        binNext[b] = binStart[b];
+    }
+
+    //American flag sort, every swap moves one tracer into the next free slot of its cell, so no second copy of the tracers is needed
+    for(int b = 0; b < nBins; ++b) {
+        while(binNext[b] < binStart[b+1]) {
+            long long k = binNext[b];
+            int target = bin[k];
+            if(target == b) {
+                ++binNext[b];
+                continue;
+            }
+            long long slot = binNext[target]++;
+            std::swap(x[k], x[slot]);
+            std::swap(y[k], y[slot]);
+            std::swap(id[k], id[slot]);
+            std::swap(bin[k], bin[slot]);
+        }
+    }
+}
+
+void Tracers::Write(std::string file, int step, double time, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    //slice of this process in each array of the file
+    long long offset = 0;
+    long long total;
+    MPI_Exscan(&count, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if(rank == 0)
+        offset = 0;                                                 //MPI_Exscan leaves the result undefined on rank 0
+    MPI_Allreduce(&count, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+
+    MPI_File fh;
+    MPI_File_open(comm, file.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+    MPI_File_set_size(fh, 0);
+
+    if(rank == 0) {
+        TracerFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "LDCPART1", 8);
+        header.step = step;
+        header.time = time;
+        header.count = total;
+        MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Offset base = sizeof(TracerFileHeader);
+    MPI_File_write_at_all(fh, base + offset*sizeof(long long), id, (int) count, MPI_LONG_LONG, MPI_STATUS_IGNORE);
+    MPI_File_write_at_all(fh, base + (total + offset)*sizeof(double), x, (int) count, MPI_DOUBLE, MPI_STATUS_IGNORE);
+    MPI_File_write_at_all(fh, base + (2*total + offset)*sizeof(double), y, (int) count, MPI_DOUBLE, MPI_STATUS_IGNORE);
+
+    MPI_File_close(&fh);
+}
+
+void Tracers::SetSortInterval(int interval)
+{
+    sortInterval = interval;
+}
+
+long long Tracers::GetLocalCount() {
+    return count;
+}
+
+const double* Tracers::GetX() {
+    return x;
+}
+
+const double* Tracers::GetY() {
+    return y;
+}
+
+const long long* Tracers::GetIds() {
+    return id;
+}
+
+void Tracers::ExchangeVelocity(const double* u0, const double* u1)
+{
+    int NxExt = Nx + 1;
+    for(int j = 0; j < Ny; ++j) {
+        std::copy(u0 + j*Nx, u0 + (j+1)*Nx, uExt + j*NxExt);
+        std::copy(u1 + j*Nx, u1 + (j+1)*Nx, vExt + j*NxExt);
+    }
+
+    //first column goes left, both components in one message
+    for(int j = 0; j < Ny; ++j) {
+        haloSend[j] = u0[j*Nx];
+        haloSend[Ny + j] = u1[j*Nx];
+    }
+    MPI_Sendrecv(haloSend, 2*Ny, MPI_DOUBLE, leftRank, 0, haloRecv, 2*Ny, MPI_DOUBLE, rightRank, 0,
+                 comm_row_grid, MPI_STATUS_IGNORE);
+    if(rightRank != MPI_PROC_NULL) {
+        for(int j = 0; j < Ny; ++j) {
+            uExt[j*NxExt + Nx] = haloRecv[j];
+            vExt[j*NxExt + Nx] = haloRecv[Ny + j];
+        }
+    }
+
+    //first row goes down including the halo column just received, which carries the corner of the diagonal neighbour
+    std::copy(uExt, uExt + NxExt, haloSend);
+    std::copy(vExt, vExt + NxExt, haloSend + NxExt);
+    MPI_Sendrecv(haloSend, 2*NxExt, MPI_DOUBLE, bottomRank, 1, haloRecv, 2*NxExt, MPI_DOUBLE, topRank, 1,
+                 comm_col_grid, MPI_STATUS_IGNORE);
+    if(topRank != MPI_PROC_NULL) {
+        std::copy(haloRecv, haloRecv + NxExt, uExt + Ny*NxExt);
+        std::copy(haloRecv + NxExt, haloRecv + 2*NxExt, vExt + Ny*NxExt);
+    }
+}
+
+void Tracers::Migrate(bool vertical)
+{
+    MPI_Comm comm = vertical ? comm_col_grid : comm_row_grid;
+    int lowRank = vertical ? bottomRank : leftRank;
+    int highRank = vertical ? topRank : rightRank;
+    int start = vertical ? yStart : xStart;
+    int end = start + (vertical ? Ny : Nx);
+    double h = vertical ? dy : dx;
+    int globalN = vertical ? globalNy : globalNx;
+    int tag = vertical ? 3 : 2;
+
+    int outside;
+    do {
+        //compact remaining tracers in place, keeping their order, and pack the leaving ones
+        long long nLow = 0, nHigh = 0, kept = 0;
+        for(long long k = 0; k < count; ++k) {
+            int c = Cell(vertical ? y[k] : x[k], h, globalN);
+            double* out;
+            if(c < start) {
+                GrowBuffer(sendLow, sendLowCapacity, nLow + 1);
+                out = sendLow + 3*nLow++;
+            }
+            else if(c >= end) {
+                GrowBuffer(sendHigh, sendHighCapacity, nHigh + 1);
+                out = sendHigh + 3*nHigh++;
+            }
+            else {
+                x[kept] = x[k];
+                y[kept] = y[k];
+                id[kept] = id[k];
+                ++kept;
+                continue;
+            }
+            out[0] = x[k];
+            out[1] = y[k];
+            out[2] = (double) id[k];                                //exact below 2^53 tracers
+        }
+        count = kept;
+
+        //counts first, so receive buffers can be sized, then one batch per direction
+        long long fromHigh = 0, fromLow = 0;
+        MPI_Sendrecv(&nLow, 1, MPI_LONG_LONG, lowRank, tag, &fromHigh, 1, MPI_LONG_LONG, highRank, tag, comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(&nHigh, 1, MPI_LONG_LONG, highRank, tag, &fromLow, 1, MPI_LONG_LONG, lowRank, tag, comm, MPI_STATUS_IGNORE);
+
+        long long firstArrived = count;
+        GrowBuffer(recvBuffer, recvCapacity, std::max(fromHigh, fromLow));
+        MPI_Sendrecv(sendLow, (int) (3*nLow), MPI_DOUBLE, lowRank, tag, recvBuffer, (int) (3*fromHigh), MPI_DOUBLE, highRank, tag,
+                     comm, MPI_STATUS_IGNORE);
+        for(long long k = 0; k < fromHigh; ++k)
+            Append(recvBuffer[3*k], recvBuffer[3*k+1], (long long) recvBuffer[3*k+2]);
+        MPI_Sendrecv(sendHigh, (int) (3*nHigh), MPI_DOUBLE, highRank, tag, recvBuffer, (int) (3*fromLow), MPI_DOUBLE, lowRank, tag,
+                     comm, MPI_STATUS_IGNORE);
+        for(long long k = 0; k < fromLow; ++k)
+            Append(recvBuffer[3*k], recvBuffer[3*k+1], (long long) recvBuffer[3*k+2]);
+
+        //tracers moving further than a local domain in one step pass through, which every process of the row or column must join
+        outside = 0;
+        for(long long k = firstArrived; k < count; ++k) {
+            int c = Cell(vertical ? y[k] : x[k], h, globalN);
+            if((c < start) || (c >= end))
+                outside = 1;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &outside, 1, MPI_INT, MPI_MAX, comm);
+    } while(outside);
+}
+
+int Tracers::Cell(double pos, double h, int globalN)
+{
+    int c = (int) floor(pos / h);
+    return std::min(std::max(c, 0), globalN - 2);                   //the last grid point closes the last cell
+}
+
+void Tracers::Reserve(long long n)
+{
+    if(n <= capacity)
+        return;
+    long long newCapacity = std::max(n, 2*capacity);
+
+    double* newX = new double[newCapacity];
+    double* newY = new double[newCapacity];
+    long long* newId = new long long[newCapacity];
+    std::copy(x, x + count, newX);
+    std::copy(y, y + count, newY);
+    std::copy(id, id + count, newId);
+    delete[] x;
+    delete[] y;
+    delete[] id;
+    delete[] bin;
+    x = newX;
+    y = newY;
+    id = newId;
+    bin = new int[newCapacity];
+    capacity = newCapacity;
+}
+
+void Tracers::Append(double px, double py, long long pid)
+{
+    Reserve(count + 1);
+    x[count] = px;
+    y[count] = py;
+    id[count] = pid;
+    ++count;
+}
@@ -0,0 +1,106 @@
+#include <cmath>
+
+#include <cblas.h>
+#include <omp.h>
+
+#include "VectorOps.h"
+
+#ifdef VECTOR_OPS_BLAS
+VectorOps::Backend VectorOps::backend = VectorOps::Blas;
+#else
+VectorOps::Backend VectorOps::backend = VectorOps::OpenMP;
+#endif
+
+void VectorOps::SetBackend(Backend pBackend)
+{
+    backend = pBackend;
+}
+
+bool VectorOps::SetBackend(std::string name)
+{
+    if(name == "openmp")
+        backend = OpenMP;
+    else if(name == "blas")
+        backend = Blas;
+    else
+        return false;
+    return true;
+}
+
+VectorOps::Backend VectorOps::GetBackend()
+{
+    return backend;
+}
+
+std::string VectorOps::GetBackendName()
+{
+    return (backend == Blas) ? "blas" : "openmp";
+}
+
+//static schedules throughout, so every operation gives each thread the same block of the vector
+
+double VectorOps::Dot(int n, const double* x, const double* y)
+{
+    if(backend == Blas)
+        return cblas_ddot(n, x, 1, y, 1);
+
+    double sum = 0.0;
+    #pragma omp parallel for simd schedule(static) reduction(+:sum) if(n >= ParallelThreshold)
+    for(int i = 0; i < n; ++i)
+        sum += x[i]*y[i];
+    return sum;
+}
+
+double VectorOps::Nrm2(int n, const double* x)
+{
+    if(backend == Blas)
+        return cblas_dnrm2(n, x, 1);
+
+    //residuals are far from overflow, so the scaling of dnrm2 is not needed
+    return sqrt(Dot(n, x, x));
+}
+
+void VectorOps::Axpy(int n, double a, const double* x, double* y)
+{
+    if(backend == Blas) {
+        cblas_daxpy(n, a, x, 1, y, 1);
+        return;
+    }
+
+    #pragma omp parallel for simd schedule(static) if(n >= ParallelThreshold)
+    for(int i = 0; i < n; ++i)
+        y[i] += a*x[i];
+}
+
+void VectorOps::Xpay(int n, const double* x, double a, double* y)
+{
+    if(backend == Blas) {
+        cblas_dscal(n, a, y, 1);
+        cblas_daxpy(n, 1.0, x, 1, y, 1);
+        return;
+    }
+
+    #pragma omp parallel for simd schedule(static) if(n >= ParallelThreshold)
+    for(int i = 0; i < n; ++i)
+        y[i] = x[i] + a*y[i];
+}
+
+void VectorOps::Copy(int n, const double* x, double* y)
+{
+    if(backend == Blas) {
+        cblas_dcopy(n, x, 1, y, 1);
+        return;
+    }
+
+    #pragma omp parallel for simd schedule(static) if(n >= ParallelThreshold)
+    for(int i = 0; i < n; ++i)
+        y[i] = x[i];
+}
+
+void VectorOps::Zero(int n, double* x)
+{
+    //threaded with either backend, as it places the pages of new vectors on the NUMA node of the threads using them
+    #pragma omp parallel for simd schedule(static) if(n >= ParallelThreshold)
+    for(int i = 0; i < n; ++i)
+        x[i] = 0.0;
+}
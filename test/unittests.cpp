@@ -8,15 +8,42 @@
 #include <iostream>
 #include <cstdlib>
 #include <sstream>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <streambuf>
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <ctime>
 #include <cblas.h>
 #include <mpi.h>
+#include <omp.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "LidDrivenCavity.h"
 #include "SolverCG.h"
+#include "BuddyCheckpoint.h"
+#include "Snapshot.h"
+#include "Renderer.h"
+#include "MetricsServer.h"
+#include "CostModel.h"
+#include "Parareal.h"
+#include "EnergyMeter.h"
+#include "Profiler.h"
+#include "AllocTracker.h"
+#include "Richardson.h"
+#include "Agglomeration.h"
+#include "PoissonSolver.h"
+#include "SolverSchur.h"
+#include "Tracers.h"
+#include "CavityBenchmark.h"
+#include "VectorOps.h"
+#include "Deadline.h"
+#include "SolverCGTiled.h"
+#include "StreamingPOD.h"
 
 /**
  * @brief Macro to map coordinates \f$ (i,j) \f$ onto its corresponding location in memory, assuming row-wise matrix storage
@@ -37,7 +64,8 @@ struct MPIFixture {
         int& argc = boost::unit_test::framework::master_test_suite().argc;
         char**& argv = boost::unit_test::framework::master_test_suite().argv;
 
-        MPI_Init(&argc, &argv);
+        int provided;
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
     }
     /**
      * @brief Finalise MPI
@@ -540,7 +568,7 @@ BOOST_AUTO_TEST_CASE(LidDrivenCavity_PrintConfiguration)
     string configTimestep = "Timestep:  0.2";
     string configSteps = "Steps:     26";                                   //also test ability of ceiling, as 25.5 should round up to 26
     string configReynolds = "Reynolds number: 100";
-    string configOther = "Linear solver: preconditioned conjugate gradient";
+    string configOther = "Linear solver: auto Poisson solver";
 
     //MPI implementation
     MPI_Comm grid,row,col;
@@ -966,4 +994,1893 @@ BOOST_AUTO_TEST_CASE(LidDrivenCavity_Integrator)
     delete[] vy;
     delete[] s;
     delete[] v;
-}
\ No newline at end of file
+}
+
+/**
+ * @test Test whether BuddyCheckpoint stores, flushes and recovers the local data of each process. The flushed file of the root process
+ * is then removed to mimic a lost node, in which case the root process should recover its data from the copy held by its partner.
+ *******************************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(BuddyCheckpoint_StoreRecover)
+{
+    int worldRank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD,&size);
+
+    MPI_Comm world = MPI_COMM_WORLD;
+    int n = 50 + worldRank;                                         //different sizes on each process, as in an uneven domain split
+    double* v = new double[n];
+    double* s = new double[n];
+    double* vOut = new double[n]();
+    double* sOut = new double[n]();
+
+    for(int i = 0; i < n; ++i) {
+        v[i] = 1000.0*worldRank + i;                                //unique data on each process
+        s[i] = -1000.0*worldRank - i;
+    }
+
+    int step = -1;
+    {
+        BuddyCheckpoint test(n,world,".",1);                        //flush every checkpoint to current directory
+        test.SetProblem(33,17,1.0,2.0,0.001,100);
+        test.Store(v,s,7);
+        test.WaitForFlush();
+
+        BOOST_CHECK_EQUAL(test.GetStep(),7);
+        if(size > 1) {
+            BOOST_CHECK(test.GetPartnerRank() != worldRank);        //data must be held by a different process
+            BOOST_CHECK(test.GetBuddyRank() != worldRank);
+        }
+
+        //recover from own file
+        BOOST_REQUIRE(test.Recover(vOut,sOut,step));
+        BOOST_CHECK_EQUAL(step,7);
+        for(int i = 0; i < n; ++i) {
+            BOOST_CHECK_EQUAL(vOut[i],v[i]);
+            BOOST_CHECK_EQUAL(sOut[i],s[i]);
+        }
+    }
+
+    //lose root file, root data should come from its partner
+    if(size > 1) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        if(worldRank == 0)
+            std::remove("./buddy_ckpt_0.bin");
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        std::fill(vOut,vOut+n,0.0);
+        std::fill(sOut,sOut+n,0.0);
+        BuddyCheckpoint test(n,world,".",1);
+        test.SetProblem(33,17,1.0,2.0,0.001,100);
+        BOOST_REQUIRE(test.Recover(vOut,sOut,step));
+        BOOST_CHECK_EQUAL(step,7);
+        for(int i = 0; i < n; ++i) {
+            BOOST_CHECK_EQUAL(vOut[i],v[i]);
+            BOOST_CHECK_EQUAL(sOut[i],s[i]);
+        }
+    }
+
+    //a recovery that fails on one process leaves the in-memory checkpoints of all processes as they were
+    if(size > 1) {
+        BuddyCheckpoint test(n,world,".",0);
+        test.SetProblem(33,17,1.0,2.0,0.001,100);
+        test.Store(s,v,3);
+        MPI_Barrier(MPI_COMM_WORLD);
+        if(worldRank == 0)
+            std::remove(("./buddy_ckpt_" + std::to_string(test.GetPartnerRank()) + ".bin").c_str());
+        MPI_Barrier(MPI_COMM_WORLD);
+        BOOST_CHECK(!test.Recover(vOut,sOut,step));
+
+        test.Flush();
+        test.WaitForFlush();
+        BOOST_REQUIRE(test.Recover(vOut,sOut,step));
+        BOOST_CHECK_EQUAL(step,3);
+        for(int i = 0; i < n; ++i) {
+            BOOST_CHECK_EQUAL(vOut[i],s[i]);
+            BOOST_CHECK_EQUAL(sOut[i],v[i]);
+        }
+    }
+
+    //files of another case on the same grid are refused, leaving the in-memory checkpoint as it was
+    {
+        BuddyCheckpoint other(n,world,".",0);
+        other.SetProblem(33,17,1.0,2.0,0.002,100);
+        other.Store(s,v,3);
+        int otherStep = -1;
+        BOOST_CHECK(!other.Recover(vOut,sOut,otherStep));
+        BOOST_CHECK_EQUAL(otherStep,-1);
+        BOOST_CHECK_EQUAL(other.GetStep(),3);
+
+        other.Flush();
+        other.WaitForFlush();
+        BOOST_REQUIRE(other.Recover(vOut,sOut,otherStep));
+        BOOST_CHECK_EQUAL(otherStep,3);
+        for(int i = 0; i < n; ++i) {
+            BOOST_CHECK_EQUAL(vOut[i],s[i]);
+            BOOST_CHECK_EQUAL(sOut[i],v[i]);
+        }
+    }
+
+    delete[] v;
+    delete[] s;
+    delete[] vOut;
+    delete[] sOut;
+}
+
+/**
+ * @test Test whether snapshots written by LidDrivenCavity can be read back with SnapshotReader, by comparing the streamfunction of
+ * each process with the subregion extracted from the file. Also tests that the text output of LidDrivenCavity::WriteSolution is
+ * converted into an equivalent snapshot file.
+ *******************************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Snapshot_WriteRead)
+{
+    double dt   = 0.01;
+    double T    = 0.05;
+    int    Nx   = 21;
+    int    Ny   = 11;
+    double Lx   = 1.0;
+    double Ly   = 2.0;
+    double Re   = 100;
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart,worldRank;
+    double dIgnore;
+
+    MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Ny, Lx,Ly,localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+    int localNpts = localNx*localNy;
+
+    double* v = new double[localNpts];
+    double* s = new double[localNpts];
+    double* sFile = new double[localNpts];
+
+    {
+        LidDrivenCavity test;
+        test.SetDomainSize(Lx,Ly);
+        test.SetGridSize(Nx,Ny);
+        test.SetTimeStep(dt);
+        test.SetFinalTime(T);
+        test.SetReynoldsNumber(Re);
+        test.SetSnapshotOutput("testOutput.snap",2);                //snapshot every 2 steps
+        test.Initialise();
+
+        test.WriteSnapshot();                                       //step 0
+        test.Integrate();                                           //steps 2 and 4
+        test.WriteSnapshot();                                       //final step 5
+        test.WriteSnapshot();                                       //duplicate of step 5, should not be written
+        test.GetData(v,s);
+        test.WriteSolution("snapshotTestOutput");
+    }                                                               //snapshot file closed by destructor
+
+    SnapshotReader reader("testOutput.snap");
+    BOOST_REQUIRE(reader.IsValid());
+    BOOST_CHECK_EQUAL(reader.GetGlobalNx(),Nx);
+    BOOST_CHECK_EQUAL(reader.GetGlobalNy(),Ny);
+    BOOST_CHECK_EQUAL(reader.GetNumFields(),4);
+    BOOST_REQUIRE_EQUAL(reader.GetNumSnapshots(),4);
+    BOOST_CHECK_EQUAL(reader.GetStep(0),0);
+    BOOST_CHECK_EQUAL(reader.GetStep(1),2);
+    BOOST_CHECK_EQUAL(reader.GetStep(2),4);
+    BOOST_CHECK_EQUAL(reader.GetStep(3),5);
+    BOOST_CHECK_EQUAL(reader.FindTime(0.041),2);
+
+    //each process extracts its own block from the file, which must match its local data exactly
+    int sField = reader.FindField("s");
+    BOOST_REQUIRE(sField >= 0);
+    reader.ReadField(3,sField,xStart,yStart,localNx,localNy,sFile);
+    for(int i = 0; i < localNpts; ++i)
+        BOOST_CHECK_EQUAL(sFile[i],s[i]);
+
+    //horizontal velocity on the top lid is U = 1 at every snapshot
+    double uTop[Nx];
+    reader.ReadField(0,reader.FindField("u0"),0,Ny-1,Nx,1,uTop);
+    for(int i = 0; i < Nx; ++i)
+        BOOST_CHECK_CLOSE(uTop[i],1.0,1e-6);
+
+    //convert legacy text output and compare with snapshot, within precision of the text output
+    if(worldRank == 0) {
+        BOOST_REQUIRE(SnapshotWriter::ConvertText("snapshotTestOutput","testConvert.snap",5,0.05));
+        SnapshotReader converted("testConvert.snap");
+        BOOST_REQUIRE(converted.IsValid());
+        BOOST_CHECK_EQUAL(converted.GetGlobalNx(),Nx);
+        BOOST_CHECK_EQUAL(converted.GetGlobalNy(),Ny);
+        BOOST_REQUIRE_EQUAL(converted.GetNumSnapshots(),1);
+
+        double* global = new double[Nx*Ny];
+        double* globalConverted = new double[Nx*Ny];
+        for(int f = 0; f < 4; ++f) {
+            reader.ReadField(3,f,0,0,Nx,Ny,global);
+            converted.ReadField(0,converted.FindField(reader.GetFieldName(f)),0,0,Nx,Ny,globalConverted);
+            for(int i = 0; i < Nx*Ny; ++i)
+                BOOST_CHECK_SMALL(global[i] - globalConverted[i], 1e-5*(1.0 + std::fabs(global[i])));
+        }
+        delete[] global;
+        delete[] globalConverted;
+
+        //indices out of range are refused, a block table pointing past the file ends the index before that record
+        BOOST_CHECK(!reader.ReadField(4,0,0,0,Nx,Ny,uTop));
+        BOOST_CHECK(!reader.ReadField(0,4,0,0,Nx,Ny,uTop));
+        BOOST_CHECK_EQUAL(reader.GetStep(-1),-1);
+        BOOST_CHECK_EQUAL(reader.GetFieldName(8),"");
+        std::ifstream in("testOutput.snap", std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        long long last = bytes.size() - reinterpret_cast<const SnapshotRecordHeader*>(bytes.data() + sizeof(SnapshotFileHeader))->recordBytes;
+        reinterpret_cast<SnapshotBlockEntry*>(&bytes[last + sizeof(SnapshotRecordHeader)])->offset = bytes.size();
+        std::ofstream out("testCorrupt.snap", std::ios::binary);
+        out.write(bytes.data(), bytes.size());
+        out.close();
+        SnapshotReader corrupt("testCorrupt.snap");
+        BOOST_REQUIRE(corrupt.IsValid());
+        BOOST_CHECK_EQUAL(corrupt.GetNumSnapshots(),3);
+        std::remove("testCorrupt.snap");
+    }
+
+    delete[] v;
+    delete[] s;
+    delete[] sFile;
+}
+
+/**
+ * @brief Read a binary PPM image written by Renderer
+ * @param[in] file      Name of the image file
+ * @param[out] width    Width of the image in pixels
+ * @param[out] height   Height of the image in pixels
+ * @return RGB pixel data, 3 bytes per pixel row by row, empty if the header is invalid
+ */
+std::string ReadPPM(std::string file, int &width, int &height)
+{
+    std::ifstream f(file.c_str(), std::ios::binary);
+    std::string magic;
+    int maxval = 0;
+    f >> magic >> width >> height >> maxval;
+    f.get();                                                        //single whitespace after header
+    if((magic != "P6") || (maxval != 255))
+        return std::string();
+
+    std::string pixels(3*width*height, '\0');
+    f.read(&pixels[0], pixels.size());
+    return pixels;
+}
+
+/**
+ * @test Tests that LidDrivenCavity renders frames of the configured size every render interval, coloured once the lid moves
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Renderer_Render)
+{
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+
+    LidDrivenCavity test;
+    test.SetDomainSize(1.0,2.0);
+    test.SetGridSize(33,65);
+    test.SetTimeStep(0.005);
+    test.SetFinalTime(0.05);
+    test.SetReynoldsNumber(100);
+    test.SetRendering("testRender",10,40);                          //height follows from aspect ratio -> 80
+    test.Initialise();
+
+    test.RenderFrame();                                             //initial state at step 0
+    test.Integrate();                                               //renders step 10
+    test.RenderFrame();                                             //duplicate of step 10, should not be rendered again
+
+    if(worldRank == 0) {
+        int width, height;
+
+        //initial flow is at rest -> every pixel white and no contours, which also shows every pixel was composited exactly once
+        std::string initial = ReadPPM("testRender_000000.ppm",width,height);
+        BOOST_CHECK_EQUAL(width,40);
+        BOOST_CHECK_EQUAL(height,80);
+        BOOST_REQUIRE_EQUAL(initial.size(),(size_t) 3*40*80);
+        BOOST_CHECK_EQUAL(initial.find_first_not_of('\xff'),std::string::npos);
+
+        //moving lid induces vorticity, shown in colour, and a streamfunction, shown as black contours
+        std::string frame = ReadPPM("testRender_000010.ppm",width,height);
+        BOOST_REQUIRE_EQUAL(frame.size(),(size_t) 3*40*80);
+        int coloured = 0;
+        int black = 0;
+        for(int k = 0; k < 40*80; ++k) {
+            unsigned char r = frame[3*k], g = frame[3*k+1], b = frame[3*k+2];
+            if((r == 0) && (g == 0) && (b == 0))
+                black++;
+            else if((r != 255) || (g != 255) || (b != 255))
+                coloured++;
+        }
+        BOOST_CHECK(coloured > 0);
+        BOOST_CHECK(black > 0);
+
+        std::ifstream missing("testRender_000005.ppm");
+        BOOST_CHECK(!missing.is_open());                            //only every 10 steps
+    }
+}
+
+/**
+ * @test Tests that the MetricsServer endpoint answers an HTTP scrape with the published step and solver metrics
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(MetricsServer_Scrape)
+{
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+    if(worldRank != 0)                                              //endpoint only lives on root process
+        return;
+
+    MetricsServer server("unix:testMetrics.sock");
+    BOOST_REQUIRE(server.IsListening());
+
+    server.SetRun(0,100,0.01);
+    server.Update(4,10,2e-7);
+    server.Update(5,12,1e-7);
+
+    //scrape the endpoint like a client would
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, "testMetrics.sock");
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    BOOST_REQUIRE_EQUAL(connect(fd, (struct sockaddr*) &addr, sizeof(addr)),0);
+
+    std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    BOOST_REQUIRE_EQUAL(send(fd, request.c_str(), request.size(), 0),(ssize_t) request.size());
+
+    std::string response;
+    char buffer[1024];
+    ssize_t bytes;
+    while((bytes = recv(fd, buffer, sizeof(buffer), 0)) > 0)       //server closes connection after response
+        response.append(buffer, bytes);
+    close(fd);
+
+    BOOST_CHECK_EQUAL(response.compare(0, 15, "HTTP/1.0 200 OK"),0);
+    BOOST_CHECK(response.find("\nldc_step 5\n") != std::string::npos);
+    BOOST_CHECK(response.find("\nldc_steps_final 100\n") != std::string::npos);
+    BOOST_CHECK(response.find("\nldc_cg_iterations 12\n") != std::string::npos);
+    BOOST_CHECK(response.find("\nldc_cg_iterations_total 22\n") != std::string::npos);
+    BOOST_CHECK(response.find("\nldc_cg_residual 1e-07\n") != std::string::npos);
+    BOOST_CHECK(response.find("# TYPE ldc_eta_seconds gauge") != std::string::npos);
+}
+
+/**
+ * @test Tests that CostModel estimates the condition number, conjugate gradient iterations, halo data and memory of a run as derived
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(CostModel_Estimates)
+{
+    CostModel model(101,101,1.0,1.0,0.002,2.0);
+
+    //for a square grid the condition number tends to 4/(pi*h)^2
+    BOOST_CHECK_CLOSE(model.GetConditionNumber(), 4.0/(M_PI*0.01)/(M_PI*0.01), 1.0);
+    int iterations = model.EstimateIterations();
+    BOOST_CHECK(iterations > 230 && iterations < 300);          //SolverCG takes ~260 iterations per step for this grid at Re = 100
+
+    //looser tolerances of SolverCG take fewer iterations
+    CostModel loose(101,101,1.0,1.0,0.002,2.0);
+    loose.SetTolerance(1e-6, 1e-6);
+    BOOST_CHECK(loose.EstimateIterations() < iterations);
+    loose.SetTolerance(1e-6, 0.0, 0.1);
+    BOOST_CHECK(loose.EstimateIterations() < iterations/2);
+
+    //single process has no neighbours, two by two grid exchanges one row and one column per halo exchange
+    BOOST_CHECK_EQUAL(model.EstimateHaloBytes(1), 0);
+    BOOST_CHECK_EQUAL(model.EstimateHaloBytes(2), 8LL*(51 + 51)*(iterations + 3));
+    BOOST_CHECK_EQUAL(model.EstimateMemory(1), 8LL*(10*101*101 + 10*(101 + 101) + 2*4*8*(101 + 101)));
+    BOOST_CHECK(model.EstimateMemory(2) < model.EstimateMemory(1));
+
+    model.Calibrate(MPI_COMM_WORLD);
+    BOOST_CHECK(model.EstimateStepTime(1,1) > 0.0);
+    BOOST_CHECK_CLOSE(model.EstimateWallTime(1,1), 1000*model.EstimateStepTime(1,1), 1e-6);
+    BOOST_CHECK(model.EstimateStepTime(1,2) <= model.EstimateStepTime(1,1));
+}
+
+/**
+ * @test Tests that Parareal run to exactness with one time slice per process matches sequential time stepping
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Parareal_MatchesSequential)
+{
+    int worldRank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+    MPI_Comm_size(MPI_COMM_WORLD,&worldSize);
+
+    int    Nx   = 21;
+    int    Ny   = 21;
+    double dt   = 0.005;
+    double T    = 0.2;
+    double Re   = 100;
+
+    //one time slice per process, so each slice is solved by a single process on the whole grid
+    Parareal parareal(worldSize,MPI_COMM_WORLD);
+    parareal.SetDomainSize(1.0,1.0);
+    parareal.SetGridSize(Nx,Ny);
+    parareal.SetTimeStep(dt);
+    parareal.SetFinalTime(T);
+    parareal.SetReynoldsNumber(Re);
+    parareal.SetCoarseFactor(4);
+    parareal.SetTolerance(0.0);                                     //run to exactness, one iteration per slice
+    parareal.Initialise();
+    parareal.Run();
+
+    BOOST_CHECK_EQUAL(parareal.GetSlice(),worldRank);
+    BOOST_CHECK_EQUAL(parareal.GetIterations(),worldSize);
+    BOOST_CHECK(parareal.GetCoarseDt() > dt);
+    BOOST_REQUIRE_EQUAL(parareal.GetNpts(),Nx*Ny);
+
+    double* v = new double[Nx*Ny];
+    double* s = new double[Nx*Ny];
+    double* vRef = new double[Nx*Ny];
+    double* sRef = new double[Nx*Ny];
+    parareal.GetData(v,s);
+
+    //sequential time stepping to the end of the time slice of this process, with fine steps distributed as in Parareal
+    int NSteps = ceil(T/dt);
+    int endStep = 0;
+    for(int k = 0; k <= worldRank; ++k)
+        endStep += NSteps / worldSize + ((k < NSteps % worldSize) ? 1 : 0);
+
+    LidDrivenCavity reference(MPI_COMM_SELF);
+    reference.SetDomainSize(1.0,1.0);
+    reference.SetGridSize(Nx,Ny);
+    reference.SetTimeStep(dt);
+    reference.SetFinalTime(T);
+    reference.SetReynoldsNumber(Re);
+    reference.SetVerbose(false);
+    reference.Initialise();
+    reference.IntegrateTo(endStep);
+    reference.GetState(vRef,sRef);
+
+    //exact in exact arithmetic after one iteration per slice, and the same operations are performed
+    for(int i = 0; i < Nx*Ny; ++i) {
+        BOOST_CHECK_SMALL(v[i] - vRef[i], 1e-10);
+        BOOST_CHECK_SMALL(s[i] - sRef[i], 1e-10);
+    }
+
+    delete[] v;
+    delete[] s;
+    delete[] vRef;
+    delete[] sRef;
+}
+
+/**
+ * @test Tests that EnergyMeter sums package energy per phase from a fake powercap tree and appends it to a CSV file
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(EnergyMeter_Phases)
+{
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+    //fake powercap tree with one package zone and one sub zone, which must be ignored
+    const long long maxRange = 262143328850;
+    if(worldRank == 0) {
+        system("mkdir -p testPowercap/intel-rapl:0/intel-rapl:0:0 testPowercap/intel-rapl:0:0");
+        std::ofstream("testPowercap/intel-rapl:0/energy_uj") << 1000000;
+        std::ofstream("testPowercap/intel-rapl:0/max_energy_range_uj") << maxRange;
+        std::ofstream("testPowercap/intel-rapl:0:0/energy_uj") << 5000000;
+        std::ofstream("testPowercap/intel-rapl:0:0/max_energy_range_uj") << maxRange;
+        std::remove("testEnergy.csv");
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    EnergyMeter meter(MPI_COMM_WORLD, "testPowercap");
+    BOOST_CHECK_EQUAL(meter.GetNumZones(), (worldRank == 0) ? 1 : 0);
+
+    //2 J over a solve of 10 iterations
+    meter.Start(EnergyMeter::Solve);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if(worldRank == 0)
+        std::ofstream("testPowercap/intel-rapl:0/energy_uj") << 3000000;
+    meter.Stop(EnergyMeter::Solve, 10);
+
+    BOOST_CHECK_EQUAL(meter.GetUnits(EnergyMeter::Solve), 10);
+    BOOST_CHECK_CLOSE(meter.GetEnergy(EnergyMeter::Solve), (worldRank == 0) ? 2.0 : 0.0, 1e-9);
+    BOOST_CHECK(meter.GetTime(EnergyMeter::Solve) >= 0.0);
+
+    //counter wraps around from 100 below its maximum to 400, which is 500 uJ
+    if(worldRank == 0)
+        std::ofstream("testPowercap/intel-rapl:0/energy_uj") << maxRange - 100;
+    meter.Start(EnergyMeter::IO);
+    if(worldRank == 0)
+        std::ofstream("testPowercap/intel-rapl:0/energy_uj") << 400;
+    meter.Stop(EnergyMeter::IO);
+
+    BOOST_CHECK_CLOSE(meter.GetEnergy(EnergyMeter::IO), (worldRank == 0) ? 500e-6 : 0.0, 1e-9);
+    BOOST_CHECK_EQUAL(meter.GetUnits(EnergyMeter::Integrate), 0);
+
+    meter.Report("test", "testEnergy.csv");
+    if(worldRank == 0) {
+        std::ifstream csv("testEnergy.csv");
+        std::string header, line;
+        std::getline(csv, header);
+        std::getline(csv, line);
+        BOOST_CHECK_EQUAL(header.substr(0, 14), "configuration,");
+        BOOST_CHECK_EQUAL(line.substr(0, 13), "test,1,Solve,");
+    }
+}
+
+/**
+ * @brief Busy loop for the profiler to sample, not inlined so it appears as a frame
+ *********************************************************************************************************************/
+__attribute__((noinline)) double ProfilerTestSpin(double seconds)
+{
+    double sum = 0.0;
+    std::clock_t start = std::clock();
+    while(double(std::clock() - start) / CLOCKS_PER_SEC < seconds)
+        for(int i = 0; i < 1000; ++i)
+            sum += sqrt(double(i) + sum);
+    return sum;
+}
+
+/**
+ * @test Tests that Profiler samples a busy loop at about the requested frequency and writes the samples as folded stacks
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Profiler_Samples)
+{
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+    std::string file = "testProfile." + std::to_string(worldRank) + ".folded";
+
+    //0.2 s of CPU time at 500 Hz gives about 100 samples
+    Profiler profiler(500);
+    profiler.Start();
+    volatile double sum = ProfilerTestSpin(0.2);
+    (void) sum;
+    profiler.Stop();
+
+    BOOST_CHECK(profiler.GetNumSamples() > 20);
+    BOOST_CHECK_EQUAL(profiler.GetDropped(), 0);
+
+    //folded stacks name the sampled function and hold every sample
+    profiler.WriteFolded(file);
+    std::ifstream f(file.c_str());
+    std::string line;
+    int total = 0, spin = 0;
+    while(std::getline(f, line)) {
+        size_t space = line.rfind(' ');
+        BOOST_REQUIRE(space != std::string::npos);
+        int count = std::stoi(line.substr(space + 1));
+        total += count;
+        if(line.find("ProfilerTestSpin") != std::string::npos)
+            spin += count;
+    }
+    BOOST_CHECK_EQUAL(total, profiler.GetNumSamples());
+    BOOST_CHECK(spin > total / 2);
+}
+
+/**
+ * @test Tests that time integration and the Poisson solver do not allocate after the first time step, and that initialising again
+ * reuses the existing arrays with the same result
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(AllocTracker_HotPathAllocationFree)
+{
+    const int Nx = 31;
+    const int Ny = 31;
+
+    LidDrivenCavity solver;
+    solver.SetDomainSize(1.0,1.0);
+    solver.SetGridSize(Nx,Ny);
+    solver.SetTimeStep(0.005);
+    solver.SetFinalTime(0.1);
+    solver.SetReynoldsNumber(100);
+    solver.SetVerbose(false);
+    solver.Initialise();
+
+    //tracker is linked in and counts
+    AllocTracker::Start();
+    double* volatile probe = new double[4];
+    delete[] probe;
+    void* volatile cProbe = malloc(16);
+    free(cProbe);
+    BOOST_REQUIRE_EQUAL(AllocTracker::Stop(), 2);
+
+    //first step warms up the MPI library and the OpenMP thread pool
+    solver.IntegrateTo(1);
+
+    AllocTracker::Start();
+    solver.IntegrateTo(10);
+    BOOST_CHECK_EQUAL(AllocTracker::Stop(), 0);
+
+    int n = solver.GetNpts();
+    double* v = new double[n];
+    double* s = new double[n];
+    double* vRepeat = new double[n];
+    double* sRepeat = new double[n];
+    solver.GetState(v,s);
+
+    //a second run of the same problem starts from zeroed arrays without reallocating them
+    AllocTracker::Start();
+    solver.Initialise();
+    BOOST_CHECK_EQUAL(AllocTracker::Stop(), 0);
+
+    solver.IntegrateTo(10);
+    solver.GetState(vRepeat,sRepeat);
+    for(int i = 0; i < n; ++i) {
+        BOOST_CHECK_EQUAL(v[i], vRepeat[i]);
+        BOOST_CHECK_EQUAL(s[i], sRepeat[i]);
+    }
+
+    //the Poisson solver on its own
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double localLx,localLy;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid,Nx,Ny,1.0,1.0,localNx,localNy,localLx,localLy,xStart,yStart);
+
+    double* b = new double[localNx*localNy];
+    double* x = new double[localNx*localNy]();
+    for(int i = 0; i < localNx; ++i)
+        for(int j = 0; j < localNy; ++j)
+            b[IDX(i,j)] = sin(M_PI * (i + xStart) / (Nx - 1)) * sin(M_PI * (j + yStart) / (Ny - 1));
+
+    SolverCG cg(localNx,localNy,1.0/(Nx - 1),1.0/(Ny - 1),row,col);
+    cg.SetVerbose(false);
+    cg.Solve(b,x);
+
+    AllocTracker::Start();
+    std::fill(x, x + localNx*localNy, 0.0);
+    cg.Solve(b,x);
+    BOOST_CHECK_EQUAL(AllocTracker::Stop(), 0);
+    BOOST_CHECK(cg.GetIterations() > 0);
+
+    //the other Poisson solver backends, where they apply to the grid and the processes
+    std::string backends[3] = {"pcg-agglomerated", "schur", "pcg-tiled"};
+    for(const std::string& name : backends) {
+        LidDrivenCavity backend;
+        backend.SetDomainSize(1.0,1.0);
+        backend.SetGridSize(Nx,Ny);
+        backend.SetTimeStep(0.005);
+        backend.SetFinalTime(0.1);
+        backend.SetReynoldsNumber(100);
+        backend.SetVerbose(false);
+        backend.SetPoissonSolver(name);
+        backend.SetAgglomeration(Nx*Ny);                                            //whole grid on one process if there are several
+        backend.Initialise();
+        if(backend.GetPoissonSolver() != name)
+            continue;
+        backend.IntegrateTo(1);
+
+        AllocTracker::Start();
+        backend.IntegrateTo(10);
+        long allocations = AllocTracker::Stop();
+        BOOST_CHECK_MESSAGE(allocations == 0, name << " allocates " << allocations << " times in 9 time steps");
+    }
+
+    //implicit time stepping, whose Newton-Krylov work space is allocated at the first step
+    LidDrivenCavity implicit;
+    implicit.SetDomainSize(1.0,1.0);
+    implicit.SetGridSize(Nx,Ny);
+    implicit.SetTimeStep(0.005);
+    implicit.SetFinalTime(0.1);
+    implicit.SetReynoldsNumber(100);
+    implicit.SetVerbose(false);
+    implicit.SetImplicit(0.5);
+    implicit.Initialise();
+    implicit.IntegrateTo(1);
+
+    AllocTracker::Start();
+    implicit.IntegrateTo(10);
+    BOOST_CHECK_EQUAL(AllocTracker::Stop(), 0);
+
+    //tracers and the decomposition of the vorticity, updated every fourth step, only write on request
+    LidDrivenCavity analysed;
+    analysed.SetDomainSize(1.0,1.0);
+    analysed.SetGridSize(Nx,Ny);
+    analysed.SetTimeStep(0.005);
+    analysed.SetFinalTime(0.1);
+    analysed.SetReynoldsNumber(100);
+    analysed.SetVerbose(false);
+    analysed.SetTracers(1000,"testAllocTracers",0);
+    analysed.SetPOD(4,"testAllocPOD.bin",1,0);
+    analysed.Initialise();
+    analysed.IntegrateTo(4);
+
+    AllocTracker::Start();
+    analysed.IntegrateTo(16);
+    BOOST_CHECK_EQUAL(AllocTracker::Stop(), 0);
+    BOOST_CHECK_EQUAL(analysed.GetPOD()->GetSnapshots(), 16);
+
+    delete[] v;
+    delete[] s;
+    delete[] vRepeat;
+    delete[] sRepeat;
+    delete[] b;
+    delete[] x;
+}
+
+/**
+ * @test Tests that Richardson extrapolation from 9 x 9 and 17 x 17 grids is closer to a 33 x 33 reference solution than the 17 x 17
+ * solution, and that the error estimate is consistent with the actual error
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Richardson_Extrapolation)
+{
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
+
+    const int N = 9;
+    const double dt = 0.002;                            //satisfies the time-step restriction of the reference grid
+    const double T = 0.1;
+    const double Re = 10;
+
+    Richardson extrapolation(false,MPI_COMM_WORLD);
+    extrapolation.SetDomainSize(1.0,1.0);
+    extrapolation.SetGridSize(N,N);
+    extrapolation.SetTimeStep(dt);
+    extrapolation.SetFinalTime(T);
+    extrapolation.SetReynoldsNumber(Re);
+    extrapolation.Initialise();
+    extrapolation.Run();
+
+    //fine grid and reference grid with a quarter of the spacing, solved separately
+    int fineN = 2*N - 1;
+    int refN = 4*N - 3;
+    double* fine[4];
+    double* ref[4];
+    for(int f = 0; f < 4; ++f) {
+        fine[f] = new double[fineN*fineN];
+        ref[f] = new double[refN*refN];
+    }
+
+    LidDrivenCavity fineSolver;
+    LidDrivenCavity refSolver;
+    LidDrivenCavity* solvers[2] = {&fineSolver, &refSolver};
+    int sizes[2] = {fineN, refN};
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->SetDomainSize(1.0,1.0);
+        solvers[k]->SetGridSize(sizes[k],sizes[k]);
+        solvers[k]->SetTimeStep(dt);
+        solvers[k]->SetFinalTime(T);
+        solvers[k]->SetReynoldsNumber(Re);
+        solvers[k]->SetVerbose(false);
+        solvers[k]->Initialise();
+        solvers[k]->Integrate();
+    }
+    fineSolver.GatherSolution(fine[0],fine[1],fine[2],fine[3]);
+    refSolver.GatherSolution(ref[0],ref[1],ref[2],ref[3]);
+
+    if(worldRank == 0) {
+        double* result = new double[N*N];
+        for(int f = 0; f < 4; ++f) {
+            extrapolation.GetExtrapolated(f,result);
+
+            double fineError = 0.0;
+            double resultError = 0.0;
+            double actual = 0.0;
+            for(int j = 0; j < N; ++j) {
+                for(int i = 0; i < N; ++i) {
+                    double r = ref[f][4*j*refN + 4*i];
+                    double h = fine[f][2*j*fineN + 2*i];
+                    fineError += (h - r) * (h - r);
+                    resultError += (result[j*N + i] - r) * (result[j*N + i] - r);
+                    actual = std::max(actual, fabs(h - r));
+                }
+            }
+            BOOST_CHECK(resultError < fineError);
+
+            //estimate of the fine grid error is of the order of the actual error
+            BOOST_CHECK(extrapolation.GetErrorEstimate(f) > 0.25 * actual);
+            BOOST_CHECK(extrapolation.GetErrorEstimate(f) < 4.0 * actual);
+        }
+        delete[] result;
+    }
+
+    for(int f = 0; f < 4; ++f) {
+        delete[] fine[f];
+        delete[] ref[f];
+    }
+}
+
+/**
+ * @test Tests that the Poisson solve agglomerated onto fewer processes gives the same solution as the solve on all processes
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Agglomeration_MatchesDistributedSolve)
+{
+    int worldSize;
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+    int p = round(sqrt(worldSize));
+
+    BOOST_CHECK_EQUAL(Agglomeration::ChooseGridSize(10000, 4, 0), 4);
+    BOOST_CHECK_EQUAL(Agglomeration::ChooseGridSize(10000, 4, 625), 4);
+    BOOST_CHECK_EQUAL(Agglomeration::ChooseGridSize(10000, 4, 626), 3);
+    BOOST_CHECK_EQUAL(Agglomeration::ChooseGridSize(10000, 4, 100000), 1);
+
+    //agglomerated onto 1 x 1 processes if minimum exceeds the global grid points, otherwise never
+    const int Nx = 21;
+    const int Ny = 17;
+    LidDrivenCavity distributed;
+    LidDrivenCavity agglomerated;
+    LidDrivenCavity* solvers[2] = {&distributed, &agglomerated};
+    int minPoints[2] = {0, Nx*Ny + 1};
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->SetDomainSize(1.0,1.0);
+        solvers[k]->SetGridSize(Nx,Ny);
+        solvers[k]->SetTimeStep(0.005);
+        solvers[k]->SetFinalTime(0.05);
+        solvers[k]->SetReynoldsNumber(100);
+        solvers[k]->SetVerbose(false);
+        solvers[k]->SetAgglomeration(minPoints[k]);
+        solvers[k]->Initialise();
+        solvers[k]->Integrate();
+    }
+    BOOST_CHECK(!distributed.IsAgglomerated());
+    BOOST_CHECK_EQUAL(agglomerated.IsAgglomerated(), p > 1);
+
+    int n = distributed.GetNpts();
+    double* v = new double[n];
+    double* s = new double[n];
+    double* vAgg = new double[n];
+    double* sAgg = new double[n];
+    distributed.GetState(v,s);
+    agglomerated.GetState(vAgg,sAgg);
+
+    //only the order of the global sums of the conjugate gradient method differs
+    for(int i = 0; i < n; ++i) {
+        BOOST_CHECK_SMALL(v[i] - vAgg[i], 1e-8);
+        BOOST_CHECK_SMALL(s[i] - sAgg[i], 1e-8);
+    }
+
+    delete[] v;
+    delete[] s;
+    delete[] vAgg;
+    delete[] sAgg;
+}
+
+/**
+ * @test Tests that solving from the fused residual gives the same time steps and output as the separate residual
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(FusedResidual_MatchesSolve)
+{
+    //uneven grid, so local domains differ in size when distributed
+    const int Nx = 23;
+    const int Ny = 19;
+    LidDrivenCavity fused;
+    LidDrivenCavity unfused;
+    LidDrivenCavity* solvers[2] = {&fused, &unfused};
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->SetDomainSize(1.0,1.0);
+        solvers[k]->SetGridSize(Nx,Ny);
+        solvers[k]->SetTimeStep(0.005);
+        solvers[k]->SetFinalTime(0.1);
+        solvers[k]->SetReynoldsNumber(100);
+        solvers[k]->SetVerbose(false);
+        solvers[k]->SetAgglomeration(0);
+        solvers[k]->SetFusedResidual(k == 0);
+        solvers[k]->Initialise();
+        solvers[k]->Integrate();
+    }
+
+    int n = fused.GetNpts();
+    double* v = new double[n];
+    double* s = new double[n];
+    double* vUnfused = new double[n];
+    double* sUnfused = new double[n];
+    fused.GetState(v,s);
+    unfused.GetState(vUnfused,sUnfused);
+
+    //initial residuals differ only in the summation order of A s
+    for(int i = 0; i < n; ++i) {
+        BOOST_CHECK_SMALL(v[i] - vUnfused[i], 1e-10);
+        BOOST_CHECK_SMALL(s[i] - sUnfused[i], 1e-10);
+    }
+
+    delete[] v;
+    delete[] s;
+    delete[] vUnfused;
+    delete[] sUnfused;
+}
+
+/**
+ * @test Test that LidDrivenCavity::WriteSolution writes the same file for any chunk size, including chunks that do not divide the
+ * local columns and a single chunk of all columns
+ *******************************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(WriteSolution_Chunks)
+{
+    int worldRank;
+    MPI_Comm_rank(MPI_COMM_WORLD,&worldRank);
+
+    LidDrivenCavity test;
+    test.SetDomainSize(1.0,1.0);
+    test.SetGridSize(23,19);
+    test.SetTimeStep(0.005);
+    test.SetFinalTime(0.02);
+    test.SetReynoldsNumber(100);
+    test.SetVerbose(false);
+    test.Initialise();
+    test.Integrate();
+
+    const int chunks[3] = {23, 1, 3};
+    std::string contents[3];
+    for(int k = 0; k < 3; ++k) {
+        test.SetOutputChunk(chunks[k]);
+        test.WriteSolution("testOutput");
+        if(worldRank == 0) {
+            std::ifstream f("testOutput");
+            std::stringstream buffer;
+            buffer << f.rdbuf();
+            contents[k] = buffer.str();
+        }
+    }
+
+    //23 columns with one line each per grid point and an empty line after each column
+    if(worldRank == 0) {
+        BOOST_CHECK_EQUAL(std::count(contents[0].begin(),contents[0].end(),'\n'),23*19 + 23);
+        BOOST_CHECK(contents[1] == contents[0]);
+        BOOST_CHECK(contents[2] == contents[0]);
+    }
+}
+
+/**
+ * @test Tests that Tracers are advected across local domains without loss or duplication, sorted by cell and written to one file
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Tracers_AdvectMigrateWrite)
+{
+    const int Nx = 21;
+    const int Ny = 17;
+    const double Lx = 1.0;
+    const double Ly = 1.0;
+    const double dx = Lx/(Nx-1);
+    const double dy = Ly/(Ny-1);
+    const long long n = 5000;
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double localLx,localLy;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid,Nx,Ny,Lx,Ly,localNx,localNy,localLx,localLy,xStart,yStart);
+
+    //uniform velocity is interpolated exactly, and moves tracers across several local domains per step
+    int localNpts = localNx*localNy;
+    double* u0 = new double[localNpts];
+    double* u1 = new double[localNpts];
+    std::fill(u0, u0 + localNpts, 0.3);
+    std::fill(u1, u1 + localNpts, -0.2);
+    const double dt = 0.7;
+    const int steps = 3;
+
+    Tracers tracers(n,Nx,Ny,dx,dy,xStart,yStart,localNx,localNy,row,col);
+    tracers.SetSortInterval(2);
+    for(int k = 0; k < steps; ++k)
+        tracers.Advect(u0, u1, dt);
+
+    //no tracer is lost or duplicated
+    long long local = tracers.GetLocalCount();
+    long long total = 0;
+    long long idSum = 0;
+    const long long* ids = tracers.GetIds();
+    for(long long k = 0; k < local; ++k)
+        idSum += ids[k];
+    MPI_Allreduce(MPI_IN_PLACE, &idSum, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&local, &total, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    BOOST_CHECK_EQUAL(total, n);
+    BOOST_CHECK_EQUAL(idSum, n*(n-1)/2);
+
+    //tracers end up on the process owning their cell, at the seeded position moved by the velocity and stopped by the walls
+    tracers.Sort();
+    const double* x = tracers.GetX();
+    const double* y = tracers.GetY();
+    const double g = 1.32471795724474602596;
+    int previousCell = -1;
+    for(long long k = 0; k < local; ++k) {
+        double x0 = fmod(0.5 + ids[k]/g, 1.0) * Lx;
+        double y0 = fmod(0.5 + ids[k]/(g*g), 1.0) * Ly;
+        BOOST_CHECK_SMALL(x[k] - std::min(x0 + steps*dt*0.3, Lx), 1e-12);
+        BOOST_CHECK_SMALL(y[k] - std::max(y0 - steps*dt*0.2, 0.0), 1e-12);
+
+        int i = std::min((int) floor(x[k]/dx), Nx-2) - xStart;
+        int j = std::min((int) floor(y[k]/dy), Ny-2) - yStart;
+        BOOST_CHECK((i >= 0) && (i < localNx) && (j >= 0) && (j < localNy));
+        BOOST_CHECK(j*localNx + i >= previousCell);                 //sorted by cell
+        previousCell = j*localNx + i;
+    }
+
+    //every process finds its own tracers in the file
+    tracers.Write("testTracers.part", steps, steps*dt, grid);
+    std::ifstream f("testTracers.part", std::ios::binary);
+    TracerFileHeader header;
+    f.read((char*) &header, sizeof(header));
+    BOOST_CHECK_EQUAL(std::string(header.magic, 8), "LDCPART1");
+    BOOST_CHECK_EQUAL(header.step, steps);
+    BOOST_CHECK_EQUAL(header.count, n);
+    long long* fileIds = new long long[n];
+    double* fileX = new double[n];
+    double* fileY = new double[n];
+    f.read((char*) fileIds, n*sizeof(long long));
+    f.read((char*) fileX, n*sizeof(double));
+    f.read((char*) fileY, n*sizeof(double));
+    BOOST_CHECK(f.good());
+    f.close();
+
+    double* xById = new double[n];
+    double* yById = new double[n];
+    for(long long k = 0; k < n; ++k) {
+        xById[fileIds[k]] = fileX[k];
+        yById[fileIds[k]] = fileY[k];
+    }
+    for(long long k = 0; k < local; ++k) {
+        BOOST_CHECK_EQUAL(xById[ids[k]], x[k]);
+        BOOST_CHECK_EQUAL(yById[ids[k]], y[k]);
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if(rank == 0)
+        remove("testTracers.part");
+
+    delete[] u0;
+    delete[] u1;
+    delete[] fileIds;
+    delete[] fileX;
+    delete[] fileY;
+    delete[] xById;
+    delete[] yById;
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+    MPI_Comm_free(&grid);
+}
+
+/**
+ * @test Tests that CavityBenchmark measures the error of the centre-line velocities against the data of Ghia, Ghia & Shin (1982)
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(CavityBenchmark_GhiaReference)
+{
+    std::string refData = "test/GhiaRefData";                  //make is run from root, so file path relative to root
+    CavityBenchmark benchmark(MPI_COMM_WORLD);
+    BOOST_CHECK(!benchmark.LoadReference("test/noSuchFile", 100));
+    BOOST_CHECK(!benchmark.LoadReference(refData, 123));
+    BOOST_REQUIRE(benchmark.LoadReference(refData, 1000));
+    BOOST_REQUIRE(benchmark.LoadReference(refData, 100));
+
+    //fluid at rest misses the lid velocity at the top of the vertical centre line
+    const int N = 17;
+    double* u0 = new double[N*N]();
+    double* u1 = new double[N*N]();
+    BOOST_CHECK_CLOSE(benchmark.ProfileError(u0, u1, N, N), 1.0, 1e-12);
+    delete[] u0;
+    delete[] u1;
+
+    //coarse grid reaches steady state close to the reference, and stays within the tolerance from some time on
+    benchmark.SetTolerance(0.15);
+    benchmark.SetMaxTime(30.0);
+    BenchmarkResult result = benchmark.Run(N, "pcg-fused", 0.9);
+    BOOST_CHECK(!result.diverged);
+    BOOST_CHECK_GT(result.steadyTime, 0.0);
+    BOOST_CHECK_LT(result.error, 0.15);
+    BOOST_CHECK_GT(result.timeToTolerance, 0.0);
+    BOOST_CHECK_LE(result.timeToTolerance, result.steadyTime);
+    BOOST_CHECK_LE(result.wallToTolerance, result.wallTime);
+    BOOST_CHECK_CLOSE(result.dt, 0.9*CavityBenchmark::StableTimeStep(N, 100), 1e-12);
+    BOOST_CHECK_EQUAL(result.steps, (int) round(result.steadyTime/result.dt));
+}
+
+/**
+ * @test Tests that the openmp and blas backends of VectorOps are selected by name and give the same results
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(VectorOps_Backends)
+{
+    VectorOps::Backend initial = VectorOps::GetBackend();
+    BOOST_CHECK(!VectorOps::SetBackend("cuda"));
+    BOOST_CHECK(VectorOps::GetBackend() == initial);
+
+    //long enough for the in-tree backend to use all threads, and not a multiple of the SIMD width
+    const int n = 20003;
+    double* x = new double[n];
+    double* y[2] = {new double[n], new double[n]};
+    double results[2][2];
+    for(int i = 0; i < n; ++i)
+        x[i] = sin(0.01*i);
+
+    const char* names[2] = {"openmp", "blas"};
+    for(int k = 0; k < 2; ++k) {
+        BOOST_REQUIRE(VectorOps::SetBackend(names[k]));
+        BOOST_CHECK_EQUAL(VectorOps::GetBackendName(), names[k]);
+
+        VectorOps::Zero(n, y[k]);
+        VectorOps::Axpy(n, 2.0, x, y[k]);                       //y = 2x
+        VectorOps::Xpay(n, x, -0.5, y[k]);                      //y = x - x = 0
+        VectorOps::Axpy(n, 3.0, x, y[k]);                       //y = 3x
+        results[k][0] = VectorOps::Dot(n, x, y[k]);
+        results[k][1] = VectorOps::Nrm2(n, y[k]);
+    }
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(y[0][i], 3.0*x[i]);
+    VectorOps::Copy(n, x, y[1]);
+
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(y[1][i], x[i]);
+    BOOST_CHECK_CLOSE(results[0][0], results[1][0], 1e-10);
+    BOOST_CHECK_CLOSE(results[0][1], results[1][1], 1e-10);
+    BOOST_CHECK_CLOSE(results[0][1]*results[0][1], 3.0*results[0][0], 1e-10);
+
+    //both backends take the same number of CG iterations to the same solution
+    LidDrivenCavity cavities[2];
+    for(int k = 0; k < 2; ++k) {
+        VectorOps::SetBackend(names[k]);
+        cavities[k].SetDomainSize(1.0,1.0);
+        cavities[k].SetGridSize(41,41);
+        cavities[k].SetTimeStep(0.005);
+        cavities[k].SetFinalTime(0.05);
+        cavities[k].SetReynoldsNumber(100);
+        cavities[k].SetVerbose(false);
+        cavities[k].Initialise();
+        cavities[k].Integrate();
+    }
+    VectorOps::SetBackend(initial);
+
+    int npts = cavities[0].GetNpts();
+    double* v[2] = {new double[npts], new double[npts]};
+    double* s[2] = {new double[npts], new double[npts]};
+    for(int k = 0; k < 2; ++k)
+        cavities[k].GetState(v[k], s[k]);
+    for(int i = 0; i < npts; ++i) {
+        BOOST_CHECK_SMALL(v[0][i] - v[1][i], 1e-9);
+        BOOST_CHECK_SMALL(s[0][i] - s[1][i], 1e-9);
+    }
+
+    delete[] x;
+    for(int k = 0; k < 2; ++k) {
+        delete[] y[k];
+        delete[] v[k];
+        delete[] s[k];
+    }
+}
+
+/**
+ * @test Tests that SolverCG stops at the loosest of its tolerances, and that looser tolerances take fewer iterations
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(SolverCG_AdaptiveTolerance)
+{
+    const int Nx = 101;
+    const int Ny = 101;
+    const double Lx = 1.0;
+    const double Ly = 1.0;
+    double dx = Lx/(Nx - 1);
+    double dy = Ly/(Ny - 1);
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double dIgnore;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Ny, Lx,Ly,localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+
+    int n = localNx*localNy;
+    double* b = new double[n];
+    double* x = new double[n];
+    for (int i = 0; i < localNx; ++i)
+        for (int j = 0; j < localNy; ++j)
+            b[IDX(i,j)] = sin(M_PI*(i + xStart)*dx) * sin(2.0*M_PI*(j + yStart)*dy) + 0.5*sin(7.0*M_PI*(i + xStart)*dx);
+
+    double e = cblas_ddot(n, b, 1, b, 1);
+    double bNorm;
+    MPI_Allreduce(&e, &bNorm, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    bNorm = sqrt(bNorm);
+
+    //fixed absolute tolerance, relative to b, and relative to the initial residual, which is b for a zero initial guess
+    double tolerances[3][3] = {{1e-6, 0.0, 0.0}, {1e-6, 1e-4, 0.0}, {1e-6, 0.0, 1e-3}};
+    int iterations[3];
+    for(int k = 0; k < 3; ++k) {
+        SolverCG solver(localNx,localNy,dx,dy,row,col);
+        solver.SetVerbose(false);
+        solver.SetTolerance(tolerances[k][0], tolerances[k][1], tolerances[k][2]);
+        std::fill(x, x+n, 0.0);
+        solver.Solve(b, x);
+        iterations[k] = solver.GetIterations();
+        BOOST_CHECK_LT(solver.GetResidual(), std::max(tolerances[k][0], std::max(tolerances[k][1], tolerances[k][2])*bNorm));
+    }
+    BOOST_CHECK_LT(iterations[1], iterations[0]);
+    BOOST_CHECK_LT(iterations[2], iterations[0]);
+
+    //relative bound below the absolute one has no effect
+    SolverCG solver(localNx,localNy,dx,dy,row,col);
+    solver.SetVerbose(false);
+    solver.SetTolerance(1e-6, 1e-12, 1e-12);
+    std::fill(x, x+n, 0.0);
+    solver.Solve(b, x);
+    BOOST_CHECK_EQUAL(solver.GetIterations(), iterations[0]);
+
+    delete[] b;
+    delete[] x;
+}
+
+//custom backend for the registry test, the same solver under another name
+static PoissonSolver* CreateCustomPoisson(const PoissonProblem& problem)
+{
+    MPI_Comm row = problem.rowGrid;
+    MPI_Comm col = problem.colGrid;
+    return new SolverCG(problem.Nx, problem.Ny, problem.dx, problem.dy, row, col, problem.cartGrid);
+}
+
+/**
+ * @test Tests that the PoissonSolver registry creates, recommends and registers backends that all solve to the tolerance
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(PoissonSolver_Registry)
+{
+    const int Nx = 41;
+    const int Ny = 41;
+    double dx = 1.0/(Nx - 1);
+    double dy = 1.0/(Ny - 1);
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int p = round(sqrt(size));
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double dIgnore;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Ny, 1.0, 1.0, localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+    PoissonProblem problem = {localNx, localNy, dx, dy, xStart, yStart, Nx, Ny, 0, grid, row, col};
+
+    std::vector<std::string> names = PoissonSolver::GetNames();
+    BOOST_REQUIRE_GE(names.size(), 2u);
+    BOOST_CHECK_EQUAL(names[0], "pcg");
+    BOOST_CHECK_EQUAL(names[1], "pcg-agglomerated");
+    BOOST_CHECK(PoissonSolver::Create("unknown", problem) == nullptr);
+
+    //agglomeration only applies below the minimum number of points per process
+    BOOST_CHECK_EQUAL(PoissonSolver::Recommend(problem), "pcg");
+    BOOST_CHECK(PoissonSolver::Create("pcg-agglomerated", problem) == nullptr);
+    problem.minPoints = Nx*Ny + 1;
+    BOOST_CHECK_EQUAL(PoissonSolver::Recommend(problem), (p > 1) ? "pcg-agglomerated" : "pcg");
+
+    int n = localNx*localNy;
+    double* b = new double[n];
+    double* x = new double[n];
+    double* xRef = new double[n];
+    for (int i = 0; i < localNx; ++i)
+        for (int j = 0; j < localNy; ++j)
+            b[IDX(i,j)] = sin(M_PI*(i + xStart)*dx) * sin(2.0*M_PI*(j + yStart)*dy);
+
+    SolverCG reference(localNx,localNy,dx,dy,row,col,grid);
+    reference.SetVerbose(false);
+    std::fill(xRef, xRef+n, 0.0);
+    reference.Solve(b, xRef);
+
+    //every backend reaches the tolerance through the interface, and reports its cost
+    PoissonSolver::Register("custom", CreateCustomPoisson);
+    BOOST_CHECK_EQUAL(PoissonSolver::GetNames().size(), names.size() + 1);
+    for(std::string name : PoissonSolver::GetNames()) {
+        PoissonSolver* solver = PoissonSolver::Create(name, problem);
+        if(!solver)
+            continue;
+        solver->SetVerbose(false);
+        solver->SetTolerance(1e-6, 0.0, 0.0);
+        std::fill(x, x+n, 0.0);
+        solver->Solve(b, x);
+        BOOST_CHECK_GT(solver->GetIterations(), 0);
+        BOOST_CHECK_LT(solver->GetResidual(), 1e-6);
+        BOOST_CHECK_GE(solver->GetSolveTime(), 0.0);
+        for(int i = 0; i < n; ++i)
+            BOOST_CHECK_SMALL(x[i] - xRef[i], 1e-6);
+        delete solver;
+    }
+
+    //measured selection is one of the applicable backends, agreed by all processes
+    std::string measured;
+    PoissonSolver* fastest = PoissonSolver::Measure(problem, 1e-6, measured, false);
+    BOOST_REQUIRE(fastest != nullptr);
+    names = PoissonSolver::GetNames();
+    BOOST_CHECK(std::find(names.begin(), names.end(), measured) != names.end());
+    BOOST_CHECK_EQUAL(fastest->GetIterations(), 0);
+    int length = measured.size();
+    int maxLength;
+    MPI_Allreduce(&length, &maxLength, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    BOOST_CHECK_EQUAL(length, maxLength);
+    delete fastest;
+
+    LidDrivenCavity cavity;
+    BOOST_CHECK(!cavity.SetPoissonSolver("unknown"));
+    BOOST_CHECK(cavity.SetPoissonSolver("measure"));
+    cavity.SetDomainSize(1.0,1.0);
+    cavity.SetGridSize(Nx,Ny);
+    cavity.SetTimeStep(0.005);
+    cavity.SetFinalTime(0.02);
+    cavity.SetReynoldsNumber(100);
+    cavity.SetVerbose(false);
+    cavity.Initialise();
+    BOOST_CHECK(!cavity.GetPoissonSolver().empty());
+    cavity.Integrate();
+
+    //a backend that does not apply falls back to the solver on all processes
+    cavity.SetAgglomeration(0);
+    BOOST_CHECK(cavity.SetPoissonSolver("pcg-agglomerated"));
+    cavity.Initialise();
+    BOOST_CHECK_EQUAL(cavity.GetPoissonSolver(), "pcg");
+    BOOST_CHECK(!cavity.IsAgglomerated());
+
+    delete[] b;
+    delete[] x;
+    delete[] xRef;
+    MPI_Comm_free(&grid);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+}
+
+/**
+ * @test Tests that SolverSchur solves in one direct solve with reused factors, matching the conjugate gradient solver
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(SolverSchur_Direct)
+{
+    const int Nx = 41;
+    const int Ny = 37;
+    double dx = 1.0/(Nx - 1);
+    double dy = 1.5/(Ny - 1);
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    int p = round(sqrt(size));
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double dIgnore;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Ny, 1.0, 1.5, localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+    PoissonProblem problem = {localNx, localNy, dx, dy, xStart, yStart, Nx, Ny, 0, grid, row, col};
+
+    //separator columns and rows of the process grid, each crossing counted once
+    SolverSchur schur(problem);
+    BOOST_REQUIRE(schur.IsFactored());
+    BOOST_CHECK_EQUAL(schur.GetInterfaceSize(), (p - 1)*(Nx - 2) + (p - 1)*(Ny - 2) - (p - 1)*(p - 1));
+
+    //boundary values of the initial guess are Dirichlet conditions for both solvers
+    int n = localNx*localNy;
+    double* b = new double[n];
+    double* x = new double[n];
+    double* xRef = new double[n];
+    for (int i = 0; i < localNx; ++i) {
+        for (int j = 0; j < localNy; ++j) {
+            double gx = (i + xStart)*dx;
+            double gy = (j + yStart)*dy;
+            b[IDX(i,j)] = sin(3.0*M_PI*gx) * cos(2.0*M_PI*gy) + gx*gy;
+            x[IDX(i,j)] = gx + 2.0*gy;
+        }
+    }
+    std::copy(x, x+n, xRef);
+
+    SolverCG cg(localNx,localNy,dx,dy,row,col,grid);
+    cg.SetVerbose(false);
+    cg.SetTolerance(1e-11);
+    cg.Solve(b, xRef);
+    schur.SetVerbose(false);
+    schur.Solve(b, x);
+    BOOST_CHECK_EQUAL(schur.GetIterations(), 1);
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(x[i] - xRef[i], 1e-9);
+
+    //factors are reused by every solve
+    for(int i = 0; i < n; ++i)
+        b[i] *= 2.0;
+    std::fill(x, x+n, 0.0);
+    std::fill(xRef, xRef+n, 0.0);
+    cg.Solve(b, xRef);
+    schur.Solve(b, x);
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(x[i] - xRef[i], 1e-9);
+
+    //registered as a backend, and selectable for the cavity
+    PoissonSolver* created = PoissonSolver::Create("schur", problem);
+    BOOST_CHECK(created != nullptr);
+    delete created;
+
+    LidDrivenCavity direct;
+    LidDrivenCavity iterative;
+    LidDrivenCavity* solvers[2] = {&direct, &iterative};
+    std::string names[2] = {"schur", "pcg"};
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->SetDomainSize(1.0,1.0);
+        solvers[k]->SetGridSize(Nx,Nx);
+        solvers[k]->SetTimeStep(0.005);
+        solvers[k]->SetFinalTime(0.05);
+        solvers[k]->SetReynoldsNumber(100);
+        solvers[k]->SetVerbose(false);
+        BOOST_CHECK(solvers[k]->SetPoissonSolver(names[k]));
+        solvers[k]->Initialise();
+        BOOST_CHECK_EQUAL(solvers[k]->GetPoissonSolver(), names[k]);
+        solvers[k]->Integrate();
+    }
+    int npts = direct.GetNpts();
+    double* v = new double[npts];
+    double* s = new double[npts];
+    double* vRef = new double[npts];
+    double* sRef = new double[npts];
+    direct.GetState(v,s);
+    iterative.GetState(vRef,sRef);
+
+    //only the conjugate gradient tolerance separates them
+    for(int i = 0; i < npts; ++i) {
+        BOOST_CHECK_SMALL(v[i] - vRef[i], 1e-5);
+        BOOST_CHECK_SMALL(s[i] - sRef[i], 1e-7);
+    }
+
+    delete[] b;
+    delete[] x;
+    delete[] xRef;
+    delete[] v;
+    delete[] s;
+    delete[] vRef;
+    delete[] sRef;
+    MPI_Comm_free(&grid);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+}
+
+/**
+ * @test Tests that implicit time stepping follows the explicit scheme below its time step restriction and stays bounded above it
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Implicit_CrankNicolson)
+{
+    const int Nx = 33;
+    double dx = 1.0/(Nx - 1);
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double dIgnore;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Nx, 1.0, 1.0, localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+
+    //a grid mode of the operator is scaled by the inverse of its shifted eigenvalue
+    const double sigma = 50.0;
+    double lambda = 8.0/dx/dx*pow(sin(0.5*M_PI*dx), 2);
+    int n = localNx*localNy;
+    double* b = new double[n];
+    double* x = new double[n]();
+    for (int i = 0; i < localNx; ++i) {
+        for (int j = 0; j < localNy; ++j)
+            b[IDX(i,j)] = sin(M_PI*(i + xStart)*dx) * sin(M_PI*(j + yStart)*dx);
+    }
+    SolverCG shifted(localNx,localNy,dx,dx,row,col,grid);
+    shifted.SetVerbose(false);
+    shifted.SetTolerance(1e-12);
+    shifted.SetShift(sigma);
+    shifted.Solve(b, x);
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(x[i] - b[i]/(sigma + lambda), 1e-10);
+
+    //below the explicit limit both schemes take the same path, apart from the first order error of the explicit scheme
+    LidDrivenCavity implicit;
+    LidDrivenCavity explicitScheme;
+    LidDrivenCavity* solvers[2] = {&implicit, &explicitScheme};
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->SetDomainSize(1.0,1.0);
+        solvers[k]->SetGridSize(Nx,Nx);
+        solvers[k]->SetTimeStep(0.005);
+        solvers[k]->SetFinalTime(0.1);
+        solvers[k]->SetReynoldsNumber(100);
+        solvers[k]->SetVerbose(false);
+    }
+    implicit.SetImplicit(0.5, 1e-8);
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->Initialise();
+        solvers[k]->Integrate();
+    }
+    BOOST_CHECK(implicit.GetNewtonIterations() > 0);
+
+    int npts = implicit.GetNpts();
+    double* v = new double[npts];
+    double* s = new double[npts];
+    double* vRef = new double[npts];
+    double* sRef = new double[npts];
+    implicit.GetState(v,s);
+    explicitScheme.GetState(vRef,sRef);
+    //the vorticity is largest at the lid corners, where the difference is too
+    for(int i = 0; i < npts; ++i) {
+        BOOST_CHECK_SMALL(v[i] - vRef[i], 0.5);
+        BOOST_CHECK_SMALL(s[i] - sRef[i], 1e-3);
+    }
+
+    //four times the explicit limit stays bounded, and every step converges
+    implicit.SetTimeStep(0.1);
+    implicit.SetFinalTime(1.0);
+    implicit.Initialise();
+    implicit.Integrate();
+    BOOST_CHECK(implicit.GetNewtonIterations() > 0);
+    implicit.GetState(v,s);
+    for(int i = 0; i < npts; ++i) {
+        BOOST_CHECK(std::isfinite(v[i]) && (fabs(v[i]) < 100.0));
+        BOOST_CHECK(std::isfinite(s[i]) && (fabs(s[i]) < 0.2));
+    }
+
+    delete[] b;
+    delete[] x;
+    delete[] v;
+    delete[] s;
+    delete[] vRef;
+    delete[] sRef;
+    MPI_Comm_free(&grid);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+}
+
+/**
+ * @test Tests that a spent budget or a signal stops all processes at one time step, with a checkpoint to resume from
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(Deadline_StopAndResume)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //a budget that is already spent is noticed at the first step, and agreed on at the second
+    LidDrivenCavity stopped;
+    stopped.SetDomainSize(1.0,1.0);
+    stopped.SetGridSize(21,21);
+    stopped.SetTimeStep(0.005);
+    stopped.SetFinalTime(0.5);
+    stopped.SetReynoldsNumber(100);
+    stopped.SetVerbose(false);
+    stopped.SetCheckpoint(0,0,"nonexistent_dir");
+    stopped.SetWalltime(1e-9, 0.0);
+    stopped.Initialise();
+    stopped.Integrate();
+    BOOST_CHECK(stopped.IsStopped());
+    BOOST_CHECK_EQUAL(stopped.GetStep(), 2);
+    BOOST_CHECK_EQUAL(stopped.GetStopReason(), "wall-clock budget");
+
+    //without a budget, the checkpoint of the stopped step is resumed from the resume directory, not the node-local one
+    LidDrivenCavity resumed;
+    resumed.SetDomainSize(1.0,1.0);
+    resumed.SetGridSize(21,21);
+    resumed.SetTimeStep(0.005);
+    resumed.SetFinalTime(0.5);
+    resumed.SetReynoldsNumber(100);
+    resumed.SetVerbose(false);
+    resumed.SetCheckpoint(0,0,"nonexistent_dir");
+    resumed.Initialise();
+    BOOST_REQUIRE(resumed.RecoverCheckpoint());
+    BOOST_CHECK_EQUAL(resumed.GetStep(), 2);
+
+    int npts = stopped.GetNpts();
+    double* v = new double[npts];
+    double* s = new double[npts];
+    double* vRef = new double[npts];
+    double* sRef = new double[npts];
+    stopped.GetState(vRef,sRef);
+    resumed.GetState(v,s);
+    for(int i = 0; i < npts; ++i) {
+        BOOST_CHECK_EQUAL(v[i], vRef[i]);
+        BOOST_CHECK_EQUAL(s[i], sRef[i]);
+    }
+    resumed.IntegrateTo(5);
+    BOOST_CHECK(!resumed.IsStopped());
+
+    //nothing to resume from elsewhere
+    LidDrivenCavity missing;
+    missing.SetDomainSize(1.0,1.0);
+    missing.SetGridSize(21,21);
+    missing.SetTimeStep(0.005);
+    missing.SetFinalTime(0.5);
+    missing.SetReynoldsNumber(100);
+    missing.SetVerbose(false);
+    missing.SetCheckpoint(0,0,"nonexistent_dir");
+    missing.SetResumeDir("nonexistent_dir");
+    missing.Initialise();
+    BOOST_CHECK(!missing.RecoverCheckpoint());
+    BOOST_CHECK_EQUAL(resumed.GetStep(), 5);
+
+    //a signal to one process stops all of them one step later
+    MPI_Comm world = MPI_COMM_WORLD;
+    Deadline deadline(world, 0.0, 0.0);
+    BOOST_CHECK(!deadline.Update());
+    Deadline::InstallSignalHandlers();
+    if(rank == 0)
+        raise(SIGUSR1);
+    BOOST_CHECK(!deadline.Update());
+    BOOST_CHECK(deadline.Update());
+    BOOST_CHECK_EQUAL(deadline.GetReason(), Deadline::Signal);
+    BOOST_CHECK_EQUAL(deadline.GetStopSignal(), SIGUSR1);
+
+    delete[] v;
+    delete[] s;
+    delete[] vRef;
+    delete[] sRef;
+}
+
+/**
+ * @test Tests that SolverCGTiled splits a wider local domain more along x and solves as SolverCG does, in the same order every time
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(SolverCGTiled_Subdomains)
+{
+    const int Nx = 41;
+    const int Ny = 37;
+    double dx = 1.0/(Nx - 1);
+    double dy = 1.5/(Ny - 1);
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double dIgnore;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Ny, 1.0, 1.5, localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+    PoissonProblem problem = {localNx, localNy, dx, dy, xStart, yStart, Nx, Ny, 0, grid, row, col};
+
+    //tiles of a wider domain are split more along x, and only exist with concurrent MPI calls from all threads
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+    int provided;
+    MPI_Query_thread(&provided);
+    SolverCGTiled tiled(problem);
+    BOOST_REQUIRE_EQUAL(tiled.IsUsable(), provided == MPI_THREAD_MULTIPLE);
+    if(!tiled.IsUsable()) {
+        omp_set_num_threads(threads);
+        MPI_Comm_free(&grid);
+        MPI_Comm_free(&row);
+        MPI_Comm_free(&col);
+        return;
+    }
+    BOOST_CHECK_EQUAL(tiled.GetThreads(), 4);
+    BOOST_CHECK_EQUAL(tiled.GetTilesX(), 2);
+    BOOST_CHECK_EQUAL(tiled.GetTilesY(), 2);
+
+    //boundary values of the initial guess are Dirichlet conditions for both solvers
+    int n = localNx*localNy;
+    double* b = new double[n];
+    double* x = new double[n];
+    double* xRef = new double[n];
+    for (int i = 0; i < localNx; ++i) {
+        for (int j = 0; j < localNy; ++j) {
+            double gx = (i + xStart)*dx;
+            double gy = (j + yStart)*dy;
+            b[IDX(i,j)] = sin(3.0*M_PI*gx) * cos(2.0*M_PI*gy) + gx*gy;
+            x[IDX(i,j)] = gx + 2.0*gy;
+        }
+    }
+    std::copy(x, x+n, xRef);
+
+    //same iteration in exact arithmetic, only the order of the sums differs
+    SolverCG cg(localNx,localNy,dx,dy,row,col,grid);
+    cg.SetVerbose(false);
+    cg.SetTolerance(1e-11);
+    cg.Solve(b, xRef);
+    tiled.SetVerbose(false);
+    tiled.SetTolerance(1e-11, 0.0, 0.0);
+    tiled.Solve(b, x);
+    BOOST_CHECK_LT(tiled.GetResidual(), 1e-11);
+    BOOST_CHECK_LE(abs(tiled.GetIterations() - cg.GetIterations()), 2);
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_SMALL(x[i] - xRef[i], 1e-9);
+
+    //threads only synchronise with their neighbours and the reductions, yet every solve sums in the same order
+    double* xAgain = new double[n];
+    for (int i = 0; i < localNx; ++i)
+        for (int j = 0; j < localNy; ++j)
+            xAgain[IDX(i,j)] = (i + xStart)*dx + 2.0*(j + yStart)*dy;
+    int iterations = tiled.GetIterations();
+    tiled.Solve(b, xAgain);
+    BOOST_CHECK_EQUAL(tiled.GetIterations(), iterations);
+    BOOST_CHECK(std::equal(x, x+n, xAgain));
+    delete[] xAgain;
+
+    //zero right hand side is solved without iterating
+    std::fill(b, b+n, 0.0);
+    tiled.Solve(b, x);
+    BOOST_CHECK_EQUAL(tiled.GetIterations(), 0);
+    for(int i = 0; i < n; ++i)
+        BOOST_CHECK_EQUAL(x[i], 0.0);
+
+    //selectable for the cavity, where it follows the solver on all processes
+    LidDrivenCavity tiledCavity;
+    LidDrivenCavity iterative;
+    LidDrivenCavity* solvers[2] = {&tiledCavity, &iterative};
+    std::string names[2] = {"pcg-tiled", "pcg"};
+    for(int k = 0; k < 2; ++k) {
+        solvers[k]->SetDomainSize(1.0,1.0);
+        solvers[k]->SetGridSize(Nx,Nx);
+        solvers[k]->SetTimeStep(0.005);
+        solvers[k]->SetFinalTime(0.05);
+        solvers[k]->SetReynoldsNumber(100);
+        solvers[k]->SetVerbose(false);
+        BOOST_CHECK(solvers[k]->SetPoissonSolver(names[k]));
+        solvers[k]->Initialise();
+        BOOST_CHECK_EQUAL(solvers[k]->GetPoissonSolver(), names[k]);
+        solvers[k]->Integrate();
+    }
+    int npts = iterative.GetNpts();
+    double* v = new double[npts];
+    double* s = new double[npts];
+    double* vRef = new double[npts];
+    double* sRef = new double[npts];
+    tiledCavity.GetState(v,s);
+    iterative.GetState(vRef,sRef);
+    for(int i = 0; i < npts; ++i) {
+        BOOST_CHECK_SMALL(v[i] - vRef[i], 1e-5);
+        BOOST_CHECK_SMALL(s[i] - sRef[i], 1e-7);
+    }
+
+    omp_set_num_threads(threads);
+    delete[] b;
+    delete[] x;
+    delete[] xRef;
+    delete[] v;
+    delete[] s;
+    delete[] vRef;
+    delete[] sRef;
+    MPI_Comm_free(&grid);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+}
+
+/**
+ * @test Tests that StreamingPOD finds orthonormal modes of snapshots of rank 3 that reproduce them, and writes them to a file
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(StreamingPOD_Incremental)
+{
+    const int Nx = 41;
+    const int Ny = 37;
+    const int snapshots = 14;
+    double dx = 1.0/(Nx - 1);
+    double dy = 1.0/(Ny - 1);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_Comm grid,row,col;
+    int localNx,localNy,xStart,yStart;
+    double dIgnore;
+    CreateCartGridVerify(grid,row,col);
+    SplitDomainMPIVerify(grid, Nx, Ny, 1.0, 1.0, localNx,localNy,dIgnore,dIgnore,xStart,yStart);
+    int n = localNx*localNy;
+
+    //three travelling and decaying structures, so the snapshots have rank 3 whatever their number
+    double* data = new double[n*snapshots];
+    for(int k = 0; k < snapshots; ++k) {
+        double t = 0.1*k;
+        for (int i = 0; i < localNx; ++i) {
+            for (int j = 0; j < localNy; ++j) {
+                double gx = (i + xStart)*dx;
+                double gy = (j + yStart)*dy;
+                data[k*n + IDX(i,j)] = cos(2.0*t)*sin(M_PI*gx)*sin(M_PI*gy) + exp(-t)*sin(2.0*M_PI*gx)*sin(M_PI*gy)
+                                     + 0.1*t*gx*gy;
+            }
+        }
+    }
+
+    //batches of 3 leave a partial batch, folded in on request
+    StreamingPOD pod(5, 3, Nx, Ny, xStart, yStart, localNx, localNy, grid);
+    for(int k = 0; k < snapshots; ++k)
+        pod.Add(data + k*n, 0.1*k);
+    BOOST_CHECK_EQUAL(pod.GetSnapshots(), 12);
+    pod.Update();
+    BOOST_REQUIRE_EQUAL(pod.GetSnapshots(), snapshots);
+    BOOST_REQUIRE_EQUAL(pod.GetModes(), 3);
+    const double* sigma = pod.GetSingularValues();
+    BOOST_CHECK(sigma[0] >= sigma[1] && sigma[1] >= sigma[2] && sigma[2] > 0.0);
+
+    //modes are orthonormal over all processes, and the energy of the snapshots is kept
+    double gram[9];
+    for(int a = 0; a < 3; ++a)
+        for(int b = 0; b < 3; ++b)
+            gram[3*a + b] = cblas_ddot(n, pod.GetMode(a), 1, pod.GetMode(b), 1);
+    MPI_Allreduce(MPI_IN_PLACE, gram, 9, MPI_DOUBLE, MPI_SUM, grid);
+    for(int a = 0; a < 3; ++a)
+        for(int b = 0; b < 3; ++b)
+            BOOST_CHECK_SMALL(gram[3*a + b] - ((a == b) ? 1.0 : 0.0), 1e-10);
+    double energy = cblas_ddot(n*snapshots, data, 1, data, 1);
+    MPI_Allreduce(MPI_IN_PLACE, &energy, 1, MPI_DOUBLE, MPI_SUM, grid);
+    BOOST_CHECK_CLOSE(sigma[0]*sigma[0] + sigma[1]*sigma[1] + sigma[2]*sigma[2], energy, 1e-8);
+
+    //every snapshot is recovered from its coefficients
+    for(int k = 0; k < snapshots; ++k) {
+        for(int i = 0; i < n; ++i) {
+            double x = 0.0;
+            for(int l = 0; l < 3; ++l)
+                x += pod.GetCoefficient(k, l)*pod.GetMode(l)[i];
+            BOOST_CHECK_SMALL(x - data[k*n + i], 1e-10);
+        }
+    }
+
+    //file holds the modes as global fields, written by each process into its local domain
+    pod.Write("pod_test.bin", 7, 0.7);
+    std::ifstream in("pod_test.bin", std::ios::binary);
+    BOOST_REQUIRE(in.good());
+    PODFileHeader header;
+    in.read((char*) &header, sizeof(header));
+    BOOST_CHECK_EQUAL(std::string(header.magic, 8), "LDCPOD01");
+    BOOST_CHECK_EQUAL(header.globalNx, Nx);
+    BOOST_CHECK_EQUAL(header.modes, 3);
+    BOOST_CHECK_EQUAL(header.snapshots, snapshots);
+    BOOST_CHECK_EQUAL(header.step, 7);
+    std::vector<double> values(3 + snapshots + 3*snapshots + 3*Nx*Ny);
+    in.read((char*) values.data(), values.size()*sizeof(double));
+    BOOST_REQUIRE(in.good());
+    BOOST_CHECK_EQUAL(values[0], sigma[0]);
+    BOOST_CHECK_EQUAL(values[3 + 1], 0.1);
+    BOOST_CHECK_EQUAL(values[3 + snapshots + 3*2 + 1], pod.GetCoefficient(2, 1));
+    const double* fields = values.data() + 3 + 4*snapshots;
+    for(int l = 0; l < 3; ++l)
+        for (int i = 0; i < localNx; ++i)
+            for (int j = 0; j < localNy; ++j)
+                BOOST_CHECK_EQUAL(fields[l*Nx*Ny + (j + yStart)*Nx + i + xStart], pod.GetMode(l)[IDX(i,j)]);
+    in.close();
+    MPI_Barrier(grid);
+    if(rank == 0)
+        std::remove("pod_test.bin");
+
+    //the cavity adds its vorticity every interval and writes the file once at the end
+    LidDrivenCavity cavity;
+    cavity.SetDomainSize(1.0,1.0);
+    cavity.SetGridSize(Nx,Nx);
+    cavity.SetTimeStep(0.005);
+    cavity.SetFinalTime(0.05);
+    cavity.SetReynoldsNumber(100);
+    cavity.SetVerbose(false);
+    cavity.SetPOD(4, "pod_cavity.bin", 2, 0);
+    cavity.Initialise();
+    BOOST_REQUIRE(cavity.GetPOD() != nullptr);
+    cavity.Integrate();
+    cavity.WritePOD();
+    BOOST_CHECK_EQUAL(cavity.GetPOD()->GetSnapshots(), 5);
+    BOOST_CHECK_GT(cavity.GetPOD()->GetModes(), 0);
+    MPI_Barrier(grid);
+    if(rank == 0)
+        std::remove("pod_cavity.bin");
+
+    delete[] data;
+    MPI_Comm_free(&grid);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+}
+
+/**
+ * @test Tests that CavityConfig::Validate reports invalid parameters, and that Configure sets up the problem as the setters do
+ *********************************************************************************************************************/
+BOOST_AUTO_TEST_CASE(CavityConfig_Validate)
+{
+    //defaults are valid on one process, each invalid parameter is reported without any communication
+    CavityConfig config;
+    BOOST_CHECK(config.Validate(1).empty());
+    BOOST_CHECK(!CavityConfig(0.0).Validate(1).empty());
+    BOOST_CHECK(!CavityConfig(1.0,1.0,9,2).Validate(1).empty());
+    BOOST_CHECK(!config.Validate(19).empty());                                      //more than 2*Nx processes along a direction
+    BOOST_CHECK(!config.FitsProcesses(19));
+    BOOST_CHECK(config.FitsProcesses(18));
+    BOOST_CHECK(!CavityConfig(1.0,1.0,9,9,-0.01).Validate(1).empty());
+    BOOST_CHECK(!CavityConfig(1.0,1.0,9,9,0.01,1.0,0.0).Validate(1).empty());
+    BOOST_CHECK(!CavityConfig(1.0,1.0,9,9,0.01,1.0,10,1.5).Validate(1).empty());
+
+    //unstable explicit time step, lifted from Crank-Nicolson on
+    CavityConfig unstable(1.0,1.0,65,65,0.01,1.0,100);
+    BOOST_CHECK_CLOSE(unstable.GetMaxTimeStep(), 0.25*100/(64.0*64.0), 1e-10);
+    BOOST_CHECK(unstable.Validate(1).find("Time-step restriction") != std::string::npos);
+    BOOST_CHECK(CavityConfig(1.0,1.0,65,65,0.01,1.0,100,0.5).Validate(1).empty());
+
+    //one configuration gives the same problem as the setters, and the local domain is split when first needed
+    MPI_Comm grid,row,col;
+    int localNx,localNy,iIgnore;
+    double localLx,localLy;
+    CreateCartGridVerify(grid,row,col);
+    const CavityConfig implicit(2.2,3.3,33,17,0.001,0.01,100,0.5);
+    SplitDomainMPIVerify(grid,implicit.GetNx(),implicit.GetNy(),implicit.GetLx(),implicit.GetLy(),localNx,localNy,localLx,localLy,
+                         iIgnore,iIgnore);
+
+    LidDrivenCavity configured;
+    configured.Configure(implicit);
+    configured.SetVerbose(false);
+    BOOST_CHECK_EQUAL(configured.GetGlobalNx(), 33);
+    BOOST_CHECK_CLOSE(configured.GetDx(), 2.2/32, 1e-10);
+    BOOST_CHECK_EQUAL(configured.GetDt(), 0.001);
+    BOOST_CHECK_EQUAL(configured.GetNx(), localNx);
+    BOOST_CHECK_EQUAL(configured.GetNy(), localNy);
+    BOOST_CHECK_CLOSE(configured.GetLy(), localLy, 1e-10);
+    BOOST_CHECK_EQUAL(configured.GetConfig().GetTheta(), 0.5);
+
+    LidDrivenCavity set;
+    set.SetDomainSize(implicit.GetLx(),implicit.GetLy());
+    set.SetGridSize(implicit.GetNx(),implicit.GetNy());
+    set.SetTimeStep(implicit.GetDt());
+    set.SetFinalTime(implicit.GetT());
+    set.SetReynoldsNumber(implicit.GetRe());
+    set.SetImplicit(implicit.GetTheta());
+    set.SetVerbose(false);
+
+    configured.Initialise();
+    configured.Integrate();
+    set.Initialise();
+    set.Integrate();
+    int n = set.GetNpts();
+    BOOST_REQUIRE_EQUAL(configured.GetNpts(), n);
+    double* v1 = new double[n];
+    double* s1 = new double[n];
+    double* v2 = new double[n];
+    double* s2 = new double[n];
+    configured.GetData(v1,s1);
+    set.GetData(v2,s2);
+    for(int i = 0; i < n; ++i) {
+        BOOST_CHECK_EQUAL(v1[i], v2[i]);
+        BOOST_CHECK_EQUAL(s1[i], s2[i]);
+    }
+
+    delete[] v1;
+    delete[] s1;
+    delete[] v2;
+    delete[] s2;
+    MPI_Comm_free(&grid);
+    MPI_Comm_free(&row);
+    MPI_Comm_free(&col);
+}